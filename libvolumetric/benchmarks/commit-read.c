@@ -0,0 +1,243 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            commit-read.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Measure the rate at which commits read file data into the
+//                  archive writer, against the 4 KiB read loop it replaced.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+// Usage: commit-read [DIRECTORY]
+//
+// Writes a tree of many small files and a tree of a few large ones into a
+// temporary directory beneath DIRECTORY (or $TMPDIR), then archives each one
+// into an uncompressed tar stream that's discarded, with each read loop in
+// turn. Compression is left out, so that the rate is that of the input path.
+// The trees are read from the page cache, after a pass to warm it up, and
+// the median of several runs is reported.
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <archive.h>
+#include <archive_entry.h>
+#include <glib-2.0/glib.h>
+
+#include <volumetric/volume/archive/commit-input.h>
+
+#define RUNS 7
+
+// The trees archived
+typedef struct BenchmarkTree {
+    const char* name;
+    unsigned int files;
+    size_t file_size;
+} BenchmarkTree;
+
+static const BenchmarkTree TREES[] = {
+    {"small", 20000, 4 * 1024},
+    {"large", 4, 128 * 1024 * 1024},
+};
+
+typedef struct ReadLoop {
+    const char* name;
+    // Bytes per block of the archive writer, or -1 for libarchive's default.
+    int bytes_per_block;
+    int (*write_file)(struct archive* writer, int fd, size_t size,
+                      CommitInput* input);
+} ReadLoop;
+
+///////////////////////////////////////////////////////////////////////////////
+// Read Loops
+////
+
+// The loop commits used before: 4 KiB reads, copied into the writer's 10 KiB
+// records.
+static int write_file_4k(struct archive* writer, int fd, size_t size,
+                         CommitInput* input __attribute__((unused))) {
+    char block[4096];
+    off_t offset = 0;
+    while (0 < size) {
+        size_t wanted = MIN(size, sizeof(block));
+        ssize_t bytes_read = pread(fd, block, wanted, offset);
+        if (0 >= bytes_read) {
+            return 0 == bytes_read ? 0 : -errno;
+        }
+        archive_write_data(writer, block, bytes_read);
+        offset += bytes_read;
+        size -= bytes_read;
+    }
+    return 0;
+}
+
+// The loop commits use now, from commit-input.h.
+static int write_file_blocks(struct archive* writer, int fd, size_t size,
+                             CommitInput* input) {
+    commit_input_advise(fd, size);
+    return commit_input_write_data(input, writer, fd, 0, size);
+}
+
+static const ReadLoop READ_LOOPS[] = {
+    {"4 KiB loop", -1, write_file_4k},
+    {"block reads", 0, write_file_blocks},
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Benchmark
+////
+
+static la_ssize_t discard_archive(struct archive* archive
+                                  __attribute__((unused)),
+                                  void* user_data __attribute__((unused)),
+                                  const void* buffer __attribute__((unused)),
+                                  size_t length) {
+    return length;
+}
+
+// Write the files of <tree> into <directory>.
+static void tree_create(const BenchmarkTree* tree, const char* directory) {
+    GByteArray* contents = g_byte_array_sized_new(tree->file_size);
+    g_byte_array_set_size(contents, tree->file_size);
+    for (size_t i = 0; i < tree->file_size; ++i) {
+        contents->data[i] = (guint8)rand();
+    }
+
+    int result = mkdir(directory, 0755);
+    assert(0 == result);
+    for (unsigned int i = 0; i < tree->files; ++i) {
+        char* path = g_strdup_printf("%s/%u", directory, i);
+        gboolean written = g_file_set_contents(
+            path, (const gchar*)contents->data, contents->len, NULL);
+        assert(written);
+        g_free(path);
+    }
+    g_byte_array_unref(contents);
+}
+
+static void tree_remove(const BenchmarkTree* tree, const char* directory) {
+    for (unsigned int i = 0; i < tree->files; ++i) {
+        char* path = g_strdup_printf("%s/%u", directory, i);
+        unlink(path);
+        g_free(path);
+    }
+    rmdir(directory);
+}
+
+// Archive the files of <tree> in <directory> with <loop>. Returns the time
+// taken, in seconds.
+static double tree_archive(const BenchmarkTree* tree, const char* directory,
+                           const ReadLoop* loop) {
+    struct archive* writer = archive_write_new();
+    archive_write_set_format_pax_restricted(writer);
+    archive_write_add_filter_none(writer);
+    if (0 <= loop->bytes_per_block) {
+        archive_write_set_bytes_per_block(writer, loop->bytes_per_block);
+    }
+    int result = archive_write_open(writer, NULL, NULL, discard_archive, NULL);
+    assert(ARCHIVE_OK == result);
+
+    CommitInput input = {0};
+    struct timespec start = {0};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned int i = 0; i < tree->files; ++i) {
+        char* path = g_strdup_printf("%s/%u", directory, i);
+        int fd = open(path, O_RDONLY);
+        assert(0 <= fd);
+        struct stat file_stat = {0};
+        fstat(fd, &file_stat);
+
+        struct archive_entry* entry = archive_entry_new();
+        archive_entry_set_pathname(entry, path);
+        archive_entry_copy_stat(entry, &file_stat);
+        archive_write_header(writer, entry);
+        result = loop->write_file(writer, fd, file_stat.st_size, &input);
+        assert(0 == result);
+        archive_write_finish_entry(writer);
+
+        archive_entry_free(entry);
+        close(fd);
+        g_free(path);
+    }
+    archive_write_close(writer);
+    struct timespec end = {0};
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    archive_write_free(writer);
+    commit_input_release(&input);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static int compare_doubles(const void* first, const void* second) {
+    double difference = *(const double*)first - *(const double*)second;
+    return (0 < difference) - (0 > difference);
+}
+
+int main(int argc, char** argv) {
+    const char* parent = 1 < argc ? argv[1] : g_get_tmp_dir();
+    char* template = g_build_filename(parent, "commit-read-XXXXXX", NULL);
+    char* directory = g_mkdtemp(template);
+    if (NULL == directory) {
+        fprintf(stderr, "Couldn't create a directory in %s: %s\n", parent,
+                strerror(errno));
+        g_free(template);
+        return 1;
+    }
+
+    printf("%-8s %-12s %10s\n", "tree", "read loop", "MB/s");
+    for (size_t i = 0; i < G_N_ELEMENTS(TREES); ++i) {
+        const BenchmarkTree* tree = &TREES[i];
+        char* tree_directory = g_build_filename(directory, tree->name, NULL);
+        tree_create(tree, tree_directory);
+        double bytes = (double)tree->files * tree->file_size;
+
+        for (size_t j = 0; j < G_N_ELEMENTS(READ_LOOPS); ++j) {
+            tree_archive(tree, tree_directory, &READ_LOOPS[j]);
+            double seconds[RUNS];
+            for (int run = 0; run < RUNS; ++run) {
+                seconds[run] =
+                    tree_archive(tree, tree_directory, &READ_LOOPS[j]);
+            }
+
+            qsort(seconds, RUNS, sizeof(seconds[0]), compare_doubles);
+            printf("%-8s %-12s %10.0f\n", tree->name, READ_LOOPS[j].name,
+                   bytes / seconds[RUNS / 2] / 1e6);
+        }
+
+        tree_remove(tree, tree_directory);
+        g_free(tree_directory);
+    }
+
+    rmdir(directory);
+    g_free(directory);
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,636 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            docker-proxy.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Tests for the Docker proxy and the archive transport,
+//                  against a mock daemon on a unix socket.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <glib-2.0/glib.h>
+
+#include <zstd.h>
+
+#include <volumetric/docker.h>
+#include <volumetric/file.h>
+#include <volumetric/volume/archive.h>
+#include <volumetric/volume/archive/transport.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Mock Daemon
+////
+
+// Routes for the helper container of a volume act on the state of the
+// daemon, rather than only responding.
+typedef enum MockAction {
+    MOCK_RESPOND,
+    // Create the helper container, unless the image is "missing".
+    MOCK_CREATE,
+    MOCK_START,
+    // Replace the contents of the volume with the request body.
+    MOCK_PUT_VOLUME,
+    // Respond with the contents of the volume.
+    MOCK_GET_VOLUME,
+    MOCK_REMOVE,
+} MockAction;
+
+// The response to a request, selected by its method and target.
+typedef struct MockRoute {
+    const char* method;
+    const char* target;
+    int status;
+    const char* body;
+    MockAction action;
+} MockRoute;
+
+static const MockRoute MOCK_ROUTES[] = {
+    {"POST", "/containers/running/pause", 204, NULL},
+    {"POST", "/containers/running/unpause", 204, NULL},
+    {"POST", "/containers/missing/pause", 404,
+     "{\"message\":\"No such container: missing\"}"},
+    {"POST", "/containers/paused/pause", 409,
+     "{\"message\":\"Container paused is already paused\"}"},
+    {"POST", "/containers/broken/unpause", 500,
+     "{\"message\":\"Cannot unpause container broken\"}"},
+    {"PUT", "/containers/helper/archive?path=%2Fvolume", 200, NULL},
+    {"GET", "/containers/helper/archive?path=%2Fvolume", 200,
+     "the tar stream"},
+    {"GET", "/containers/missing/archive?path=%2Fvolume", 404,
+     "{\"message\":\"No such container: missing\"}"},
+    {"DELETE", "/containers/helper?force=true", 204, NULL},
+    {"POST", "/containers/create", 201, "{\"Id\":\"volume-helper\"}",
+     MOCK_CREATE},
+    {"POST", "/containers/volume-helper/start", 204, NULL, MOCK_START},
+    {"PUT", "/containers/volume-helper/archive?path=%2Fvolume", 200, NULL,
+     MOCK_PUT_VOLUME},
+    {"GET", "/containers/volume-helper/archive?path=%2Fvolume", 200, NULL,
+     MOCK_GET_VOLUME},
+    {"DELETE", "/containers/volume-helper?force=true", 204, NULL,
+     MOCK_REMOVE},
+    {"PUT", "/containers/broken/archive?path=%2Fvolume", 500,
+     "{\"message\":\"Cannot extract archive\"}"},
+};
+
+// The helper container of a volume.
+typedef struct MockHelper {
+    bool created;
+    bool started;
+    // The volume, as the tar archive last put into it
+    GString* volume;
+} MockHelper;
+
+// The last request the daemon received.
+typedef struct MockRequest {
+    char method[16];
+    char target[256];
+    char content_type[64];
+    GString* body;
+} MockRequest;
+
+typedef struct MockDaemon {
+    char* directory;
+    char* socket_path;
+    int listener;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    MockRequest request;
+    MockHelper helper;
+} MockDaemon;
+
+static const MockRoute* mock_route_find(const char* method,
+                                        const char* target) {
+    for (size_t i = 0; i < G_N_ELEMENTS(MOCK_ROUTES); ++i) {
+        if (!strcmp(MOCK_ROUTES[i].method, method) &&
+            !strcmp(MOCK_ROUTES[i].target, target)) {
+            return &MOCK_ROUTES[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Read from <connection> until <message> holds at least <length> bytes.
+static bool mock_read_at_least(int connection, GString* message,
+                               size_t length) {
+    char buffer[4096];
+    while (message->len < length) {
+        ssize_t bytes_read = read(connection, buffer, sizeof(buffer));
+        if (0 >= bytes_read) {
+            return false;
+        }
+        g_string_append_len(message, buffer, bytes_read);
+    }
+
+    return true;
+}
+
+// Read from <connection> until <message> contains <delimiter>, starting at
+// <offset>. Returns the offset of the delimiter, or -1.
+static gssize mock_read_until(int connection, GString* message, size_t offset,
+                              const char* delimiter) {
+    for (;;) {
+        const char* found = g_strstr_len(message->str + offset,
+                                         message->len - offset, delimiter);
+        if (NULL != found) {
+            return found - message->str;
+        } else if (!mock_read_at_least(connection, message,
+                                       message->len + 1)) {
+            return -1;
+        }
+    }
+}
+
+// Read the body of a request whose headers end at <offset> in <message>.
+static bool mock_read_body(int connection, GString* message, size_t offset,
+                           const char* headers, GString* body) {
+    const char* length_header = strstr(headers, "\r\nContent-Length:");
+    if (NULL != length_header) {
+        size_t length = strtoul(length_header + 17, NULL, 10);
+        if (!mock_read_at_least(connection, message, offset + length)) {
+            return false;
+        }
+        g_string_append_len(body, message->str + offset, length);
+        return true;
+    } else if (NULL == strstr(headers, "\r\nTransfer-Encoding: chunked")) {
+        return true;
+    }
+
+    for (;;) {
+        gssize line_end = mock_read_until(connection, message, offset, "\r\n");
+        if (0 > line_end) {
+            return false;
+        }
+        size_t length = strtoul(message->str + offset, NULL, 16);
+        offset = line_end + 2;
+        if (!mock_read_at_least(connection, message, offset + length + 2)) {
+            return false;
+        } else if (0 == length) {
+            return true;
+        }
+        g_string_append_len(body, message->str + offset, length);
+        offset += length + 2;
+    }
+}
+
+// The client may have hung up already, after aborting an upload.
+static void mock_write(int connection, const char* data, size_t length) {
+    while (0 < length) {
+        ssize_t written = send(connection, data, length, MSG_NOSIGNAL);
+        if (0 >= written) {
+            return;
+        }
+        data += written;
+        length -= written;
+    }
+}
+
+// Apply <action> to the helper, for a request with <body>. Routes for a
+// helper that doesn't exist (yet, or anymore) respond 404.
+static void mock_helper_act(MockHelper* helper, MockAction action,
+                            const GString* body, int* status,
+                            const char** content_type, GString* response) {
+    if (MOCK_RESPOND == action) {
+        return;
+    } else if (MOCK_CREATE == action) {
+        if (NULL != strstr(body->str, "\"missing\"")) {
+            *status = 404;
+            g_string_assign(response,
+                            "{\"message\":\"No such image: missing\"}");
+        } else {
+            helper->created = true;
+            g_string_truncate(helper->volume, 0);
+        }
+        return;
+    } else if (!helper->created) {
+        *status = 404;
+        g_string_assign(response,
+                        "{\"message\":\"No such container: volume-helper\"}");
+        return;
+    }
+
+    switch (action) {
+    case MOCK_START:
+        helper->started = true;
+        break;
+    case MOCK_PUT_VOLUME:
+        g_string_truncate(helper->volume, 0);
+        g_string_append_len(helper->volume, body->str, body->len);
+        break;
+    case MOCK_GET_VOLUME:
+        *content_type = "application/x-tar";
+        g_string_append_len(response, helper->volume->str,
+                            helper->volume->len);
+        break;
+    case MOCK_REMOVE:
+        helper->created = false;
+        helper->started = false;
+        break;
+    default:
+        break;
+    }
+}
+
+// Serve one request on <connection>, then close it.
+static void mock_daemon_serve(MockDaemon* daemon, int connection) {
+    GString* message = g_string_new(NULL);
+    GString* body = g_string_new(NULL);
+    gssize headers_end = mock_read_until(connection, message, 0, "\r\n\r\n");
+    if (0 > headers_end) {
+        g_string_free(message, TRUE);
+        g_string_free(body, TRUE);
+        close(connection);
+        return;
+    }
+
+    char* headers = g_strndup(message->str, headers_end + 2);
+    char method[16] = {0};
+    char target[256] = {0};
+    sscanf(headers, "%15s %255s", method, target);
+    char content_type[64] = {0};
+    const char* type_header = strstr(headers, "\r\nContent-Type:");
+    if (NULL != type_header) {
+        sscanf(type_header + 15, " %63[^\r]", content_type);
+    }
+    bool complete = mock_read_body(connection, message, headers_end + 4,
+                                   headers, body);
+    g_free(headers);
+    g_string_free(message, TRUE);
+
+    pthread_mutex_lock(&daemon->lock);
+    strcpy(daemon->request.method, method);
+    strcpy(daemon->request.target, target);
+    strcpy(daemon->request.content_type, content_type);
+    g_string_truncate(daemon->request.body, 0);
+    g_string_append_len(daemon->request.body, body->str, body->len);
+    pthread_mutex_unlock(&daemon->lock);
+
+    const MockRoute* route = mock_route_find(method, target);
+    int status = !complete ? 400 : NULL != route ? route->status : 404;
+    const char* content_type_out = "application/json";
+    GString* response_body = g_string_new(
+        NULL != route && NULL != route->body ? route->body : "");
+    pthread_mutex_lock(&daemon->lock);
+    if (complete && NULL != route) {
+        mock_helper_act(&daemon->helper, route->action, body, &status,
+                        &content_type_out, response_body);
+    }
+    pthread_mutex_unlock(&daemon->lock);
+    g_string_free(body, TRUE);
+
+    char* headers_out = g_strdup_printf("HTTP/1.1 %d Mock\r\n"
+                                        "Content-Type: %s\r\n"
+                                        "Content-Length: %zu\r\n"
+                                        "Connection: close\r\n"
+                                        "\r\n",
+                                        status, content_type_out,
+                                        response_body->len);
+    mock_write(connection, headers_out, strlen(headers_out));
+    mock_write(connection, response_body->str, response_body->len);
+    g_free(headers_out);
+    g_string_free(response_body, TRUE);
+    close(connection);
+}
+
+static void* mock_daemon_run(void* user_data) {
+    MockDaemon* daemon = (MockDaemon*)user_data;
+    for (;;) {
+        int connection = accept(daemon->listener, NULL, NULL);
+        if (0 > connection) {
+            return NULL;
+        }
+        mock_daemon_serve(daemon, connection);
+    }
+}
+
+static MockDaemon* mock_daemon_start() {
+    MockDaemon* daemon = g_malloc0(sizeof(MockDaemon));
+    daemon->directory = g_dir_make_tmp("volumetric-test-XXXXXX", NULL);
+    assert(NULL != daemon->directory);
+    daemon->socket_path = g_strdup_printf("%s/docker.sock", daemon->directory);
+    daemon->request.body = g_string_new(NULL);
+    daemon->helper.volume = g_string_new(NULL);
+    pthread_mutex_init(&daemon->lock, NULL);
+
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    assert(strlen(daemon->socket_path) < sizeof(address.sun_path));
+    strcpy(address.sun_path, daemon->socket_path);
+    daemon->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(0 <= daemon->listener);
+    int result =
+        bind(daemon->listener, (struct sockaddr*)&address, sizeof(address));
+    assert(0 == result);
+    result = listen(daemon->listener, 8);
+    assert(0 == result);
+
+    result = pthread_create(&daemon->thread, NULL, mock_daemon_run, daemon);
+    assert(0 == result);
+    return daemon;
+}
+
+static void mock_daemon_stop(MockDaemon* daemon) {
+    // Wakes the daemon thread from accept().
+    shutdown(daemon->listener, SHUT_RDWR);
+    pthread_join(daemon->thread, NULL);
+    close(daemon->listener);
+    unlink(daemon->socket_path);
+    rmdir(daemon->directory);
+
+    pthread_mutex_destroy(&daemon->lock);
+    g_string_free(daemon->request.body, TRUE);
+    g_string_free(daemon->helper.volume, TRUE);
+    g_free(daemon->socket_path);
+    g_free(daemon->directory);
+    g_free(daemon);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Tests
+////
+
+static int failures = 0;
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+                    #condition);                                              \
+            ++failures;                                                       \
+        }                                                                     \
+    } while (0)
+
+// Check the method and target of the last request, and that its body is
+// <body>.
+static void check_request(MockDaemon* daemon, const char* method,
+                          const char* target, const char* body) {
+    pthread_mutex_lock(&daemon->lock);
+    CHECK(!strcmp(method, daemon->request.method));
+    CHECK(!strcmp(target, daemon->request.target));
+    CHECK(!strcmp(body, daemon->request.body->str));
+    pthread_mutex_unlock(&daemon->lock);
+}
+
+static void test_pause(Docker* docker, MockDaemon* daemon) {
+    CHECK(0 == docker_container_pause(docker, "running"));
+    check_request(daemon, "POST", "/containers/running/pause", "");
+    CHECK(0 == docker_container_unpause(docker, "running"));
+    check_request(daemon, "POST", "/containers/running/unpause", "");
+}
+
+static void test_pause_error_statuses(Docker* docker, MockDaemon* daemon) {
+    CHECK(0 > docker_container_pause(docker, "missing"));
+    check_request(daemon, "POST", "/containers/missing/pause", "");
+    CHECK(0 > docker_container_pause(docker, "paused"));
+    CHECK(0 > docker_container_unpause(docker, "broken"));
+    check_request(daemon, "POST", "/containers/broken/unpause", "");
+
+    // The handle is still usable after an error.
+    CHECK(0 == docker_container_pause(docker, "running"));
+}
+
+static void test_put_archive(Docker* docker, MockDaemon* daemon) {
+    static const char archive[] = "an archive";
+    CHECK(0 == docker_container_put_archive(docker, "helper", "/volume",
+                                            archive, strlen(archive)));
+    check_request(daemon, "PUT", "/containers/helper/archive?path=%2Fvolume",
+                  archive);
+    pthread_mutex_lock(&daemon->lock);
+    CHECK(!strcmp("application/x-tar", daemon->request.content_type));
+    pthread_mutex_unlock(&daemon->lock);
+}
+
+// Produces the string in <user_data> a few bytes at a time.
+static size_t read_in_pieces(char* buffer, size_t size, size_t nitems,
+                             void* user_data) {
+    const char** remaining = (const char**)user_data;
+    size_t length = strlen(*remaining);
+    if (3 < length) {
+        length = 3;
+    }
+    if (size * nitems < length) {
+        length = size * nitems;
+    }
+
+    memcpy(buffer, *remaining, length);
+    *remaining += length;
+    return length;
+}
+
+static void test_put_archive_stream(Docker* docker, MockDaemon* daemon) {
+    const char* remaining = "a streamed archive";
+    CHECK(0 == docker_container_put_archive_stream(
+                   docker, "helper", "/volume", read_in_pieces, &remaining));
+    check_request(daemon, "PUT", "/containers/helper/archive?path=%2Fvolume",
+                  "a streamed archive");
+}
+
+static size_t append_to_string(char* buffer, size_t size, size_t nitems,
+                               void* user_data) {
+    g_string_append_len((GString*)user_data, buffer, size * nitems);
+    return size * nitems;
+}
+
+static void test_get_archive(Docker* docker, MockDaemon* daemon) {
+    GString* archive = g_string_new(NULL);
+    CHECK(0 == docker_container_get_archive(docker, "helper", "/volume",
+                                            append_to_string, archive));
+    check_request(daemon, "GET", "/containers/helper/archive?path=%2Fvolume",
+                  "");
+    CHECK(!strcmp("the tar stream", archive->str));
+
+    g_string_truncate(archive, 0);
+    CHECK(0 > docker_container_get_archive(docker, "missing", "/volume",
+                                           append_to_string, archive));
+    g_string_free(archive, TRUE);
+}
+
+// A DELETE following a POST or a PUT must not be sent with either method,
+// or with a request body.
+static void test_remove_after_post(Docker* docker, MockDaemon* daemon) {
+    CHECK(0 == docker_container_pause(docker, "running"));
+    CHECK(0 == docker_container_remove(docker, "helper"));
+    check_request(daemon, "DELETE", "/containers/helper?force=true", "");
+
+    CHECK(0 == docker_container_put_archive(docker, "helper", "/volume", "x",
+                                            1));
+    CHECK(0 == docker_container_remove(docker, "helper"));
+    check_request(daemon, "DELETE", "/containers/helper?force=true", "");
+}
+
+// Read <fd> to the end.
+static GString* read_all(int fd) {
+    GString* contents = g_string_new(NULL);
+    char buffer[4096];
+    ssize_t bytes_read = 0;
+    while (0 < (bytes_read = read(fd, buffer, sizeof(buffer)))) {
+        g_string_append_len(contents, buffer, bytes_read);
+    }
+    return contents;
+}
+
+// Receive the volume through the transport, and check that it's <expected>.
+static void check_transport_get(Docker* docker, const char* helper,
+                                const GString* expected) {
+    int fd = -1;
+    ArchiveTransportStream* stream =
+        archive_transport_get_start(docker, helper, &fd);
+    CHECK(NULL != stream);
+    if (NULL == stream) {
+        return;
+    }
+
+    GString* received = read_all(fd);
+    CHECK(0 == archive_transport_get_finish(stream));
+    CHECK(g_string_equal(expected, received));
+    g_string_free(received, TRUE);
+}
+
+// An archive put through the transport comes back unchanged, and a
+// zstd-compressed one comes back decompressed.
+static void test_transport_round_trip(Docker* docker, MockDaemon* daemon) {
+    ArchiveVolume config = {.name = "data"};
+    char* helper = archive_transport_helper_new(&config, docker);
+    CHECK(NULL != helper && !strcmp("volume-helper", helper));
+    if (NULL == helper) {
+        return;
+    }
+    pthread_mutex_lock(&daemon->lock);
+    CHECK(!strcmp("POST", daemon->request.method));
+    CHECK(!strcmp("/containers/create", daemon->request.target));
+    CHECK(NULL != strstr(daemon->request.body->str, "busybox"));
+    CHECK(NULL != strstr(daemon->request.body->str, "\"data\""));
+    CHECK(NULL != strstr(daemon->request.body->str, "\"/volume\""));
+    pthread_mutex_unlock(&daemon->lock);
+
+    // Large enough to take several reads on either side of the socket.
+    GString* archive = g_string_sized_new(1 << 20);
+    for (guint32 i = 0; archive->len < 1 << 20; ++i) {
+        g_string_append_printf(archive, "%u\n", i * 2654435761u);
+    }
+    FileContents file = {.contents = archive->str, .size = archive->len};
+    CHECK(0 == archive_transport_put(docker, helper, &file));
+    check_transport_get(docker, helper, archive);
+
+    size_t capacity = ZSTD_compressBound(archive->len);
+    void* compressed = g_malloc(capacity);
+    size_t length =
+        ZSTD_compress(compressed, capacity, archive->str, archive->len, 3);
+    assert(!ZSTD_isError(length));
+    file = (FileContents){.contents = compressed, .size = length};
+    CHECK(0 == archive_transport_put(docker, helper, &file));
+    check_transport_get(docker, helper, archive);
+
+    // The helper only holds the volume, it's never started.
+    pthread_mutex_lock(&daemon->lock);
+    CHECK(!daemon->helper.started);
+    pthread_mutex_unlock(&daemon->lock);
+
+    archive_transport_helper_free(docker, helper);
+    check_request(daemon, "DELETE", "/containers/volume-helper?force=true",
+                  "");
+    g_free(compressed);
+    g_string_free(archive, TRUE);
+}
+
+static void test_transport_errors(Docker* docker, MockDaemon* daemon) {
+    ArchiveVolume config = {.name = "data", .helper_image = "missing"};
+    CHECK(NULL == archive_transport_helper_new(&config, docker));
+
+    config.helper_image = NULL;
+    char* helper = archive_transport_helper_new(&config, docker);
+    CHECK(NULL != helper);
+    if (NULL == helper) {
+        return;
+    }
+    static const char archive[] = "an archive";
+    FileContents file = {.contents = (void*)archive, .size = strlen(archive)};
+    CHECK(0 == archive_transport_put(docker, helper, &file));
+    CHECK(0 > archive_transport_put(docker, "broken", &file));
+
+    // A truncated zstd archive is never extracted into the volume.
+    char compressed[256];
+    size_t length = ZSTD_compress(compressed, sizeof(compressed),
+                                  "a compressed archive", 20, 3);
+    assert(!ZSTD_isError(length));
+    file = (FileContents){.contents = compressed, .size = length - 4};
+    CHECK(0 > archive_transport_put(docker, helper, &file));
+    GString* expected = g_string_new(archive);
+    check_transport_get(docker, helper, expected);
+    g_string_free(expected, TRUE);
+
+    // Nothing is received from a helper that's been removed.
+    char* removed = g_strdup(helper);
+    archive_transport_helper_free(docker, helper);
+    int fd = -1;
+    ArchiveTransportStream* stream =
+        archive_transport_get_start(docker, removed, &fd);
+    CHECK(NULL != stream);
+    if (NULL != stream) {
+        GString* received = read_all(fd);
+        CHECK(0 == received->len);
+        CHECK(0 > archive_transport_get_finish(stream));
+        g_string_free(received, TRUE);
+    }
+    g_free(removed);
+    check_request(daemon, "GET",
+                  "/containers/volume-helper/archive?path=%2Fvolume", "");
+}
+
+int main() {
+    MockDaemon* daemon = mock_daemon_start();
+    char* docker_host = g_strdup_printf("unix://%s", daemon->socket_path);
+    setenv("DOCKER_HOST", docker_host, 1);
+    g_free(docker_host);
+
+    Docker* docker = docker_proxy_new();
+    assert(NULL != docker);
+    test_pause(docker, daemon);
+    test_pause_error_statuses(docker, daemon);
+    test_put_archive(docker, daemon);
+    test_put_archive_stream(docker, daemon);
+    test_get_archive(docker, daemon);
+    test_remove_after_post(docker, daemon);
+    test_transport_round_trip(docker, daemon);
+    test_transport_errors(docker, daemon);
+    docker_proxy_free(docker);
+
+    mock_daemon_stop(daemon);
+    if (0 != failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,462 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            parallel-gzip.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Round-trip tests of the parallel gzip decoder against zlib.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib-2.0/glib.h>
+#include <zlib.h>
+
+#include <volumetric/parallel-gzip.h>
+
+// The decoder splits its input into 4 MiB chunks, and only decodes in
+// parallel from the second chunk on, so most inputs compress to several
+// chunks.
+#define MiB (1024 * 1024)
+static const size_t LARGE_SIZE = 24 * MiB;
+static const unsigned int THREADS = 4;
+
+///////////////////////////////////////////////////////////////////////////////
+// Input
+////
+
+static uint64_t random_next(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// Runs of random bytes, alternating with copies of the data up to 32 KiB
+// back, so that zlib emits back-references of every distance. Many of them
+// reach across the boundaries of the decoder's chunks. Compresses to about
+// half its size.
+static GByteArray* make_input(size_t size, uint64_t seed) {
+    GByteArray* input = g_byte_array_sized_new(size);
+    g_byte_array_set_size(input, size);
+    uint64_t state = seed;
+    size_t length = 0;
+    while (length < size) {
+        size_t run = 1 + random_next(&state) % 4096;
+        run = MIN(run, size - length);
+        size_t distance = 1 + random_next(&state) % 32768;
+        if (0 == random_next(&state) % 2 || distance > length) {
+            for (size_t i = 0; i < run; ++i) {
+                input->data[length + i] = (guint8)random_next(&state);
+            }
+        } else {
+            // The regions may overlap, which repeats the source.
+            for (size_t i = 0; i < run; ++i) {
+                input->data[length + i] = input->data[length + i - distance];
+            }
+        }
+        length += run;
+    }
+    return input;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Compression
+////
+
+// Append a gzip member holding <input> to <output>. The compression level
+// and strategy switch to the next of <levels> and <strategies> every
+// <switch_size> bytes, which ends the current block. If <name> isn't NULL,
+// it's stored in the header.
+static void compress_member(GByteArray* output, const guint8* input,
+                            size_t size, const int* levels,
+                            const int* strategies, size_t count,
+                            size_t switch_size, const char* name) {
+    z_stream stream = {0};
+    int result = deflateInit2(&stream, levels[0], Z_DEFLATED, 15 + 16, 8,
+                              strategies[0]);
+    assert(Z_OK == result);
+    gz_header header = {.os = 3, .name = (Bytef*)name};
+    if (NULL != name) {
+        result = deflateSetHeader(&stream, &header);
+        assert(Z_OK == result);
+    }
+
+    size_t offset = 0;
+    size_t next = 0;
+    guint8 buffer[64 * 1024];
+    for (;;) {
+        size_t length = MIN(switch_size, size - offset);
+        stream.next_in = (Bytef*)input + offset;
+        stream.avail_in = length;
+        offset += length;
+        int flush = offset == size ? Z_FINISH : Z_NO_FLUSH;
+        do {
+            stream.next_out = buffer;
+            stream.avail_out = sizeof(buffer);
+            result = deflate(&stream, flush);
+            assert(Z_STREAM_ERROR != result);
+            g_byte_array_append(output, buffer,
+                                sizeof(buffer) - stream.avail_out);
+        } while (0 == stream.avail_out || 0 != stream.avail_in);
+        if (Z_FINISH == flush) {
+            break;
+        }
+
+        next = (next + 1) % count;
+        // deflateParams() flushes what came before, if it has to.
+        do {
+            stream.next_out = buffer;
+            stream.avail_out = sizeof(buffer);
+            result = deflateParams(&stream, levels[next], strategies[next]);
+            g_byte_array_append(output, buffer,
+                                sizeof(buffer) - stream.avail_out);
+        } while (Z_BUF_ERROR == result);
+        assert(Z_OK == result);
+    }
+
+    assert(Z_STREAM_END == result);
+    deflateEnd(&stream);
+}
+
+static GByteArray* compress_simple(const GByteArray* input, int level,
+                                   int strategy) {
+    GByteArray* output = g_byte_array_new();
+    compress_member(output, input->data, input->len, &level, &strategy, 1,
+                    input->len, NULL);
+    return output;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Decompression
+////
+
+// Decode <data> to the end. Returns 0 or the negative errno of the decoder.
+static int decode(const GByteArray* data, GByteArray* output) {
+    ParallelGzip* decoder =
+        parallel_gzip_new(data->data, data->len, THREADS);
+    if (NULL == decoder) {
+        return -EINVAL;
+    }
+
+    ssize_t length = 0;
+    const void* buffer = NULL;
+    while (0 < (length = parallel_gzip_read(decoder, &buffer))) {
+        g_byte_array_append(output, buffer, length);
+    }
+    parallel_gzip_free(decoder);
+    return (int)length;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Tests
+////
+
+static int failures = 0;
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+                    #condition);                                              \
+            ++failures;                                                       \
+        }                                                                     \
+    } while (0)
+
+static void check_round_trip(const char* name, const GByteArray* compressed,
+                             const GByteArray* expected) {
+    GByteArray* output = g_byte_array_new();
+    int result = decode(compressed, output);
+    if (0 != result || output->len != expected->len ||
+        0 != memcmp(output->data, expected->data, expected->len)) {
+        fprintf(stderr, "%s: decoded %u of %u bytes (%d)\n", name,
+                output->len, expected->len, result);
+        ++failures;
+    }
+    g_byte_array_unref(output);
+}
+
+static void check_failure(const char* name, const GByteArray* compressed) {
+    GByteArray* output = g_byte_array_new();
+    int result = decode(compressed, output);
+    if (0 <= result) {
+        fprintf(stderr, "%s: decoded %u bytes without an error\n", name,
+                output->len);
+        ++failures;
+    }
+    g_byte_array_unref(output);
+}
+
+static void test_detect(const GByteArray* compressed) {
+    CHECK(parallel_gzip_detect(compressed->data, compressed->len));
+    CHECK(!parallel_gzip_detect(compressed->data, 4 * MiB));
+    guint8 bytes[] = {'n', 'o', 't', ' ', 'g', 'z', 'i', 'p', 0, 0, 0, 0};
+    CHECK(!parallel_gzip_detect(bytes, sizeof(bytes)));
+}
+
+static void test_dynamic_blocks(const GByteArray* input) {
+    GByteArray* compressed =
+        compress_simple(input, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY);
+    CHECK(compressed->len > 2 * 4 * MiB);
+    test_detect(compressed);
+    check_round_trip("dynamic", compressed, input);
+    g_byte_array_unref(compressed);
+}
+
+// Without dynamic blocks, no chunk after the first finds a block to start
+// from, so the stream is decoded by the first chunk and sequentially.
+static void test_fixed_blocks(const GByteArray* input) {
+    GByteArray* compressed =
+        compress_simple(input, Z_DEFAULT_COMPRESSION, Z_FIXED);
+    check_round_trip("fixed", compressed, input);
+    g_byte_array_unref(compressed);
+}
+
+static void test_stored_blocks(const GByteArray* input) {
+    GByteArray* compressed =
+        compress_simple(input, Z_NO_COMPRESSION, Z_DEFAULT_STRATEGY);
+    check_round_trip("stored", compressed, input);
+    g_byte_array_unref(compressed);
+}
+
+// Stored, fixed and dynamic blocks follow each other in one member, so that
+// chunks begin in the middle of each kind.
+static void test_mixed_blocks(const GByteArray* input) {
+    const int levels[] = {Z_NO_COMPRESSION, Z_DEFAULT_COMPRESSION,
+                          Z_DEFAULT_COMPRESSION, Z_BEST_SPEED};
+    const int strategies[] = {Z_DEFAULT_STRATEGY, Z_FIXED,
+                              Z_DEFAULT_STRATEGY, Z_DEFAULT_STRATEGY};
+    GByteArray* compressed = g_byte_array_new();
+    compress_member(compressed, input->data, input->len, levels, strategies,
+                    G_N_ELEMENTS(levels), 3 * MiB + 12345, NULL);
+    check_round_trip("mixed", compressed, input);
+    g_byte_array_unref(compressed);
+}
+
+// Members follow each other, some of them with a name in the header, and
+// one of them empty. Each has its own trailer and window.
+static void test_multiple_members(const GByteArray* input) {
+    const int level = Z_DEFAULT_COMPRESSION;
+    const int strategy = Z_DEFAULT_STRATEGY;
+    const size_t splits[] = {0, 7 * MiB, 7 * MiB, 7 * MiB + 1, 16 * MiB,
+                             input->len};
+    GByteArray* compressed = g_byte_array_new();
+    for (size_t i = 0; i + 1 < G_N_ELEMENTS(splits); ++i) {
+        compress_member(compressed, input->data + splits[i],
+                        splits[i + 1] - splits[i], &level, &strategy, 1,
+                        input->len, 0 == i % 2 ? "member" : NULL);
+    }
+    check_round_trip("multiple members", compressed, input);
+
+    // Anything after the last member is ignored, as gzip(1) does.
+    guint8 padding[512] = {0};
+    g_byte_array_append(compressed, padding, sizeof(padding));
+    check_round_trip("multiple members, padded", compressed, input);
+    g_byte_array_unref(compressed);
+}
+
+static GByteArray* deflate_raw(const guint8* input, size_t size) {
+    z_stream stream = {0};
+    int result = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                              -15, 8, Z_DEFAULT_STRATEGY);
+    assert(Z_OK == result);
+    GByteArray* output = g_byte_array_new();
+    g_byte_array_set_size(output, deflateBound(&stream, size));
+    stream.next_in = (Bytef*)input;
+    stream.avail_in = size;
+    stream.next_out = output->data;
+    stream.avail_out = output->len;
+    result = deflate(&stream, Z_FINISH);
+    assert(Z_STREAM_END == result);
+    g_byte_array_set_size(output, output->len - stream.avail_out);
+    deflateEnd(&stream);
+    return output;
+}
+
+// Append non-final stored blocks holding <input> to a deflate stream which
+// ends on a byte boundary.
+static void append_stored(GByteArray* output, const guint8* input,
+                          size_t size) {
+    while (0 < size) {
+        size_t length = MIN(size, 0xffff);
+        guint8 header[5] = {0, length & 0xff, length >> 8, ~length & 0xff,
+                            (~length >> 8) & 0xff};
+        g_byte_array_append(output, header, sizeof(header));
+        g_byte_array_append(output, input, length);
+        input += length;
+        size -= length;
+    }
+}
+
+static void append_u32_le(GByteArray* output, uint32_t value) {
+    guint8 bytes[4] = {value & 0xff, (value >> 8) & 0xff,
+                       (value >> 16) & 0xff, value >> 24};
+    g_byte_array_append(output, bytes, sizeof(bytes));
+}
+
+// The raw deflate stream of the input holds many valid dynamic block
+// headers, at arbitrary bit offsets. Stored between dynamic blocks, they're
+// found by the search for the first block of a chunk, but none of them is
+// where a block of the member begins, and decoding from them fails.
+static void test_false_positive_blocks(const GByteArray* input) {
+    GByteArray* raw = deflate_raw(input->data, input->len);
+    const int levels[] = {Z_NO_COMPRESSION, Z_DEFAULT_COMPRESSION};
+    const int strategies[] = {Z_DEFAULT_STRATEGY, Z_DEFAULT_STRATEGY};
+    GByteArray* compressed = g_byte_array_new();
+    compress_member(compressed, raw->data, raw->len, levels, strategies,
+                    G_N_ELEMENTS(levels), 5 * MiB, NULL);
+    check_round_trip("false positives", compressed, raw);
+    g_byte_array_unref(compressed);
+    g_byte_array_unref(raw);
+}
+
+// A complete deflate stream is stored just after the start of the second
+// chunk, so that decoding from its first block succeeds, through its final
+// block. The first chunk decodes past it, up to the dynamic blocks which
+// follow, so the second chunk doesn't begin where the first one ended, and
+// its region is decoded again.
+static void test_false_positive_chunk(const GByteArray* input) {
+    // Two bits per byte, which deflate compresses with dynamic blocks.
+    GByteArray* embedded_input = g_byte_array_new();
+    uint64_t state = 42;
+    for (size_t i = 0; i < 96 * 1024; ++i) {
+        guint8 letter = 'a' + random_next(&state) % 4;
+        g_byte_array_append(embedded_input, &letter, 1);
+    }
+    GByteArray* embedded =
+        deflate_raw(embedded_input->data, embedded_input->len);
+    g_byte_array_unref(embedded_input);
+    assert(embedded->len < 0xffff);
+
+    // The stored data: random bytes up to a little into the second chunk,
+    // the embedded stream, and random bytes again. The rest of the input is
+    // compressed after it.
+    const guint8 header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3};
+    size_t before = 4 * MiB + 1000;
+    size_t after = 512 * 1024;
+    GByteArray* expected = g_byte_array_new();
+    g_byte_array_append(expected, input->data, before);
+    g_byte_array_append(expected, embedded->data, embedded->len);
+    g_byte_array_append(expected, input->data + before, after);
+    size_t stored = expected->len;
+    g_byte_array_append(expected, input->data + before + after,
+                        8 * MiB);
+
+    GByteArray* compressed = g_byte_array_new();
+    g_byte_array_append(compressed, header, sizeof(header));
+    append_stored(compressed, expected->data, stored);
+    GByteArray* tail =
+        deflate_raw(expected->data + stored, expected->len - stored);
+    g_byte_array_append(compressed, tail->data, tail->len);
+    append_u32_le(compressed, crc32(0, expected->data, expected->len));
+    append_u32_le(compressed, expected->len);
+    check_round_trip("false positive chunk", compressed, expected);
+
+    g_byte_array_unref(tail);
+    g_byte_array_unref(compressed);
+    g_byte_array_unref(expected);
+    g_byte_array_unref(embedded);
+}
+
+static GByteArray* copy_prefix(const GByteArray* data, size_t length) {
+    GByteArray* copy = g_byte_array_sized_new(length);
+    g_byte_array_append(copy, data->data, length);
+    return copy;
+}
+
+static void test_truncated(const GByteArray* input) {
+    GByteArray* compressed =
+        compress_simple(input, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY);
+    // In the first chunk, in a later chunk, in the last block, in the CRC
+    // and in the size of the trailer.
+    const size_t lengths[] = {
+        1 * MiB, 6 * MiB, compressed->len - 100, compressed->len - 6,
+        compressed->len - 1,
+    };
+    for (size_t i = 0; i < G_N_ELEMENTS(lengths); ++i) {
+        GByteArray* truncated = copy_prefix(compressed, lengths[i]);
+        char* name = g_strdup_printf("truncated to %zu", lengths[i]);
+        check_failure(name, truncated);
+        g_free(name);
+        g_byte_array_unref(truncated);
+    }
+    g_byte_array_unref(compressed);
+}
+
+static void test_corrupt(const GByteArray* input) {
+    GByteArray* compressed =
+        compress_simple(input, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY);
+    size_t trailer = compressed->len - 8;
+
+    // The CRC and the size (ISIZE) of the trailer
+    GByteArray* corrupt = copy_prefix(compressed, compressed->len);
+    corrupt->data[trailer] ^= 0x01;
+    check_failure("CRC mismatch", corrupt);
+    g_byte_array_unref(corrupt);
+
+    corrupt = copy_prefix(compressed, compressed->len);
+    corrupt->data[trailer + 4] ^= 0x01;
+    check_failure("ISIZE mismatch", corrupt);
+    g_byte_array_unref(corrupt);
+
+    // The data of each chunk. Flipping a bit either breaks the deflate
+    // stream, or changes the output, which the CRC catches.
+    const size_t offsets[] = {100 * 1024, 5 * MiB + 3, 9 * MiB + 7};
+    for (size_t i = 0; i < G_N_ELEMENTS(offsets); ++i) {
+        corrupt = copy_prefix(compressed, compressed->len);
+        corrupt->data[offsets[i]] ^= 0x10;
+        char* name = g_strdup_printf("corrupt at %zu", offsets[i]);
+        check_failure(name, corrupt);
+        g_free(name);
+        g_byte_array_unref(corrupt);
+    }
+    g_byte_array_unref(compressed);
+}
+
+int main() {
+    GByteArray* input = make_input(LARGE_SIZE, 0x9e3779b97f4a7c15);
+    test_dynamic_blocks(input);
+    test_fixed_blocks(input);
+    test_stored_blocks(input);
+    test_mixed_blocks(input);
+    test_multiple_members(input);
+    test_false_positive_blocks(input);
+    test_false_positive_chunk(input);
+    test_truncated(input);
+    test_corrupt(input);
+    g_byte_array_unref(input);
+
+    if (0 != failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,488 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            archive-pipeline.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Decompress archive entries on a separate thread, ahead of
+//                  the thread writing them to disk.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <archive.h>
+#include <archive_entry.h>
+#include <glib-2.0/glib.h>
+
+#include <volumetric/archive-pipeline.h>
+
+// The buffer is at least this large, so that blocks aren't split too finely.
+static const size_t MINIMUM_BUFFER_SIZE = 64 * 1024;
+
+// Every entry takes a few records, regardless of its size, so many small
+// files would otherwise fill the record queue long before the buffer.
+static const size_t BYTES_PER_RECORD = 1024;
+static const size_t MINIMUM_RECORDS = 256;
+
+typedef enum RecordType {
+    // The header of the next entry, or the error reading it.
+    RECORD_HEADER,
+    // A block of data of the current entry, or the error reading it.
+    RECORD_DATA,
+    // The end of the data of the current entry.
+    RECORD_DATA_END,
+    // The end of the archive.
+    RECORD_END,
+} RecordType;
+
+typedef struct PipelineRecord {
+    RecordType type;
+    int status;
+    char* error; // If status is not ARCHIVE_OK
+
+    struct archive_entry* entry;
+
+    // Region of the buffer. <padding> bytes at the end of the buffer are
+    // skipped when a block doesn't fit there.
+    size_t position;
+    size_t padding;
+    size_t size;
+    // Offset of the block in the entry, or of the header in the archive.
+    la_int64_t offset;
+} PipelineRecord;
+
+typedef struct ArchivePipeline {
+    struct archive* reader;
+    ArchivePipelineFilter filter;
+    void* filter_data;
+    GThread* thread; // NULL if entries are read on the caller's thread
+
+    GMutex lock;
+    GCond not_full;
+    GCond not_empty;
+    bool stopping;
+
+    unsigned char* buffer;
+    size_t capacity;
+    size_t head;
+    size_t used;
+
+    PipelineRecord* records;
+    size_t record_capacity;
+    size_t first_record;
+    size_t record_count;
+
+    // Owned by the consumer
+    PipelineRecord current;
+    struct archive_entry* entry;
+    la_int64_t header_position;
+    char* error;
+    size_t depth_samples;
+    uint64_t depth_total;
+
+    ArchivePipelineStats stats;
+} ArchivePipeline;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static char* error_string_new(struct archive* reader, int status) {
+    const char* error = archive_error_string(reader);
+    if (ARCHIVE_OK == status || NULL == error) {
+        return NULL;
+    }
+
+    char* copy = strdup(error);
+    assert(NULL != copy);
+    return copy;
+}
+
+static void record_release(PipelineRecord* record) {
+    if (NULL != record->entry) {
+        archive_entry_free(record->entry);
+    }
+    free(record->error);
+    memset(record, 0, sizeof(*record));
+}
+
+// Append <record> to the queue, waiting for room in the queue and for
+// <record->size> bytes of the buffer, which are filled from <data>. Returns
+// false if the pipeline is being stopped.
+static bool pipeline_push(ArchivePipeline* pipeline, PipelineRecord* record,
+                          const void* data) {
+    g_mutex_lock(&pipeline->lock);
+    bool stalled = false;
+    for (;;) {
+        if (pipeline->stopping) {
+            g_mutex_unlock(&pipeline->lock);
+            record_release(record);
+            return false;
+        }
+
+        if (0 == pipeline->used) {
+            pipeline->head = 0;
+        }
+        record->position = pipeline->head;
+        record->padding = 0;
+        if (pipeline->head + record->size > pipeline->capacity) {
+            record->position = 0;
+            record->padding = pipeline->capacity - pipeline->head;
+        }
+
+        size_t needed = record->padding + record->size;
+        if (pipeline->record_count < pipeline->record_capacity &&
+            pipeline->used + needed <= pipeline->capacity) {
+            break;
+        }
+
+        if (!stalled) {
+            ++pipeline->stats.decompress_stalls;
+            stalled = true;
+        }
+        g_cond_wait(&pipeline->not_full, &pipeline->lock);
+    }
+
+    // The region is unused until the record is queued, so it's filled without
+    // holding the lock.
+    g_mutex_unlock(&pipeline->lock);
+    if (0 < record->size) {
+        memcpy(pipeline->buffer + record->position, data, record->size);
+    }
+
+    g_mutex_lock(&pipeline->lock);
+    size_t index = (pipeline->first_record + pipeline->record_count) %
+                   pipeline->record_capacity;
+    pipeline->records[index] = *record;
+    ++pipeline->record_count;
+    pipeline->head = record->position + record->size;
+    pipeline->used += record->padding + record->size;
+    if (pipeline->used > pipeline->stats.peak_depth) {
+        pipeline->stats.peak_depth = pipeline->used;
+    }
+    g_cond_signal(&pipeline->not_empty);
+    g_mutex_unlock(&pipeline->lock);
+    return true;
+}
+
+// Queue the data of the current entry, split into blocks which fit in a
+// quarter of the buffer.
+static bool pipeline_read_data(ArchivePipeline* pipeline) {
+    size_t largest_block = pipeline->capacity / 4;
+    for (;;) {
+        const void* block = NULL;
+        size_t size = 0;
+        la_int64_t offset = 0;
+        int status =
+            archive_read_data_block(pipeline->reader, &block, &size, &offset);
+        if (ARCHIVE_EOF == status) {
+            PipelineRecord record = {.type = RECORD_DATA_END};
+            return pipeline_push(pipeline, &record, NULL);
+        } else if (ARCHIVE_OK != status) {
+            PipelineRecord record = {
+                .type = RECORD_DATA,
+                .status = status,
+                .error = error_string_new(pipeline->reader, status),
+            };
+            return pipeline_push(pipeline, &record, NULL);
+        }
+
+        const unsigned char* data = block;
+        while (0 < size) {
+            PipelineRecord record = {
+                .type = RECORD_DATA,
+                .size = size < largest_block ? size : largest_block,
+                .offset = offset,
+            };
+            if (!pipeline_push(pipeline, &record, data)) {
+                return false;
+            }
+            data += record.size;
+            offset += record.size;
+            size -= record.size;
+        }
+    }
+}
+
+static gpointer pipeline_run(gpointer data) {
+    ArchivePipeline* pipeline = (ArchivePipeline*)data;
+    for (;;) {
+        struct archive_entry* entry = NULL;
+        int status = archive_read_next_header(pipeline->reader, &entry);
+        if (ARCHIVE_EOF == status) {
+            PipelineRecord record = {.type = RECORD_END};
+            pipeline_push(pipeline, &record, NULL);
+            break;
+        }
+
+        // The data of entries which aren't wanted is skipped with the next
+        // header.
+        if (ARCHIVE_WARN <= status && NULL != pipeline->filter &&
+            !pipeline->filter(pipeline->filter_data, entry)) {
+            continue;
+        }
+
+        PipelineRecord record = {
+            .type = RECORD_HEADER,
+            .status = status,
+            .error = error_string_new(pipeline->reader, status),
+            .offset = archive_read_header_position(pipeline->reader),
+        };
+        if (ARCHIVE_WARN <= status) {
+            record.entry = archive_entry_clone(entry);
+            assert(NULL != record.entry);
+        }
+        if (!pipeline_push(pipeline, &record, NULL) || ARCHIVE_WARN > status ||
+            !pipeline_read_data(pipeline)) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+// Return the bytes of the record last taken by the consumer to the buffer.
+static void pipeline_release_current(ArchivePipeline* pipeline) {
+    PipelineRecord* record = &pipeline->current;
+    size_t released = record->padding + record->size;
+    record_release(record);
+    if (0 == released) {
+        return;
+    }
+
+    g_mutex_lock(&pipeline->lock);
+    pipeline->used -= released;
+    g_cond_signal(&pipeline->not_full);
+    g_mutex_unlock(&pipeline->lock);
+}
+
+// Wait for the next record, and return a copy of it, leaving it in the
+// queue.
+static PipelineRecord pipeline_peek(ArchivePipeline* pipeline) {
+    g_mutex_lock(&pipeline->lock);
+    if (0 == pipeline->record_count) {
+        ++pipeline->stats.write_stalls;
+        while (0 == pipeline->record_count) {
+            g_cond_wait(&pipeline->not_empty, &pipeline->lock);
+        }
+    }
+
+    PipelineRecord record = pipeline->records[pipeline->first_record];
+    pipeline->depth_total += pipeline->used;
+    ++pipeline->depth_samples;
+    g_mutex_unlock(&pipeline->lock);
+    return record;
+}
+
+// Take the record returned by the last pipeline_peek() off the queue. It's
+// held in <pipeline->current> until it's released.
+static void pipeline_pop(ArchivePipeline* pipeline) {
+    g_mutex_lock(&pipeline->lock);
+    pipeline->current = pipeline->records[pipeline->first_record];
+    pipeline->first_record =
+        (pipeline->first_record + 1) % pipeline->record_capacity;
+    --pipeline->record_count;
+    g_cond_signal(&pipeline->not_full);
+    g_mutex_unlock(&pipeline->lock);
+}
+
+// Keep the error of the current record, for archive_pipeline_error_string().
+static int pipeline_take_status(ArchivePipeline* pipeline) {
+    if (NULL != pipeline->current.error) {
+        free(pipeline->error);
+        pipeline->error = pipeline->current.error;
+        pipeline->current.error = NULL;
+    }
+    return pipeline->current.status;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+ArchivePipeline* archive_pipeline_new(struct archive* reader,
+                                      size_t buffer_size,
+                                      ArchivePipelineFilter filter,
+                                      void* filter_data) {
+    ArchivePipeline* pipeline = malloc(sizeof(ArchivePipeline));
+    if (NULL == pipeline) {
+        return NULL;
+    }
+    memset(pipeline, 0, sizeof(*pipeline));
+    pipeline->reader = reader;
+    pipeline->filter = filter;
+    pipeline->filter_data = filter_data;
+    if (0 == buffer_size) {
+        return pipeline;
+    }
+
+    if (buffer_size < MINIMUM_BUFFER_SIZE) {
+        buffer_size = MINIMUM_BUFFER_SIZE;
+    }
+    pipeline->capacity = buffer_size;
+    pipeline->buffer = malloc(buffer_size);
+    assert(NULL != pipeline->buffer);
+    pipeline->record_capacity = buffer_size / BYTES_PER_RECORD;
+    if (pipeline->record_capacity < MINIMUM_RECORDS) {
+        pipeline->record_capacity = MINIMUM_RECORDS;
+    }
+    pipeline->records =
+        calloc(pipeline->record_capacity, sizeof(PipelineRecord));
+    assert(NULL != pipeline->records);
+
+    g_mutex_init(&pipeline->lock);
+    g_cond_init(&pipeline->not_full);
+    g_cond_init(&pipeline->not_empty);
+    pipeline->thread =
+        g_thread_new("archive-pipeline", pipeline_run, pipeline);
+    return pipeline;
+}
+
+int archive_pipeline_next_header(ArchivePipeline* pipeline,
+                                 struct archive_entry** entry) {
+    if (NULL == pipeline->thread) {
+        for (;;) {
+            int status = archive_read_next_header(pipeline->reader, entry);
+            if (ARCHIVE_EOF == status || ARCHIVE_WARN > status ||
+                NULL == pipeline->filter ||
+                pipeline->filter(pipeline->filter_data, *entry)) {
+                return status;
+            }
+        }
+    }
+
+    // As with libarchive, the last entry is only valid until this call.
+    pipeline_release_current(pipeline);
+    if (NULL != pipeline->entry) {
+        archive_entry_free(pipeline->entry);
+        pipeline->entry = NULL;
+    }
+
+    for (;;) {
+        PipelineRecord record = pipeline_peek(pipeline);
+        if (RECORD_END == record.type) {
+            // Left in the queue, so that later calls return it as well.
+            return ARCHIVE_EOF;
+        }
+
+        pipeline_pop(pipeline);
+        if (RECORD_HEADER == record.type) {
+            pipeline->entry = pipeline->current.entry;
+            pipeline->current.entry = NULL;
+            pipeline->header_position = pipeline->current.offset;
+            *entry = pipeline->entry;
+            return pipeline_take_status(pipeline);
+        }
+
+        // Data which wasn't read is skipped.
+        pipeline_release_current(pipeline);
+    }
+}
+
+int64_t archive_pipeline_header_position(ArchivePipeline* pipeline) {
+    if (NULL == pipeline->thread) {
+        return archive_read_header_position(pipeline->reader);
+    }
+    return pipeline->header_position;
+}
+
+int archive_pipeline_read_data_block(ArchivePipeline* pipeline,
+                                     const void** block, size_t* size,
+                                     int64_t* offset) {
+    if (NULL == pipeline->thread) {
+        la_int64_t data_offset = 0;
+        int status = archive_read_data_block(pipeline->reader, block, size,
+                                             &data_offset);
+        *offset = data_offset;
+        return status;
+    }
+
+    pipeline_release_current(pipeline);
+    *block = NULL;
+    *size = 0;
+    *offset = 0;
+    PipelineRecord record = pipeline_peek(pipeline);
+    if (RECORD_HEADER == record.type || RECORD_END == record.type) {
+        return ARCHIVE_EOF;
+    }
+
+    pipeline_pop(pipeline);
+    if (RECORD_DATA_END == record.type) {
+        return ARCHIVE_EOF;
+    } else if (ARCHIVE_OK != record.status) {
+        return pipeline_take_status(pipeline);
+    }
+
+    *block = pipeline->buffer + record.position;
+    *size = record.size;
+    *offset = record.offset;
+    return ARCHIVE_OK;
+}
+
+const char* archive_pipeline_error_string(ArchivePipeline* pipeline) {
+    if (NULL == pipeline->thread) {
+        return archive_error_string(pipeline->reader);
+    }
+    return pipeline->error;
+}
+
+void archive_pipeline_free(ArchivePipeline* pipeline,
+                           ArchivePipelineStats* stats) {
+    if (NULL != pipeline->thread) {
+        g_mutex_lock(&pipeline->lock);
+        pipeline->stopping = true;
+        g_cond_signal(&pipeline->not_full);
+        g_mutex_unlock(&pipeline->lock);
+        g_thread_join(pipeline->thread);
+
+        record_release(&pipeline->current);
+        for (size_t i = 0; i < pipeline->record_count; ++i) {
+            size_t index =
+                (pipeline->first_record + i) % pipeline->record_capacity;
+            record_release(&pipeline->records[index]);
+        }
+        if (NULL != pipeline->entry) {
+            archive_entry_free(pipeline->entry);
+        }
+
+        g_mutex_clear(&pipeline->lock);
+        g_cond_clear(&pipeline->not_full);
+        g_cond_clear(&pipeline->not_empty);
+        free(pipeline->records);
+        free(pipeline->buffer);
+        free(pipeline->error);
+    }
+
+    if (0 < pipeline->depth_samples) {
+        pipeline->stats.mean_depth =
+            pipeline->depth_total / pipeline->depth_samples;
+    }
+    if (NULL != stats) {
+        *stats = pipeline->stats;
+    }
+    free(pipeline);
+}
+
+///////////////////////////////////////////////////////////////////////////////
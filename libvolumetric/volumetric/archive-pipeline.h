@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            archive-pipeline.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Decompress archive entries on a separate thread, ahead of
+//                  the thread writing them to disk.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#ifndef VOLUMETRIC_ARCHIVE_PIPELINE_H
+#define VOLUMETRIC_ARCHIVE_PIPELINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct archive;
+struct archive_entry;
+
+typedef struct ArchivePipeline ArchivePipeline;
+
+// Counters for sizing the buffer of a pipeline. If the decompressor stalls
+// often, the storage can't keep up, and a larger buffer only helps to absorb
+// bursts. If the writer stalls often, decompression is the bottleneck.
+typedef struct ArchivePipelineStats {
+    // Bytes of decompressed data buffered, at most and on average (sampled
+    // whenever the writer takes a block).
+    size_t peak_depth;
+    size_t mean_depth;
+    // Times the decompressor waited for space in the buffer.
+    size_t decompress_stalls;
+    // Times the writer waited for the decompressor.
+    size_t write_stalls;
+} ArchivePipelineStats;
+
+// Returns true if <entry> is wanted. Called on the thread reading the archive.
+typedef bool (*ArchivePipelineFilter)(void* user_data,
+                                      struct archive_entry* entry);
+
+// Read entries from <reader> (which must be open) on a new thread, buffering
+// up to <buffer_size> bytes of decompressed data. If <buffer_size> is 0,
+// entries are read on the calling thread instead, as they're requested.
+// <reader> must not be used by the caller until the pipeline is freed. If
+// <filter> is not NULL, entries it doesn't want are skipped without reading
+// their data.
+ArchivePipeline* archive_pipeline_new(struct archive* reader,
+                                      size_t buffer_size,
+                                      ArchivePipelineFilter filter,
+                                      void* filter_data);
+
+// Equivalent to archive_read_next_header(3). Data of the current entry which
+// hasn't been read is skipped.
+int archive_pipeline_next_header(ArchivePipeline* pipeline,
+                                 struct archive_entry** entry);
+
+// Equivalent to archive_read_header_position(3), for the current entry.
+int64_t archive_pipeline_header_position(ArchivePipeline* pipeline);
+
+// Equivalent to archive_read_data_block(3). The block is valid until the next
+// call.
+int archive_pipeline_read_data_block(ArchivePipeline* pipeline,
+                                     const void** block, size_t* size,
+                                     int64_t* offset);
+
+// Equivalent to archive_error_string(3), for the last call which failed.
+const char* archive_pipeline_error_string(ArchivePipeline* pipeline);
+
+// Stop the reading thread, and free the pipeline. If <stats> is not NULL, it's
+// filled in with the counters collected by the pipeline.
+void archive_pipeline_free(ArchivePipeline* pipeline,
+                           ArchivePipelineStats* stats);
+
+#endif // VOLUMETRIC_ARCHIVE_PIPELINE_H
+
+///////////////////////////////////////////////////////////////////////////////
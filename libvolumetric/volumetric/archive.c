@@ -7,7 +7,7 @@
 //
 // CREATED:         01/22/2022
 //
-// LAST EDITED:     01/01/2023
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -25,28 +25,94 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ////
 
+// For SEEK_DATA, SEEK_HOLE, fallocate(2) and sync_file_range(2)
+#define _GNU_SOURCE
+
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fts.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
 
 #include <archive.h>
 #include <archive_entry.h>
+#include <glib-2.0/glib.h>
 
+#include <volumetric/archive-pipeline.h>
 #include <volumetric/archive.h>
+#include <volumetric/batch-io.h>
+#include <volumetric/directory.h>
 #include <volumetric/file.h>
+#include <volumetric/hash.h>
+#include <volumetric/parallel-gzip.h>
+#include <volumetric/parallel-stream.h>
+#include <volumetric/path-filter.h>
+#include <volumetric/seekable-zstd.h>
+#include <volumetric/string-handling.h>
+
+static const char* STAGING_DIRECTORY = ".volumetric-staging";
+
+// Size of the blocks handed to libarchive when reading from memory through a
+// callback.
+static const size_t READ_BLOCK_SIZE = 1024 * 1024;
+
+// Regular files up to this size are created in batches of BATCH_FILES, when
+// io_uring is available.
+static const la_int64_t BATCH_FILE_SIZE = 64 * 1024;
+static const guint BATCH_FILES = 256;
+
+// In durable mode, writeback of regular files of at least this size is started
+// as soon as they're extracted. Smaller files are left to the sync at the end,
+// so that they don't each cost another open(2).
+static const la_int64_t WRITE_BEHIND_SIZE = 1024 * 1024;
+
+// Regular files of at least this size are allocated in full before their data
+// is written, so that the filesystem can lay them out in as few extents as
+// possible.
+static const la_int64_t PREALLOCATE_SIZE = 1024 * 1024;
+
+// Size of a tar header, which is stored with each entry, but not extracted.
+static const uint64_t TAR_HEADER_SIZE = 512;
+
+// Feeds a memory-mapped archive to libarchive. If <hash> is set, every byte
+// of the file is hashed on its way to the decompressor. For seekable
+// archives, frames are decompressed in parallel by <stream>, and for large
+// gzip archives, if it's asked for, by <gzip>. In either case, libarchive
+// only sees the uncompressed tar stream.
+typedef struct ArchiveSource {
+    const unsigned char* data;
+    size_t size;
+    size_t offset;
+    FileHashContext* hash;
+
+    // Chunks of <stream> are the frames of <index>.
+    const SeekableIndex* index;
+    ParallelStream* stream;
+    size_t frame;
+
+    ParallelGzip* gzip;
+} ArchiveSource;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Private API
 ////
 
-static int copy_data(struct archive* reader, struct archive* writer) {
+static int copy_data(ArchivePipeline* reader, struct archive* writer) {
     int result = 0;
     const void* buff = NULL;
     size_t size = 0;
-    la_int64_t offset = 0;
+    int64_t offset = 0;
 
     for (;;) {
-        result = archive_read_data_block(reader, &buff, &size, &offset);
+        result =
+            archive_pipeline_read_data_block(reader, &buff, &size, &offset);
         if (result == ARCHIVE_EOF)
             return ARCHIVE_OK;
         if (result < ARCHIVE_OK)
@@ -82,60 +148,1208 @@ static void prepend_directory_path(const char* directory,
     // NOLINTNEXTLINE(clang-analyzer-unix.Malloc)
 }
 
-///////////////////////////////////////////////////////////////////////////////
-// Public API
-////
+// Advance the hashed region of the file up to <offset>.
+static void archive_source_hash_through(ArchiveSource* source, size_t offset) {
+    if (offset <= source->offset) {
+        return;
+    }
 
-void archive_extract_to_disk_universal(const FileContents* file,
-                                       const char* location) {
+    if (NULL != source->hash) {
+        file_hash_context_update(source->hash, source->data + source->offset,
+                                 offset - source->offset);
+    }
+    source->offset = offset;
+}
+
+static la_ssize_t archive_source_read(struct archive* archive,
+                                      void* user_data, const void** buffer) {
+    ArchiveSource* source = (ArchiveSource*)user_data;
+    if (NULL != source->stream) {
+        ssize_t length = parallel_stream_next(source->stream, buffer);
+        if (0 > length) {
+            archive_set_error(archive, (int)-length,
+                              "Couldn't decompress archive frame");
+            return ARCHIVE_FATAL;
+        } else if (0 < length) {
+            const SeekableFrame* frame = &source->index->frames[source->frame];
+            archive_source_hash_through(
+                source, frame->compressed_offset + frame->compressed_size);
+            ++source->frame;
+        }
+
+        return length;
+    }
+
+    if (NULL != source->gzip) {
+        ssize_t length = parallel_gzip_read(source->gzip, buffer);
+        if (0 > length) {
+            archive_set_error(archive, (int)-length,
+                              "Couldn't decompress gzip stream");
+            return ARCHIVE_FATAL;
+        }
+
+        archive_source_hash_through(source, parallel_gzip_tell(source->gzip));
+        return length;
+    }
+
+    size_t length = source->size - source->offset;
+    if (length > READ_BLOCK_SIZE) {
+        length = READ_BLOCK_SIZE;
+    }
+
+    *buffer = source->data + source->offset;
+    archive_source_hash_through(source, source->offset + length);
+    return (la_ssize_t)length;
+}
+
+static int decompress_seekable_frame(void* user_data, size_t chunk,
+                                     void** data, size_t* length) {
+    ArchiveSource* source = (ArchiveSource*)user_data;
+    const SeekableFrame* frame =
+        &source->index->frames[chunk];
+    *length = frame->uncompressed_size;
+    return seekable_frame_decompress(source->data, frame, data);
+}
+
+// Skip whole frames of a seekable archive which libarchive doesn't need, so
+// that they aren't decompressed at all. Returns the number of bytes skipped,
+// which may be fewer than requested.
+static la_int64_t archive_source_skip(struct archive* archive,
+                                      void* user_data, la_int64_t request) {
+    ArchiveSource* source = (ArchiveSource*)user_data;
+    if (NULL == source->stream) {
+        return 0;
+    }
+
+    const SeekableIndex* index = source->index;
+    size_t frame = source->frame;
+    la_int64_t skipped = 0;
+    while (frame < index->frame_count &&
+           skipped + (la_int64_t)index->frames[frame].uncompressed_size <=
+               request) {
+        skipped += index->frames[frame].uncompressed_size;
+        ++frame;
+    }
+    if (frame == source->frame) {
+        return 0;
+    }
+
+    // libarchive is done with the last frame returned, which is freed here.
+    parallel_stream_seek(source->stream, frame);
+    source->frame = frame;
+    return skipped;
+}
+
+// Open <read_archive> on <source>. Seekable archives, and large gzip archives
+// if options->parallel_gzip is set, are decompressed by up to
+// options->threads threads. Returns a libarchive status.
+static int archive_source_open(ArchiveSource* source,
+                               struct archive* read_archive,
+                               const ArchiveExtractOptions* options) {
+    archive_read_support_format_all(read_archive);
+    archive_read_support_filter_all(read_archive);
+    unsigned int threads = options->threads;
+    if (0 == threads) {
+        threads = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    if (NULL != source->index) {
+        source->stream =
+            parallel_stream_new(source->index->frame_count, threads,
+                                decompress_seekable_frame, NULL, source);
+        assert(NULL != source->stream);
+    } else if (options->parallel_gzip && threads > 1 &&
+               parallel_gzip_detect(source->data, source->size)) {
+        source->gzip = parallel_gzip_new(source->data, source->size, threads);
+        assert(NULL != source->gzip);
+    }
+
+    return archive_read_open2(read_archive, source, NULL, archive_source_read,
+                              archive_source_skip, NULL);
+}
+
+static void archive_source_close(ArchiveSource* source) {
+    if (NULL != source->stream) {
+        parallel_stream_free(source->stream);
+        source->stream = NULL;
+    }
+    if (NULL != source->gzip) {
+        parallel_gzip_free(source->gzip);
+        source->gzip = NULL;
+    }
+}
+
+static struct archive* extractor_new() {
     /* Select which attributes we want to restore. */
     int flags = ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM |
                 ARCHIVE_EXTRACT_ACL | ARCHIVE_EXTRACT_FFLAGS |
                 ARCHIVE_EXTRACT_OWNER;
 
-    struct archive* read_archive = archive_read_new();
-    archive_read_support_format_all(read_archive);
-    archive_read_support_filter_all(read_archive);
     struct archive* extractor = archive_write_disk_new();
     archive_write_disk_set_options(extractor, flags);
     archive_write_disk_set_standard_lookup(extractor);
+    return extractor;
+}
 
-    int result =
-        archive_read_open_memory(read_archive, file->contents, file->size);
-    assert(0 == result);
+// True if <entry> can be created with a batch, rather than by libarchive.
+// This is the case for small, plain regular files, whose metadata amounts to
+// ownership, permissions and timestamps.
+static bool entry_is_batchable(struct archive_entry* entry) {
+    unsigned long fflags_set = 0;
+    unsigned long fflags_clear = 0;
+    archive_entry_fflags(entry, &fflags_set, &fflags_clear);
+    return AE_IFREG == archive_entry_filetype(entry) &&
+           NULL == archive_entry_hardlink(entry) &&
+           BATCH_FILE_SIZE >= archive_entry_size(entry) &&
+           0 == archive_entry_sparse_count(entry) &&
+           0 == archive_entry_xattr_count(entry) &&
+           0 == archive_entry_acl_count(entry,
+                                        ARCHIVE_ENTRY_ACL_TYPE_POSIX1E |
+                                            ARCHIVE_ENTRY_ACL_TYPE_NFS4) &&
+           0 == fflags_set;
+}
 
-    struct archive_entry* entry = NULL;
+// Take a copy of <entry> (with <location> prepended to its path) and its
+// data, to be created with the next batch.
+static int batch_add_entry(GPtrArray* batch, ArchivePipeline* reader,
+                           struct archive_entry* entry,
+                           const char* location) {
+    size_t size = archive_entry_size(entry);
+    unsigned char* data = calloc(size + 1, 1);
+    assert(NULL != data);
+    size_t total = 0;
     for (;;) {
-
-        result = archive_read_next_header(read_archive, &entry);
-        if (result == ARCHIVE_EOF)
+        const void* block = NULL;
+        size_t length = 0;
+        int64_t offset = 0;
+        int result =
+            archive_pipeline_read_data_block(reader, &block, &length, &offset);
+        if (ARCHIVE_EOF == result) {
             break;
-        if (result < ARCHIVE_OK)
-            fprintf(stderr, "%s\n", archive_error_string(read_archive));
-        assert(ARCHIVE_WARN <= result);
+        } else if (ARCHIVE_OK != result) {
+            fprintf(stderr, "%s\n", archive_pipeline_error_string(reader));
+            free(data);
+            return result;
+        } else if (offset < 0 || (size_t)offset + length > size) {
+            fprintf(stderr, "%s: data past the end of the entry\n",
+                    archive_entry_pathname(entry));
+            free(data);
+            return ARCHIVE_FATAL;
+        }
+
+        memcpy(data + offset, block, length);
+        if ((size_t)offset + length > total) {
+            total = offset + length;
+        }
+    }
+
+    prepend_directory_path(location, entry);
+    struct archive_entry* copy = archive_entry_clone(entry);
+    archive_entry_set_size(copy, total);
+    g_ptr_array_add(batch, copy);
+    g_ptr_array_add(batch, data);
+    return ARCHIVE_OK;
+}
+
+// Restore what libarchive would have of the metadata of <entry>, for files
+// which were created (or already existed) without its help.
+static int restore_metadata(struct archive* extractor,
+                            struct archive_entry* entry) {
+    const char* path = archive_entry_pathname(entry);
+    if (0 == geteuid()) {
+        uid_t uid =
+            archive_write_disk_uid(extractor, archive_entry_uname(entry),
+                                   archive_entry_uid(entry));
+        gid_t gid =
+            archive_write_disk_gid(extractor, archive_entry_gname(entry),
+                                   archive_entry_gid(entry));
+        if (0 != lchown(path, uid, gid)) {
+            return -errno;
+        }
+    }
 
-        prepend_directory_path(location, entry);
+    // chown(2) may clear set-user-ID bits, so permissions come after.
+    if (0 != chmod(path, archive_entry_perm(entry) & 07777)) {
+        return -errno;
+    }
+
+    struct timespec times[2] = {
+        {.tv_nsec = UTIME_OMIT},
+        {archive_entry_mtime(entry), archive_entry_mtime_nsec(entry)},
+    };
+    if (archive_entry_atime_is_set(entry)) {
+        times[0].tv_sec = archive_entry_atime(entry);
+        times[0].tv_nsec = archive_entry_atime_nsec(entry);
+    }
+    return 0 == utimensat(AT_FDCWD, path, times, AT_SYMLINK_NOFOLLOW) ? 0
+                                                                      : -errno;
+}
+
+// Create the files queued in <batch>, which holds pairs of entries and their
+// data. Files which can't be created with the batch, e.g. because they already
+// exist or their directory doesn't, are handed to libarchive instead.
+static int batch_flush(GPtrArray* batch, BatchIo* io,
+                       struct archive* extractor) {
+    guint count = batch->len / 2;
+    if (0 == count) {
+        return ARCHIVE_OK;
+    }
+
+    BatchIoWrite* files = calloc(count, sizeof(BatchIoWrite));
+    assert(NULL != files);
+    for (guint i = 0; i < count; ++i) {
+        struct archive_entry* entry = batch->pdata[2 * i];
+        files[i].path = archive_entry_pathname(entry);
+        files[i].data = batch->pdata[2 * i + 1];
+        files[i].size = archive_entry_size(entry);
+    }
+    batch_io_write_files(io, files, count);
+
+    int result = ARCHIVE_OK;
+    for (guint i = 0; i < count && ARCHIVE_WARN <= result; ++i) {
+        struct archive_entry* entry = batch->pdata[2 * i];
+        if (0 == files[i].result &&
+            0 == restore_metadata(extractor, entry)) {
+            continue;
+        }
 
         result = archive_write_header(extractor, entry);
+        if (ARCHIVE_WARN <= result && 0 < files[i].size &&
+            (la_ssize_t)files[i].size !=
+                archive_write_data(extractor, files[i].data, files[i].size)) {
+            result = ARCHIVE_FATAL;
+        }
+        if (ARCHIVE_WARN <= result) {
+            result = archive_write_finish_entry(extractor);
+        }
         if (result < ARCHIVE_OK) {
             fprintf(stderr, "%s\n", archive_error_string(extractor));
-        } else if (archive_entry_size(entry) > 0) {
-            result = copy_data(read_archive, extractor);
-            if (result < ARCHIVE_OK)
-                fprintf(stderr, "%s\n", archive_error_string(extractor));
-            assert(ARCHIVE_WARN <= result);
         }
+    }
+
+    for (guint i = 0; i < count; ++i) {
+        archive_entry_free(batch->pdata[2 * i]);
+        free(batch->pdata[2 * i + 1]);
+    }
+    g_ptr_array_set_size(batch, 0);
+    free(files);
+    return result;
+}
 
-        result = archive_write_finish_entry(extractor);
+// Sparse files aren't preallocated, since that would fill in their holes.
+static bool entry_needs_preallocation(struct archive_entry* entry) {
+    return AE_IFREG == archive_entry_filetype(entry) &&
+           NULL == archive_entry_hardlink(entry) &&
+           0 == archive_entry_sparse_count(entry) &&
+           archive_entry_size(entry) >= PREALLOCATE_SIZE;
+}
+
+// Allocate the file libarchive just created for <entry>. Filesystems which
+// can't preallocate are left to allocate as the data is written, but running
+// out of space is an error. Returns 0 on success, or -ENOSPC.
+static int preallocate_entry(struct archive_entry* entry) {
+    int fd = open(archive_entry_pathname(entry),
+                  O_WRONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (0 > fd) {
+        return 0;
+    }
+
+    int result = 0;
+    if (0 != fallocate(fd, 0, 0, archive_entry_size(entry)) &&
+        ENOSPC == errno) {
+        result = -ENOSPC;
+    }
+    close(fd);
+    return result;
+}
+
+// Write the current entry of <reader> underneath <location>. Returns a
+// libarchive status.
+static int extract_entry(ArchivePipeline* reader,
+                         struct archive* extractor,
+                         struct archive_entry* entry, const char* location) {
+    prepend_directory_path(location, entry);
+
+    int result = archive_write_header(extractor, entry);
+    if (ARCHIVE_OK == result && entry_needs_preallocation(entry) &&
+        0 != preallocate_entry(entry)) {
+        fprintf(stderr, "%s: %s\n", archive_entry_pathname(entry),
+                strerror(ENOSPC));
+        return ARCHIVE_FATAL;
+    }
+
+    if (result < ARCHIVE_OK) {
+        fprintf(stderr, "%s\n", archive_error_string(extractor));
+    } else if (archive_entry_size(entry) > 0) {
+        result = copy_data(reader, extractor);
         if (result < ARCHIVE_OK)
             fprintf(stderr, "%s\n", archive_error_string(extractor));
-        assert(ARCHIVE_WARN <= result);
+        if (result < ARCHIVE_WARN)
+            return result;
     }
 
-    archive_read_close(read_archive);
-    archive_read_free(read_archive);
+    result = archive_write_finish_entry(extractor);
+    if (result < ARCHIVE_OK)
+        fprintf(stderr, "%s\n", archive_error_string(extractor));
+    return result;
+}
+
+// Start writeback of the file at <path> without waiting for it, so that less
+// is left to do when the filesystem is synced. Failing that isn't an error.
+static void start_writeback(const char* path) {
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (0 <= fd) {
+        sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+        close(fd);
+    }
+}
+
+static bool entry_needs_writeback(struct archive_entry* entry) {
+    return AE_IFREG == archive_entry_filetype(entry) &&
+           NULL == archive_entry_hardlink(entry) &&
+           archive_entry_size(entry) >= WRITE_BEHIND_SIZE;
+}
+
+static bool entry_is_selected(void* user_data, struct archive_entry* entry) {
+    const PathFilter* filter = (const PathFilter*)user_data;
+    return NULL == filter ||
+           path_filter_selects(filter, archive_entry_pathname(entry),
+                               AE_IFDIR == archive_entry_filetype(entry));
+}
+
+// Read past the entries which were written before an extraction was
+// interrupted. Directories are kept in <directories>, since their metadata is
+// only restored once nothing more is written into them.
+static int skip_written_entries(struct archive* read_archive,
+                                const ArchiveCheckpoint* checkpoint,
+                                const PathFilter* filter,
+                                GPtrArray* directories) {
+    struct archive_entry* entry = NULL;
+    for (uint64_t i = 0; i < checkpoint->entries;) {
+        int result = archive_read_next_header(read_archive, &entry);
+        if (ARCHIVE_EOF == result) {
+            fprintf(stderr, "Checkpoint is past the end of the archive\n");
+            return ARCHIVE_FATAL;
+        }
+        if (result < ARCHIVE_OK)
+            fprintf(stderr, "%s\n", archive_error_string(read_archive));
+        if (result < ARCHIVE_WARN)
+            return result;
+        if (!entry_is_selected((void*)filter, entry))
+            continue;
+
+        ++i;
+        if (AE_IFDIR == archive_entry_filetype(entry)) {
+            struct archive_entry* directory = archive_entry_clone(entry);
+            assert(NULL != directory);
+            g_ptr_array_add(directories, directory);
+        }
+    }
+
+    if (0 < checkpoint->entries &&
+        (strcmp(checkpoint->pathname, archive_entry_pathname(entry)) ||
+         checkpoint->offset != archive_read_header_position(read_archive))) {
+        fprintf(stderr, "Checkpoint doesn't match the archive\n");
+        return ARCHIVE_FATAL;
+    }
+    return ARCHIVE_OK;
+}
+
+// Sync everything written underneath <location>, and then save <checkpoint>,
+// whose last entry is <entry>.
+static int save_checkpoint(ArchivePipeline* reader,
+                           struct archive_entry* entry, const char* location,
+                           const ArchiveExtractOptions* options,
+                           ArchiveCheckpoint* checkpoint) {
+    int result = directory_sync_filesystem(location);
+    if (0 != result) {
+        fprintf(stderr, "Couldn't sync %s: %s\n", location, strerror(-result));
+        return ARCHIVE_FATAL;
+    }
+
+    // The path of the entry has <location> prepended by now.
+    checkpoint->pathname =
+        strdup(archive_entry_pathname(entry) + strlen(location) + 1);
+    assert(NULL != checkpoint->pathname);
+    checkpoint->offset = archive_pipeline_header_position(reader);
+    result = options->checkpoint(options->checkpoint_data, checkpoint);
+    free(checkpoint->pathname);
+    checkpoint->pathname = NULL;
+    if (0 != result) {
+        fprintf(stderr, "Couldn't save checkpoint: %s\n", strerror(-result));
+        return ARCHIVE_FATAL;
+    }
+    return ARCHIVE_OK;
+}
+
+static int extract_entries(ArchivePipeline* reader, const char* location,
+                           const ArchiveExtractOptions* options,
+                           GPtrArray* directories,
+                           ArchiveExtractStats* stats) {
+    struct archive* extractor = extractor_new();
+    BatchIo* io = options->batch_io ? batch_io_new() : NULL;
+    GPtrArray* batch = g_ptr_array_new();
+    int result = ARCHIVE_OK;
+    for (guint i = 0; i < directories->len; ++i) {
+        prepend_directory_path(location, directories->pdata[i]);
+    }
+
+    ArchiveCheckpoint checkpoint = {0};
+    if (NULL != options->resume) {
+        checkpoint.entries = options->resume->entries;
+    }
+    uint64_t unsaved_bytes = 0;
+    struct archive_entry* entry = NULL;
+    while (ARCHIVE_WARN <= result) {
+        result = archive_pipeline_next_header(reader, &entry);
+        if (result == ARCHIVE_EOF) {
+            result = ARCHIVE_OK;
+            break;
+        }
+        if (result < ARCHIVE_OK)
+            fprintf(stderr, "%s\n", archive_pipeline_error_string(reader));
+        if (result < ARCHIVE_WARN)
+            break;
+
+        // Entries are still created in order, so the batch is flushed before
+        // anything is handed to libarchive.
+        if (NULL != io && entry_is_batchable(entry)) {
+            result = batch_add_entry(batch, reader, entry, location);
+            if (ARCHIVE_WARN <= result && 2 * BATCH_FILES <= batch->len)
+                result = batch_flush(batch, io, extractor);
+        } else {
+            result = batch_flush(batch, io, extractor);
+            if (ARCHIVE_WARN <= result)
+                result = extract_entry(reader, extractor, entry,
+                                       location);
+            if (ARCHIVE_WARN <= result && options->durable &&
+                entry_needs_writeback(entry))
+                start_writeback(archive_entry_pathname(entry));
+        }
+        if (result < ARCHIVE_WARN)
+            break;
+        ++stats->entries_written;
+
+        // libarchive leaves alone directories which already exist, which
+        // those from before an interruption may.
+        if (NULL != options->resume &&
+            AE_IFDIR == archive_entry_filetype(entry)) {
+            struct archive_entry* directory = archive_entry_clone(entry);
+            assert(NULL != directory);
+            g_ptr_array_add(directories, directory);
+        }
+
+        ++checkpoint.entries;
+        unsaved_bytes += archive_entry_size(entry);
+        if (NULL != options->checkpoint &&
+            unsaved_bytes >= options->checkpoint_interval) {
+            result = batch_flush(batch, io, extractor);
+            if (ARCHIVE_WARN <= result)
+                result = save_checkpoint(reader, entry, location, options,
+                                         &checkpoint);
+            unsaved_bytes = 0;
+        }
+    }
+
+    if (ARCHIVE_WARN <= result)
+        result = batch_flush(batch, io, extractor);
+    for (guint i = 0; i < directories->len && ARCHIVE_WARN <= result; ++i) {
+        struct archive_entry* directory = directories->pdata[i];
+        int error = restore_metadata(extractor, directory);
+        if (0 != error) {
+            fprintf(stderr, "%s: %s\n", archive_entry_pathname(directory),
+                    strerror(-error));
+            result = ARCHIVE_FATAL;
+        }
+    }
+    for (guint i = 0; i < batch->len; i += 2) {
+        archive_entry_free(batch->pdata[i]);
+        free(batch->pdata[i + 1]);
+    }
+    g_ptr_array_unref(batch);
+    if (NULL != io)
+        batch_io_free(io);
+
     archive_write_close(extractor);
     archive_write_free(extractor);
+    return result < ARCHIVE_WARN ? -EIO : 0;
+}
+
+// Path of an entry relative to the root of the archive, without any leading
+// "./" or trailing slashes. The root itself is "".
+static char* entry_relative_path(const char* pathname) {
+    for (;;) {
+        if ('/' == pathname[0]) {
+            pathname += 1;
+        } else if ('.' == pathname[0] && '/' == pathname[1]) {
+            pathname += 2;
+        } else if ('.' == pathname[0] && '\0' == pathname[1]) {
+            pathname += 1;
+        } else {
+            break;
+        }
+    }
+
+    char* path = strdup(pathname);
+    assert(NULL != path);
+    size_t length = strlen(path);
+    while (length > 0 && '/' == path[length - 1]) {
+        path[--length] = '\0';
+    }
+    return path;
+}
+
+// Record <path> and all of its ancestors as present in the archive. Takes
+// ownership of <path>.
+static void mark_present(GHashTable* present, char* path) {
+    while ('\0' != path[0] && g_hash_table_add(present, path)) {
+        char* separator = strrchr(path, '/');
+        if (NULL == separator) {
+            return;
+        }
+        path = strndup(path, separator - path);
+        assert(NULL != path);
+    }
+}
+
+// True if the metadata of the file on disk matches <entry>. The modification
+// time of directories isn't compared, since it changes whenever any of their
+// children do.
+static bool entry_matches_file(struct archive_entry* entry, const char* path,
+                               const struct stat* file_stat) {
+    if ((mode_t)archive_entry_filetype(entry) != (file_stat->st_mode & S_IFMT))
+        return false;
+
+    // Ownership is only restored when running as root.
+    if (0 == geteuid() && (archive_entry_uid(entry) != file_stat->st_uid ||
+                           archive_entry_gid(entry) != file_stat->st_gid))
+        return false;
+
+    if (S_ISLNK(file_stat->st_mode)) {
+        const char* target = archive_entry_symlink(entry);
+        char buffer[PATH_MAX] = {0};
+        ssize_t length = readlink(path, buffer, sizeof(buffer) - 1);
+        return NULL != target && length >= 0 && !strcmp(target, buffer);
+    }
+
+    if ((archive_entry_perm(entry) & 07777) != (file_stat->st_mode & 07777))
+        return false;
+    if (S_ISDIR(file_stat->st_mode))
+        return true;
+
+    if (archive_entry_mtime(entry) != file_stat->st_mtim.tv_sec ||
+        archive_entry_mtime_nsec(entry) != file_stat->st_mtim.tv_nsec)
+        return false;
+    return !S_ISREG(file_stat->st_mode) ||
+           archive_entry_size(entry) == file_stat->st_size;
+}
+
+// Returns 1 if the range [start, end) of <fd> is all zeros, 0 if it isn't,
+// or a negative errno.
+static int file_range_is_zero(int fd, off_t start, off_t end) {
+    unsigned char buffer[64 * 1024];
+    while (start < end) {
+        size_t size = end - start < (off_t)sizeof(buffer)
+                          ? (size_t)(end - start)
+                          : sizeof(buffer);
+        ssize_t length = pread(fd, buffer, size, start);
+        if (0 > length) {
+            return -errno;
+        } else if (0 == length) {
+            return 1;
+        } else if (0 != buffer[0] ||
+                   memcmp(buffer, buffer + 1, (size_t)length - 1)) {
+            return 0;
+        }
+        start += length;
+    }
+    return 1;
+}
+
+// Make the range [start, end) of <fd>, which is a hole in the archive, read
+// as zeros. Only the data regions of the file are read. Returns 1 if the file
+// was modified, 0 if it already matched, or a negative errno.
+static int patch_file_hole(int fd, off_t start, off_t end) {
+    bool modified = false;
+    off_t position = start;
+    while (position < end) {
+        off_t data = lseek(fd, position, SEEK_DATA);
+        off_t hole = end;
+        if (0 > data && ENXIO == errno) {
+            break;
+        } else if (0 > data) {
+            // The filesystem doesn't support SEEK_DATA, so check everything.
+            data = position;
+        } else {
+            hole = lseek(fd, data, SEEK_HOLE);
+            if (0 > hole || hole > end) {
+                hole = end;
+            }
+        }
+        if (data >= end) {
+            break;
+        }
+
+        int zero = file_range_is_zero(fd, data, hole);
+        if (0 > zero) {
+            return zero;
+        } else if (!zero) {
+            if (0 != fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                               data, hole - data)) {
+                static const unsigned char zeros[64 * 1024] = {0};
+                for (off_t offset = data; offset < hole;) {
+                    size_t size = hole - offset < (off_t)sizeof(zeros)
+                                      ? (size_t)(hole - offset)
+                                      : sizeof(zeros);
+                    ssize_t length = pwrite(fd, zeros, size, offset);
+                    if (0 >= length) {
+                        return 0 == length ? -EIO : -errno;
+                    }
+                    offset += length;
+                }
+            }
+            modified = true;
+        }
+        position = hole;
+    }
+    return modified;
+}
+
+// Compare the data of <entry> with the regular file at <path>, and rewrite
+// only the blocks that differ. Ranges between the blocks are holes in sparse
+// entries, which must read as zeros. Returns 1 if the file was modified, 0 if
+// it already matched, or a negative errno.
+static int patch_file_contents(ArchivePipeline* reader,
+                               struct archive_entry* entry,
+                               const char* path) {
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (0 > fd) {
+        return -errno;
+    }
+
+    unsigned char* buffer = NULL;
+    size_t capacity = 0;
+    int result = 0;
+    bool modified = false;
+    off_t position = 0;
+    for (;;) {
+        const void* block = NULL;
+        size_t size = 0;
+        int64_t offset = 0;
+        int status =
+            archive_pipeline_read_data_block(reader, &block, &size, &offset);
+        if (ARCHIVE_EOF == status) {
+            // The entry may end with a hole.
+            int patched =
+                patch_file_hole(fd, position, archive_entry_size(entry));
+            result = 0 > patched ? patched : 0;
+            modified = modified || 0 < patched;
+            break;
+        } else if (status < ARCHIVE_OK) {
+            fprintf(stderr, "%s\n", archive_pipeline_error_string(reader));
+            result = -EIO;
+            break;
+        }
+
+        int patched =
+            offset > position ? patch_file_hole(fd, position, offset) : 0;
+        if (0 > patched) {
+            result = patched;
+            break;
+        }
+        modified = modified || 0 < patched;
+        position = offset + size;
+
+        if (size > capacity) {
+            buffer = realloc(buffer, size);
+            assert(NULL != buffer);
+            capacity = size;
+        }
+        ssize_t length = pread(fd, buffer, size, offset);
+        if ((ssize_t)size == length && !memcmp(buffer, block, size)) {
+            continue;
+        }
+
+        if ((ssize_t)size != pwrite(fd, block, size, offset)) {
+            result = -errno;
+            break;
+        }
+        modified = true;
+    }
+
+    // Writing moved the modification time.
+    if (0 == result && modified) {
+        struct timespec times[2] = {
+            {.tv_nsec = UTIME_OMIT},
+            {archive_entry_mtime(entry), archive_entry_mtime_nsec(entry)},
+        };
+        if (archive_entry_atime_is_set(entry)) {
+            times[0].tv_sec = archive_entry_atime(entry);
+            times[0].tv_nsec = archive_entry_atime_nsec(entry);
+        }
+        if (0 != futimens(fd, times)) {
+            result = -errno;
+        }
+    }
+
+    free(buffer);
+    close(fd);
+    return 0 != result ? result : modified;
+}
+
+// Remove everything underneath <location> which isn't in <present>.
+static int remove_absent_files(const char* location, GHashTable* present,
+                               ArchiveExtractStats* stats) {
+    char* const paths[] = {(char*)location, NULL};
+    FTS* tree = fts_open(paths, FTS_PHYSICAL | FTS_NOCHDIR, NULL);
+    if (NULL == tree) {
+        return -errno;
+    }
+
+    size_t prefix_length = strlen(location) + 1;
+    int result = 0;
+    FTSENT* file = NULL;
+    while (0 == result && NULL != (file = fts_read(tree))) {
+        if (0 == file->fts_level || FTS_DP == file->fts_info ||
+            g_hash_table_contains(present, file->fts_path + prefix_length)) {
+            continue;
+        }
+
+        if (FTS_D == file->fts_info) {
+            fts_set(tree, file, FTS_SKIP);
+            result = directory_remove_recursive(file->fts_path);
+        } else if (0 != unlink(file->fts_path)) {
+            result = -errno;
+        }
+
+        if (0 != result) {
+            fprintf(stderr, "Couldn't remove %s: %s\n", file->fts_path,
+                    strerror(-result));
+        } else {
+            ++stats->files_removed;
+        }
+    }
+
+    fts_close(tree);
+    return result;
+}
+
+// Bring an earlier checkout in <location> up to date with the archive,
+// writing only the entries that differ.
+static int update_entries(ArchivePipeline* reader, const char* location,
+                          const ArchiveExtractOptions* options,
+                          ArchiveExtractStats* stats) {
+    GHashTable* present =
+        g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+    struct archive* extractor = extractor_new();
+
+    int result = ARCHIVE_OK;
+    struct archive_entry* entry = NULL;
+    for (;;) {
+        result = archive_pipeline_next_header(reader, &entry);
+        if (result == ARCHIVE_EOF) {
+            result = ARCHIVE_OK;
+            break;
+        }
+        if (result < ARCHIVE_OK)
+            fprintf(stderr, "%s\n", archive_pipeline_error_string(reader));
+        if (result < ARCHIVE_WARN)
+            break;
+
+        char* relative = entry_relative_path(archive_entry_pathname(entry));
+        char* path = string_join_new(string_new(location), '/', relative);
+        mark_present(present, relative);
+
+        // Hard links are cheap to recreate, so they always are.
+        struct stat file_stat = {0};
+        bool exists = 0 == lstat(path, &file_stat);
+        bool unchanged = NULL == archive_entry_hardlink(entry) && exists &&
+                         entry_matches_file(entry, path, &file_stat);
+        if (unchanged && ARCHIVE_UPDATE_CONTENTS == options->update &&
+            S_ISREG(file_stat.st_mode) && file_stat.st_size > 0) {
+            int patched = patch_file_contents(reader, entry, path);
+            if (0 > patched) {
+                fprintf(stderr, "Couldn't update %s: %s\n", path,
+                        strerror(-patched));
+                free(path);
+                result = ARCHIVE_FATAL;
+                break;
+            }
+            unchanged = 0 == patched;
+            if (!unchanged) {
+                ++stats->entries_written;
+            }
+        } else if (!unchanged) {
+            // libarchive won't replace a directory with anything else.
+            if (exists && S_ISDIR(file_stat.st_mode) &&
+                AE_IFDIR != archive_entry_filetype(entry)) {
+                directory_remove_recursive(path);
+            }
+
+            result = extract_entry(reader, extractor, entry, location);
+            if (result < ARCHIVE_WARN) {
+                free(path);
+                break;
+            }
+            ++stats->entries_written;
+        }
+
+        if (unchanged) {
+            ++stats->entries_unchanged;
+        } else if (options->durable && entry_needs_writeback(entry)) {
+            start_writeback(path);
+        }
+        free(path);
+    }
+
+    archive_write_close(extractor);
+    archive_write_free(extractor);
+    if (result >= ARCHIVE_WARN) {
+        result = remove_absent_files(location, present, stats);
+    } else {
+        result = -EIO;
+    }
+
+    g_hash_table_unref(present);
+    return result;
+}
+
+static void report_hash_mismatch(const FileHash* expected_hash,
+                                 const FileHash* hash, const char* action) {
+    char* expected = file_hash_to_string(expected_hash);
+    char* got = file_hash_to_string(hash);
+    fprintf(stderr,
+            "Error: %s hash mismatch, %s.\n"
+            "Expected:\n"
+            "    %s\n"
+            "Got:\n"
+            "    %s\n",
+            file_hash_type_to_string(expected_hash->hash_type), action,
+            expected, got);
+    free(expected);
+    free(got);
+}
+
+// Extract the entries from <source>, then account for the rest of the file
+// in the hash, since libarchive stops reading at the end-of-archive marker.
+static int extract_source(ArchiveSource* source, const char* location,
+                          const ArchiveExtractOptions* options,
+                          ArchiveExtractStats* stats) {
+    struct archive* read_archive = archive_read_new();
+    GPtrArray* directories =
+        g_ptr_array_new_with_free_func((GDestroyNotify)archive_entry_free);
+    bool resume = NULL != options->resume &&
+                  ARCHIVE_UPDATE_NONE == options->update;
+    int result = archive_source_open(source, read_archive, options);
+    if (ARCHIVE_OK != result) {
+        fprintf(stderr, "%s\n", archive_error_string(read_archive));
+        result = -EIO;
+    } else if (resume && ARCHIVE_WARN > skip_written_entries(
+                                            read_archive, options->resume,
+                                            options->filter, directories)) {
+        result = -EIO;
+    } else {
+        ArchivePipeline* reader =
+            archive_pipeline_new(read_archive, options->buffer_size,
+                                 entry_is_selected, (void*)options->filter);
+        assert(NULL != reader);
+        if (ARCHIVE_UPDATE_NONE == options->update) {
+            result =
+                extract_entries(reader, location, options, directories, stats);
+        } else {
+            result = update_entries(reader, location, options, stats);
+        }
+        archive_pipeline_free(reader, &stats->pipeline);
+    }
+    g_ptr_array_unref(directories);
+
+    archive_read_close(read_archive);
+    archive_read_free(read_archive);
+    archive_source_close(source);
+
+    archive_source_hash_through(source, source->size);
+    return result;
+}
+
+// Estimate of the space taken by the extracted entries of an archive
+typedef struct ArchiveFootprint {
+    uint64_t bytes;
+    uint64_t inodes;
+} ArchiveFootprint;
+
+static void footprint_add(ArchiveFootprint* footprint, uint64_t data_size,
+                          uint64_t block_size) {
+    footprint->bytes += (data_size + block_size - 1) / block_size * block_size;
+    ++footprint->inodes;
+}
+
+// The entry index has the size of every entry, and its extent in the tar
+// stream, which is smaller for sparse files.
+static void measure_index(const SeekableIndex* index, const PathFilter* filter,
+                          uint64_t block_size, ArchiveFootprint* footprint) {
+    for (size_t i = 0; i < index->entry_count; ++i) {
+        const SeekableEntry* entry = &index->entries[i];
+        if (NULL != filter &&
+            !path_filter_selects(filter, entry->pathname,
+                                 entry->is_directory)) {
+            continue;
+        }
+
+        uint64_t extent = entry->end_offset - entry->header_offset;
+        uint64_t stored = extent > TAR_HEADER_SIZE ? extent - TAR_HEADER_SIZE
+                                                   : 0;
+        uint64_t size = 0 < entry->size ? (uint64_t)entry->size : 0;
+        footprint_add(footprint, size < stored ? size : stored, block_size);
+    }
+}
+
+// Bytes of data stored on disk for <entry>, not counting holes.
+static uint64_t entry_data_size(struct archive_entry* entry) {
+    if (AE_IFREG != archive_entry_filetype(entry) ||
+        NULL != archive_entry_hardlink(entry) ||
+        0 > archive_entry_size(entry)) {
+        return 0;
+    } else if (0 == archive_entry_sparse_reset(entry)) {
+        return (uint64_t)archive_entry_size(entry);
+    }
+
+    uint64_t size = 0;
+    la_int64_t offset = 0;
+    la_int64_t length = 0;
+    while (ARCHIVE_OK == archive_entry_sparse_next(entry, &offset, &length)) {
+        size += (uint64_t)length;
+    }
+    return size;
+}
+
+// Read the headers of the entries in <source>, skipping their data. Returns 0
+// on success, or a negative errno.
+static int measure_headers(ArchiveSource* source,
+                           const ArchiveExtractOptions* options,
+                           uint64_t block_size, ArchiveFootprint* footprint) {
+    struct archive* read_archive = archive_read_new();
+    int result = archive_source_open(source, read_archive, options);
+    struct archive_entry* entry = NULL;
+    while (ARCHIVE_WARN <= result) {
+        result = archive_read_next_header(read_archive, &entry);
+        if (ARCHIVE_EOF == result) {
+            result = ARCHIVE_OK;
+            break;
+        } else if (ARCHIVE_WARN > result) {
+            break;
+        }
+
+        if (entry_is_selected((void*)options->filter, entry)) {
+            uint64_t size = AE_IFDIR == archive_entry_filetype(entry)
+                                ? block_size
+                                : entry_data_size(entry);
+            footprint_add(footprint, size, block_size);
+        }
+    }
+    if (ARCHIVE_WARN > result) {
+        fprintf(stderr, "%s\n", archive_error_string(read_archive));
+    }
+
+    archive_read_close(read_archive);
+    archive_read_free(read_archive);
+    archive_source_close(source);
+    source->offset = 0;
+    source->frame = 0;
+    return ARCHIVE_WARN > result ? -EIO : 0;
+}
+
+// Fail early, rather than halfway through, if the filesystem holding
+// <location> doesn't have room for the entries of <source>. Archives without
+// an index are only measured for ARCHIVE_PREFLIGHT_ALL. Returns 0 if there
+// seems to be room, or if the archive wasn't measured, or a negative errno.
+static int check_free_space(ArchiveSource* source, const char* location,
+                            const ArchiveExtractOptions* options) {
+    bool indexed = NULL != source->index && 0 < source->index->entry_count;
+    if (!indexed && ARCHIVE_PREFLIGHT_ALL != options->preflight) {
+        return 0;
+    }
+
+    struct statvfs filesystem = {0};
+    if (0 != statvfs(location, &filesystem)) {
+        return -errno;
+    }
+
+    uint64_t block_size = filesystem.f_frsize;
+    ArchiveFootprint footprint = {0};
+    if (indexed) {
+        measure_index(source->index, options->filter, block_size,
+                      &footprint);
+    } else {
+        int result = measure_headers(source, options, block_size, &footprint);
+        if (0 != result) {
+            return result;
+        }
+    }
+
+    // Filesystems which allocate inodes dynamically report none at all.
+    uint64_t available = (uint64_t)filesystem.f_bavail * block_size;
+    if (footprint.bytes > available ||
+        (0 < filesystem.f_files && footprint.inodes > filesystem.f_favail)) {
+        fprintf(stderr,
+                "Not enough space in %s: %ju MiB and %ju inodes are needed, "
+                "but %ju MiB and %ju inodes are available\n",
+                location, (uintmax_t)(footprint.bytes >> 20),
+                (uintmax_t)footprint.inodes, (uintmax_t)(available >> 20),
+                (uintmax_t)filesystem.f_favail);
+        return -ENOSPC;
+    }
+
+    return 0;
+}
+
+// Extract into a staging directory underneath <location>, hashing the archive
+// as it's decompressed. The staged contents are moved into place only if the
+// digest matches, and are removed otherwise.
+static int extract_verified(ArchiveSource* source, const char* location,
+                            const ArchiveExtractOptions* options,
+                            ArchiveExtractStats* stats) {
+    const FileHash* expected_hash = options->expected_hash;
+    char* staging = string_join_new(string_new(location), '/',
+                                    STAGING_DIRECTORY);
+    // Remnants of an earlier, interrupted checkout must not be committed,
+    // unless that checkout is being resumed.
+    struct stat staging_stat = {0};
+    bool staged = 0 == lstat(staging, &staging_stat);
+    if (staged && NULL == options->resume) {
+        directory_remove_recursive(staging);
+        staged = false;
+    } else if (!staged && NULL != options->resume) {
+        fprintf(stderr, "Staging directory %s is missing, can't resume\n",
+                staging);
+        free(staging);
+        return -ENOENT;
+    }
+
+    if (!staged && 0 != mkdir(staging, 0700)) {
+        int result = -errno;
+        fprintf(stderr, "Couldn't create staging directory %s: %s\n",
+                staging, strerror(errno));
+        free(staging);
+        return result;
+    }
+
+    // A resumed extraction doesn't see the whole archive, so it's verified
+    // up front instead.
+    FileHash* hash = NULL;
+    int result = 0;
+    if (NULL != options->resume) {
+        hash = file_hash_of_buffer(expected_hash->hash_type,
+                                   (void*)source->data, source->size);
+        if (file_hash_equal(expected_hash, hash)) {
+            result = extract_source(source, staging, options, stats);
+        } else {
+            report_hash_mismatch(expected_hash, hash,
+                                 "discarding extracted contents");
+            result = -EINVAL;
+        }
+    } else {
+        source->hash = file_hash_context_new(expected_hash->hash_type);
+        assert(NULL != source->hash);
+        result = extract_source(source, staging, options, stats);
+
+        hash = file_hash_context_finish(source->hash);
+        source->hash = NULL;
+        if (0 == result && !file_hash_equal(expected_hash, hash)) {
+            report_hash_mismatch(expected_hash, hash,
+                                 "discarding extracted contents");
+            result = -EINVAL;
+        }
+    }
+    file_hash_free(hash);
+
+    if (0 == result) {
+        result = directory_move_contents(staging, location);
+    }
+
+    // The archive's root entry ("./") was applied to the staging directory.
+    if (0 == result && 0 == stat(staging, &staging_stat)) {
+        chmod(location, staging_stat.st_mode & 07777);
+        if (0 != chown(location, staging_stat.st_uid, staging_stat.st_gid)) {
+            perror("couldn't set ownership of volume root");
+        }
+    }
+
+    int remove_result = directory_remove_recursive(staging);
+    if (0 == result) {
+        result = remove_result;
+    }
+
+    free(staging);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+void archive_extract_to_disk_universal(const FileContents* file,
+                                       const char* location) {
+    int result = archive_extract_to_disk(file, location, NULL);
+    assert(0 == result);
+}
+
+int archive_extract_to_disk(const FileContents* file, const char* location,
+                            const ArchiveExtractOptions* options) {
+    static const ArchiveExtractOptions default_options = {0};
+    if (NULL == options) {
+        options = &default_options;
+    }
+
+    ArchiveSource source = {
+        .data = file->contents,
+        .size = file->size,
+    };
+
+    // Archives in the seekable format can be decompressed in parallel.
+    SeekableIndex* index = seekable_index_read(file->contents, file->size);
+    source.index = index;
+
+    ArchiveExtractStats local_stats = {0};
+    ArchiveExtractStats* stats =
+        NULL != options->stats ? options->stats : &local_stats;
+    memset(stats, 0, sizeof(*stats));
+
+    int result = 0;
+    if (ARCHIVE_PREFLIGHT_NONE != options->preflight &&
+        ARCHIVE_UPDATE_NONE == options->update &&
+        NULL == options->resume) {
+        result = check_free_space(&source, location, options);
+    }
+
+    if (0 == result && NULL != options->expected_hash &&
+        ARCHIVE_UPDATE_NONE != options->update) {
+        // An update can't be staged, so the archive is verified up front.
+        FileHash* hash = file_hash_of_buffer(options->expected_hash->hash_type,
+                                             file->contents, file->size);
+        if (file_hash_equal(options->expected_hash, hash)) {
+            result = extract_source(&source, location, options, stats);
+        } else {
+            report_hash_mismatch(options->expected_hash, hash,
+                                 "leaving existing contents in place");
+            result = -EINVAL;
+        }
+        file_hash_free(hash);
+    } else if (0 == result && NULL != options->expected_hash) {
+        result = extract_verified(&source, location, options, stats);
+    } else if (0 == result) {
+        result = extract_source(&source, location, options, stats);
+    }
+
+    if (0 == result && options->durable) {
+        gint64 start = g_get_monotonic_time();
+        result = directory_sync_filesystem(location);
+        stats->sync_microseconds = g_get_monotonic_time() - start;
+    }
+
+    if (NULL != index) {
+        seekable_index_free(index);
+    }
+    return result;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         01/22/2022
 //
-// LAST EDITED:     01/26/2022
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -28,13 +28,137 @@
 #ifndef VOLUMETRIC_ARCHIVE_H
 #define VOLUMETRIC_ARCHIVE_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <volumetric/archive-pipeline.h>
+
 typedef struct FileContents FileContents;
+typedef struct FileHash FileHash;
+typedef struct PathFilter PathFilter;
+
+// How archive_extract_to_disk() treats existing contents of <location>.
+typedef enum ArchiveUpdateMode {
+    // <location> is expected to be empty.
+    ARCHIVE_UPDATE_NONE,
+    // <location> holds an earlier checkout. Entries are skipped if the type,
+    // mode, owner, size and modification time on disk already match, and
+    // files which aren't in the archive are removed.
+    ARCHIVE_UPDATE_METADATA,
+    // As above, but the data of regular files is compared as well, and only
+    // the blocks that differ are rewritten.
+    ARCHIVE_UPDATE_CONTENTS,
+} ArchiveUpdateMode;
+
+// Whether archive_extract_to_disk() checks for free space before extracting.
+typedef enum ArchivePreflight {
+    ARCHIVE_PREFLIGHT_NONE,
+    // Only archives in the seekable format are checked, using the sizes in
+    // their entry index, which costs next to nothing.
+    ARCHIVE_PREFLIGHT_INDEXED,
+    // Other archives are checked as well, by a pass over their headers. That
+    // costs another decompression of the whole archive if it's compressed.
+    ARCHIVE_PREFLIGHT_ALL,
+} ArchivePreflight;
+
+typedef struct ArchiveExtractStats {
+    size_t entries_written;
+    size_t entries_unchanged;
+    size_t files_removed;
+    // Only collected if ArchiveExtractOptions.buffer_size is set.
+    ArchivePipelineStats pipeline;
+    // Time spent waiting for the extracted contents to be synced to disk, if
+    // ArchiveExtractOptions.durable is set.
+    uint64_t sync_microseconds;
+} ArchiveExtractStats;
+
+// Progress of an extraction, from which it can be resumed if it's
+// interrupted.
+typedef struct ArchiveCheckpoint {
+    // Number of entries written, in the order of the archive. Entries which
+    // aren't selected by ArchiveExtractOptions.filter don't count.
+    uint64_t entries;
+    // The last of them, and the offset of its header in the uncompressed
+    // archive. These only serve to check that the checkpoint belongs to the
+    // archive it's resumed from.
+    char* pathname;
+    int64_t offset;
+} ArchiveCheckpoint;
+
+// Persist <checkpoint>. Returns 0 on success, or a negative errno, which
+// aborts the extraction.
+typedef int (*ArchiveCheckpointSave)(void* user_data,
+                                     const ArchiveCheckpoint* checkpoint);
+
+typedef struct ArchiveExtractOptions {
+    // If not NULL, the archive is hashed as it's decompressed, and the
+    // extracted contents are only moved into <location> if the digest
+    // matches. This saves a second pass over the archive.
+    const FileHash* expected_hash;
+
+    // Maximum number of threads used to decompress seekable archives and
+    // large gzip archives. 0 to use one thread per CPU.
+    unsigned int threads;
+
+    // Decode gzip archives of at least 8 MiB with the decoder of
+    // parallel-gzip.h, on <threads> threads. Otherwise, libarchive decodes
+    // them on a single thread.
+    bool parallel_gzip;
+
+    // Bytes of decompressed data buffered between the thread decompressing
+    // the archive and the thread writing it to disk, so that one can run
+    // ahead while the other is busy. 0 to do both on the calling thread.
+    size_t buffer_size;
+
+    ArchiveUpdateMode update;
+
+    // If not NULL, only the entries it selects are extracted (or updated).
+    // The data of the others is skipped, which, for seekable archives, means
+    // that frames holding nothing but skipped data aren't decompressed.
+    const PathFilter* filter;
+
+    // Check that the filesystem holding <location> has room for the entries
+    // before writing any of them, and fail with -ENOSPC if it doesn't. Only
+    // used when <update> is ARCHIVE_UPDATE_NONE and nothing is resumed.
+    ArchivePreflight preflight;
+
+    // Create small files in batches through io_uring, if it's available.
+    // Only used when <update> is ARCHIVE_UPDATE_NONE.
+    bool batch_io;
+
+    // If not NULL, filled in with statistics about the extraction.
+    ArchiveExtractStats* stats;
+
+    // Writeback of large files is started as soon as they're written, and
+    // the filesystem holding <location> is synced once before returning, so
+    // that a successful extraction survives a power loss.
+    bool durable;
+
+    // If not NULL, <checkpoint> is called whenever at least
+    // <checkpoint_interval> bytes have been written since the last call, once
+    // everything written so far has been synced to disk. Only used when
+    // <update> is ARCHIVE_UPDATE_NONE.
+    ArchiveCheckpointSave checkpoint;
+    void* checkpoint_data;
+    uint64_t checkpoint_interval;
+
+    // If not NULL, the extraction to <location> was interrupted after
+    // <resume>, and continues from there, with the same options. Entries
+    // before it aren't written again.
+    const ArchiveCheckpoint* resume;
+} ArchiveExtractOptions;
 
 // Lazy, universal archive extraction routine. Works for all archive files
 // supported by BSD's libarchive.
 void archive_extract_to_disk_universal(const FileContents* file,
                                        const char* location);
 
+// Extract the archive to <location>, according to <options> (which may be
+// NULL). Returns 0 on success, or a negative errno.
+int archive_extract_to_disk(const FileContents* file, const char* location,
+                            const ArchiveExtractOptions* options);
+
 #endif // VOLUMETRIC_ARCHIVE_H
 
 ///////////////////////////////////////////////////////////////////////////////
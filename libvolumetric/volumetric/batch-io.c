@@ -0,0 +1,413 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            batch-io.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of batched file operations.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+// For statx(2)
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#include <config.h>
+#ifdef CONFIG_IO_URING
+#include <liburing.h>
+#endif
+
+#include <volumetric/batch-io.h>
+
+#ifdef CONFIG_IO_URING
+
+// Files are submitted in chunks of this many. Every file needs at most two
+// submission queue entries at once (a write or read, and a linked close).
+#define CHUNK_FILES 64
+static const unsigned int RING_ENTRIES = 2 * CHUNK_FILES;
+
+typedef struct BatchIo {
+    struct io_uring ring;
+    bool failed;
+} BatchIo;
+
+// Operations are identified in the completion queue by the index of their
+// file in the chunk and the kind of operation.
+typedef enum BatchIoOperation {
+    BATCH_IO_OPEN,
+    BATCH_IO_STAT,
+    BATCH_IO_READ,
+    BATCH_IO_WRITE,
+    BATCH_IO_CLOSE,
+} BatchIoOperation;
+
+// The state of the files of a chunk, between round trips to the kernel.
+typedef struct BatchIoChunk {
+    int fds[CHUNK_FILES];
+    int results[CHUNK_FILES];
+    ssize_t transferred[CHUNK_FILES];
+    struct statx stats[CHUNK_FILES];
+} BatchIoChunk;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static struct io_uring_sqe* batch_io_get_sqe(BatchIo* io, size_t index,
+                                             BatchIoOperation operation) {
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&io->ring);
+    assert(NULL != sqe);
+    io_uring_sqe_set_data64(sqe, (uint64_t)index << 3 | operation);
+    return sqe;
+}
+
+// Submit the queued operations, and record the <count> results in <chunk>.
+static void batch_io_complete(BatchIo* io, BatchIoChunk* chunk,
+                              unsigned int count) {
+    if (!io->failed && 0 > io_uring_submit(&io->ring)) {
+        io->failed = true;
+    }
+
+    for (unsigned int i = 0; !io->failed && i < count; ++i) {
+        struct io_uring_cqe* cqe = NULL;
+        int result = io_uring_wait_cqe(&io->ring, &cqe);
+        if (-EINTR == result) {
+            --i;
+            continue;
+        } else if (0 != result) {
+            io->failed = true;
+            break;
+        }
+
+        uint64_t tag = io_uring_cqe_get_data64(cqe);
+        size_t index = tag >> 3;
+        int res = cqe->res;
+        io_uring_cqe_seen(&io->ring, cqe);
+        switch ((BatchIoOperation)(tag & 7)) {
+        case BATCH_IO_OPEN:
+            if (0 > res) {
+                chunk->results[index] = res;
+            } else {
+                chunk->fds[index] = res;
+            }
+            break;
+        case BATCH_IO_STAT:
+            chunk->results[index] = 0 > res ? res : 0;
+            break;
+        case BATCH_IO_READ:
+        case BATCH_IO_WRITE:
+            chunk->transferred[index] = res;
+            break;
+        case BATCH_IO_CLOSE:
+            // A close is cancelled if the transfer linked to it fails or
+            // comes up short, and is finished without the ring. Any other
+            // close releases the descriptor, even if it fails.
+            if (-ECANCELED != res) {
+                chunk->fds[index] = -1;
+                if (0 > res) {
+                    chunk->results[index] = res;
+                }
+            }
+            break;
+        }
+    }
+
+    // Once the queues are out of step with the chunk, completions can't be
+    // matched with files anymore, so the ring isn't used again.
+    if (io->failed) {
+        for (size_t i = 0; i < CHUNK_FILES; ++i) {
+            chunk->results[i] = -EIO;
+        }
+    }
+}
+
+static void batch_io_chunk_init(BatchIoChunk* chunk) {
+    for (size_t i = 0; i < CHUNK_FILES; ++i) {
+        chunk->fds[i] = -1;
+        chunk->results[i] = 0;
+        chunk->transferred[i] = 0;
+    }
+}
+
+static void stat_from_statx(struct stat* file_stat, const struct statx* x) {
+    memset(file_stat, 0, sizeof(*file_stat));
+    file_stat->st_dev = makedev(x->stx_dev_major, x->stx_dev_minor);
+    file_stat->st_ino = x->stx_ino;
+    file_stat->st_mode = x->stx_mode;
+    file_stat->st_nlink = x->stx_nlink;
+    file_stat->st_uid = x->stx_uid;
+    file_stat->st_gid = x->stx_gid;
+    file_stat->st_rdev = makedev(x->stx_rdev_major, x->stx_rdev_minor);
+    file_stat->st_size = x->stx_size;
+    file_stat->st_blksize = x->stx_blksize;
+    file_stat->st_blocks = x->stx_blocks;
+    file_stat->st_atim.tv_sec = x->stx_atime.tv_sec;
+    file_stat->st_atim.tv_nsec = x->stx_atime.tv_nsec;
+    file_stat->st_mtim.tv_sec = x->stx_mtime.tv_sec;
+    file_stat->st_mtim.tv_nsec = x->stx_mtime.tv_nsec;
+    file_stat->st_ctim.tv_sec = x->stx_ctime.tv_sec;
+    file_stat->st_ctim.tv_nsec = x->stx_ctime.tv_nsec;
+}
+
+static void batch_io_write_chunk(BatchIo* io, BatchIoWrite* files,
+                                 size_t count) {
+    if (io->failed) {
+        for (size_t i = 0; i < count; ++i) {
+            files[i].result = -EIO;
+        }
+        return;
+    }
+
+    BatchIoChunk chunk;
+    batch_io_chunk_init(&chunk);
+    for (size_t i = 0; i < count; ++i) {
+        struct io_uring_sqe* sqe = batch_io_get_sqe(io, i, BATCH_IO_OPEN);
+        io_uring_prep_openat(sqe, AT_FDCWD, files[i].path,
+                             O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    }
+    batch_io_complete(io, &chunk, count);
+
+    // Files opened before a failure are written without the ring.
+    unsigned int submitted = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (0 > chunk.fds[i] || io->failed) {
+            continue;
+        }
+
+        if (0 < files[i].size) {
+            struct io_uring_sqe* sqe = batch_io_get_sqe(io, i, BATCH_IO_WRITE);
+            io_uring_prep_write(sqe, chunk.fds[i], files[i].data,
+                                files[i].size, 0);
+            sqe->flags |= IOSQE_IO_LINK;
+            ++submitted;
+        }
+        struct io_uring_sqe* sqe = batch_io_get_sqe(io, i, BATCH_IO_CLOSE);
+        io_uring_prep_close(sqe, chunk.fds[i]);
+        ++submitted;
+    }
+    batch_io_complete(io, &chunk, submitted);
+
+    // Short writes are finished here.
+    for (size_t i = 0; i < count; ++i) {
+        files[i].result = chunk.results[i];
+        if (0 > chunk.fds[i]) {
+            continue;
+        }
+
+        const char* data = files[i].data;
+        ssize_t written = chunk.transferred[i];
+        while (0 <= written && (size_t)written < files[i].size) {
+            ssize_t length = pwrite(chunk.fds[i], data + written,
+                                    files[i].size - written, written);
+            written = 0 < length ? written + length : -errno;
+        }
+        if (0 > written) {
+            files[i].result = (int)written;
+        }
+        if (0 != close(chunk.fds[i]) && 0 == files[i].result) {
+            files[i].result = -errno;
+        }
+    }
+}
+
+static void batch_io_read_chunk(BatchIo* io, BatchIoRead* files,
+                                size_t count, size_t max_size) {
+    if (io->failed) {
+        for (size_t i = 0; i < count; ++i) {
+            files[i].result = -EIO;
+            files[i].data = NULL;
+            files[i].size = 0;
+        }
+        return;
+    }
+
+    BatchIoChunk chunk;
+    batch_io_chunk_init(&chunk);
+    for (size_t i = 0; i < count; ++i) {
+        struct io_uring_sqe* sqe = batch_io_get_sqe(io, i, BATCH_IO_STAT);
+        io_uring_prep_statx(sqe, AT_FDCWD, files[i].path, 0,
+                            STATX_BASIC_STATS, &chunk.stats[i]);
+    }
+    batch_io_complete(io, &chunk, count);
+
+    unsigned int submitted = 0;
+    for (size_t i = 0; i < count; ++i) {
+        files[i].result = chunk.results[i];
+        files[i].data = NULL;
+        files[i].size = 0;
+        if (0 != files[i].result) {
+            continue;
+        }
+
+        stat_from_statx(&files[i].stat, &chunk.stats[i]);
+        if (!io->failed && S_ISREG(files[i].stat.st_mode) &&
+            0 < files[i].stat.st_size &&
+            (size_t)files[i].stat.st_size <= max_size) {
+            files[i].size = files[i].stat.st_size;
+            struct io_uring_sqe* sqe = batch_io_get_sqe(io, i, BATCH_IO_OPEN);
+            io_uring_prep_openat(sqe, AT_FDCWD, files[i].path,
+                                 O_RDONLY | O_CLOEXEC, 0);
+            ++submitted;
+        }
+    }
+
+    // Open failures don't affect the result of the stat.
+    memset(chunk.results, 0, sizeof(chunk.results));
+    batch_io_complete(io, &chunk, submitted);
+
+    submitted = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (0 > chunk.fds[i]) {
+            continue;
+        }
+
+        files[i].data = malloc(files[i].size);
+        assert(NULL != files[i].data);
+        if (io->failed) {
+            continue;
+        }
+
+        struct io_uring_sqe* sqe = batch_io_get_sqe(io, i, BATCH_IO_READ);
+        io_uring_prep_read(sqe, chunk.fds[i], files[i].data, files[i].size,
+                           0);
+        sqe->flags |= IOSQE_IO_LINK;
+        sqe = batch_io_get_sqe(io, i, BATCH_IO_CLOSE);
+        io_uring_prep_close(sqe, chunk.fds[i]);
+        submitted += 2;
+    }
+    batch_io_complete(io, &chunk, submitted);
+
+    // Short reads are finished here. Files which have shrunk in the meantime
+    // are returned as they are now.
+    for (size_t i = 0; i < count; ++i) {
+        if (NULL == files[i].data) {
+            files[i].size = 0;
+            continue;
+        }
+
+        char* data = files[i].data;
+        ssize_t total = chunk.transferred[i];
+        while (0 <= chunk.fds[i] && 0 <= total &&
+               (size_t)total < files[i].size) {
+            ssize_t length = pread(chunk.fds[i], data + total,
+                                   files[i].size - total, total);
+            if (0 >= length) {
+                total = 0 == length ? total : -errno;
+                break;
+            }
+            total += length;
+        }
+        if (0 <= chunk.fds[i]) {
+            close(chunk.fds[i]);
+        }
+
+        if (0 > total) {
+            free(files[i].data);
+            files[i].data = NULL;
+            files[i].size = 0;
+        } else {
+            files[i].size = total;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+BatchIo* batch_io_new() {
+    BatchIo* io = malloc(sizeof(BatchIo));
+    assert(NULL != io);
+    io->failed = false;
+    if (0 > io_uring_queue_init(RING_ENTRIES, &io->ring, 0)) {
+        free(io);
+        return NULL;
+    }
+
+    // openat, statx and close were only added in Linux 5.6.
+    static const int required[] = {IORING_OP_OPENAT, IORING_OP_STATX,
+                                   IORING_OP_READ, IORING_OP_WRITE,
+                                   IORING_OP_CLOSE};
+    struct io_uring_probe* probe = io_uring_get_probe_ring(&io->ring);
+    bool supported = NULL != probe;
+    for (size_t i = 0; supported && i < sizeof(required) / sizeof(int); ++i) {
+        supported = io_uring_opcode_supported(probe, required[i]);
+    }
+    if (NULL != probe) {
+        io_uring_free_probe(probe);
+    }
+
+    if (!supported) {
+        batch_io_free(io);
+        return NULL;
+    }
+    return io;
+}
+
+void batch_io_free(BatchIo* io) {
+    io_uring_queue_exit(&io->ring);
+    free(io);
+}
+
+void batch_io_write_files(BatchIo* io, BatchIoWrite* files, size_t count) {
+    for (size_t i = 0; i < count; i += CHUNK_FILES) {
+        size_t length = count - i < CHUNK_FILES ? count - i : CHUNK_FILES;
+        batch_io_write_chunk(io, files + i, length);
+    }
+}
+
+void batch_io_read_files(BatchIo* io, BatchIoRead* files, size_t count,
+                         size_t max_size) {
+    for (size_t i = 0; i < count; i += CHUNK_FILES) {
+        size_t length = count - i < CHUNK_FILES ? count - i : CHUNK_FILES;
+        batch_io_read_chunk(io, files + i, length, max_size);
+    }
+}
+
+#else // CONFIG_IO_URING
+
+BatchIo* batch_io_new() { return NULL; }
+void batch_io_free(BatchIo* io) { (void)io; }
+
+void batch_io_write_files(BatchIo* io, BatchIoWrite* files, size_t count) {
+    (void)io, (void)files, (void)count;
+    assert(false);
+}
+
+void batch_io_read_files(BatchIo* io, BatchIoRead* files, size_t count,
+                         size_t max_size) {
+    (void)io, (void)files, (void)count, (void)max_size;
+    assert(false);
+}
+
+#endif // CONFIG_IO_URING
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            batch-io.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Batched file operations, submitted through io_uring.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#ifndef VOLUMETRIC_BATCH_IO_H
+#define VOLUMETRIC_BATCH_IO_H
+
+#include <stddef.h>
+#include <sys/stat.h>
+
+// Submits the syscalls for many small files at once, so that the cost of
+// handling large numbers of them isn't dominated by syscall latency.
+typedef struct BatchIo BatchIo;
+
+// A file to create and fill with <size> bytes of <data>. <result> is set to
+// 0 on success, or a negative errno.
+typedef struct BatchIoWrite {
+    const char* path;
+    const void* data;
+    size_t size;
+    int result;
+} BatchIoWrite;
+
+// A file to stat(2), and to read if it's small enough. <result> is the result
+// of the stat. On success, <data> is a malloc'd buffer of the <size> bytes of
+// the file, or NULL if the file wasn't read, which is not an error.
+typedef struct BatchIoRead {
+    const char* path;
+    struct stat stat;
+    void* data;
+    size_t size;
+    int result;
+} BatchIoRead;
+
+// Returns NULL if io_uring isn't supported by this build or by the kernel, in
+// which case callers fall back to issuing the syscalls themselves.
+BatchIo* batch_io_new();
+void batch_io_free(BatchIo* io);
+
+// Create each file, which must not exist yet, with mode 0600, and write its
+// data.
+void batch_io_write_files(BatchIo* io, BatchIoWrite* files, size_t count);
+
+// Stat each file, following symbolic links, and read the non-empty regular
+// files of at most <max_size> bytes.
+void batch_io_read_files(BatchIo* io, BatchIoRead* files, size_t count,
+                         size_t max_size);
+
+#endif // VOLUMETRIC_BATCH_IO_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,345 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            chunk-store.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Content-addressed store of compressed chunks of file data
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glib-2.0/glib.h>
+#include <zstd.h>
+
+#include <volumetric/chunk-store.h>
+#include <volumetric/chunker.h>
+
+static const int COMPRESSION_LEVEL = 3;
+// The largest zstd frame header
+static const size_t FRAME_HEADER_SIZE = 18;
+
+typedef struct ChunkStore {
+    char* directory; // Of the chunks, not the store
+    FileHashType hash_type;
+    ZSTD_CCtx* compress;
+    ZSTD_DCtx* decompress;
+    // Holds one compressed chunk
+    void* buffer;
+    size_t buffer_size;
+} ChunkStore;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static int chunk_store_make_directory(const char* directory) {
+    if (0 != mkdir(directory, 0755) && EEXIST != errno) {
+        return -errno;
+    }
+    return 0;
+}
+
+// The path of the chunk named <hash>, which must be free'd with g_free().
+static char* chunk_store_get_path(ChunkStore* store, const FileHash* hash) {
+    char* name = file_hash_to_string(hash);
+    char* path =
+        g_strdup_printf("%s/%.2s/%s", store->directory, name, name);
+    free(name);
+    return path;
+}
+
+static int chunk_store_sync_directory(const char* directory) {
+    int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (0 > fd) {
+        return -errno;
+    }
+
+    int result = 0 == fsync(fd) ? 0 : -errno;
+    close(fd);
+    return result;
+}
+
+// Write the file at <path> under a temporary name, and publish it once it's
+// on disk, so that a chunk is never found incomplete after a crash.
+static int chunk_store_write_file(const char* path, const void* data,
+                                  size_t length) {
+    char* temporary = g_strdup_printf("%s.XXXXXX", path);
+    int fd = mkstemp(temporary);
+    if (0 > fd) {
+        int result = -errno;
+        g_free(temporary);
+        return result;
+    }
+
+    int result = 0;
+    const unsigned char* position = data;
+    while (0 == result && 0 < length) {
+        ssize_t written = write(fd, position, length);
+        if (0 > written && EINTR != errno) {
+            result = -errno;
+        } else if (0 < written) {
+            position += written;
+            length -= written;
+        }
+    }
+
+    if (0 == result) {
+        fchmod(fd, 0444);
+        if (0 != fsync(fd)) {
+            result = -errno;
+        }
+    }
+    if (0 != close(fd) && 0 == result) {
+        result = -errno;
+    }
+    if (0 == result && 0 != rename(temporary, path)) {
+        result = -errno;
+    }
+    if (0 != result) {
+        unlink(temporary);
+    }
+    g_free(temporary);
+
+    if (0 == result) {
+        char* parent = g_path_get_dirname(path);
+        result = chunk_store_sync_directory(parent);
+        g_free(parent);
+    }
+    return result;
+}
+
+// Read the whole file at <path> into the buffer of the store. Returns the
+// number of bytes read, or a negative errno.
+static ssize_t chunk_store_read_file(ChunkStore* store, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (0 > fd) {
+        return -errno;
+    }
+
+    struct stat file_stat = {0};
+    if (0 != fstat(fd, &file_stat)) {
+        int result = -errno;
+        close(fd);
+        return result;
+    } else if ((size_t)file_stat.st_size > store->buffer_size) {
+        // Chunks are never larger than this, unless they're corrupt.
+        close(fd);
+        return -EBADMSG;
+    }
+
+    size_t length = 0;
+    ssize_t result = 0;
+    while (length < (size_t)file_stat.st_size) {
+        result = read(fd, (char*)store->buffer + length,
+                      file_stat.st_size - length);
+        if (0 > result && EINTR == errno) {
+            continue;
+        } else if (0 > result) {
+            result = -errno;
+            break;
+        } else if (0 == result) {
+            break;
+        }
+        length += result;
+    }
+
+    close(fd);
+    return 0 > result ? result : (ssize_t)length;
+}
+
+// Check that the chunk at <path> looks like a chunk of <length> bytes: that
+// it isn't empty or too large, and that its frame declares <length> bytes.
+// This only reads the frame header, so checking every chunk of an unchanged
+// volume is cheap. Returns 0 if it does, -EBADMSG if it doesn't, or another
+// negative errno.
+static int chunk_store_check_chunk(ChunkStore* store, const char* path,
+                                   size_t length) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (0 > fd) {
+        return -errno;
+    }
+
+    int result = 0;
+    struct stat file_stat = {0};
+    unsigned char header[FRAME_HEADER_SIZE];
+    ssize_t header_size = 0;
+    if (0 != fstat(fd, &file_stat)) {
+        result = -errno;
+    } else if (!S_ISREG(file_stat.st_mode) || 0 == file_stat.st_size ||
+               (size_t)file_stat.st_size > store->buffer_size) {
+        result = -EBADMSG;
+    } else if (0 > (header_size = pread(fd, header, sizeof(header), 0))) {
+        result = -errno;
+    } else if (ZSTD_getFrameContentSize(header, header_size) != length) {
+        result = -EBADMSG;
+    }
+
+    close(fd);
+    return result;
+}
+
+// Read the chunk at <path> into <buffer>, and check that it's <length>
+// bytes, named <hash>. Returns 0 on success, or a negative errno.
+static int chunk_store_read_chunk(ChunkStore* store, const char* path,
+                                  const FileHash* hash, void* buffer,
+                                  size_t length) {
+    ssize_t compressed_size = chunk_store_read_file(store, path);
+    if (0 > compressed_size) {
+        return (int)compressed_size;
+    }
+
+    size_t result = ZSTD_decompressDCtx(store->decompress, buffer, length,
+                                        store->buffer, compressed_size);
+    if (ZSTD_isError(result) || result != length) {
+        return -EBADMSG;
+    }
+
+    FileHash* data_hash = chunk_store_hash(store, buffer, length);
+    bool intact = file_hash_equal(hash, data_hash);
+    file_hash_free(data_hash);
+    return intact ? 0 : -EBADMSG;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+int chunk_store_open(const char* directory, FileHashType hash_type,
+                     bool create, ChunkStore** store) {
+    char* chunks = g_strdup_printf("%s/chunks", directory);
+    int result = 0;
+    if (create) {
+        result = chunk_store_make_directory(directory);
+        if (0 == result) {
+            result = chunk_store_make_directory(chunks);
+        }
+    } else {
+        struct stat directory_stat = {0};
+        result = 0 == stat(directory, &directory_stat) ? 0 : -errno;
+    }
+    if (0 != result) {
+        g_free(chunks);
+        return result;
+    }
+
+    ChunkStore* new_store = malloc(sizeof(ChunkStore));
+    assert(NULL != new_store);
+    new_store->directory = chunks;
+    new_store->hash_type = hash_type;
+    new_store->compress = ZSTD_createCCtx();
+    new_store->decompress = ZSTD_createDCtx();
+    assert(NULL != new_store->compress && NULL != new_store->decompress);
+    ZSTD_CCtx_setParameter(new_store->compress, ZSTD_c_compressionLevel,
+                           COMPRESSION_LEVEL);
+    new_store->buffer_size = ZSTD_compressBound(CHUNKER_MAX_SIZE);
+    new_store->buffer = malloc(new_store->buffer_size);
+    assert(NULL != new_store->buffer);
+    *store = new_store;
+    return 0;
+}
+
+void chunk_store_free(ChunkStore* store) {
+    ZSTD_freeCCtx(store->compress);
+    ZSTD_freeDCtx(store->decompress);
+    free(store->buffer);
+    g_free(store->directory);
+    free(store);
+}
+
+FileHash* chunk_store_hash(ChunkStore* store, const void* data,
+                           size_t length) {
+    return file_hash_of_buffer(store->hash_type, (void*)data, length);
+}
+
+bool chunk_store_contains(ChunkStore* store, const FileHash* hash,
+                          size_t length) {
+    char* path = chunk_store_get_path(store, hash);
+    bool contains = 0 == chunk_store_check_chunk(store, path, length);
+    g_free(path);
+    return contains;
+}
+
+int chunk_store_put(ChunkStore* store, const FileHash* hash, const void* data,
+                    size_t length) {
+    assert(CHUNKER_MAX_SIZE >= length);
+    // Chunks written by earlier versions are shared, so a damaged one would
+    // corrupt this version as well. It's replaced instead.
+    char* path = chunk_store_get_path(store, hash);
+    int check = chunk_store_check_chunk(store, path, length);
+    if (0 == check) {
+        g_free(path);
+        return 0;
+    } else if (-ENOENT != check) {
+        fprintf(stderr, "Chunk %s is corrupt, writing it again\n", path);
+    }
+
+    // Chunks are spread over 256 directories, so that none gets too large.
+    char* parent = g_path_get_dirname(path);
+    int result = chunk_store_make_directory(parent);
+    g_free(parent);
+
+    size_t compressed_size = 0;
+    if (0 == result) {
+        compressed_size = ZSTD_compress2(store->compress, store->buffer,
+                                         store->buffer_size, data, length);
+        if (ZSTD_isError(compressed_size)) {
+            fprintf(stderr, "%s: zstd compression failed: %s\n", path,
+                    ZSTD_getErrorName(compressed_size));
+            result = -EIO;
+        }
+    }
+
+    if (0 == result) {
+        result = chunk_store_write_file(path, store->buffer, compressed_size);
+    }
+    g_free(path);
+    return 0 == result ? 1 : result;
+}
+
+int chunk_store_get(ChunkStore* store, const FileHash* hash, void* buffer,
+                    size_t capacity, size_t length) {
+    // The length comes from a manifest, which may be corrupt.
+    if (capacity < length || CHUNKER_MAX_SIZE < length) {
+        return -EBADMSG;
+    }
+
+    char* path = chunk_store_get_path(store, hash);
+    int result = chunk_store_read_chunk(store, path, hash, buffer, length);
+    if (-EBADMSG == result) {
+        fprintf(stderr, "Chunk %s is corrupt\n", path);
+    } else if (0 != result) {
+        fprintf(stderr, "Couldn't read chunk %s: %s\n", path,
+                strerror(-result));
+    }
+
+    g_free(path);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
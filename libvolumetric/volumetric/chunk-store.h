@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            chunk-store.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Content-addressed store of compressed chunks of file data
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef VOLUMETRIC_CHUNK_STORE_H
+#define VOLUMETRIC_CHUNK_STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <volumetric/hash.h>
+
+// A directory holding every chunk (see chunker.h) of every version of a
+// volume, once. The layout is:
+//
+//  chunks/<first two digits of the hash>/<hash>
+//
+// Each chunk is a single zstd frame, named by the hash of its uncompressed
+// data, so chunks shared between files, or versions, are only stored once.
+// Chunks are only ever replaced if they're found to be damaged, and a chunk
+// is complete once it has its name. A store isn't safe to use from several
+// threads.
+typedef struct ChunkStore ChunkStore;
+
+// Open the store in <directory>, whose chunks are named by hashes of
+// <hash_type>. Unless <create> is true, the directory must exist. Returns 0
+// on success, or a negative errno.
+int chunk_store_open(const char* directory, FileHashType hash_type,
+                     bool create, ChunkStore** store);
+void chunk_store_free(ChunkStore* store);
+
+// Hash <length> bytes at <data> into the name of their chunk. Must be free'd
+// with file_hash_free().
+FileHash* chunk_store_hash(ChunkStore* store, const void* data, size_t length);
+
+// Returns true if the chunk named <hash>, of <length> bytes, is stored. Only
+// the size of the file and its frame header are checked. The data is checked
+// against its name when it's read, by chunk_store_get().
+bool chunk_store_contains(ChunkStore* store, const FileHash* hash,
+                          size_t length);
+
+// Store the chunk of <length> bytes at <data>, named <hash>, unless
+// chunk_store_contains() it already. A copy which fails that check is
+// replaced. New chunks are synced to disk before they're named. Returns 1 if
+// the chunk was written, 0 if it was already stored, or a negative errno.
+int chunk_store_put(ChunkStore* store, const FileHash* hash, const void* data,
+                    size_t length);
+
+// Read the chunk named <hash>, of <length> bytes, into <buffer>, which holds
+// <capacity> bytes. The data is checked against its name. Returns 0 on
+// success, or a negative errno.
+int chunk_store_get(ChunkStore* store, const FileHash* hash, void* buffer,
+                    size_t capacity, size_t length);
+
+#endif // VOLUMETRIC_CHUNK_STORE_H
+
+///////////////////////////////////////////////////////////////////////////////
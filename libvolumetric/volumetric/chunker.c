@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            chunker.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Content-defined chunking of file data
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <stdint.h>
+
+#include <glib-2.0/glib.h>
+
+#include <volumetric/chunker.h>
+
+// Normalized chunking: boundaries are harder to find before the average size
+// (more bits of the hash must be zero), and easier after it, which keeps most
+// chunks close to the average. The bits are at the top of the hash, since
+// they depend on the most bytes.
+static const uint64_t CHUNKER_MASK_SMALL = ~UINT64_C(0) << (64 - 18);
+static const uint64_t CHUNKER_MASK_LARGE = ~UINT64_C(0) << (64 - 14);
+
+// A random value for every byte, rolled into the hash. The seed is fixed,
+// since the boundaries of stored chunks depend on it.
+static const uint64_t CHUNKER_GEAR_SEED = UINT64_C(0x766f6c756d657472);
+static uint64_t chunker_gear[256];
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+// splitmix64, which is easy to reproduce anywhere.
+static const uint64_t* chunker_get_gear() {
+    static gsize initialized = 0;
+    if (g_once_init_enter(&initialized)) {
+        uint64_t state = CHUNKER_GEAR_SEED;
+        for (size_t i = 0; i < G_N_ELEMENTS(chunker_gear); ++i) {
+            state += UINT64_C(0x9e3779b97f4a7c15);
+            uint64_t value = state;
+            value = (value ^ (value >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+            value = (value ^ (value >> 27)) * UINT64_C(0x94d049bb133111eb);
+            chunker_gear[i] = value ^ (value >> 31);
+        }
+        g_once_init_leave(&initialized, 1);
+    }
+
+    return chunker_gear;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+size_t chunker_next_boundary(const unsigned char* data, size_t length) {
+    if (CHUNKER_MIN_SIZE >= length) {
+        return length;
+    }
+
+    const uint64_t* gear = chunker_get_gear();
+    size_t end = MIN(length, CHUNKER_MAX_SIZE);
+    size_t average = MIN(end, CHUNKER_AVERAGE_SIZE);
+    uint64_t hash = 0;
+    size_t i = CHUNKER_MIN_SIZE;
+    for (; i < average; ++i) {
+        hash = (hash << 1) + gear[data[i]];
+        if (0 == (hash & CHUNKER_MASK_SMALL)) {
+            return i + 1;
+        }
+    }
+
+    for (; i < end; ++i) {
+        hash = (hash << 1) + gear[data[i]];
+        if (0 == (hash & CHUNKER_MASK_LARGE)) {
+            return i + 1;
+        }
+    }
+
+    return end;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            chunker.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Content-defined chunking of file data
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef VOLUMETRIC_CHUNKER_H
+#define VOLUMETRIC_CHUNKER_H
+
+#include <stddef.h>
+
+// Data is cut into chunks wherever a rolling hash of the last bytes matches a
+// pattern (FastCDC), so an insertion or deletion only changes the chunks
+// around it. Chunks are between CHUNKER_MIN_SIZE and CHUNKER_MAX_SIZE bytes,
+// CHUNKER_AVERAGE_SIZE on average. The boundaries only depend on the data,
+// so they must never change once chunks are stored.
+#define CHUNKER_MIN_SIZE (16 * 1024)
+#define CHUNKER_AVERAGE_SIZE (64 * 1024)
+#define CHUNKER_MAX_SIZE (256 * 1024)
+
+// Returns the length of the first chunk of the <length> bytes at <data>.
+// Unless they're the end of the stream, there must be at least
+// CHUNKER_MAX_SIZE of them.
+size_t chunker_next_boundary(const unsigned char* data, size_t length);
+
+#endif // VOLUMETRIC_CHUNKER_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         01/17/2022
 //
-// LAST EDITED:     06/23/2022
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -27,6 +27,7 @@
 
 #include <errno.h>
 #include <libgen.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -54,6 +55,58 @@ typedef struct ProjectIter {
 static void
 volumetric_configuration_defaults(VolumetricConfiguration* config) {
     config->volume_path = strdup("");
+    config->extract_buffer_size = 16 * 1024 * 1024;
+    config->docker_root = strdup("/var/lib/docker");
+}
+
+// Parse a size in bytes, such as "512M".
+static int parse_size(const char* string, uint64_t* size) {
+    char* end = NULL;
+    errno = 0;
+    unsigned long long value = strtoull(string, &end, 10);
+    if (0 != errno || end == string || '-' == string[0]) {
+        return -EINVAL;
+    }
+
+    const char* suffixes = "KMGT";
+    if ('\0' != *end) {
+        const char* suffix = strchr(suffixes, *end);
+        if (NULL == suffix || '\0' != end[1]) {
+            return -EINVAL;
+        }
+        for (const char* i = suffixes; i <= suffix; ++i) {
+            if (value > UINT64_MAX / 1024) {
+                return -EINVAL;
+            }
+            value *= 1024;
+        }
+    }
+
+    *size = value;
+    return 0;
+}
+
+static int visit_io_limits(SerdecYamlDeserializer* deser, void* user_data,
+                           const char* key) {
+    VolumetricConfiguration* config = (VolumetricConfiguration*)user_data;
+    const char* temp = NULL;
+    int result = serdec_yaml_deserialize_string(deser, &temp);
+    if (0 > result) {
+        return result;
+    }
+
+    char* end = NULL;
+    errno = 0;
+    unsigned long limit = strtoul(temp, &end, 10);
+    if (0 != errno || end == temp || '\0' != *end || '-' == temp[0] ||
+        UINT_MAX < limit) {
+        fprintf(stderr, "Invalid io-limits for %s: %s\n", key, temp);
+        return -EINVAL;
+    }
+
+    g_hash_table_insert(config->io_limits, g_strdup(key),
+                        GUINT_TO_POINTER((guint)limit));
+    return result;
 }
 
 static int visit_mapping(SerdecYamlDeserializer* deser, void* user_data,
@@ -84,6 +137,46 @@ static int visit_mapping(SerdecYamlDeserializer* deser, void* user_data,
         config->volume_path = strdup(temp);
     }
 
+    else if (!strcmp("extract-cache-size", key)) {
+        result = serdec_yaml_deserialize_string(deser, &temp);
+        if (0 > result) {
+            return result;
+        } else if (0 != parse_size(temp, &config->extract_cache_size)) {
+            fprintf(stderr, "Invalid extract-cache-size: %s\n", temp);
+            return -EINVAL;
+        }
+    }
+
+    else if (!strcmp("extract-buffer-size", key)) {
+        result = serdec_yaml_deserialize_string(deser, &temp);
+        if (0 > result) {
+            return result;
+        } else if (0 != parse_size(temp, &config->extract_buffer_size)) {
+            fprintf(stderr, "Invalid extract-buffer-size: %s\n", temp);
+            return -EINVAL;
+        }
+    }
+
+    else if (!strcmp("staging-directory", key)) {
+        result = serdec_yaml_deserialize_string(deser, &temp);
+        free(config->staging_directory);
+        config->staging_directory = strdup(temp);
+    }
+
+    else if (!strcmp("docker-root", key)) {
+        result = serdec_yaml_deserialize_string(deser, &temp);
+        free(config->docker_root);
+        config->docker_root = strdup(temp);
+    }
+
+    else if (!strcmp("io-limits", key)) {
+        if (NULL == config->io_limits) {
+            config->io_limits =
+                g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        }
+        result = serdec_yaml_deserialize_map(deser, visit_io_limits, config);
+    }
+
     return result;
 }
 
@@ -168,6 +261,11 @@ void volumetric_configuration_release(VolumetricConfiguration* config) {
     if (NULL != config->volume_path) {
         free(config->volume_path);
     }
+    free(config->staging_directory);
+    free(config->docker_root);
+    if (NULL != config->io_limits) {
+        g_hash_table_unref(config->io_limits);
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -243,7 +341,7 @@ bool volumetric_configuration_find_volume_by_name(
         g_hash_table_iter_init(&iter, project_file->volumes);
         while (g_hash_table_iter_next(&iter, &key, &value)) {
             Volume* current_volume = (Volume*)value;
-            if (!strcmp(volume_name, current_volume->archive.name)) {
+            if (!strcmp(volume_name, volume_get_name(current_volume))) {
                 // TODO: This should be a volume_copy method or similar
                 // Have to steal the volume from the container, then free it
                 g_hash_table_steal(project_file->volumes, key);
@@ -7,7 +7,7 @@
 //
 // CREATED:         01/16/2022
 //
-// LAST EDITED:     02/15/2022
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -29,6 +29,9 @@
 #define VOLUMETRIC_CONFIGURATION_H
 
 #include <stdbool.h>
+#include <stdint.h>
+
+typedef struct _GHashTable GHashTable;
 
 // Keys currently supported in configuration:
 // version:
@@ -45,11 +48,51 @@
 // volume-path:
 //  type: string
 //  description: Colon-separated list of paths to search for volume images
+//
+// extract-cache-size:
+//  type: string
+//  description: Maximum disk usage of the cache of extracted volume images,
+//   in bytes, with an optional K, M, G or T suffix. The cache is disabled if
+//   this is absent or 0.
+//
+// extract-buffer-size:
+//  type: string
+//  description: Bytes of decompressed data buffered between decompressing
+//   an archive and writing it to disk, with an optional K, M, G or T suffix.
+//   Defaults to 16M. With 0, archives are decompressed and written on one
+//   thread.
+//
+// staging-directory:
+//  type: string
+//  description: Where volume images are extracted before the Docker daemon
+//   is running (volumetric-checkout --stage). Staged trees are moved into
+//   the volumes, so this should be on the same filesystem as docker-root.
+//   Defaults to a directory next to the lock files.
+//
+// docker-root:
+//  type: string
+//  description: Data root of the Docker daemon. Defaults to /var/lib/docker.
+//   While staging, a volume is taken to exist if its directory exists here.
+//
+// io-limits:
+//  type: map of string to integer
+//  description: Maximum number of volumes read from or written to a device
+//   at once, by kind of device (rotational, solid-state or network) or by
+//   name (e.g. sda, or server:/export for network filesystems), which takes
+//   precedence. 0 is unlimited. Defaults to 1 for rotational devices, 2 for
+//   network filesystems, and no limit for solid-state devices. See
+//   io-scheduler.h.
 
 typedef struct VolumetricConfiguration {
     char* version;
     char* volume_directory;
     char* volume_path;
+    uint64_t extract_cache_size;
+    uint64_t extract_buffer_size;
+    char* staging_directory; // May be NULL
+    char* docker_root;
+    // Kind or name of device to GUINT_TO_POINTER(limit). May be NULL.
+    GHashTable* io_limits;
 } VolumetricConfiguration;
 
 typedef enum ParseResult {
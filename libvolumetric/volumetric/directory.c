@@ -7,7 +7,7 @@
 //
 // CREATED:         01/29/2022
 //
-// LAST EDITED:     02/13/2022
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -25,15 +25,24 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ////
 
+// For copy_file_range(2), syncfs(2), renameat2(2), SEEK_DATA and SEEK_HOLE
+#define _GNU_SOURCE
+
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <fts.h>
+#include <linux/fs.h>
 #include <linux/limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include <glib-2.0/glib.h>
 
@@ -48,8 +57,204 @@ typedef struct DirectoryIter {
     DirectoryEntry entry;
 } DirectoryIter;
 
+// A rename done by directory_exchange_contents(), which can be undone by
+// renaming <to> back to <from> with the same flags.
+typedef struct DirectoryExchange {
+    char* from;
+    char* to;
+    unsigned int flags;
+} DirectoryExchange;
+
 static const size_t ABSOLUTE_PATH_CAPACITY = PATH_MAX;
 
+// Size of the buffer used when a file has to be copied through userspace.
+static const size_t COPY_BUFFER_SIZE = 1024 * 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static void directory_exchange_clear(gpointer data) {
+    DirectoryExchange* exchange = data;
+    free(exchange->from);
+    free(exchange->to);
+}
+
+// Copy the range [start, end) of <source> to the same offsets in
+// <destination>: in the kernel if possible, otherwise through a buffer.
+static int copy_file_range_data(int source, int destination, off_t start,
+                                off_t end) {
+    off_t input = start;
+    off_t output = start;
+    while (input < end) {
+        ssize_t length = copy_file_range(source, &input, destination, &output,
+                                         (size_t)(end - input), 0);
+        if (0 >= length) {
+            break;
+        }
+    }
+    if (input >= end) {
+        return 0;
+    }
+
+    char* buffer = malloc(COPY_BUFFER_SIZE);
+    assert(NULL != buffer);
+    int result = 0;
+    while (input < end) {
+        size_t size = end - input < (off_t)COPY_BUFFER_SIZE
+                          ? (size_t)(end - input)
+                          : COPY_BUFFER_SIZE;
+        ssize_t length = pread(source, buffer, size, input);
+        if (0 >= length) {
+            result = 0 == length ? -EIO : -errno;
+            break;
+        }
+        if (length != pwrite(destination, buffer, (size_t)length, input)) {
+            result = -errno;
+            break;
+        }
+        input += length;
+    }
+
+    free(buffer);
+    return result;
+}
+
+// Copy <size> bytes of <source> to <destination>: as a reflink if possible,
+// and otherwise only the data regions, so that holes in sparse files remain.
+static int copy_file_data(int source, int destination, off_t size) {
+    if (0 == ioctl(destination, FICLONE, source)) {
+        return 0;
+    } else if (0 != ftruncate(destination, size)) {
+        return -errno;
+    }
+
+    off_t position = 0;
+    while (position < size) {
+        off_t data = lseek(source, position, SEEK_DATA);
+        off_t hole = size;
+        if (0 > data && ENXIO == errno) {
+            break;
+        } else if (0 > data) {
+            // The filesystem doesn't support SEEK_DATA.
+            data = position;
+        } else {
+            hole = lseek(source, data, SEEK_HOLE);
+            if (0 > hole || hole > size) {
+                hole = size;
+            }
+        }
+
+        int result = copy_file_range_data(source, destination, data, hole);
+        if (0 != result) {
+            return result;
+        }
+        position = hole;
+    }
+
+    return 0;
+}
+
+// Apply the ownership, permissions and timestamps in <source_stat> to <path>.
+// Permissions are not applied to symbolic links.
+static int clone_metadata(const char* path, const struct stat* source_stat) {
+    if (0 == geteuid() &&
+        0 != lchown(path, source_stat->st_uid, source_stat->st_gid)) {
+        return -errno;
+    }
+
+    // chown(2) may clear set-user-ID bits, so permissions come after.
+    if (!S_ISLNK(source_stat->st_mode) &&
+        0 != chmod(path, source_stat->st_mode & 07777)) {
+        return -errno;
+    }
+
+    const struct timespec times[2] = {source_stat->st_atim,
+                                      source_stat->st_mtim};
+    if (0 != utimensat(AT_FDCWD, path, times, AT_SYMLINK_NOFOLLOW)) {
+        return -errno;
+    }
+    return 0;
+}
+
+static int clone_regular_file(const char* source, const char* destination,
+                              const struct stat* source_stat) {
+    int source_fd = open(source, O_RDONLY | O_CLOEXEC);
+    if (0 > source_fd) {
+        return -errno;
+    }
+
+    int destination_fd =
+        open(destination, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (0 > destination_fd) {
+        int result = -errno;
+        close(source_fd);
+        return result;
+    }
+
+    int result =
+        copy_file_data(source_fd, destination_fd, source_stat->st_size);
+    close(source_fd);
+    if (0 != close(destination_fd) && 0 == result) {
+        result = -errno;
+    }
+    return result;
+}
+
+// Hard links within the source tree are preserved. <links> maps the device
+// and inode of files with more than one link to their first copy.
+static int clone_file(const FTSENT* node, const char* destination,
+                      DirectoryCloneMode mode, GHashTable* links) {
+    const struct stat* source_stat = node->fts_statp;
+    if (DIRECTORY_CLONE_HARDLINK == mode && S_ISREG(source_stat->st_mode)) {
+        if (0 == link(node->fts_path, destination)) {
+            return 0;
+        } else if (EXDEV != errno) {
+            return -errno;
+        }
+    }
+
+    char* key = NULL;
+    if (source_stat->st_nlink > 1 && !S_ISDIR(source_stat->st_mode)) {
+        key = g_strdup_printf("%ju:%ju", (uintmax_t)source_stat->st_dev,
+                              (uintmax_t)source_stat->st_ino);
+        const char* first = g_hash_table_lookup(links, key);
+        if (NULL != first) {
+            g_free(key);
+            return 0 == link(first, destination) ? 0 : -errno;
+        }
+    }
+
+    int result = 0;
+    if (S_ISREG(source_stat->st_mode)) {
+        result = clone_regular_file(node->fts_path, destination, source_stat);
+    } else if (S_ISLNK(source_stat->st_mode)) {
+        char target[PATH_MAX] = {0};
+        ssize_t length = readlink(node->fts_path, target, sizeof(target) - 1);
+        if (0 > length || 0 != symlink(target, destination)) {
+            result = -errno;
+        }
+    } else if (0 != mknod(destination, source_stat->st_mode,
+                          source_stat->st_rdev)) {
+        result = -errno;
+    }
+
+    if (0 == result) {
+        result = clone_metadata(destination, source_stat);
+    }
+    if (0 == result && NULL != key) {
+        g_hash_table_insert(links, key, strdup(destination));
+        key = NULL;
+    }
+
+    g_free(key);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
 DirectoryIter* directory_iter_new(const char* directory) {
     DIR* system_directory = opendir(directory);
     if (NULL == system_directory) {
@@ -125,4 +330,217 @@ GPtrArray* get_file_list_for_directory(const char* directory) {
     return list;
 }
 
+int directory_remove_recursive(const char* directory) {
+    char* directory_owned = string_new(directory);
+    char* const paths[] = {directory_owned, NULL};
+    FTS* tree = fts_open(paths, FTS_NOCHDIR | FTS_PHYSICAL, 0);
+    if (NULL == tree) {
+        free(directory_owned);
+        return -errno;
+    }
+
+    int result = 0;
+    FTSENT* node = NULL;
+    while (0 == result && (node = fts_read(tree))) {
+        switch (node->fts_info) {
+        case FTS_D:
+            // Directories are removed in post-order (FTS_DP)
+            break;
+        case FTS_DP:
+            if (0 != rmdir(node->fts_accpath)) {
+                result = -errno;
+            }
+            break;
+        case FTS_DNR:
+        case FTS_ERR:
+        case FTS_NS:
+            result = -node->fts_errno;
+            break;
+        default:
+            if (0 != unlink(node->fts_accpath)) {
+                result = -errno;
+            }
+            break;
+        }
+    }
+
+    if (0 != result) {
+        fprintf(stderr, "Couldn't remove %s: %s\n",
+                NULL != node ? node->fts_path : directory, strerror(-result));
+    }
+
+    fts_close(tree);
+    free(directory_owned);
+    return result;
+}
+
+int directory_move_contents(const char* source, const char* destination) {
+    DIR* source_directory = opendir(source);
+    if (NULL == source_directory) {
+        int result = -errno;
+        fprintf(stderr, "%s:%d: Couldn't open directory: %s (%s)\n", __FILE__,
+                __LINE__, source, strerror(errno));
+        return result;
+    }
+    closedir(source_directory);
+
+    DirectoryIter* iter = directory_iter_new(source);
+    DirectoryEntry* entry = NULL;
+    int result = 0;
+    while (0 == result && NULL != (entry = directory_iter_next(iter))) {
+        char* target = string_join_new(string_new(destination), '/',
+                                       entry->entry->d_name);
+        if (0 != rename(entry->absolute_path, target)) {
+            result = -errno;
+            fprintf(stderr, "Couldn't move %s to %s: %s\n",
+                    entry->absolute_path, target, strerror(errno));
+        }
+        free(target);
+    }
+
+    directory_iter_free(iter);
+    return result;
+}
+
+int directory_exchange_contents(const char* source, const char* destination) {
+    // Entries move between the directories, so both are listed up front.
+    const char* directories[2] = {source, destination};
+    GHashTable* names[2] = {0};
+    int result = 0;
+    for (int i = 0; i < 2; ++i) {
+        names[i] = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+        DIR* directory = opendir(directories[i]);
+        if (NULL == directory) {
+            result = -errno;
+            fprintf(stderr, "%s:%d: Couldn't open directory: %s (%s)\n",
+                    __FILE__, __LINE__, directories[i], strerror(errno));
+            continue;
+        }
+
+        struct dirent* entry = NULL;
+        while (NULL != (entry = readdir(directory))) {
+            if (strcmp(".", entry->d_name) && strcmp("..", entry->d_name)) {
+                g_hash_table_add(names[i], strdup(entry->d_name));
+            }
+        }
+        closedir(directory);
+    }
+
+    // Entries in both are exchanged, and the rest are moved across.
+    GArray* done = g_array_new(FALSE, FALSE, sizeof(DirectoryExchange));
+    g_array_set_clear_func(done, directory_exchange_clear);
+    for (int i = 0; i < 2 && 0 == result; ++i) {
+        GHashTableIter iter;
+        g_hash_table_iter_init(&iter, names[i]);
+        const char* name = NULL;
+        while (0 == result &&
+               g_hash_table_iter_next(&iter, (gpointer*)&name, NULL)) {
+            bool in_both = g_hash_table_contains(names[1 - i], name);
+            if (in_both && 1 == i) {
+                continue;
+            }
+
+            DirectoryExchange exchange = {
+                .from = string_join_new(string_new(directories[i]), '/', name),
+                .to = string_join_new(string_new(directories[1 - i]), '/',
+                                      name),
+                .flags = in_both ? RENAME_EXCHANGE : RENAME_NOREPLACE,
+            };
+            if (0 != renameat2(AT_FDCWD, exchange.from, AT_FDCWD, exchange.to,
+                               exchange.flags)) {
+                result = -errno;
+                fprintf(stderr, "Couldn't move %s to %s: %s\n", exchange.from,
+                        exchange.to, strerror(errno));
+                free(exchange.from);
+                free(exchange.to);
+            } else {
+                g_array_append_val(done, exchange);
+            }
+        }
+    }
+
+    // Put everything back where it was, in the opposite order, so that
+    // neither directory is left with a mix of both.
+    for (guint i = done->len; 0 != result && 0 < i; --i) {
+        const DirectoryExchange* exchange =
+            &g_array_index(done, DirectoryExchange, i - 1);
+        if (0 != renameat2(AT_FDCWD, exchange->to, AT_FDCWD, exchange->from,
+                           exchange->flags)) {
+            fprintf(stderr,
+                    "Couldn't move %s back to %s: %s. %s is incomplete!\n",
+                    exchange->to, exchange->from, strerror(errno),
+                    destination);
+        }
+    }
+
+    g_array_unref(done);
+    g_hash_table_unref(names[0]);
+    g_hash_table_unref(names[1]);
+    return result;
+}
+
+int directory_clone(const char* source, const char* destination,
+                    DirectoryCloneMode mode) {
+    char* source_owned = string_new(source);
+    char* const paths[] = {source_owned, NULL};
+    FTS* tree = fts_open(paths, FTS_NOCHDIR | FTS_PHYSICAL, 0);
+    if (NULL == tree) {
+        free(source_owned);
+        return -errno;
+    }
+
+    GHashTable* links = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                              free);
+    size_t prefix_length = strlen(source);
+    int result = 0;
+    FTSENT* node = NULL;
+    while (0 == result && (node = fts_read(tree))) {
+        char* path = string_join_new(string_new(destination), '/',
+                                     node->fts_path + prefix_length);
+        switch (node->fts_info) {
+        case FTS_D:
+            // The destination itself already exists.
+            if (0 != node->fts_level && 0 != mkdir(path, 0700)) {
+                result = -errno;
+            }
+            break;
+        case FTS_DP:
+            // Directory timestamps are applied once their contents are done.
+            result = clone_metadata(0 == node->fts_level ? destination : path,
+                                    node->fts_statp);
+            break;
+        case FTS_DNR:
+        case FTS_ERR:
+        case FTS_NS:
+            result = -node->fts_errno;
+            break;
+        default:
+            result = clone_file(node, path, mode, links);
+            break;
+        }
+
+        if (0 != result) {
+            fprintf(stderr, "Couldn't clone %s to %s: %s\n", node->fts_path,
+                    path, strerror(-result));
+        }
+        free(path);
+    }
+
+    g_hash_table_unref(links);
+    fts_close(tree);
+    free(source_owned);
+    return result;
+}
+
+int directory_sync_filesystem(const char* directory) {
+    int fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (0 > fd) {
+        return -errno;
+    }
+
+    int result = 0 == syncfs(fd) ? 0 : -errno;
+    close(fd);
+    return result;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         01/29/2022
 //
-// LAST EDITED:     02/15/2022
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -45,6 +45,41 @@ DirectoryEntry* directory_iter_next(DirectoryIter* iter);
 // TODO: Obviously this one is not like the others.
 GPtrArray* get_file_list_for_directory(const char* directory);
 
+// Remove the directory and everything underneath it. Symbolic links are not
+// followed. Returns 0 on success, or a negative errno.
+int directory_remove_recursive(const char* directory);
+
+// Move every entry in <source> into <destination> (which must be on the same
+// filesystem). Returns 0 on success, or a negative errno.
+int directory_move_contents(const char* source, const char* destination);
+
+// Exchange the contents of <source> and <destination> (which must be on the
+// same filesystem), entry by entry, with renameat2(2). Entries are never
+// missing from either directory in between, but the exchange as a whole is
+// only atomic to processes which are stopped while it happens. If an entry
+// can't be exchanged, the entries exchanged before it are put back, so both
+// directories keep their contents. Returns 0 on success, or a negative errno.
+int directory_exchange_contents(const char* source, const char* destination);
+
+typedef enum DirectoryCloneMode {
+    // Regular files are copied, sharing extents with the source (reflinks)
+    // where the filesystem supports it.
+    DIRECTORY_CLONE_COPY,
+    // Regular files are hard links to the source, so modifying them modifies
+    // the source as well. Falls back to copying across filesystems.
+    DIRECTORY_CLONE_HARDLINK,
+} DirectoryCloneMode;
+
+// Recreate the tree at <source> underneath the existing directory
+// <destination>, including ownership (when running as root), permissions and
+// timestamps. Returns 0 on success, or a negative errno.
+int directory_clone(const char* source, const char* destination,
+                    DirectoryCloneMode mode);
+
+// Flush everything written to the filesystem holding <directory> to disk.
+// Returns 0 on success, or a negative errno.
+int directory_sync_filesystem(const char* directory);
+
 #endif // VOLUMETRIC_DIRECTORY_H
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         01/17/2022
 //
-// LAST EDITED:     01/07/2023
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -38,6 +38,7 @@ typedef struct json_object json_object;
 typedef struct DockerVolumeListIter DockerVolumeListIter;
 typedef struct DockerMountIter DockerMountIter;
 typedef struct DockerContainerIter DockerContainerIter;
+typedef struct _GPtrArray GPtrArray;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Docker Proxy General API
@@ -58,6 +59,15 @@ typedef struct Docker {
 Docker* docker_proxy_new();
 void docker_proxy_free(Docker* docker);
 
+// Called with successive chunks of a stream sent to or received from the
+// daemon, of up to <size> * <nitems> bytes. Returns the number of bytes
+// produced into <buffer> (0 at the end of the stream), or consumed from it
+// (anything less aborts the transfer). Returning DOCKER_STREAM_ABORT also
+// aborts a stream being sent.
+typedef size_t (*DockerStreamCallback)(char* buffer, size_t size,
+                                       size_t nitems, void* user_data);
+#define DOCKER_STREAM_ABORT ((size_t)0x10000000)
+
 ///////////////////////////////////////////////////////////////////////////////
 // Docker Volume API
 ////
@@ -71,6 +81,14 @@ typedef struct DockerVolume {
 // Create the volume
 DockerVolume* docker_volume_create(Docker* docker, const char* name);
 
+// Create the volume with the local driver, which mounts <device>, a filesystem
+// of <type>, with <options> (as for mount(8)) whenever a container uses it.
+DockerVolume* docker_volume_create_local_mount(Docker* docker,
+                                               const char* name,
+                                               const char* type,
+                                               const char* device,
+                                               const char* options);
+
 // Iteration API for the /volumes endpoint
 DockerVolumeListIter* docker_volume_list(Docker* docker);
 const DockerVolume* docker_volume_list_iter_next(DockerVolumeListIter* iter);
@@ -115,10 +133,47 @@ void docker_container_iter_free(DockerContainerIter* iter);
 const DockerMount* docker_mount_iter_next(DockerMountIter* iter);
 void docker_mount_iter_free(DockerMountIter* iter);
 
-// Pause/Un-pause a container
+// Get the IDs of the containers which have the volume <volume_name> mounted.
+// The strings are freed with the array.
+GPtrArray* docker_container_list_consumers(Docker* docker,
+                                           const char* volume_name);
+
+// Pause/Un-pause a container. Returns 0, or a negative errno if the request
+// fails, or the daemon responds with an error status.
 int docker_container_pause(Docker* docker, const char* container_id);
 int docker_container_unpause(Docker* docker, const char* container_id);
 
+// Create a container from <image>, with the volume <volume_name> mounted at
+// <target>, to reach the volume through the archive endpoints below. The
+// container is never started, so the image only has to exist locally.
+// Returns the ID of the container, which must be free'd, or NULL.
+char* docker_container_create_helper(Docker* docker, const char* image,
+                                     const char* volume_name,
+                                     const char* target);
+
+// Remove the container, even if it's running.
+int docker_container_remove(Docker* docker, const char* container_id);
+
+// Extract the tar archive of <length> bytes at <data> (which may be
+// compressed with gzip, bzip2 or xz) into the directory <path> in the
+// container. The archive is sent from where it is, without being copied.
+int docker_container_put_archive(Docker* docker, const char* container_id,
+                                 const char* path, const void* data,
+                                 size_t length);
+
+// As above, for an archive produced by <read>.
+int docker_container_put_archive_stream(Docker* docker,
+                                        const char* container_id,
+                                        const char* path,
+                                        DockerStreamCallback read,
+                                        void* user_data);
+
+// Pass an uncompressed tar archive of <path> in the container to <write>.
+// Its entries are named relative to the parent directory of <path>.
+int docker_container_get_archive(Docker* docker, const char* container_id,
+                                 const char* path, DockerStreamCallback write,
+                                 void* user_data);
+
 // Free memory
 void docker_container_free(DockerContainer* container);
 void docker_mount_free(DockerMount* mount);
@@ -7,7 +7,7 @@
 //
 // CREATED:         02/13/2022
 //
-// LAST EDITED:     09/18/2022
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -26,9 +26,12 @@
 ////
 
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <curl/curl.h>
 #include <glib-2.0/glib.h>
 #include <json-c/json.h>
 #include <json-c/json_tokener.h>
@@ -105,6 +108,18 @@ static void populate_docker_container_from_json(DockerContainer* container,
     }
 }
 
+// URL of the archive endpoint for <path> in the container
+static char* get_archive_url(Docker* docker, const char* container_id,
+                             const char* path) {
+    char* escaped_path = curl_easy_escape(docker->curl, path, 0);
+    assert(NULL != escaped_path);
+    char* url =
+        g_strdup_printf("http://localhost/containers/%s/archive?path=%s",
+                        container_id, escaped_path);
+    curl_free(escaped_path);
+    return url;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public API
 ////
@@ -181,6 +196,93 @@ void docker_mount_iter_free(DockerMountIter* iter) {
     free(iter);
 }
 
+char* docker_container_create_helper(Docker* docker, const char* image,
+                                     const char* volume_name,
+                                     const char* target) {
+    json_object* mount = json_object_new_object();
+    json_object_object_add(mount, "Type", json_object_new_string("volume"));
+    json_object_object_add(mount, "Source",
+                           json_object_new_string(volume_name));
+    json_object_object_add(mount, "Target", json_object_new_string(target));
+    json_object* mounts = json_object_new_array();
+    json_object_array_add(mounts, mount);
+    json_object* host_config = json_object_new_object();
+    json_object_object_add(host_config, "Mounts", mounts);
+
+    json_object* request = json_object_new_object();
+    json_object_object_add(request, "Image", json_object_new_string(image));
+    json_object_object_add(request, "HostConfig", host_config);
+
+    docker->read_object = NULL;
+    int result = http_encode(request, &docker->read_object,
+                             &docker->read_object_length);
+    json_object_put(request);
+    if (0 != result) {
+        return NULL;
+    }
+
+    docker->read_object_index = 0;
+    result = http_post_application_json(
+        docker, "http://localhost/containers/create");
+    free(docker->read_object);
+    if (0 != result) {
+        return NULL;
+    }
+
+    json_object* id = json_object_object_get(docker->write_object, "Id");
+    char* container_id = NULL;
+    if (NULL != id) {
+        container_id = strdup(json_object_get_string(id));
+    } else {
+        json_object* message =
+            json_object_object_get(docker->write_object, "message");
+        fprintf(stderr, "%s:%d:Docker daemon says: %s\n", __FILE__, __LINE__,
+                json_object_get_string(message));
+    }
+
+    json_object_put(docker->write_object);
+    docker->write_object = NULL;
+    return container_id;
+}
+
+int docker_container_remove(Docker* docker, const char* container_id) {
+    char* url = g_strdup_printf("http://localhost/containers/%s?force=true",
+                                container_id);
+    int result = http_delete_without_response(docker, url);
+    g_free(url);
+    return result;
+}
+
+int docker_container_put_archive(Docker* docker, const char* container_id,
+                                 const char* path, const void* data,
+                                 size_t length) {
+    char* url = get_archive_url(docker, container_id, path);
+    int result = http_put(docker, url, "application/x-tar", data, length);
+    g_free(url);
+    return result;
+}
+
+int docker_container_put_archive_stream(Docker* docker,
+                                        const char* container_id,
+                                        const char* path,
+                                        DockerStreamCallback read,
+                                        void* user_data) {
+    char* url = get_archive_url(docker, container_id, path);
+    int result =
+        http_put_stream(docker, url, "application/x-tar", read, user_data);
+    g_free(url);
+    return result;
+}
+
+int docker_container_get_archive(Docker* docker, const char* container_id,
+                                 const char* path, DockerStreamCallback write,
+                                 void* user_data) {
+    char* url = get_archive_url(docker, container_id, path);
+    int result = http_get_stream(docker, url, write, user_data);
+    g_free(url);
+    return result;
+}
+
 void docker_container_free(DockerContainer* container) {
     if (NULL != container->id) {
         free(container->id);
@@ -198,24 +300,38 @@ void docker_mount_free(DockerMount* mount) {
     free(mount);
 }
 
+GPtrArray* docker_container_list_consumers(Docker* docker,
+                                           const char* volume_name) {
+    GPtrArray* consumers = g_ptr_array_new_with_free_func(free);
+
+    DockerContainerIter* containers = docker_container_list(docker);
+    const DockerContainer* container = NULL;
+    while (NULL != (container = docker_container_iter_next(containers))) {
+        if (NULL == container->mounts) {
+            continue;
+        }
+
+        const DockerMount* mount = NULL;
+        while (NULL != (mount = docker_mount_iter_next(container->mounts))) {
+            if (!strcmp(mount->source, volume_name)) {
+                g_ptr_array_add(consumers, strdup(container->id));
+            }
+        }
+    }
+
+    docker_container_iter_free(containers);
+    return consumers;
+}
+
 int docker_container_pause(Docker* docker, const char* container_id) {
     char* pause_url = string_append_new(
         string_append_new(strdup("http://localhost/containers/"),
                           container_id),
         "/pause");
     assert(NULL != pause_url);
-    int result = http_post(docker, pause_url);
+    // The daemon responds with 204 No Content.
+    int result = http_post_without_response(docker, pause_url);
     free(pause_url);
-
-    if (NULL != docker->write_object) {
-        json_object* message =
-            json_object_object_get(docker->write_object, "message");
-        fprintf(stderr, "%s:%d:Docker daemon says: %s\n", __FUNCTION__,
-                __LINE__, json_object_get_string(message));
-        json_object_put(docker->write_object);
-        return 1;
-    }
-
     return result;
 }
 
@@ -225,18 +341,8 @@ int docker_container_unpause(Docker* docker, const char* container_id) {
                           container_id),
         "/unpause");
     assert(NULL != unpause_url);
-    int result = http_post(docker, unpause_url);
+    int result = http_post_without_response(docker, unpause_url);
     free(unpause_url);
-
-    if (NULL != docker->write_object) {
-        json_object* message =
-            json_object_object_get(docker->write_object, "message");
-        fprintf(stderr, "%s:%d:Docker daemon says: %s\n", __FUNCTION__,
-                __LINE__, json_object_get_string(message));
-        json_object_put(docker->write_object);
-        return 1;
-    }
-
     return result;
 }
 
@@ -7,7 +7,7 @@
 //
 // CREATED:         02/13/2022
 //
-// LAST EDITED:     01/03/2023
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -45,9 +45,31 @@ int http_post_application_json(Docker* docker, const char* url);
 // POST without a request object
 int http_post(Docker* docker, const char* url);
 
+// POST without a request object, for endpoints which don't respond with a
+// JSON object
+int http_post_without_response(Docker* docker, const char* url);
+
 // DELETE without a request object
 int http_delete(Docker* docker, const char* url);
 
+// DELETE, for endpoints which don't respond with a JSON object
+int http_delete_without_response(Docker* docker, const char* url);
+
+// PUT <length> bytes at <data> as a request of <content_type>. The data is
+// sent from where it is. The response is discarded.
+int http_put(Docker* docker, const char* url, const char* content_type,
+             const void* data, size_t length);
+
+// PUT the data produced by <read>, until it returns 0. The response is
+// discarded.
+int http_put_stream(Docker* docker, const char* url,
+                    const char* content_type, DockerStreamCallback read,
+                    void* user_data);
+
+// GET, passing the response to <write>
+int http_get_stream(Docker* docker, const char* url,
+                    DockerStreamCallback write, void* user_data);
+
 #endif // VOLUMETRIC_DOCKER_INTERNAL_H
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         02/13/2022
 //
-// LAST EDITED:     01/07/2023
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -29,6 +29,7 @@
 #include <string.h>
 
 #include <curl/curl.h>
+#include <glib-2.0/glib.h>
 #include <json-c/json.h>
 #include <json-c/json_tokener.h>
 
@@ -41,6 +42,9 @@
 
 static const char* DOCKER_SOCK_PATH = "/var/run/docker.sock";
 
+_Static_assert(DOCKER_STREAM_ABORT == CURL_READFUNC_ABORT,
+               "DOCKER_STREAM_ABORT must abort curl uploads");
+
 static size_t copy_data_to_curl_request(char* buffer,
                                         size_t size __attribute__((unused)),
                                         size_t nitems, void* user_data) {
@@ -79,6 +83,49 @@ static size_t copy_data_from_curl_response(void* buffer,
     return nmemb;
 }
 
+// Report the outcome of a transfer whose response isn't a JSON object.
+static int http_check_response(CURLcode response, const char* error_buffer) {
+    if (CURLE_OK != response) {
+        fprintf(stderr, "%s:%d:Error during call to docker daemon: %s (%s)\n",
+                __FILE__, __LINE__, error_buffer,
+                curl_easy_strerror(response));
+        return -EIO;
+    }
+
+    return 0;
+}
+
+static size_t discard_curl_response(void* buffer __attribute__((unused)),
+                                    size_t size, size_t nmemb,
+                                    void* user_data __attribute__((unused))) {
+    return size * nmemb;
+}
+
+// Perform a request whose response body is passed to <write>, or discarded
+// if it's NULL.
+static int http_perform_stream(Docker* docker, const char* url,
+                               DockerStreamCallback write, void* user_data) {
+    curl_easy_setopt(docker->curl, CURLOPT_URL, url);
+    if (NULL != write) {
+        curl_easy_setopt(docker->curl, CURLOPT_WRITEFUNCTION, write);
+        curl_easy_setopt(docker->curl, CURLOPT_WRITEDATA, user_data);
+    } else {
+        curl_easy_setopt(docker->curl, CURLOPT_WRITEFUNCTION,
+                         discard_curl_response);
+    }
+
+    char error_buffer[CURL_ERROR_SIZE] = {0};
+    curl_easy_setopt(docker->curl, CURLOPT_ERRORBUFFER, error_buffer);
+    int result =
+        http_check_response(curl_easy_perform(docker->curl), error_buffer);
+
+    // Reset state incurred by this function
+    curl_easy_setopt(docker->curl, CURLOPT_WRITEFUNCTION, NULL);
+    curl_easy_setopt(docker->curl, CURLOPT_WRITEDATA, NULL);
+    curl_easy_setopt(docker->curl, CURLOPT_ERRORBUFFER, NULL);
+    return result;
+}
+
 static int http_read_application_json(Docker* docker, const char* url) {
     docker->tokener = json_tokener_new();
     curl_easy_setopt(docker->curl, CURLOPT_URL, url);
@@ -164,6 +211,7 @@ int http_post_application_json(Docker* docker, const char* url) {
     curl_easy_setopt(docker->curl, CURLOPT_HTTPHEADER, NULL);
     curl_easy_setopt(docker->curl, CURLOPT_READFUNCTION, NULL);
     curl_easy_setopt(docker->curl, CURLOPT_READDATA, NULL);
+    curl_slist_free_all(headers);
 
     return result;
 }
@@ -173,13 +221,97 @@ int http_post(Docker* docker, const char* url) {
     return http_read_application_json(docker, url);
 }
 
+int http_post_without_response(Docker* docker, const char* url) {
+    // An empty request body, rather than one read from stdin.
+    curl_easy_setopt(docker->curl, CURLOPT_POSTFIELDS, "");
+    curl_easy_setopt(docker->curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                     (curl_off_t)0);
+    int result = http_perform_stream(docker, url, NULL, NULL);
+
+    // Reset state incurred by this function
+    curl_easy_setopt(docker->curl, CURLOPT_POSTFIELDS, NULL);
+    curl_easy_setopt(docker->curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                     (curl_off_t)-1);
+    curl_easy_setopt(docker->curl, CURLOPT_HTTPGET, 1);
+    return result;
+}
+
 int http_delete(Docker* docker, const char* url) {
+    // Otherwise, a request body is read after a POST.
+    curl_easy_setopt(docker->curl, CURLOPT_HTTPGET, 1);
     curl_easy_setopt(docker->curl, CURLOPT_CUSTOMREQUEST, "DELETE");
     int result = http_read_application_json(docker, url);
     curl_easy_setopt(docker->curl, CURLOPT_CUSTOMREQUEST, NULL);
     return result;
 }
 
+int http_delete_without_response(Docker* docker, const char* url) {
+    curl_easy_setopt(docker->curl, CURLOPT_HTTPGET, 1);
+    curl_easy_setopt(docker->curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+    int result = http_perform_stream(docker, url, NULL, NULL);
+    curl_easy_setopt(docker->curl, CURLOPT_CUSTOMREQUEST, NULL);
+    return result;
+}
+
+int http_put(Docker* docker, const char* url, const char* content_type,
+             const void* data, size_t length) {
+    // libcurl sends the request body from <data>, without copying it.
+    curl_easy_setopt(docker->curl, CURLOPT_POSTFIELDS, data);
+    curl_easy_setopt(docker->curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                     (curl_off_t)length);
+    curl_easy_setopt(docker->curl, CURLOPT_CUSTOMREQUEST, "PUT");
+    struct curl_slist* headers = NULL;
+    char* content_type_header =
+        g_strdup_printf("Content-Type: %s", content_type);
+    headers = curl_slist_append(headers, content_type_header);
+    curl_easy_setopt(docker->curl, CURLOPT_HTTPHEADER, headers);
+
+    int result = http_perform_stream(docker, url, NULL, NULL);
+
+    // Reset state incurred by this function
+    curl_easy_setopt(docker->curl, CURLOPT_HTTPHEADER, NULL);
+    curl_easy_setopt(docker->curl, CURLOPT_CUSTOMREQUEST, NULL);
+    curl_easy_setopt(docker->curl, CURLOPT_POSTFIELDS, NULL);
+    curl_easy_setopt(docker->curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                     (curl_off_t)-1);
+    curl_easy_setopt(docker->curl, CURLOPT_HTTPGET, 1);
+    curl_slist_free_all(headers);
+    g_free(content_type_header);
+    return result;
+}
+
+int http_put_stream(Docker* docker, const char* url,
+                    const char* content_type, DockerStreamCallback read,
+                    void* user_data) {
+    // Without a size, the body is sent with chunked transfer encoding.
+    curl_easy_setopt(docker->curl, CURLOPT_UPLOAD, 1);
+    curl_easy_setopt(docker->curl, CURLOPT_READFUNCTION, read);
+    curl_easy_setopt(docker->curl, CURLOPT_READDATA, user_data);
+    struct curl_slist* headers = NULL;
+    char* content_type_header =
+        g_strdup_printf("Content-Type: %s", content_type);
+    headers = curl_slist_append(headers, content_type_header);
+    curl_easy_setopt(docker->curl, CURLOPT_HTTPHEADER, headers);
+
+    int result = http_perform_stream(docker, url, NULL, NULL);
+
+    // Reset state incurred by this function
+    curl_easy_setopt(docker->curl, CURLOPT_HTTPHEADER, NULL);
+    curl_easy_setopt(docker->curl, CURLOPT_READFUNCTION, NULL);
+    curl_easy_setopt(docker->curl, CURLOPT_READDATA, NULL);
+    curl_easy_setopt(docker->curl, CURLOPT_UPLOAD, 0);
+    curl_easy_setopt(docker->curl, CURLOPT_HTTPGET, 1);
+    curl_slist_free_all(headers);
+    g_free(content_type_header);
+    return result;
+}
+
+int http_get_stream(Docker* docker, const char* url,
+                    DockerStreamCallback write, void* user_data) {
+    curl_easy_setopt(docker->curl, CURLOPT_HTTPGET, 1);
+    return http_perform_stream(docker, url, write, user_data);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public API
 ////
@@ -7,7 +7,7 @@
 //
 // CREATED:         01/18/2022
 //
-// LAST EDITED:     01/03/2023
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -68,14 +68,8 @@ static void populate_docker_volume_from_json(DockerVolume* volume,
     }
 }
 
-///////////////////////////////////////////////////////////////////////////////
-// Public API
-////
-
-DockerVolume* docker_volume_create(Docker* docker, const char* name) {
-    // Create json_object for request
-    json_object* request = json_object_new_object();
-    json_object_object_add(request, "Name", json_object_new_string(name));
+static DockerVolume* docker_volume_create_from_request(Docker* docker,
+                                                       json_object* request) {
     docker->read_object = NULL;
     if (0 != http_encode(request, &docker->read_object,
                          &docker->read_object_length)) {
@@ -105,6 +99,37 @@ error:
     return NULL;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+DockerVolume* docker_volume_create(Docker* docker, const char* name) {
+    // Create json_object for request
+    json_object* request = json_object_new_object();
+    json_object_object_add(request, "Name", json_object_new_string(name));
+    return docker_volume_create_from_request(docker, request);
+}
+
+DockerVolume* docker_volume_create_local_mount(Docker* docker,
+                                               const char* name,
+                                               const char* type,
+                                               const char* device,
+                                               const char* options) {
+    json_object* driver_options = json_object_new_object();
+    json_object_object_add(driver_options, "type",
+                           json_object_new_string(type));
+    json_object_object_add(driver_options, "device",
+                           json_object_new_string(device));
+    json_object_object_add(driver_options, "o",
+                           json_object_new_string(options));
+
+    json_object* request = json_object_new_object();
+    json_object_object_add(request, "Name", json_object_new_string(name));
+    json_object_object_add(request, "Driver", json_object_new_string("local"));
+    json_object_object_add(request, "DriverOpts", driver_options);
+    return docker_volume_create_from_request(docker, request);
+}
+
 DockerVolumeListIter* docker_volume_list(Docker* docker) {
     DockerVolumeListIter* iter = malloc(sizeof(DockerVolumeListIter));
     if (NULL == iter) {
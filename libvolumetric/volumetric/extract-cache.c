@@ -0,0 +1,473 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            extract-cache.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the extracted tree cache.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fts.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <glib-2.0/glib.h>
+
+#include <volumetric/directory.h>
+#include <volumetric/extract-cache.h>
+#include <volumetric/hash.h>
+
+// Layout of the cache directory:
+//  .lock                 Shared while entries are open, exclusive to evict.
+//  .staging-XXXXXX/      Archives that are currently being extracted.
+//  <hash-type>-<hash>/
+//      tree/             The extracted archive.
+//      size              Disk usage of tree, in bytes.
+//      pins/<owner>      Owners which need the tree to stay, if any.
+// The modification time of an entry directory is its last use.
+static const char* LOCK_NAME = ".lock";
+static const char* STAGING_PREFIX = ".staging-";
+static const char* TREE_NAME = "tree";
+static const char* SIZE_NAME = "size";
+static const char* PINS_NAME = "pins";
+
+// Staging directories older than this were left behind by a crash.
+static const time_t STALE_STAGING_SECONDS = 24 * 60 * 60;
+
+typedef struct ExtractCache {
+    char* directory;
+    char* lock_path;
+    uint64_t max_size;
+} ExtractCache;
+
+typedef struct ExtractCacheEntry {
+    ExtractCache* cache;
+    int lock_fd;
+    char* tree;
+} ExtractCacheEntry;
+
+typedef struct EvictionCandidate {
+    char* path;
+    struct timespec last_used;
+    uint64_t size;
+    bool pinned;
+} EvictionCandidate;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static int lock_cache(ExtractCache* cache, int operation) {
+    int fd = open(cache->lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (0 > fd) {
+        return -errno;
+    }
+
+    while (0 != flock(fd, operation)) {
+        if (EINTR != errno) {
+            int result = -errno;
+            close(fd);
+            return result;
+        }
+    }
+    return fd;
+}
+
+static char* get_entry_path(ExtractCache* cache, const FileHash* hash) {
+    char* hex = file_hash_to_string(hash);
+    char* path = g_strdup_printf("%s/%s-%s", cache->directory,
+                                 file_hash_type_to_string(hash->hash_type),
+                                 hex);
+    free(hex);
+    return path;
+}
+
+// Disk usage of the tree at <path>. Files with several links are counted once
+// per link, so this may overestimate.
+static uint64_t get_tree_size(const char* path) {
+    char* owned_path = strdup(path);
+    char* const paths[] = {owned_path, NULL};
+    FTS* tree = fts_open(paths, FTS_NOCHDIR | FTS_PHYSICAL, 0);
+    if (NULL == tree) {
+        free(owned_path);
+        return 0;
+    }
+
+    uint64_t size = 0;
+    FTSENT* node = NULL;
+    while (NULL != (node = fts_read(tree))) {
+        if (FTS_DP != node->fts_info && NULL != node->fts_statp) {
+            size += (uint64_t)node->fts_statp->st_blocks * 512;
+        }
+    }
+
+    fts_close(tree);
+    free(owned_path);
+    return size;
+}
+
+static int write_entry_size(const char* entry_path, uint64_t size) {
+    char* path = g_strdup_printf("%s/%s", entry_path, SIZE_NAME);
+    FILE* output = fopen(path, "w");
+    g_free(path);
+    if (NULL == output) {
+        return -errno;
+    }
+
+    fprintf(output, "%" PRIu64 "\n", size);
+    return 0 == fclose(output) ? 0 : -errno;
+}
+
+static bool read_entry_size(const char* entry_path, uint64_t* size) {
+    char* path = g_strdup_printf("%s/%s", entry_path, SIZE_NAME);
+    FILE* input = fopen(path, "r");
+    g_free(path);
+    if (NULL == input) {
+        return false;
+    }
+
+    bool valid = 1 == fscanf(input, "%" SCNu64, size);
+    fclose(input);
+    return valid;
+}
+
+static bool entry_is_pinned(const char* entry_path) {
+    char* path = g_strdup_printf("%s/%s", entry_path, PINS_NAME);
+    DIR* pins = opendir(path);
+    g_free(path);
+    if (NULL == pins) {
+        return false;
+    }
+
+    bool pinned = false;
+    struct dirent* pin = NULL;
+    while (!pinned && NULL != (pin = readdir(pins))) {
+        pinned = strcmp(".", pin->d_name) && strcmp("..", pin->d_name);
+    }
+    closedir(pins);
+    return pinned;
+}
+
+// Remove the pins of <owner> from every entry but <except> (which may be
+// NULL). Must be called with the cache locked.
+static void remove_pins(ExtractCache* cache, const char* owner,
+                        const char* except) {
+    DIR* directory = opendir(cache->directory);
+    if (NULL == directory) {
+        return;
+    }
+
+    struct dirent* entry = NULL;
+    while (NULL != (entry = readdir(directory))) {
+        if ('.' == entry->d_name[0]) {
+            continue;
+        }
+
+        char* entry_path =
+            g_strdup_printf("%s/%s", cache->directory, entry->d_name);
+        if (NULL == except || strcmp(entry_path, except)) {
+            char* pin = g_strdup_printf("%s/%s/%s", entry_path, PINS_NAME,
+                                        owner);
+            unlink(pin);
+            g_free(pin);
+        }
+        g_free(entry_path);
+    }
+    closedir(directory);
+}
+
+static int compare_last_used(const void* first, const void* second) {
+    const EvictionCandidate* a = first;
+    const EvictionCandidate* b = second;
+    if (a->last_used.tv_sec != b->last_used.tv_sec) {
+        return a->last_used.tv_sec < b->last_used.tv_sec ? -1 : 1;
+    }
+    return (a->last_used.tv_nsec > b->last_used.tv_nsec) -
+           (a->last_used.tv_nsec < b->last_used.tv_nsec);
+}
+
+static void clear_candidate(void* data) {
+    g_free(((EvictionCandidate*)data)->path);
+}
+
+// Collect the entries of the cache, removing abandoned staging directories on
+// the way. Must be called with the cache locked exclusively.
+static GArray* get_eviction_candidates(ExtractCache* cache) {
+    GArray* candidates =
+        g_array_new(false, true, sizeof(EvictionCandidate));
+    g_array_set_clear_func(candidates, clear_candidate);
+    DIR* directory = opendir(cache->directory);
+    if (NULL == directory) {
+        return candidates;
+    }
+
+    time_t now = time(NULL);
+    struct dirent* entry = NULL;
+    while (NULL != (entry = readdir(directory))) {
+        if ('.' == entry->d_name[0] &&
+            strncmp(STAGING_PREFIX, entry->d_name, strlen(STAGING_PREFIX))) {
+            continue;
+        }
+
+        EvictionCandidate candidate = {0};
+        candidate.path =
+            g_strdup_printf("%s/%s", cache->directory, entry->d_name);
+        struct stat entry_stat = {0};
+        if (0 != lstat(candidate.path, &entry_stat) ||
+            !S_ISDIR(entry_stat.st_mode)) {
+            g_free(candidate.path);
+            continue;
+        }
+
+        if ('.' == entry->d_name[0]) {
+            if (entry_stat.st_mtime + STALE_STAGING_SECONDS < now) {
+                directory_remove_recursive(candidate.path);
+            }
+            g_free(candidate.path);
+            continue;
+        }
+
+        // Pinned entries still count towards the size of the cache.
+        candidate.last_used = entry_stat.st_mtim;
+        candidate.pinned = entry_is_pinned(candidate.path);
+        if (!read_entry_size(candidate.path, &candidate.size)) {
+            g_free(candidate.path);
+            continue;
+        }
+        g_array_append_val(candidates, candidate);
+    }
+
+    closedir(directory);
+    return candidates;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+ExtractCache* extract_cache_new(const char* directory, uint64_t max_size) {
+    if (0 != mkdir(directory, 0700) && EEXIST != errno) {
+        fprintf(stderr, "Couldn't create extract cache %s: %s\n", directory,
+                strerror(errno));
+        return NULL;
+    }
+
+    ExtractCache* cache = malloc(sizeof(ExtractCache));
+    assert(NULL != cache);
+    cache->directory = strdup(directory);
+    cache->lock_path = g_strdup_printf("%s/%s", directory, LOCK_NAME);
+    cache->max_size = max_size;
+    return cache;
+}
+
+void extract_cache_free(ExtractCache* cache) {
+    free(cache->directory);
+    g_free(cache->lock_path);
+    free(cache);
+}
+
+const char* extract_cache_get_directory(ExtractCache* cache) {
+    return cache->directory;
+}
+
+ExtractCacheEntry* extract_cache_lookup(ExtractCache* cache,
+                                        const FileHash* hash) {
+    int lock_fd = lock_cache(cache, LOCK_SH);
+    if (0 > lock_fd) {
+        return NULL;
+    }
+
+    char* entry_path = get_entry_path(cache, hash);
+    char* tree = g_strdup_printf("%s/%s", entry_path, TREE_NAME);
+    struct stat tree_stat = {0};
+    if (0 != stat(tree, &tree_stat)) {
+        g_free(tree);
+        g_free(entry_path);
+        close(lock_fd);
+        return NULL;
+    }
+
+    // Record the use for eviction.
+    utimensat(AT_FDCWD, entry_path, NULL, 0);
+    g_free(entry_path);
+
+    ExtractCacheEntry* entry = malloc(sizeof(ExtractCacheEntry));
+    assert(NULL != entry);
+    entry->cache = cache;
+    entry->lock_fd = lock_fd;
+    entry->tree = tree;
+    return entry;
+}
+
+char* extract_cache_stage(ExtractCache* cache) {
+    char* staging =
+        g_strdup_printf("%s/%sXXXXXX", cache->directory, STAGING_PREFIX);
+    if (NULL == mkdtemp(staging)) {
+        fprintf(stderr, "Couldn't create staging directory in %s: %s\n",
+                cache->directory, strerror(errno));
+        g_free(staging);
+        return NULL;
+    }
+
+    char* tree = g_strdup_printf("%s/%s", staging, TREE_NAME);
+    g_free(staging);
+    if (0 != mkdir(tree, 0755)) {
+        fprintf(stderr, "Couldn't create %s: %s\n", tree, strerror(errno));
+        extract_cache_discard(cache, tree);
+        g_free(tree);
+        return NULL;
+    }
+
+    // Returned to the caller, who will free(3) it.
+    char* result = strdup(tree);
+    g_free(tree);
+    return result;
+}
+
+ExtractCacheEntry* extract_cache_insert(ExtractCache* cache,
+                                        const FileHash* hash,
+                                        const char* staging) {
+    char* staging_entry = g_path_get_dirname(staging);
+    int result = write_entry_size(staging_entry, get_tree_size(staging));
+    if (0 != result) {
+        fprintf(stderr, "Couldn't record size of %s: %s\n", staging,
+                strerror(-result));
+        extract_cache_discard(cache, staging);
+        g_free(staging_entry);
+        return NULL;
+    }
+
+    // No lock is taken here: rename(2) is atomic, so lookups see either the
+    // whole entry or none of it. Only removal takes the exclusive lock, so
+    // that entries aren't removed while they're open. Taking it here would
+    // wait on every open entry, including any held by whoever waits on us.
+    char* entry_path = get_entry_path(cache, hash);
+    if (0 != rename(staging_entry, entry_path)) {
+        if (EEXIST != errno && ENOTEMPTY != errno) {
+            fprintf(stderr, "Couldn't insert %s into the extract cache: %s\n",
+                    entry_path, strerror(errno));
+        }
+        extract_cache_discard(cache, staging);
+    }
+
+    g_free(entry_path);
+    g_free(staging_entry);
+    return extract_cache_lookup(cache, hash);
+}
+
+void extract_cache_discard(ExtractCache* cache, const char* staging) {
+    (void)cache;
+    char* staging_entry = g_path_get_dirname(staging);
+    directory_remove_recursive(staging_entry);
+    g_free(staging_entry);
+}
+
+int extract_cache_entry_clone(ExtractCacheEntry* entry,
+                              const char* destination,
+                              DirectoryCloneMode mode) {
+    return directory_clone(entry->tree, destination, mode);
+}
+
+const char* extract_cache_entry_get_tree(ExtractCacheEntry* entry) {
+    return entry->tree;
+}
+
+int extract_cache_entry_pin(ExtractCacheEntry* entry, const char* owner) {
+    // The entry is open, so the cache is locked.
+    char* entry_path = g_path_get_dirname(entry->tree);
+    char* pins = g_strdup_printf("%s/%s", entry_path, PINS_NAME);
+    char* pin = g_strdup_printf("%s/%s", pins, owner);
+    int result = 0;
+    if (0 != mkdir(pins, 0700) && EEXIST != errno) {
+        result = -errno;
+    } else {
+        int fd = open(pin, O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+        if (0 > fd) {
+            result = -errno;
+        } else {
+            close(fd);
+            remove_pins(entry->cache, owner, entry_path);
+        }
+    }
+
+    g_free(pin);
+    g_free(pins);
+    g_free(entry_path);
+    return result;
+}
+
+void extract_cache_unpin(ExtractCache* cache, const char* owner) {
+    int lock_fd = lock_cache(cache, LOCK_SH);
+    if (0 > lock_fd) {
+        return;
+    }
+    remove_pins(cache, owner, NULL);
+    close(lock_fd);
+}
+
+void extract_cache_entry_close(ExtractCacheEntry* entry) {
+    close(entry->lock_fd);
+    g_free(entry->tree);
+    free(entry);
+}
+
+void extract_cache_evict(ExtractCache* cache) {
+    int lock_fd = lock_cache(cache, LOCK_EX);
+    if (0 > lock_fd) {
+        fprintf(stderr, "Couldn't lock extract cache %s: %s\n",
+                cache->directory, strerror(-lock_fd));
+        return;
+    }
+
+    GArray* candidates = get_eviction_candidates(cache);
+    g_array_sort(candidates, compare_last_used);
+    uint64_t total_size = 0;
+    for (guint i = 0; i < candidates->len; ++i) {
+        total_size += g_array_index(candidates, EvictionCandidate, i).size;
+    }
+
+    for (guint i = 0; i < candidates->len && total_size > cache->max_size;
+         ++i) {
+        EvictionCandidate* candidate =
+            &g_array_index(candidates, EvictionCandidate, i);
+        if (!candidate->pinned &&
+            0 == directory_remove_recursive(candidate->path)) {
+            total_size -= candidate->size;
+        }
+    }
+
+    g_array_unref(candidates);
+    close(lock_fd);
+}
+
+///////////////////////////////////////////////////////////////////////////////
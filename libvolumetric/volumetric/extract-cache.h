@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            extract-cache.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Cache of extracted archive trees, keyed by the hash
+//                  of the archive.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#ifndef VOLUMETRIC_EXTRACT_CACHE_H
+#define VOLUMETRIC_EXTRACT_CACHE_H
+
+#include <stdint.h>
+
+#include <volumetric/directory.h>
+
+typedef struct FileHash FileHash;
+
+// The cache holds the trees of archives that have been extracted on this host,
+// so that checking out the same archive again only requires cloning the tree.
+// Entries are evicted, least recently used first, once the cache grows past
+// its maximum size, unless they're pinned. The cache may be shared between
+// threads and processes.
+typedef struct ExtractCache ExtractCache;
+
+// An entry in the cache. The entry won't be evicted while it's open.
+typedef struct ExtractCacheEntry ExtractCacheEntry;
+
+// Open the cache in <directory>, which is created if it doesn't exist.
+ExtractCache* extract_cache_new(const char* directory, uint64_t max_size);
+void extract_cache_free(ExtractCache* cache);
+const char* extract_cache_get_directory(ExtractCache* cache);
+
+// Open the entry for the archive with <hash>, or return NULL if there isn't
+// one.
+ExtractCacheEntry* extract_cache_lookup(ExtractCache* cache,
+                                        const FileHash* hash);
+
+// Create an empty directory in the cache to extract an archive into. The path
+// must be free'd, and passed to either extract_cache_insert or
+// extract_cache_discard.
+char* extract_cache_stage(ExtractCache* cache);
+
+// Turn a staged directory into the entry for <hash>, and open it. If another
+// thread inserted the same archive in the meantime, that entry is opened
+// instead. Returns NULL on failure, in which case the staged tree is removed.
+ExtractCacheEntry* extract_cache_insert(ExtractCache* cache,
+                                        const FileHash* hash,
+                                        const char* staging);
+void extract_cache_discard(ExtractCache* cache, const char* staging);
+
+// Recreate the tree of <entry> underneath the (existing) <destination>.
+// Returns 0 on success, or a negative errno.
+int extract_cache_entry_clone(ExtractCacheEntry* entry,
+                              const char* destination,
+                              DirectoryCloneMode mode);
+void extract_cache_entry_close(ExtractCacheEntry* entry);
+
+// Path of the extracted tree of <entry>, which must not be modified. It stays
+// valid while the entry is open or pinned.
+const char* extract_cache_entry_get_tree(ExtractCacheEntry* entry);
+
+// Keep <entry> from being evicted on behalf of <owner>, e.g. a volume which
+// uses the tree directly, until it's unpinned. An owner only pins one entry
+// at a time, so any other entry pinned by <owner> is unpinned. Returns 0 on
+// success, or a negative errno.
+int extract_cache_entry_pin(ExtractCacheEntry* entry, const char* owner);
+
+// Remove the pin of <owner>, if there is one.
+void extract_cache_unpin(ExtractCache* cache, const char* owner);
+
+// Remove least recently used entries until the cache fits in its maximum
+// size. Waits for open entries to be closed.
+void extract_cache_evict(ExtractCache* cache);
+
+#endif // VOLUMETRIC_EXTRACT_CACHE_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,365 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            gzip-writer.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the block-parallel gzip writer.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <archive.h>
+#include <glib-2.0/glib.h>
+#include <zlib.h>
+
+#include <volumetric/gzip-writer.h>
+
+// Size of the deflate history window, in bytes.
+#define WINDOW_SIZE 32768
+
+// Uncompressed bytes per block. Each block costs the few bytes of its sync
+// flush, and the matches which would have reached back into the block before
+// it further than the window.
+static const size_t BLOCK_SIZE = 1024 * 1024;
+static const int COMPRESSION_LEVEL = Z_DEFAULT_COMPRESSION;
+
+// Blocks compressed or waiting to be written, per worker. Bounds the memory
+// used when the workers are faster than the disk, or the other way around.
+static const guint BLOCKS_PER_WORKER = 2;
+
+// Member header: magic, deflate, no flags, no mtime, no extra flags, Unix
+static const unsigned char GZIP_HEADER[10] = {0x1f, 0x8b, 8, 0, 0,
+                                              0,    0,    0, 0, 3};
+
+typedef struct GzipBlock {
+    unsigned char* input;
+    size_t input_length;
+    unsigned char dictionary[WINDOW_SIZE];
+    size_t dictionary_length;
+    bool last;
+
+    // Set by the worker
+    unsigned char* output;
+    size_t output_length;
+    uLong crc;
+    int result;
+    bool done;
+} GzipBlock;
+
+typedef struct GzipWriter {
+    int fd;
+    char* path;
+    struct archive* archive;
+    int error;
+
+    GThreadPool* workers;
+    GMutex lock;
+    GCond block_done;
+    GQueue* blocks; // Submitted blocks, in order, until they're written
+    guint max_blocks;
+
+    // The block being filled, and the last WINDOW_SIZE bytes before it
+    unsigned char* block;
+    size_t block_length;
+    unsigned char window[WINDOW_SIZE];
+    size_t window_length;
+
+    // For the trailer, of the blocks written so far
+    uLong crc;
+    uint64_t uncompressed_size;
+} GzipWriter;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static int write_all(int fd, const void* buffer, size_t length) {
+    const unsigned char* data = buffer;
+    while (0 < length) {
+        ssize_t written = write(fd, data, length);
+        if (0 > written) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return -errno;
+        }
+
+        data += written;
+        length -= written;
+    }
+
+    return 0;
+}
+
+static void put_u32_le(unsigned char* buffer, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        buffer[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+// GFunc: compress a block, on a worker thread.
+static void gzip_block_compress(gpointer data, gpointer user_data) {
+    GzipBlock* block = (GzipBlock*)data;
+    GzipWriter* writer = (GzipWriter*)user_data;
+    int result = 0;
+    z_stream stream = {0};
+    if (Z_OK != deflateInit2(&stream, COMPRESSION_LEVEL, Z_DEFLATED,
+                             -MAX_WBITS, 8, Z_DEFAULT_STRATEGY)) {
+        result = -ENOMEM;
+    } else {
+        if (0 < block->dictionary_length) {
+            deflateSetDictionary(&stream, block->dictionary,
+                                 block->dictionary_length);
+        }
+
+        // The sync flush appends an empty stored block, of a few bytes.
+        size_t capacity = deflateBound(&stream, block->input_length) + 16;
+        block->output = malloc(capacity);
+        assert(NULL != block->output);
+        stream.next_in = block->input;
+        stream.avail_in = block->input_length;
+        stream.next_out = block->output;
+        stream.avail_out = capacity;
+        int status = deflate(&stream, block->last ? Z_FINISH : Z_SYNC_FLUSH);
+        if ((block->last && Z_STREAM_END != status) ||
+            (!block->last && Z_OK != status) || 0 != stream.avail_in ||
+            0 == stream.avail_out) {
+            result = -EIO;
+        }
+        block->output_length = capacity - stream.avail_out;
+        deflateEnd(&stream);
+    }
+
+    block->crc = crc32(0, block->input, block->input_length);
+    free(block->input);
+    block->input = NULL;
+
+    g_mutex_lock(&writer->lock);
+    block->result = result;
+    block->done = true;
+    g_cond_broadcast(&writer->block_done);
+    g_mutex_unlock(&writer->lock);
+}
+
+// Write the submitted blocks out, in order, until at most <max_blocks> are
+// left. Returns (and records) the first error.
+static int gzip_writer_drain(GzipWriter* writer, guint max_blocks) {
+    g_mutex_lock(&writer->lock);
+    while (max_blocks < g_queue_get_length(writer->blocks)) {
+        GzipBlock* block = g_queue_peek_head(writer->blocks);
+        while (!block->done) {
+            g_cond_wait(&writer->block_done, &writer->lock);
+        }
+        g_queue_pop_head(writer->blocks);
+        g_mutex_unlock(&writer->lock);
+
+        // Blocks after an error are still waited for, but not written.
+        if (0 == writer->error && 0 != block->result) {
+            fprintf(stderr, "%s: deflate failed\n", writer->path);
+            writer->error = block->result;
+        }
+        if (0 == writer->error) {
+            writer->error =
+                write_all(writer->fd, block->output, block->output_length);
+            if (0 != writer->error) {
+                fprintf(stderr, "%s: write failed: %s\n", writer->path,
+                        strerror(-writer->error));
+            }
+        }
+        writer->crc =
+            crc32_combine(writer->crc, block->crc, block->input_length);
+        writer->uncompressed_size += block->input_length;
+        free(block->output);
+        free(block);
+
+        g_mutex_lock(&writer->lock);
+    }
+    g_mutex_unlock(&writer->lock);
+    return writer->error;
+}
+
+// Hand the current block to the workers.
+static int gzip_writer_submit(GzipWriter* writer, bool last) {
+    GzipBlock* block = calloc(1, sizeof(GzipBlock));
+    assert(NULL != block);
+    block->input = writer->block;
+    block->input_length = writer->block_length;
+    block->last = last;
+    memcpy(block->dictionary, writer->window, writer->window_length);
+    block->dictionary_length = writer->window_length;
+
+    // Slide the window over the block.
+    if (WINDOW_SIZE <= block->input_length) {
+        memcpy(writer->window,
+               block->input + block->input_length - WINDOW_SIZE,
+               WINDOW_SIZE);
+        writer->window_length = WINDOW_SIZE;
+    } else {
+        size_t keep =
+            MIN(writer->window_length, WINDOW_SIZE - block->input_length);
+        memmove(writer->window,
+                writer->window + writer->window_length - keep, keep);
+        memcpy(writer->window + keep, block->input, block->input_length);
+        writer->window_length = keep + block->input_length;
+    }
+
+    writer->block = NULL;
+    writer->block_length = 0;
+    if (!last) {
+        writer->block = malloc(BLOCK_SIZE);
+        assert(NULL != writer->block);
+    }
+
+    g_mutex_lock(&writer->lock);
+    g_queue_push_tail(writer->blocks, block);
+    g_mutex_unlock(&writer->lock);
+    g_thread_pool_push(writer->workers, block, NULL);
+    return gzip_writer_drain(writer, writer->max_blocks);
+}
+
+static la_ssize_t gzip_writer_write(struct archive* archive, void* user_data,
+                                    const void* buffer, size_t length) {
+    GzipWriter* writer = (GzipWriter*)user_data;
+    const unsigned char* input = buffer;
+    size_t remaining = length;
+    while (0 < remaining) {
+        size_t copy_length = MIN(BLOCK_SIZE - writer->block_length, remaining);
+        memcpy(writer->block + writer->block_length, input, copy_length);
+        writer->block_length += copy_length;
+        input += copy_length;
+        remaining -= copy_length;
+
+        if (BLOCK_SIZE == writer->block_length &&
+            0 != gzip_writer_submit(writer, false)) {
+            archive_set_error(archive, -writer->error,
+                              "Couldn't write block");
+            return -1;
+        }
+    }
+
+    return (la_ssize_t)length;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+GzipWriter* gzip_writer_new(const char* path, unsigned int threads) {
+    GzipWriter* writer = calloc(1, sizeof(GzipWriter));
+    if (NULL == writer) {
+        return NULL;
+    }
+
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (0 > writer->fd) {
+        fprintf(stderr, "%s:%d: Couldn't open %s for writing: %s\n",
+                __FUNCTION__, __LINE__, path, strerror(errno));
+        free(writer);
+        return NULL;
+    }
+
+    writer->error = write_all(writer->fd, GZIP_HEADER, sizeof(GZIP_HEADER));
+    if (0 != writer->error) {
+        fprintf(stderr, "%s: write failed: %s\n", path,
+                strerror(-writer->error));
+        close(writer->fd);
+        free(writer);
+        return NULL;
+    }
+
+    if (0 == threads) {
+        threads = g_get_num_processors();
+    }
+    writer->path = strdup(path);
+    writer->workers = g_thread_pool_new(gzip_block_compress, writer, threads,
+                                        FALSE, NULL);
+    g_mutex_init(&writer->lock);
+    g_cond_init(&writer->block_done);
+    writer->blocks = g_queue_new();
+    writer->max_blocks = threads * BLOCKS_PER_WORKER;
+    writer->block = malloc(BLOCK_SIZE);
+    assert(NULL != writer->workers && NULL != writer->block);
+    writer->crc = crc32(0, NULL, 0);
+
+    writer->archive = archive_write_new();
+    archive_write_set_format_pax_restricted(writer->archive);
+    archive_write_add_filter_none(writer->archive);
+    // Data reaches the callback in the blocks it was written in, rather than
+    // copied into 10 KiB records first.
+    archive_write_set_bytes_per_block(writer->archive, 0);
+    archive_write_set_bytes_in_last_block(writer->archive, 1);
+    int result = archive_write_open(writer->archive, writer, NULL,
+                                    gzip_writer_write, NULL);
+    assert(ARCHIVE_OK == result);
+    return writer;
+}
+
+struct archive* gzip_writer_get_archive(GzipWriter* writer) {
+    return writer->archive;
+}
+
+int gzip_writer_close(GzipWriter* writer) {
+    // Writes the end-of-archive marker into the last block.
+    if (ARCHIVE_OK != archive_write_close(writer->archive) &&
+        0 == writer->error) {
+        fprintf(stderr, "%s: %s\n", writer->path,
+                archive_error_string(writer->archive));
+        writer->error = -EIO;
+    }
+    archive_write_free(writer->archive);
+
+    if (0 == writer->error) {
+        gzip_writer_submit(writer, true);
+    }
+    gzip_writer_drain(writer, 0);
+    g_thread_pool_free(writer->workers, FALSE, TRUE);
+
+    int result = writer->error;
+    if (0 == result) {
+        unsigned char trailer[8] = {0};
+        put_u32_le(trailer, writer->crc);
+        put_u32_le(trailer + 4, writer->uncompressed_size & 0xffffffff);
+        result = write_all(writer->fd, trailer, sizeof(trailer));
+    }
+    if (0 != close(writer->fd) && 0 == result) {
+        result = -errno;
+    }
+
+    g_queue_free(writer->blocks);
+    g_mutex_clear(&writer->lock);
+    g_cond_clear(&writer->block_done);
+    free(writer->block);
+    free(writer->path);
+    free(writer);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            gzip-writer.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Block-parallel gzip compression of tar archives.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#ifndef VOLUMETRIC_GZIP_WRITER_H
+#define VOLUMETRIC_GZIP_WRITER_H
+
+// The tar stream is cut into fixed-size blocks, which are compressed by
+// worker threads as raw deflate streams, each primed with the last 32 KiB of
+// the block before it. Every block but the last ends on a byte boundary
+// (with a sync flush), so the blocks are simply concatenated into a single
+// gzip member, which any gzip decoder can read.
+
+struct archive;
+
+typedef struct GzipWriter GzipWriter;
+
+// Create a .tar.gz archive at <path>, compressed by up to <threads> workers
+// (0 for one per CPU). Entries are written to the archive returned by
+// gzip_writer_get_archive().
+GzipWriter* gzip_writer_new(const char* path, unsigned int threads);
+struct archive* gzip_writer_get_archive(GzipWriter* writer);
+
+// Flush the remaining data and the gzip trailer, and free the writer. Returns
+// 0 on success, or a negative errno.
+int gzip_writer_close(GzipWriter* writer);
+
+#endif // VOLUMETRIC_GZIP_WRITER_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         01/22/2022
 //
-// LAST EDITED:     01/01/2023
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -49,20 +49,22 @@ static void convert_hex_string_to_bytes(const char* string,
     *byte_array = result;
 }
 
-static void get_md5_hash(void* buffer, size_t length, unsigned char* hash_out,
-                         unsigned int* hash_length) {
-    assert(EVP_MAX_MD_SIZE <= *hash_length);
-    const EVP_MD* digest = EVP_get_digestbyname("MD5");
-    assert(NULL != digest);
-
-    EVP_MD_CTX* context = EVP_MD_CTX_new();
-    EVP_DigestInit_ex(context, digest, NULL);
-    EVP_DigestUpdate(context, buffer, length);
-
-    EVP_DigestFinal_ex(context, hash_out, hash_length);
-    EVP_MD_CTX_free(context);
+static const EVP_MD* get_digest_for_type(FileHashType hash_type) {
+    switch (hash_type) {
+    case FILE_HASH_TYPE_MD5:
+        return EVP_get_digestbyname("MD5");
+    case FILE_HASH_TYPE_SHA256:
+        return EVP_get_digestbyname("SHA256");
+    default:
+        return NULL;
+    }
 }
 
+typedef struct FileHashContext {
+    FileHashType hash_type;
+    EVP_MD_CTX* context;
+} FileHashContext;
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public API
 ////
@@ -72,6 +74,8 @@ FileHashType file_hash_type_from_string(const char* string) {
     // to lowercase instead of comparing both versions.
     if (!strcmp("md5", string) || !strcmp("MD5", string)) {
         return FILE_HASH_TYPE_MD5;
+    } else if (!strcmp("sha256", string) || !strcmp("SHA256", string)) {
+        return FILE_HASH_TYPE_SHA256;
     } else {
         fprintf(stderr, "Unknown hash type: %s\n", string);
         return FILE_HASH_TYPE_INVALID;
@@ -82,6 +86,8 @@ const char* file_hash_type_to_string(FileHashType hash_type) {
     switch (hash_type) {
     case FILE_HASH_TYPE_MD5:
         return "md5";
+    case FILE_HASH_TYPE_SHA256:
+        return "sha256";
     case FILE_HASH_TYPE_INVALID:
         return "invalid";
     default:
@@ -91,32 +97,13 @@ const char* file_hash_type_to_string(FileHashType hash_type) {
 
 FileHash* file_hash_of_buffer(FileHashType hash_type, void* buffer,
                               size_t length) {
-    FileHash* file_hash = malloc(sizeof(FileHash));
-    if (NULL == file_hash) {
+    FileHashContext* context = file_hash_context_new(hash_type);
+    if (NULL == context) {
         return NULL;
     }
-    memset(file_hash, 0, sizeof(FileHash));
 
-    if (FILE_HASH_TYPE_MD5 == hash_type) {
-        file_hash->hash_type = hash_type;
-        unsigned int hash_length = EVP_MAX_MD_SIZE;
-        file_hash->hash_string = malloc(hash_length);
-        if (NULL == file_hash->hash_string) {
-            free(file_hash);
-            return NULL;
-        }
-        memset(file_hash->hash_string, 0, hash_length);
-
-        get_md5_hash(buffer, length, (unsigned char*)file_hash->hash_string,
-                     &hash_length);
-        file_hash->hash_length = (size_t)hash_length;
-    } else {
-        fprintf(stderr, "%s:%d: Unknown FileHashType", __FILE__, __LINE__);
-        free(file_hash);
-        return NULL;
-    }
-
-    return file_hash;
+    file_hash_context_update(context, buffer, length);
+    return file_hash_context_finish(context);
 }
 
 FileHash* file_hash_from_string(FileHashType type, const char* hex_string) {
@@ -167,4 +154,56 @@ bool file_hash_equal(const FileHash* first, const FileHash* second) {
                    first->hash_length);
 }
 
+FileHashContext* file_hash_context_new(FileHashType hash_type) {
+    const EVP_MD* digest = get_digest_for_type(hash_type);
+    if (NULL == digest) {
+        fprintf(stderr, "%s:%d: Unknown FileHashType\n", __FILE__, __LINE__);
+        return NULL;
+    }
+
+    FileHashContext* context = malloc(sizeof(FileHashContext));
+    if (NULL == context) {
+        return NULL;
+    }
+
+    context->hash_type = hash_type;
+    context->context = EVP_MD_CTX_new();
+    assert(NULL != context->context);
+    EVP_DigestInit_ex(context->context, digest, NULL);
+    return context;
+}
+
+void file_hash_context_update(FileHashContext* context, const void* buffer,
+                              size_t length) {
+    EVP_DigestUpdate(context->context, buffer, length);
+}
+
+FileHash* file_hash_context_finish(FileHashContext* context) {
+    FileHash* file_hash = malloc(sizeof(FileHash));
+    if (NULL == file_hash) {
+        EVP_MD_CTX_free(context->context);
+        free(context);
+        return NULL;
+    }
+    memset(file_hash, 0, sizeof(FileHash));
+
+    file_hash->hash_type = context->hash_type;
+    unsigned int hash_length = EVP_MAX_MD_SIZE;
+    file_hash->hash_string = malloc(hash_length);
+    if (NULL == file_hash->hash_string) {
+        EVP_MD_CTX_free(context->context);
+        free(context);
+        free(file_hash);
+        return NULL;
+    }
+    memset(file_hash->hash_string, 0, hash_length);
+
+    EVP_DigestFinal_ex(context->context,
+                       (unsigned char*)file_hash->hash_string, &hash_length);
+    file_hash->hash_length = (size_t)hash_length;
+    EVP_MD_CTX_free(context->context);
+    free(context);
+    return file_hash;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
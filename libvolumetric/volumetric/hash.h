@@ -8,7 +8,7 @@
 //
 // CREATED:         01/21/2022
 //
-// LAST EDITED:     01/01/2023
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -35,6 +35,7 @@
 typedef enum FileHashType {
     FILE_HASH_TYPE_INVALID,
     FILE_HASH_TYPE_MD5,
+    FILE_HASH_TYPE_SHA256,
 } FileHashType;
 
 // The Hash string is not necessarily composed of printable characters, so
@@ -70,6 +71,18 @@ void file_hash_free(FileHash* hash);
 // Partial equality check between two file hashes
 bool file_hash_equal(const FileHash* first, const FileHash* second);
 
+// Incremental hashing, for data which is not available all at once (e.g. an
+// archive which is hashed as it's being decompressed).
+typedef struct FileHashContext FileHashContext;
+
+FileHashContext* file_hash_context_new(FileHashType hash_type);
+void file_hash_context_update(FileHashContext* context, const void* buffer,
+                              size_t length);
+
+// Finalize the hash and free the context. The result must be free'd using
+// file_hash_free.
+FileHash* file_hash_context_finish(FileHashContext* context);
+
 #endif // VOLUMETRIC_HASH_H
 
 ///////////////////////////////////////////////////////////////////////////////
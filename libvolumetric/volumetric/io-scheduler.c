@@ -0,0 +1,395 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            io-scheduler.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the per-device stream limits.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#include <glib-2.0/glib.h>
+
+#include <volumetric/io-scheduler.h>
+
+const char* IO_DEVICE_ROTATIONAL = "rotational";
+const char* IO_DEVICE_SOLID_STATE = "solid-state";
+const char* IO_DEVICE_NETWORK = "network";
+
+static const guint DEFAULT_ROTATIONAL_LIMIT = 1;
+static const guint DEFAULT_NETWORK_LIMIT = 2;
+
+// Filesystem types (in /proc/self/mountinfo) whose mount source is a server
+static const char* NETWORK_FILESYSTEMS[] = {
+    "nfs", "nfs4", "cifs", "smb3", "ceph", "glusterfs", "fuse.sshfs", "9p",
+    NULL,
+};
+
+// Device-mapper and md devices are followed to the disk underneath, as long as
+// there's only one.
+static const int MAX_STACKED_DEVICES = 8;
+
+typedef struct IoDevice {
+    char* name;
+    guint limit; // 0 is unlimited
+    guint streams;
+} IoDevice;
+
+typedef struct IoScheduler {
+    GHashTable* limits;  // May be NULL
+    GHashTable* devices; // Name to IoDevice
+    GMutex lock;
+    GCond released;
+} IoScheduler;
+
+typedef struct IoStreams {
+    IoScheduler* scheduler;
+    GPtrArray* devices;
+} IoStreams;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static void io_device_free(gpointer data) {
+    IoDevice* device = data;
+    g_free(device->name);
+    free(device);
+}
+
+// Stat <path>, or its closest ancestor which exists.
+static int stat_existing(const char* path, struct stat* stat_buffer) {
+    char* current = g_strdup(path);
+    int result = 0;
+    while (0 != stat(current, stat_buffer)) {
+        result = -errno;
+        if (ENOENT != errno || !strcmp("/", current) ||
+            !strcmp(".", current)) {
+            break;
+        }
+
+        char* parent = g_path_get_dirname(current);
+        g_free(current);
+        current = parent;
+        result = 0;
+    }
+    g_free(current);
+    return result;
+}
+
+// Find the type and source of the filesystem mounted from <device>.
+static int find_mount(dev_t device, char** type, char** source) {
+    FILE* mountinfo = fopen("/proc/self/mountinfo", "r");
+    if (NULL == mountinfo) {
+        return -errno;
+    }
+
+    // Lines look like this (see proc(5)), with optional fields before "-":
+    // 36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw
+    int result = -ENOENT;
+    char* line = NULL;
+    size_t line_size = 0;
+    while (0 < getline(&line, &line_size, mountinfo)) {
+        unsigned int major_number = 0, minor_number = 0;
+        const char* separator = strstr(line, " - ");
+        if (2 != sscanf(line, "%*d %*d %u:%u", &major_number,
+                        &minor_number) ||
+            makedev(major_number, minor_number) != device ||
+            NULL == separator) {
+            continue;
+        }
+
+        if (2 == sscanf(separator, " - %ms %ms", type, source)) {
+            result = 0;
+        }
+        break;
+    }
+    free(line);
+    fclose(mountinfo);
+    return result;
+}
+
+// The directory of the disk (not the partition, or device-mapper target) in
+// sysfs for <device>, or NULL if it's not a block device. Must be free'd.
+static char* get_disk_directory(dev_t device) {
+    char* link = g_strdup_printf("/sys/dev/block/%u:%u", major(device),
+                                 minor(device));
+    char* directory = realpath(link, NULL);
+    g_free(link);
+
+    for (int i = 0; NULL != directory && i < MAX_STACKED_DEVICES; ++i) {
+        char* partition = g_strdup_printf("%s/partition", directory);
+        bool is_partition = 0 == access(partition, F_OK);
+        g_free(partition);
+        if (is_partition) {
+            char* parent = g_path_get_dirname(directory);
+            free(directory);
+            directory = strdup(parent);
+            g_free(parent);
+        }
+
+        char* slaves_path = g_strdup_printf("%s/slaves", directory);
+        DIR* slaves = opendir(slaves_path);
+        g_free(slaves_path);
+        if (NULL == slaves) {
+            break;
+        }
+
+        char* only_slave = NULL;
+        guint count = 0;
+        struct dirent* entry = NULL;
+        while (NULL != (entry = readdir(slaves))) {
+            if ('.' != entry->d_name[0] && 1 == ++count) {
+                only_slave = g_strdup(entry->d_name);
+            }
+        }
+        closedir(slaves);
+        if (1 != count) {
+            g_free(only_slave);
+            break;
+        }
+
+        char* slave_link = g_strdup_printf("/sys/class/block/%s", only_slave);
+        char* slave = realpath(slave_link, NULL);
+        g_free(slave_link);
+        g_free(only_slave);
+        if (NULL == slave) {
+            break;
+        }
+        free(directory);
+        directory = slave;
+    }
+    return directory;
+}
+
+static bool is_rotational(const char* disk_directory) {
+    char* path = g_strdup_printf("%s/queue/rotational", disk_directory);
+    FILE* file = fopen(path, "r");
+    g_free(path);
+    if (NULL == file) {
+        return false;
+    }
+
+    int rotational = fgetc(file);
+    fclose(file);
+    return '1' == rotational;
+}
+
+static bool is_network_filesystem(const char* type) {
+    for (const char** network = NETWORK_FILESYSTEMS; NULL != *network;
+         ++network) {
+        if (!strcmp(*network, type)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Find the name and kind of the device holding <path>. The name must be
+// free'd with g_free().
+static int io_device_identify(const char* path, char** name,
+                              const char** kind) {
+    struct stat stat_buffer = {0};
+    int result = stat_existing(path, &stat_buffer);
+    if (0 != result) {
+        return result;
+    }
+
+    // Filesystems like btrfs use anonymous device numbers, so the device is
+    // found through the mount source instead.
+    dev_t device = stat_buffer.st_dev;
+    char* disk = get_disk_directory(device);
+    char* type = NULL;
+    char* source = NULL;
+    if (NULL == disk && 0 == find_mount(device, &type, &source)) {
+        struct stat source_stat = {0};
+        if (is_network_filesystem(type)) {
+            *name = g_strdup(source);
+            *kind = IO_DEVICE_NETWORK;
+            free(type);
+            free(source);
+            return 0;
+        } else if ('/' == source[0] && 0 == stat(source, &source_stat) &&
+                   S_ISBLK(source_stat.st_mode)) {
+            disk = get_disk_directory(source_stat.st_rdev);
+        }
+        free(type);
+        free(source);
+    }
+
+    // Memory-backed filesystems, e.g. tmpfs, don't have a disk.
+    if (NULL == disk) {
+        *name = g_strdup_printf("%u:%u", major(device), minor(device));
+        *kind = IO_DEVICE_SOLID_STATE;
+        return 0;
+    }
+
+    *name = g_path_get_basename(disk);
+    *kind = is_rotational(disk) ? IO_DEVICE_ROTATIONAL : IO_DEVICE_SOLID_STATE;
+    free(disk);
+    return 0;
+}
+
+static guint get_limit(IoScheduler* scheduler, const char* name,
+                       const char* kind) {
+    gpointer limit = NULL;
+    if (NULL != scheduler->limits &&
+        (g_hash_table_lookup_extended(scheduler->limits, name, NULL, &limit) ||
+         g_hash_table_lookup_extended(scheduler->limits, kind, NULL,
+                                      &limit))) {
+        return GPOINTER_TO_UINT(limit);
+    } else if (IO_DEVICE_ROTATIONAL == kind) {
+        return DEFAULT_ROTATIONAL_LIMIT;
+    } else if (IO_DEVICE_NETWORK == kind) {
+        return DEFAULT_NETWORK_LIMIT;
+    }
+    return 0;
+}
+
+// Whether a stream can be opened on each of <devices>. The scheduler must be
+// locked.
+static bool io_devices_available(GPtrArray* devices) {
+    for (guint i = 0; i < devices->len; ++i) {
+        IoDevice* device = devices->pdata[i];
+        if (0 != device->limit && device->streams >= device->limit) {
+            return false;
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+IoScheduler* io_scheduler_new(GHashTable* limits) {
+    IoScheduler* scheduler = malloc(sizeof(IoScheduler));
+    assert(NULL != scheduler);
+    scheduler->limits = NULL != limits ? g_hash_table_ref(limits) : NULL;
+    scheduler->devices = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                               io_device_free);
+    g_mutex_init(&scheduler->lock);
+    g_cond_init(&scheduler->released);
+    return scheduler;
+}
+
+void io_scheduler_free(IoScheduler* scheduler) {
+    if (NULL != scheduler->limits) {
+        g_hash_table_unref(scheduler->limits);
+    }
+    g_hash_table_unref(scheduler->devices);
+    g_mutex_clear(&scheduler->lock);
+    g_cond_clear(&scheduler->released);
+    free(scheduler);
+}
+
+IoStreams* io_scheduler_acquire(IoScheduler* scheduler, const char* path,
+                                ...) {
+    if (NULL == scheduler) {
+        return NULL;
+    }
+
+    // Devices are identified before locking the scheduler, since that reads
+    // sysfs. Paths which can't be stat'ed aren't limited.
+    GPtrArray* names = g_ptr_array_new_with_free_func(g_free);
+    GPtrArray* kinds = g_ptr_array_new();
+    va_list args;
+    va_start(args, path);
+    for (const char* next = path; NULL != next;
+         next = va_arg(args, const char*)) {
+        char* name = NULL;
+        const char* kind = NULL;
+        if (0 == io_device_identify(next, &name, &kind)) {
+            g_ptr_array_add(names, name);
+            g_ptr_array_add(kinds, (gpointer)kind);
+        }
+    }
+    va_end(args);
+
+    IoStreams* streams = malloc(sizeof(IoStreams));
+    assert(NULL != streams);
+    streams->scheduler = scheduler;
+    streams->devices = g_ptr_array_new();
+
+    // All of the streams are taken at once, so that acquiring streams never
+    // waits while holding others.
+    g_mutex_lock(&scheduler->lock);
+    for (guint i = 0; i < names->len; ++i) {
+        IoDevice* device =
+            g_hash_table_lookup(scheduler->devices, names->pdata[i]);
+        if (NULL == device) {
+            device = calloc(1, sizeof(IoDevice));
+            assert(NULL != device);
+            device->name = g_strdup(names->pdata[i]);
+            device->limit =
+                get_limit(scheduler, device->name, kinds->pdata[i]);
+            g_hash_table_insert(scheduler->devices, device->name, device);
+        }
+        if (!g_ptr_array_find(streams->devices, device, NULL)) {
+            g_ptr_array_add(streams->devices, device);
+        }
+    }
+    while (!io_devices_available(streams->devices)) {
+        g_cond_wait(&scheduler->released, &scheduler->lock);
+    }
+    for (guint i = 0; i < streams->devices->len; ++i) {
+        IoDevice* device = streams->devices->pdata[i];
+        ++device->streams;
+    }
+    g_mutex_unlock(&scheduler->lock);
+
+    g_ptr_array_unref(names);
+    g_ptr_array_unref(kinds);
+    return streams;
+}
+
+void io_streams_release(IoStreams* streams) {
+    if (NULL == streams) {
+        return;
+    }
+
+    IoScheduler* scheduler = streams->scheduler;
+    g_mutex_lock(&scheduler->lock);
+    for (guint i = 0; i < streams->devices->len; ++i) {
+        IoDevice* device = streams->devices->pdata[i];
+        --device->streams;
+    }
+    g_cond_broadcast(&scheduler->released);
+    g_mutex_unlock(&scheduler->lock);
+
+    g_ptr_array_unref(streams->devices);
+    free(streams);
+}
+
+///////////////////////////////////////////////////////////////////////////////
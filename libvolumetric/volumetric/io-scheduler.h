@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            io-scheduler.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Limits on concurrent streams per block device.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#ifndef VOLUMETRIC_IO_SCHEDULER_H
+#define VOLUMETRIC_IO_SCHEDULER_H
+
+typedef struct _GHashTable GHashTable;
+
+// The scheduler caps the number of volumes which are read from or written to
+// each device at once, so that checking out several volumes in parallel
+// doesn't thrash spinning disks or network filesystems. Paths are mapped to
+// the disk backing them (through partitions and device-mapper targets) with
+// sysfs, or to the mount source of network filesystems. It may be shared
+// between threads.
+typedef struct IoScheduler IoScheduler;
+
+// Streams held on a set of devices, until released.
+typedef struct IoStreams IoStreams;
+
+// The kinds of devices, which are also the keys of the default limits.
+extern const char* IO_DEVICE_ROTATIONAL;  // "rotational"
+extern const char* IO_DEVICE_SOLID_STATE; // "solid-state"
+extern const char* IO_DEVICE_NETWORK;     // "network"
+
+// <limits> maps kinds of devices, or the names of devices (e.g. sda, or
+// server:/export for network filesystems), to the maximum number of streams
+// on them, as GUINT_TO_POINTER(limit). Names take precedence, and 0 is
+// unlimited. Without a limit for their kind, rotational devices take one
+// stream at a time, network filesystems two, and solid-state devices any
+// number. <limits> may be NULL.
+IoScheduler* io_scheduler_new(GHashTable* limits);
+void io_scheduler_free(IoScheduler* scheduler);
+
+// Wait until a stream can be opened on every device holding one of the paths
+// (a NULL-terminated list), and take them all at once. Paths which don't
+// exist yet are mapped through their parent directories. If <scheduler> is
+// NULL, nothing is limited, and NULL is returned.
+IoStreams* io_scheduler_acquire(IoScheduler* scheduler, const char* path,
+                                ...);
+void io_streams_release(IoStreams* streams); // <streams> may be NULL
+
+#endif // VOLUMETRIC_IO_SCHEDULER_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,1061 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            lazy-archive.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Publish the tree of a seekable archive before it's
+//                  extracted
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/fuse.h>
+#include <linux/openat2.h>
+
+#include <archive.h>
+#include <archive_entry.h>
+#include <glib-2.0/glib.h>
+
+#include <volumetric/lazy-archive.h>
+#include <volumetric/seekable-zstd.h>
+
+// Entries are read from a window this large after their header offset, unless
+// that's too small for their (extended) headers.
+static const uint64_t HEADER_WINDOW_SIZE = 64 * 1024;
+
+// Requests are read into buffers large enough for the largest write, although
+// the filesystem is read-only.
+static const uint32_t MAX_WRITE = 128 * 1024;
+static const size_t REQUEST_BUFFER_SIZE = 128 * 1024 + 4096;
+static const unsigned int SERVER_THREADS = 4;
+
+// The tree never changes, so the kernel may cache it for as long as it likes.
+static const uint64_t ATTRIBUTE_TIMEOUT = 24 * 60 * 60;
+static const uint32_t REPORTED_BLOCK_SIZE = 4096;
+
+typedef enum LazyNodeState {
+    LAZY_NODE_MISSING,
+    LAZY_NODE_EXTRACTING,
+    LAZY_NODE_EXTRACTED,
+    LAZY_NODE_FAILED,
+} LazyNodeState;
+
+// Node IDs are the inode numbers of the filesystem. Node N is at index N - 1
+// in the node array, so the root is FUSE_ROOT_ID.
+typedef struct LazyNode {
+    char* path; // Relative to the root, "" for the root itself
+    const char* name;
+    guint parent;
+    struct stat stat;
+    char* symlink;
+    // Node the entry is a hard link to, or 0. Links are the same inode as
+    // their target.
+    guint hardlink;
+    // NULL for directories which are only implied by the paths of others
+    const SeekableEntry* entry;
+    // Children of a directory, by name, and in archive order for readdir.
+    GHashTable* children;
+    GArray* child_ids;
+    LazyNodeState state;
+} LazyNode;
+
+typedef struct LazyArchive {
+    const void* contents;
+    size_t size;
+    SeekableIndex* index;
+    GPtrArray* nodes;
+    int tree_fd;
+    uint64_t total_size;
+
+    char* mountpoint;
+    int fuse_fd;
+    dev_t device;
+    GPtrArray* servers;
+    GThread* completer;
+    LazyArchiveComplete complete;
+    void* user_data;
+    int result;
+
+    GMutex lock;
+    GCond extracted;
+} LazyArchive;
+
+// Reads a range of the uncompressed tar stream, one frame at a time.
+typedef struct RangeReader {
+    const LazyArchive* lazy;
+    uint64_t offset;
+    uint64_t end;
+    size_t frame; // Frame in <data>, or SIZE_MAX
+    void* data;
+} RangeReader;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static LazyNode* get_node(const LazyArchive* lazy, uint64_t id) {
+    if (0 == id || id > lazy->nodes->len) {
+        return NULL;
+    }
+    return lazy->nodes->pdata[id - 1];
+}
+
+// Hard links are answered with their target.
+static guint resolve_node(const LazyArchive* lazy, guint id) {
+    const LazyNode* node = get_node(lazy, id);
+    while (NULL != node && 0 != node->hardlink) {
+        id = node->hardlink;
+        node = get_node(lazy, id);
+    }
+    return id;
+}
+
+static void lazy_node_free(gpointer data) {
+    LazyNode* node = data;
+    free(node->path);
+    free(node->symlink);
+    if (NULL != node->children) {
+        g_hash_table_unref(node->children);
+        g_array_free(node->child_ids, TRUE);
+    }
+    free(node);
+}
+
+// Paths in archives are usually relative to "./", and directories may end in
+// a slash. Returns NULL if <pathname> has a ".." component, since it could
+// name something outside of the backing tree.
+static char* normalize_path(const char* pathname) {
+    gchar** components = g_strsplit(pathname, "/", -1);
+    GString* path = g_string_new(NULL);
+    bool escapes = false;
+    for (gchar** component = components; NULL != *component; ++component) {
+        if (!strcmp("..", *component)) {
+            escapes = true;
+            break;
+        } else if ('\0' == (*component)[0] || !strcmp(".", *component)) {
+            continue;
+        }
+
+        if (0 < path->len) {
+            g_string_append_c(path, '/');
+        }
+        g_string_append(path, *component);
+    }
+    g_strfreev(components);
+
+    char* normalized = escapes ? NULL : strdup(path->str);
+    assert(escapes || NULL != normalized);
+    g_string_free(path, TRUE);
+    return normalized;
+}
+
+static guint add_node(LazyArchive* lazy, GHashTable* paths, char* path);
+
+// The directory at <path>, created as an implied directory if the archive
+// doesn't have it (yet).
+static guint get_directory(LazyArchive* lazy, GHashTable* paths,
+                           const char* path) {
+    guint id = GPOINTER_TO_UINT(g_hash_table_lookup(paths, path));
+    if (0 != id) {
+        return id;
+    }
+
+    char* directory = strdup(path);
+    assert(NULL != directory);
+    id = add_node(lazy, paths, directory);
+    LazyNode* node = get_node(lazy, id);
+    node->stat.st_mode = S_IFDIR | 0755;
+    node->children = g_hash_table_new(g_str_hash, g_str_equal);
+    node->child_ids = g_array_new(FALSE, FALSE, sizeof(guint));
+    node->stat.st_uid = getuid();
+    node->stat.st_gid = getgid();
+    clock_gettime(CLOCK_REALTIME, &node->stat.st_mtim);
+    node->stat.st_atim = node->stat.st_mtim;
+    node->stat.st_ctim = node->stat.st_mtim;
+    return id;
+}
+
+// Add a node for <path> (taking ownership of it), or return the existing one.
+static guint add_node(LazyArchive* lazy, GHashTable* paths, char* path) {
+    guint id = GPOINTER_TO_UINT(g_hash_table_lookup(paths, path));
+    if (0 != id) {
+        free(path);
+        return id;
+    }
+
+    const char* slash = strrchr(path, '/');
+    guint parent = 0;
+    if (NULL != slash) {
+        char* parent_path = g_strndup(path, slash - path);
+        parent = get_directory(lazy, paths, parent_path);
+        g_free(parent_path);
+    } else if ('\0' != path[0]) {
+        parent = FUSE_ROOT_ID;
+    }
+
+    LazyNode* node = calloc(1, sizeof(LazyNode));
+    assert(NULL != node);
+    node->path = path;
+    node->name = NULL != slash ? slash + 1 : path;
+    node->parent = parent;
+    g_ptr_array_add(lazy->nodes, node);
+    id = lazy->nodes->len;
+    g_hash_table_insert(paths, node->path, GUINT_TO_POINTER(id));
+
+    // Entries beneath anything but a directory are rejected in load_tree().
+    LazyNode* directory = get_node(lazy, parent);
+    if (NULL != directory && NULL != directory->children) {
+        g_hash_table_insert(directory->children, (char*)node->name,
+                            GUINT_TO_POINTER(id));
+        g_array_append_val(directory->child_ids, id);
+    }
+    return id;
+}
+
+static size_t find_frame(const SeekableIndex* index, uint64_t offset) {
+    size_t low = 0;
+    size_t high = index->frame_count;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (index->frames[middle].uncompressed_offset <= offset) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static la_ssize_t range_reader_read(struct archive* archive, void* user_data,
+                                    const void** buffer) {
+    RangeReader* reader = user_data;
+    if (reader->offset >= reader->end) {
+        return 0;
+    }
+
+    const SeekableIndex* index = reader->lazy->index;
+    size_t frame = find_frame(index, reader->offset);
+    if (frame != reader->frame) {
+        free(reader->data);
+        reader->data = NULL;
+        reader->frame = SIZE_MAX;
+        int result = seekable_frame_decompress(
+            reader->lazy->contents, &index->frames[frame], &reader->data);
+        if (0 != result) {
+            archive_set_error(archive, -result, "Couldn't decompress frame");
+            return ARCHIVE_FATAL;
+        }
+        reader->frame = frame;
+    }
+
+    const SeekableFrame* current = &index->frames[frame];
+    uint64_t frame_end =
+        current->uncompressed_offset + current->uncompressed_size;
+    uint64_t end = MIN(frame_end, reader->end);
+    if (end <= reader->offset) {
+        return 0;
+    }
+    *buffer = (const char*)reader->data +
+              (reader->offset - current->uncompressed_offset);
+    la_ssize_t length = end - reader->offset;
+    reader->offset = end;
+    return length;
+}
+
+// Open the tar entries in [offset, end) of the uncompressed stream.
+static struct archive* range_reader_open(RangeReader* reader, uint64_t offset,
+                                         uint64_t end) {
+    reader->offset = offset;
+    reader->end = end;
+    struct archive* archive = archive_read_new();
+    assert(NULL != archive);
+    archive_read_support_format_tar(archive);
+    if (ARCHIVE_OK !=
+        archive_read_open(archive, reader, NULL, range_reader_read, NULL)) {
+        archive_read_free(archive);
+        return NULL;
+    }
+    return archive;
+}
+
+// Read the header of <entry> into a new node.
+static int load_entry(LazyArchive* lazy, GHashTable* paths,
+                      RangeReader* reader, const SeekableEntry* entry) {
+    uint64_t window_end =
+        MIN(entry->end_offset, entry->header_offset + HEADER_WINDOW_SIZE);
+    struct archive* archive = NULL;
+    struct archive_entry* archive_entry = NULL;
+    for (;;) {
+        archive = range_reader_open(reader, entry->header_offset, window_end);
+        if (NULL != archive &&
+            ARCHIVE_OK == archive_read_next_header(archive, &archive_entry)) {
+            break;
+        }
+        if (NULL != archive) {
+            archive_read_free(archive);
+        }
+        if (window_end == entry->end_offset) {
+            return -EINVAL;
+        }
+        window_end = entry->end_offset;
+    }
+
+    char* path = normalize_path(archive_entry_pathname(archive_entry));
+    if (NULL == path) {
+        archive_read_free(archive);
+        return -EINVAL;
+    }
+    guint id = add_node(lazy, paths, path);
+    LazyNode* node = get_node(lazy, id);
+    node->entry = entry;
+    node->stat = *archive_entry_stat(archive_entry);
+    if (0 == node->stat.st_atime) {
+        node->stat.st_atim = node->stat.st_mtim;
+    }
+    if (0 == node->stat.st_ctime) {
+        node->stat.st_ctim = node->stat.st_mtim;
+    }
+
+    int result = 0;
+    const char* hardlink = archive_entry_hardlink(archive_entry);
+    const char* symlink = archive_entry_symlink(archive_entry);
+    if (NULL != hardlink) {
+        char* target = normalize_path(hardlink);
+        if (NULL != target) {
+            node->hardlink =
+                GPOINTER_TO_UINT(g_hash_table_lookup(paths, target));
+            free(target);
+        }
+        if (0 == node->hardlink || id == node->hardlink) {
+            result = -EINVAL;
+        }
+    } else if (NULL != symlink) {
+        node->symlink = strdup(symlink);
+        assert(NULL != node->symlink);
+    }
+    if (S_ISDIR(node->stat.st_mode) && NULL == node->children) {
+        node->children = g_hash_table_new(g_str_hash, g_str_equal);
+        node->child_ids = g_array_new(FALSE, FALSE, sizeof(guint));
+    }
+    if (S_ISREG(node->stat.st_mode) && 0 == node->hardlink) {
+        lazy->total_size += node->stat.st_size;
+    }
+    archive_read_free(archive);
+    return result;
+}
+
+// Read every header of the archive into the node tree.
+static int load_tree(LazyArchive* lazy) {
+    GHashTable* paths = g_hash_table_new(g_str_hash, g_str_equal);
+    char* root_path = strdup("");
+    assert(NULL != root_path);
+    guint root = get_directory(lazy, paths, root_path);
+    free(root_path);
+    LazyNode* node = get_node(lazy, root);
+    node->children = g_hash_table_new(g_str_hash, g_str_equal);
+    node->child_ids = g_array_new(FALSE, FALSE, sizeof(guint));
+
+    RangeReader reader = {.lazy = lazy, .frame = SIZE_MAX};
+    int result = 0;
+    for (size_t i = 0; i < lazy->index->entry_count && 0 == result; ++i) {
+        result = load_entry(lazy, paths, &reader, &lazy->index->entries[i]);
+    }
+    free(reader.data);
+    g_hash_table_unref(paths);
+    if (0 != result) {
+        return result;
+    }
+
+    // Nothing may be created through a symlink (or anything else but a
+    // directory) in the backing tree, or it could end up outside of it.
+    for (guint id = 1; id <= lazy->nodes->len; ++id) {
+        node = get_node(lazy, id);
+        LazyNode* parent = get_node(lazy, node->parent);
+        if (NULL != parent && !S_ISDIR(parent->stat.st_mode)) {
+            return -EINVAL;
+        }
+    }
+
+    // Directories get their children, and link counts are counted.
+    for (guint id = 1; id <= lazy->nodes->len; ++id) {
+        node = get_node(lazy, id);
+        if (S_ISDIR(node->stat.st_mode) && NULL == node->children) {
+            node->children = g_hash_table_new(g_str_hash, g_str_equal);
+            node->child_ids = g_array_new(FALSE, FALSE, sizeof(guint));
+        }
+        node->stat.st_nlink = S_ISDIR(node->stat.st_mode) ? 2 : 1;
+    }
+    for (guint id = 1; id <= lazy->nodes->len; ++id) {
+        node = get_node(lazy, id);
+        LazyNode* target = get_node(lazy, resolve_node(lazy, id));
+        LazyNode* parent = get_node(lazy, node->parent);
+        if (target != node) {
+            ++target->stat.st_nlink;
+        } else if (S_ISDIR(node->stat.st_mode) && NULL != parent) {
+            ++parent->stat.st_nlink;
+        }
+    }
+    return 0;
+}
+
+// Create the missing parent directories of <path> in the backing tree. Their
+// metadata is applied once the tree is complete.
+static int make_parents(LazyArchive* lazy, const char* path) {
+    char* parent = strdup(path);
+    assert(NULL != parent);
+    int result = 0;
+    for (char* slash = strchr(parent, '/'); NULL != slash && 0 == result;
+         slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        if (0 != mkdirat(lazy->tree_fd, parent, 0700) && EEXIST != errno) {
+            result = -errno;
+        }
+        *slash = '/';
+    }
+    free(parent);
+    return result;
+}
+
+// Open <path> in the backing tree. Resolving it may not leave the tree, and
+// a symlink in its last component isn't followed.
+static int open_beneath(LazyArchive* lazy, const char* path, int flags,
+                        mode_t mode) {
+    struct open_how how = {
+        .flags = flags | O_NOFOLLOW | O_CLOEXEC,
+        .mode = 0 != (flags & O_CREAT) ? mode : 0,
+        .resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS,
+    };
+    int fd = syscall(SYS_openat2, lazy->tree_fd, path, &how, sizeof(how));
+    if (0 > fd && ENOSYS == errno) {
+        // Before Linux 5.6, this relies on the paths of nodes never having
+        // ".." components, or a non-directory node above them.
+        fd = openat(lazy->tree_fd, path, how.flags, how.mode);
+    }
+    return fd;
+}
+
+static int write_all(int fd, const char* data, size_t length, off_t offset) {
+    while (0 < length) {
+        ssize_t written = pwrite(fd, data, length, offset);
+        if (0 > written) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return -errno;
+        }
+        data += written;
+        length -= written;
+        offset += written;
+    }
+    return 0;
+}
+
+// Extract the data of a regular file into the backing tree. Files read in
+// archive order through the same <reader> share the frames they're in.
+static int write_file(LazyArchive* lazy, const LazyNode* node,
+                      RangeReader* reader) {
+    int result = make_parents(lazy, node->path);
+    if (0 != result) {
+        return result;
+    }
+    int fd = open_beneath(lazy, node->path, O_WRONLY | O_CREAT | O_TRUNC,
+                          0600);
+    if (0 > fd) {
+        return -errno;
+    }
+
+    const SeekableEntry* entry = node->entry;
+    struct archive* archive =
+        range_reader_open(reader, entry->header_offset, entry->end_offset);
+    struct archive_entry* archive_entry = NULL;
+    if (NULL == archive ||
+        ARCHIVE_OK != archive_read_next_header(archive, &archive_entry)) {
+        result = -EIO;
+    }
+
+    // Holes in sparse files are left as they are.
+    while (0 == result) {
+        const void* block = NULL;
+        size_t length = 0;
+        la_int64_t offset = 0;
+        int status =
+            archive_read_data_block(archive, &block, &length, &offset);
+        if (ARCHIVE_EOF == status) {
+            break;
+        } else if (ARCHIVE_OK != status) {
+            result = -EIO;
+            break;
+        }
+        result = write_all(fd, block, length, offset);
+    }
+    if (NULL != archive) {
+        archive_read_free(archive);
+    }
+
+    const struct timespec times[2] = {node->stat.st_atim, node->stat.st_mtim};
+    if (0 == result &&
+        (0 != ftruncate(fd, node->stat.st_size) ||
+         (0 == geteuid() &&
+          0 != fchown(fd, node->stat.st_uid, node->stat.st_gid)) ||
+         0 != fchmod(fd, node->stat.st_mode & 07777) ||
+         0 != futimens(fd, times))) {
+        result = -errno;
+    }
+    if (0 != close(fd) && 0 == result) {
+        result = -errno;
+    }
+    return result;
+}
+
+// Extract the regular file <node>, unless it's been extracted already. If
+// another thread is extracting it, wait for that instead.
+static int extract_file(LazyArchive* lazy, LazyNode* node,
+                        RangeReader* reader) {
+    g_mutex_lock(&lazy->lock);
+    while (LAZY_NODE_EXTRACTING == node->state) {
+        g_cond_wait(&lazy->extracted, &lazy->lock);
+    }
+    LazyNodeState state = node->state;
+    if (LAZY_NODE_MISSING == state) {
+        node->state = LAZY_NODE_EXTRACTING;
+    }
+    g_mutex_unlock(&lazy->lock);
+    if (LAZY_NODE_EXTRACTED == state) {
+        return 0;
+    } else if (LAZY_NODE_FAILED == state) {
+        return -EIO;
+    }
+
+    int result = write_file(lazy, node, reader);
+    g_mutex_lock(&lazy->lock);
+    node->state = 0 == result ? LAZY_NODE_EXTRACTED : LAZY_NODE_FAILED;
+    g_cond_broadcast(&lazy->extracted);
+    g_mutex_unlock(&lazy->lock);
+    return result;
+}
+
+// Apply the metadata of <node> to its path in the backing tree.
+static int apply_metadata(LazyArchive* lazy, const LazyNode* node) {
+    const struct timespec times[2] = {node->stat.st_atim, node->stat.st_mtim};
+    if ('\0' == node->path[0]) {
+        if ((0 == geteuid() &&
+             0 != fchown(lazy->tree_fd, node->stat.st_uid,
+                         node->stat.st_gid)) ||
+            0 != fchmod(lazy->tree_fd, node->stat.st_mode & 07777) ||
+            0 != futimens(lazy->tree_fd, times)) {
+            return -errno;
+        }
+        return 0;
+    }
+
+    bool is_link = S_ISLNK(node->stat.st_mode);
+    if ((0 == geteuid() &&
+         0 != fchownat(lazy->tree_fd, node->path, node->stat.st_uid,
+                       node->stat.st_gid, AT_SYMLINK_NOFOLLOW)) ||
+        (!is_link &&
+         0 != fchmodat(lazy->tree_fd, node->path, node->stat.st_mode & 07777,
+                       0)) ||
+        0 != utimensat(lazy->tree_fd, node->path, times,
+                       AT_SYMLINK_NOFOLLOW)) {
+        return -errno;
+    }
+    return 0;
+}
+
+// Create <node> in the backing tree, if it isn't there yet.
+static int materialize_node(LazyArchive* lazy, LazyNode* node,
+                            RangeReader* reader) {
+    mode_t type = node->stat.st_mode & S_IFMT;
+    if ('\0' == node->path[0]) {
+        return 0;
+    } else if (0 != node->hardlink) {
+        LazyNode* target = get_node(lazy, resolve_node(lazy, node->hardlink));
+        int result = S_ISREG(target->stat.st_mode)
+                         ? extract_file(lazy, target, reader)
+                         : 0;
+        if (0 == result) {
+            result = make_parents(lazy, node->path);
+        }
+        if (0 == result && 0 != linkat(lazy->tree_fd, target->path,
+                                       lazy->tree_fd, node->path, 0)) {
+            result = EEXIST == errno ? 0 : -errno;
+        }
+        return result;
+    } else if (S_IFREG == type) {
+        return extract_file(lazy, node, reader);
+    }
+
+    int result = make_parents(lazy, node->path);
+    if (0 != result) {
+        return result;
+    }
+    if (S_IFDIR == type) {
+        result = mkdirat(lazy->tree_fd, node->path, 0700);
+    } else if (S_IFLNK == type) {
+        result = symlinkat(node->symlink, lazy->tree_fd, node->path);
+    } else {
+        result = mknodat(lazy->tree_fd, node->path, node->stat.st_mode,
+                         node->stat.st_rdev);
+    }
+    if (0 != result && EEXIST != errno) {
+        return -errno;
+    }
+    return S_IFDIR == type ? 0 : apply_metadata(lazy, node);
+}
+
+// Extract everything which hasn't been extracted on demand. Directories get
+// their metadata last, since creating their children changes it.
+static gpointer complete_tree(gpointer user_data) {
+    LazyArchive* lazy = user_data;
+    RangeReader reader = {.lazy = lazy, .frame = SIZE_MAX};
+    int result = 0;
+    for (guint id = 1; id <= lazy->nodes->len && 0 == result; ++id) {
+        result = materialize_node(lazy, get_node(lazy, id), &reader);
+    }
+    free(reader.data);
+    for (guint id = lazy->nodes->len; 0 < id && 0 == result; --id) {
+        LazyNode* node = get_node(lazy, id);
+        if (S_ISDIR(node->stat.st_mode)) {
+            result = apply_metadata(lazy, node);
+        }
+    }
+
+    lazy->result = result;
+    if (0 == result && NULL != lazy->complete) {
+        lazy->complete(lazy, lazy->user_data);
+    }
+    return NULL;
+}
+
+static void reply(LazyArchive* lazy, uint64_t unique, int error,
+                  const void* data, size_t length) {
+    struct fuse_out_header header = {
+        .len = sizeof(header) + length,
+        .error = error,
+        .unique = unique,
+    };
+    struct iovec vector[2] = {
+        {.iov_base = &header, .iov_len = sizeof(header)},
+        {.iov_base = (void*)data, .iov_len = length},
+    };
+    // Fails with ENOENT if the request was interrupted, which is harmless.
+    ssize_t written = writev(lazy->fuse_fd, vector, 0 < length ? 2 : 1);
+    (void)written;
+}
+
+static void reply_error(LazyArchive* lazy, uint64_t unique, int error) {
+    reply(lazy, unique, error, NULL, 0);
+}
+
+static void fill_attributes(const LazyNode* node, guint id,
+                            struct fuse_attr* attributes) {
+    const struct stat* stat = &node->stat;
+    unsigned int device_major = major(stat->st_rdev);
+    unsigned int device_minor = minor(stat->st_rdev);
+    *attributes = (struct fuse_attr){
+        .ino = id,
+        .size = stat->st_size,
+        .blocks = (stat->st_size + 511) / 512,
+        .atime = stat->st_atim.tv_sec,
+        .mtime = stat->st_mtim.tv_sec,
+        .ctime = stat->st_ctim.tv_sec,
+        .atimensec = stat->st_atim.tv_nsec,
+        .mtimensec = stat->st_mtim.tv_nsec,
+        .ctimensec = stat->st_ctim.tv_nsec,
+        .mode = stat->st_mode,
+        .nlink = stat->st_nlink,
+        .uid = stat->st_uid,
+        .gid = stat->st_gid,
+        // The kernel's "new" encoding of device numbers
+        .rdev = (device_minor & 0xff) | (device_major << 8) |
+                ((device_minor & ~0xffu) << 12),
+        .blksize = REPORTED_BLOCK_SIZE,
+    };
+}
+
+static void handle_init(LazyArchive* lazy, const struct fuse_in_header* header,
+                        const struct fuse_init_in* init) {
+    struct fuse_init_out out = {
+        .major = FUSE_KERNEL_VERSION,
+        .minor = FUSE_KERNEL_MINOR_VERSION,
+        .max_readahead = init->max_readahead,
+        .flags = init->flags & FUSE_ASYNC_READ,
+        .max_background = 16,
+        .congestion_threshold = 12,
+        .max_write = MAX_WRITE,
+        .time_gran = 1,
+    };
+    size_t length =
+        23 > init->minor ? FUSE_COMPAT_22_INIT_OUT_SIZE : sizeof(out);
+    reply(lazy, header->unique, 0, &out, length);
+}
+
+static void handle_lookup(LazyArchive* lazy,
+                          const struct fuse_in_header* header,
+                          const char* name) {
+    const LazyNode* parent = get_node(lazy, header->nodeid);
+    if (NULL == parent || NULL == parent->children) {
+        reply_error(lazy, header->unique, NULL == parent ? -ENOENT : -ENOTDIR);
+        return;
+    }
+    guint id = GPOINTER_TO_UINT(g_hash_table_lookup(parent->children, name));
+    if (0 == id) {
+        reply_error(lazy, header->unique, -ENOENT);
+        return;
+    }
+
+    id = resolve_node(lazy, id);
+    struct fuse_entry_out out = {
+        .nodeid = id,
+        .entry_valid = ATTRIBUTE_TIMEOUT,
+        .attr_valid = ATTRIBUTE_TIMEOUT,
+    };
+    fill_attributes(get_node(lazy, id), id, &out.attr);
+    reply(lazy, header->unique, 0, &out, sizeof(out));
+}
+
+static void handle_getattr(LazyArchive* lazy,
+                           const struct fuse_in_header* header) {
+    const LazyNode* node = get_node(lazy, header->nodeid);
+    if (NULL == node) {
+        reply_error(lazy, header->unique, -ENOENT);
+        return;
+    }
+    struct fuse_attr_out out = {.attr_valid = ATTRIBUTE_TIMEOUT};
+    fill_attributes(node, header->nodeid, &out.attr);
+    reply(lazy, header->unique, 0, &out, sizeof(out));
+}
+
+static void handle_readlink(LazyArchive* lazy,
+                            const struct fuse_in_header* header) {
+    const LazyNode* node = get_node(lazy, header->nodeid);
+    if (NULL == node || NULL == node->symlink) {
+        reply_error(lazy, header->unique, -EINVAL);
+        return;
+    }
+    reply(lazy, header->unique, 0, node->symlink, strlen(node->symlink));
+}
+
+// Files are extracted when they're opened, and read from the backing tree.
+static void handle_open(LazyArchive* lazy, const struct fuse_in_header* header,
+                        const struct fuse_open_in* open) {
+    LazyNode* node = get_node(lazy, header->nodeid);
+    if (NULL == node || !S_ISREG(node->stat.st_mode)) {
+        reply_error(lazy, header->unique, NULL == node ? -ENOENT : -EINVAL);
+        return;
+    } else if (O_RDONLY != (open->flags & O_ACCMODE)) {
+        reply_error(lazy, header->unique, -EROFS);
+        return;
+    }
+
+    RangeReader reader = {.lazy = lazy, .frame = SIZE_MAX};
+    int result = extract_file(lazy, node, &reader);
+    free(reader.data);
+    int fd = -1;
+    if (0 == result) {
+        fd = open_beneath(lazy, node->path, O_RDONLY, 0);
+        result = 0 > fd ? -errno : 0;
+    }
+    if (0 != result) {
+        reply_error(lazy, header->unique, result);
+        return;
+    }
+    struct fuse_open_out out = {.fh = fd, .open_flags = FOPEN_KEEP_CACHE};
+    reply(lazy, header->unique, 0, &out, sizeof(out));
+}
+
+static void handle_read(LazyArchive* lazy, const struct fuse_in_header* header,
+                        const struct fuse_read_in* read) {
+    char* buffer = malloc(read->size);
+    assert(NULL != buffer);
+    ssize_t length = pread(read->fh, buffer, read->size, read->offset);
+    if (0 > length) {
+        reply_error(lazy, header->unique, -errno);
+    } else {
+        reply(lazy, header->unique, 0, buffer, length);
+    }
+    free(buffer);
+}
+
+static void handle_readdir(LazyArchive* lazy,
+                           const struct fuse_in_header* header,
+                           const struct fuse_read_in* read) {
+    const LazyNode* directory = get_node(lazy, header->nodeid);
+    if (NULL == directory || NULL == directory->children) {
+        reply_error(lazy, header->unique, -ENOTDIR);
+        return;
+    }
+
+    // Offsets are positions in the list of children.
+    char* buffer = calloc(1, read->size);
+    assert(NULL != buffer);
+    size_t used = 0;
+    for (uint64_t i = read->offset; i < directory->child_ids->len; ++i) {
+        const LazyNode* child = get_node(
+            lazy, g_array_index(directory->child_ids, guint, i));
+        guint id = resolve_node(lazy, g_array_index(directory->child_ids,
+                                                    guint, i));
+        size_t name_length = strlen(child->name);
+        size_t size = FUSE_DIRENT_ALIGN(FUSE_NAME_OFFSET + name_length);
+        if (used + size > read->size) {
+            break;
+        }
+
+        struct fuse_dirent* entry = (struct fuse_dirent*)(buffer + used);
+        entry->ino = id;
+        entry->off = i + 1;
+        entry->namelen = name_length;
+        entry->type = (get_node(lazy, id)->stat.st_mode & S_IFMT) >> 12;
+        memcpy(entry->name, child->name, name_length);
+        used += size;
+    }
+    reply(lazy, header->unique, 0, buffer, used);
+    free(buffer);
+}
+
+static void handle_statfs(LazyArchive* lazy,
+                          const struct fuse_in_header* header) {
+    struct fuse_statfs_out out = {
+        .st =
+            {
+                .blocks = (lazy->total_size + REPORTED_BLOCK_SIZE - 1) /
+                          REPORTED_BLOCK_SIZE,
+                .files = lazy->nodes->len,
+                .bsize = REPORTED_BLOCK_SIZE,
+                .namelen = 255,
+                .frsize = REPORTED_BLOCK_SIZE,
+            },
+    };
+    reply(lazy, header->unique, 0, &out, sizeof(out));
+}
+
+static void handle_request(LazyArchive* lazy,
+                           const struct fuse_in_header* header,
+                           const void* body) {
+    switch (header->opcode) {
+    case FUSE_INIT:
+        handle_init(lazy, header, body);
+        break;
+    case FUSE_LOOKUP:
+        handle_lookup(lazy, header, body);
+        break;
+    case FUSE_GETATTR:
+        handle_getattr(lazy, header);
+        break;
+    case FUSE_READLINK:
+        handle_readlink(lazy, header);
+        break;
+    case FUSE_OPEN:
+        handle_open(lazy, header, body);
+        break;
+    case FUSE_READ:
+        handle_read(lazy, header, body);
+        break;
+    case FUSE_RELEASE:
+        close(((const struct fuse_release_in*)body)->fh);
+        reply_error(lazy, header->unique, 0);
+        break;
+    case FUSE_OPENDIR: {
+        struct fuse_open_out out = {.open_flags = FOPEN_KEEP_CACHE};
+        reply(lazy, header->unique, 0, &out, sizeof(out));
+        break;
+    }
+    case FUSE_READDIR:
+        handle_readdir(lazy, header, body);
+        break;
+    case FUSE_STATFS:
+        handle_statfs(lazy, header);
+        break;
+    case FUSE_FLUSH:
+    case FUSE_RELEASEDIR:
+    case FUSE_ACCESS:
+    case FUSE_DESTROY:
+        reply_error(lazy, header->unique, 0);
+        break;
+    case FUSE_FORGET:
+    case FUSE_BATCH_FORGET:
+    case FUSE_INTERRUPT:
+        // Nodes live as long as the filesystem, and requests are never
+        // interrupted. These don't get replies.
+        break;
+    default:
+        reply_error(lazy, header->unique, -ENOSYS);
+        break;
+    }
+}
+
+// Answer requests until the filesystem is gone.
+static gpointer serve_requests(gpointer user_data) {
+    LazyArchive* lazy = user_data;
+    char* buffer = malloc(REQUEST_BUFFER_SIZE);
+    assert(NULL != buffer);
+    for (;;) {
+        ssize_t length = read(lazy->fuse_fd, buffer, REQUEST_BUFFER_SIZE);
+        if (0 > length && (EINTR == errno || ENOENT == errno)) {
+            continue;
+        } else if (0 > length) {
+            // ENODEV once the filesystem is unmounted and released
+            break;
+        } else if ((size_t)length < sizeof(struct fuse_in_header)) {
+            continue;
+        }
+        handle_request(lazy, (const struct fuse_in_header*)buffer,
+                       buffer + sizeof(struct fuse_in_header));
+    }
+    free(buffer);
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+LazyArchive* lazy_archive_new(const void* contents, size_t size,
+                              const char* tree) {
+    SeekableIndex* index = seekable_index_read(contents, size);
+    if (NULL == index) {
+        return NULL;
+    }
+    int tree_fd = open(tree, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (0 > tree_fd) {
+        seekable_index_free(index);
+        return NULL;
+    }
+
+    LazyArchive* lazy = calloc(1, sizeof(LazyArchive));
+    assert(NULL != lazy);
+    lazy->contents = contents;
+    lazy->size = size;
+    lazy->index = index;
+    lazy->nodes = g_ptr_array_new_with_free_func(lazy_node_free);
+    lazy->tree_fd = tree_fd;
+    lazy->fuse_fd = -1;
+    g_mutex_init(&lazy->lock);
+    g_cond_init(&lazy->extracted);
+    if (0 != load_tree(lazy)) {
+        lazy_archive_free(lazy);
+        return NULL;
+    }
+    return lazy;
+}
+
+void lazy_archive_free(LazyArchive* lazy) {
+    if (0 <= lazy->fuse_fd) {
+        close(lazy->fuse_fd);
+    }
+    close(lazy->tree_fd);
+    g_ptr_array_free(lazy->nodes, TRUE);
+    seekable_index_free(lazy->index);
+    free(lazy->mountpoint);
+    g_mutex_clear(&lazy->lock);
+    g_cond_clear(&lazy->extracted);
+    free(lazy);
+}
+
+int lazy_archive_start(LazyArchive* lazy, const char* mountpoint,
+                       LazyArchiveComplete complete, void* user_data) {
+    lazy->fuse_fd = open("/dev/fuse", O_RDWR | O_CLOEXEC);
+    if (0 > lazy->fuse_fd) {
+        return -errno;
+    }
+
+    // Containers run as anyone, and the kernel checks the archive's modes.
+    char* options = g_strdup_printf(
+        "fd=%d,rootmode=%o,user_id=%u,group_id=%u,allow_other,"
+        "default_permissions",
+        lazy->fuse_fd, S_IFDIR, getuid(), getgid());
+    int result = 0;
+    if (0 != mount("volumetric", mountpoint, "fuse.volumetric", MS_RDONLY,
+                   options)) {
+        result = -errno;
+    }
+    g_free(options);
+    if (0 != result) {
+        close(lazy->fuse_fd);
+        lazy->fuse_fd = -1;
+        return result;
+    }
+
+    lazy->mountpoint = strdup(mountpoint);
+    assert(NULL != lazy->mountpoint);
+    lazy->complete = complete;
+    lazy->user_data = user_data;
+    lazy->servers = g_ptr_array_new();
+    for (unsigned int i = 0; i < SERVER_THREADS; ++i) {
+        g_ptr_array_add(lazy->servers,
+                        g_thread_new("lazy-serve", serve_requests, lazy));
+    }
+
+    // Answered by the servers, once the kernel has initialized the
+    // connection. The device identifies the mount in lazy_archive_detach().
+    struct stat mount_stat = {0};
+    if (0 != stat(mountpoint, &mount_stat)) {
+        result = -errno;
+        umount2(mountpoint, MNT_DETACH);
+        lazy_archive_wait(lazy);
+        return result;
+    }
+    lazy->device = mount_stat.st_dev;
+    lazy->completer = g_thread_new("lazy-complete", complete_tree, lazy);
+    return 0;
+}
+
+void lazy_archive_detach(LazyArchive* lazy) {
+    // The mountpoint may have been taken over by another filesystem since.
+    struct stat mount_stat = {0};
+    if (0 == stat(lazy->mountpoint, &mount_stat) &&
+        mount_stat.st_dev == lazy->device) {
+        umount2(lazy->mountpoint, MNT_DETACH);
+    }
+}
+
+int lazy_archive_wait(LazyArchive* lazy) {
+    if (NULL != lazy->servers) {
+        for (guint i = 0; i < lazy->servers->len; ++i) {
+            g_thread_join(lazy->servers->pdata[i]);
+        }
+        g_ptr_array_free(lazy->servers, TRUE);
+        lazy->servers = NULL;
+    }
+    if (NULL != lazy->completer) {
+        g_thread_join(lazy->completer);
+        lazy->completer = NULL;
+    }
+    return lazy->result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            lazy-archive.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Publish the tree of a seekable archive before it's
+//                  extracted
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#ifndef VOLUMETRIC_LAZY_ARCHIVE_H
+#define VOLUMETRIC_LAZY_ARCHIVE_H
+
+#include <stddef.h>
+
+// A read-only FUSE filesystem publishing the tree of a seekable archive (see
+// seekable-zstd.h) as soon as its headers are read. Regular files are
+// extracted into a backing tree when they're first opened, and the rest of the
+// archive is extracted in the background, so that the backing tree is
+// eventually complete and the filesystem is no longer needed. The FUSE
+// protocol is spoken directly over /dev/fuse, so mounting requires
+// CAP_SYS_ADMIN.
+typedef struct LazyArchive LazyArchive;
+
+// Called from the background thread once the backing tree is complete.
+typedef void (*LazyArchiveComplete)(LazyArchive* lazy, void* user_data);
+
+// Read the tree of the seekable archive in <contents>, which must stay mapped
+// until the object is free'd. Files are extracted underneath the existing,
+// empty directory <tree>. Returns NULL if the archive isn't seekable, or its
+// headers can't be read.
+LazyArchive* lazy_archive_new(const void* contents, size_t size,
+                              const char* tree);
+void lazy_archive_free(LazyArchive* lazy);
+
+// Mount the filesystem at <mountpoint>, start answering requests, and start
+// completing the backing tree in the background, calling <complete> when it's
+// done. Returns 0 once the tree is published, or a negative errno.
+int lazy_archive_start(LazyArchive* lazy, const char* mountpoint,
+                       LazyArchiveComplete complete, void* user_data);
+
+// Detach the filesystem from its mountpoint, if it's still mounted there.
+// Existing users are served until they're gone.
+void lazy_archive_detach(LazyArchive* lazy);
+
+// Wait until the filesystem is unmounted and no longer used, and the backing
+// tree is complete. Returns 0, or a negative errno if the tree couldn't be
+// completed.
+int lazy_archive_wait(LazyArchive* lazy);
+
+#endif // VOLUMETRIC_LAZY_ARCHIVE_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,1072 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            parallel-gzip.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the parallel gzip decoder.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <assert.h>
+#include <endian.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include <volumetric/parallel-gzip.h>
+#include <volumetric/parallel-stream.h>
+
+// Size of the deflate history window, in bytes.
+#define WINDOW_SIZE 32768
+#define MAX_CODE_BITS 15
+#define MAX_CODE_LENGTH_BITS 7
+#define FIXED_LITERAL_BITS 9
+#define FIXED_DISTANCE_BITS 5
+
+// Compressed bytes per chunk. Files smaller than two chunks are left to
+// libarchive.
+static const size_t CHUNK_SIZE = 4 * 1024 * 1024;
+
+// A speculatively decoded chunk is abandoned (and later decoded sequentially)
+// if it would hold more than this much data in memory.
+static const size_t MAX_CHUNK_OUTPUT = 64 * 1024 * 1024;
+
+// Amount of data produced per call during sequential decoding.
+static const size_t SEQUENTIAL_OUTPUT = 4 * 1024 * 1024;
+
+static const uint16_t LENGTH_BASE[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                         1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                         4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DISTANCE_BASE[30] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0,  0,  1,  1,  2,  2,
+                                           3, 3, 4,  4,  5,  5,  6,  6,
+                                           7, 7, 8,  8,  9,  9,  10, 10,
+                                           11, 11, 12, 12, 13, 13};
+static const uint8_t CODE_LENGTH_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+enum {
+    GZIP_FLAG_HCRC = 0x02,
+    GZIP_FLAG_EXTRA = 0x04,
+    GZIP_FLAG_NAME = 0x08,
+    GZIP_FLAG_COMMENT = 0x10,
+    GZIP_FLAG_RESERVED = 0xe0,
+};
+
+// Reads the deflate stream least-significant bit first. Reads past the end of
+// the data produce zeros, and are caught by bit_reader_overrun().
+typedef struct BitReader {
+    const uint8_t* data;
+    size_t size;
+    size_t position;
+} BitReader;
+
+// Lookup table indexed by the next <bits> bits of the stream. Entries hold
+// (symbol << 4) | code length, or 0 for bit patterns that aren't a code.
+typedef struct HuffmanTable {
+    uint16_t* entries;
+    unsigned int bits;
+} HuffmanTable;
+
+typedef struct Inflater {
+    HuffmanTable literal;
+    HuffmanTable distance;
+    HuffmanTable fixed_literal;
+    HuffmanTable fixed_distance;
+    uint16_t literal_entries[1 << MAX_CODE_BITS];
+    uint16_t distance_entries[1 << MAX_CODE_BITS];
+    uint16_t code_length_entries[1 << MAX_CODE_LENGTH_BITS];
+    uint16_t fixed_literal_entries[1 << FIXED_LITERAL_BITS];
+    uint16_t fixed_distance_entries[1 << FIXED_DISTANCE_BITS];
+} Inflater;
+
+// Decompressed data. While the window preceding the data is unknown, output
+// is recorded in <symbols>: values below 256 are literal bytes, and values
+// from 256 refer to byte (value - 256) of the unknown window. Once the last
+// WINDOW_SIZE symbols are all literals, nothing can refer to the unknown
+// window anymore, so those symbols are copied to the start of <bytes>
+// (<prefix_length>) and decoding continues there.
+typedef struct InflateOutput {
+    uint16_t* symbols;
+    size_t symbol_count;
+    size_t symbol_capacity;
+    size_t last_marker;
+
+    uint8_t* bytes;
+    size_t byte_count;
+    size_t byte_capacity;
+    size_t prefix_length;
+
+    bool markers;
+} InflateOutput;
+
+typedef enum InflateStop {
+    // Reached a dynamic block at or beyond the requested boundary.
+    INFLATE_STOP_BOUNDARY,
+    // Decoded the final block of a gzip member.
+    INFLATE_STOP_FINAL,
+    // Produced at least the requested amount of data.
+    INFLATE_STOP_LIMIT,
+} InflateStop;
+
+typedef enum ChunkStatus {
+    // No block was found in the chunk. Its data is decoded by the chunk
+    // before it.
+    CHUNK_EMPTY,
+    CHUNK_DECODED,
+    // A block was found, but decoding from it failed or produced too much
+    // data to hold in memory.
+    CHUNK_UNUSABLE,
+} ChunkStatus;
+
+typedef struct GzipChunk {
+    ChunkStatus status;
+    // Bit offsets of the first block decoded, and of the end of the last one.
+    size_t start;
+    size_t end;
+    // The last block decoded was the final block of a member.
+    bool final;
+    InflateOutput output;
+} GzipChunk;
+
+typedef struct ParallelGzip {
+    const uint8_t* data;
+    size_t size;
+    size_t first_block;
+    size_t chunk_count;
+    ParallelStream* stream;
+    size_t next_chunk;
+    Inflater* inflater;
+
+    // Bit offset of the next block to be handed to the consumer.
+    size_t position;
+    uint8_t window[WINDOW_SIZE];
+    size_t window_length;
+    uint32_t crc;
+    uint32_t member_size;
+    bool done;
+
+    // Decoding sequentially from <position> until a dynamic block at or after
+    // <sequential_boundary>.
+    bool sequential;
+    size_t sequential_boundary;
+
+    // Data returned by the next read, and the buffer owned by the decoder
+    // which is released at the next read.
+    const uint8_t* pending;
+    size_t pending_length;
+    void* owned;
+} ParallelGzip;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+// Returns the next 57 bits of the stream.
+static inline uint64_t bit_reader_peek_wide(const BitReader* reader) {
+    size_t byte = reader->position >> 3;
+    uint64_t value = 0;
+    if (byte + sizeof(value) <= reader->size) {
+        memcpy(&value, reader->data + byte, sizeof(value));
+        value = le64toh(value);
+    } else {
+        for (size_t i = 0; i < sizeof(value) && byte + i < reader->size;
+             ++i) {
+            value |= (uint64_t)reader->data[byte + i] << (8 * i);
+        }
+    }
+
+    return value >> (reader->position & 7);
+}
+
+static inline uint32_t bit_reader_peek(const BitReader* reader,
+                                       unsigned int count) {
+    return (uint32_t)(bit_reader_peek_wide(reader) &
+                      ((UINT64_C(1) << count) - 1));
+}
+
+static inline void bit_reader_skip(BitReader* reader, unsigned int count) {
+    reader->position += count;
+}
+
+static inline uint32_t bit_reader_read(BitReader* reader, unsigned int count) {
+    uint32_t value = bit_reader_peek(reader, count);
+    bit_reader_skip(reader, count);
+    return value;
+}
+
+static inline bool bit_reader_overrun(const BitReader* reader) {
+    return reader->position > reader->size * 8;
+}
+
+// Build a canonical Huffman code. As in zlib, an incomplete code is only
+// accepted if <complete> is false and it consists of a single one-bit code.
+static int huffman_table_build(HuffmanTable* table, const uint8_t* lengths,
+                               size_t count, bool complete) {
+    unsigned int counts[MAX_CODE_BITS + 1] = {0};
+    for (size_t i = 0; i < count; ++i) {
+        ++counts[lengths[i]];
+    }
+    counts[0] = 0;
+
+    int left = 1;
+    unsigned int max = 0;
+    for (unsigned int length = 1; length <= MAX_CODE_BITS; ++length) {
+        left <<= 1;
+        left -= (int)counts[length];
+        if (left < 0) {
+            return -EINVAL;
+        }
+        if (0 != counts[length]) {
+            max = length;
+        }
+    }
+
+    if (0 == max) {
+        // No codes: every lookup fails.
+        table->bits = 1;
+        table->entries[0] = table->entries[1] = 0;
+        return 0;
+    }
+    if (left > 0 && (complete || 1 != max)) {
+        return -EINVAL;
+    }
+
+    unsigned int next[MAX_CODE_BITS + 1] = {0};
+    unsigned int code = 0;
+    for (unsigned int length = 1; length <= MAX_CODE_BITS; ++length) {
+        code = (code + counts[length - 1]) << 1;
+        next[length] = code;
+    }
+
+    size_t size = (size_t)1 << max;
+    table->bits = max;
+    memset(table->entries, 0, size * sizeof(uint16_t));
+    for (size_t symbol = 0; symbol < count; ++symbol) {
+        unsigned int length = lengths[symbol];
+        if (0 == length) {
+            continue;
+        }
+
+        // Codes are packed starting with their most significant bit.
+        unsigned int value = next[length]++;
+        size_t reversed = 0;
+        for (unsigned int i = 0; i < length; ++i) {
+            reversed = (reversed << 1) | ((value >> i) & 1);
+        }
+        for (size_t i = reversed; i < size; i += (size_t)1 << length) {
+            table->entries[i] = (uint16_t)((symbol << 4) | length);
+        }
+    }
+
+    return 0;
+}
+
+static inline int huffman_decode(const HuffmanTable* table,
+                                 BitReader* reader) {
+    uint16_t entry = table->entries[bit_reader_peek(reader, table->bits)];
+    if (0 == entry) {
+        return -1;
+    }
+    bit_reader_skip(reader, entry & 0xf);
+    return entry >> 4;
+}
+
+static Inflater* inflater_new() {
+    Inflater* inflater = malloc(sizeof(Inflater));
+    if (NULL == inflater) {
+        return NULL;
+    }
+
+    inflater->literal.entries = inflater->literal_entries;
+    inflater->distance.entries = inflater->distance_entries;
+    inflater->fixed_literal.entries = inflater->fixed_literal_entries;
+    inflater->fixed_distance.entries = inflater->fixed_distance_entries;
+
+    uint8_t lengths[288];
+    memset(lengths, 8, 144);
+    memset(lengths + 144, 9, 112);
+    memset(lengths + 256, 7, 24);
+    memset(lengths + 280, 8, 8);
+    int result = huffman_table_build(&inflater->fixed_literal, lengths, 288,
+                                     true);
+    assert(0 == result);
+
+    // Distance codes 30 and 31 complete the code, but never occur.
+    memset(lengths, 5, 32);
+    result = huffman_table_build(&inflater->fixed_distance, lengths, 32,
+                                 true);
+    assert(0 == result);
+    return inflater;
+}
+
+// Read the header of a dynamic block (after the block type), and build its
+// tables.
+static int inflater_read_dynamic_header(Inflater* inflater,
+                                        BitReader* reader) {
+    unsigned int literal_count = bit_reader_read(reader, 5) + 257;
+    unsigned int distance_count = bit_reader_read(reader, 5) + 1;
+    unsigned int code_length_count = bit_reader_read(reader, 4) + 4;
+    if (literal_count > 286 || distance_count > 30) {
+        return -EINVAL;
+    }
+
+    uint8_t lengths[286 + 30] = {0};
+    for (unsigned int i = 0; i < code_length_count; ++i) {
+        lengths[CODE_LENGTH_ORDER[i]] = (uint8_t)bit_reader_read(reader, 3);
+    }
+
+    HuffmanTable code_lengths = {.entries = inflater->code_length_entries};
+    if (0 != huffman_table_build(&code_lengths, lengths, 19, true)) {
+        return -EINVAL;
+    }
+
+    unsigned int total = literal_count + distance_count;
+    memset(lengths, 0, sizeof(lengths));
+    unsigned int index = 0;
+    while (index < total) {
+        int symbol = huffman_decode(&code_lengths, reader);
+        if (symbol < 0) {
+            return -EINVAL;
+        } else if (symbol < 16) {
+            lengths[index++] = (uint8_t)symbol;
+            continue;
+        }
+
+        uint8_t value = 0;
+        unsigned int repeat = 0;
+        if (16 == symbol) {
+            if (0 == index) {
+                return -EINVAL;
+            }
+            value = lengths[index - 1];
+            repeat = 3 + bit_reader_read(reader, 2);
+        } else if (17 == symbol) {
+            repeat = 3 + bit_reader_read(reader, 3);
+        } else {
+            repeat = 11 + bit_reader_read(reader, 7);
+        }
+
+        if (index + repeat > total) {
+            return -EINVAL;
+        }
+        memset(lengths + index, value, repeat);
+        index += repeat;
+    }
+
+    if (bit_reader_overrun(reader) || 0 == lengths[256]) {
+        return -EINVAL;
+    }
+    if (0 != huffman_table_build(&inflater->literal, lengths, literal_count,
+                                 false) ||
+        0 != huffman_table_build(&inflater->distance, lengths + literal_count,
+                                 distance_count, false)) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+static void output_init_markers(InflateOutput* output) {
+    memset(output, 0, sizeof(*output));
+    output->markers = true;
+}
+
+// Begin output following a known <window>.
+static void output_init_window(InflateOutput* output, const uint8_t* window,
+                               size_t length) {
+    memset(output, 0, sizeof(*output));
+    output->byte_capacity = length > 0 ? length : 1;
+    output->bytes = malloc(output->byte_capacity);
+    assert(NULL != output->bytes);
+    if (length > 0) {
+        memcpy(output->bytes, window, length);
+    }
+    output->byte_count = output->prefix_length = length;
+}
+
+static void output_release(InflateOutput* output) {
+    free(output->symbols);
+    free(output->bytes);
+    memset(output, 0, sizeof(*output));
+}
+
+static inline size_t output_length(const InflateOutput* output) {
+    return output->symbol_count + output->byte_count - output->prefix_length;
+}
+
+static inline void output_reserve_symbols(InflateOutput* output,
+                                          size_t count) {
+    if (output->symbol_count + count <= output->symbol_capacity) {
+        return;
+    }
+
+    size_t capacity = output->symbol_capacity > 0
+                          ? output->symbol_capacity
+                          : 64 * 1024;
+    while (capacity < output->symbol_count + count) {
+        capacity *= 2;
+    }
+    output->symbols = realloc(output->symbols, capacity * sizeof(uint16_t));
+    assert(NULL != output->symbols);
+    output->symbol_capacity = capacity;
+}
+
+static inline void output_reserve_bytes(InflateOutput* output, size_t count) {
+    if (output->byte_count + count <= output->byte_capacity) {
+        return;
+    }
+
+    size_t capacity =
+        output->byte_capacity > 0 ? output->byte_capacity : 64 * 1024;
+    while (capacity < output->byte_count + count) {
+        capacity *= 2;
+    }
+    output->bytes = realloc(output->bytes, capacity);
+    assert(NULL != output->bytes);
+    output->byte_capacity = capacity;
+}
+
+static inline void output_symbol(InflateOutput* output, uint16_t value) {
+    output->symbols[output->symbol_count++] = value;
+    if (value >= 256) {
+        output->last_marker = output->symbol_count;
+    }
+}
+
+// Switch to plain bytes once the unknown window is out of reach.
+static void output_leave_markers(InflateOutput* output) {
+    if (!output->markers ||
+        output->symbol_count - output->last_marker < WINDOW_SIZE) {
+        return;
+    }
+
+    output_reserve_bytes(output, WINDOW_SIZE);
+    const uint16_t* tail =
+        output->symbols + output->symbol_count - WINDOW_SIZE;
+    for (size_t i = 0; i < WINDOW_SIZE; ++i) {
+        output->bytes[i] = (uint8_t)tail[i];
+    }
+    output->byte_count = output->prefix_length = WINDOW_SIZE;
+    output->markers = false;
+}
+
+static inline void output_literal(InflateOutput* output, uint8_t value) {
+    if (!output->markers) {
+        output_reserve_bytes(output, 1);
+        output->bytes[output->byte_count++] = value;
+        return;
+    }
+
+    output_reserve_symbols(output, 1);
+    output_symbol(output, value);
+    output_leave_markers(output);
+}
+
+static int output_copy(InflateOutput* output, size_t length,
+                       size_t distance) {
+    if (!output->markers) {
+        if (distance > output->byte_count) {
+            return -EINVAL;
+        }
+
+        output_reserve_bytes(output, length);
+        uint8_t* destination = output->bytes + output->byte_count;
+        const uint8_t* source = destination - distance;
+        // The regions may overlap, which repeats the source.
+        for (size_t i = 0; i < length; ++i) {
+            destination[i] = source[i];
+        }
+        output->byte_count += length;
+        return 0;
+    }
+
+    if (distance > output->symbol_count + WINDOW_SIZE) {
+        return -EINVAL;
+    }
+
+    output_reserve_symbols(output, length);
+    for (size_t i = 0; i < length; ++i) {
+        size_t position = output->symbol_count;
+        if (distance > position) {
+            output_symbol(output,
+                          (uint16_t)(256 + WINDOW_SIZE + position - distance));
+        } else {
+            output_symbol(output, output->symbols[position - distance]);
+        }
+    }
+    output_leave_markers(output);
+    return 0;
+}
+
+static int inflate_stored_block(BitReader* reader, InflateOutput* output) {
+    reader->position = (reader->position + 7) & ~(size_t)7;
+    uint32_t length = bit_reader_read(reader, 16);
+    uint32_t complement = bit_reader_read(reader, 16);
+    size_t byte = reader->position / 8;
+    if (bit_reader_overrun(reader) || length != (~complement & 0xffff) ||
+        byte + length > reader->size) {
+        return -EINVAL;
+    }
+
+    const uint8_t* data = reader->data + byte;
+    if (output->markers) {
+        output_reserve_symbols(output, length);
+        for (size_t i = 0; i < length; ++i) {
+            output_symbol(output, data[i]);
+        }
+        output_leave_markers(output);
+    } else {
+        output_reserve_bytes(output, length);
+        memcpy(output->bytes + output->byte_count, data, length);
+        output->byte_count += length;
+    }
+
+    reader->position += (size_t)length * 8;
+    return 0;
+}
+
+// Decode a block of compressed data. Fails with -E2BIG once <output> holds
+// more than <limit> bytes, which bounds the damage done by decoding garbage.
+static int inflate_huffman_block(BitReader* reader, InflateOutput* output,
+                                 const HuffmanTable* literal,
+                                 const HuffmanTable* distance, size_t limit) {
+    for (;;) {
+        int symbol = huffman_decode(literal, reader);
+        if (symbol < 0 || bit_reader_overrun(reader)) {
+            return -EINVAL;
+        } else if (symbol < 256) {
+            output_literal(output, (uint8_t)symbol);
+            continue;
+        } else if (256 == symbol) {
+            return 0;
+        }
+
+        symbol -= 257;
+        if (symbol >= 29) {
+            return -EINVAL;
+        }
+        size_t length = LENGTH_BASE[symbol] +
+                        bit_reader_read(reader, LENGTH_EXTRA[symbol]);
+
+        symbol = huffman_decode(distance, reader);
+        if (symbol < 0 || symbol >= 30) {
+            return -EINVAL;
+        }
+        size_t offset = DISTANCE_BASE[symbol] +
+                        bit_reader_read(reader, DISTANCE_EXTRA[symbol]);
+        if (0 != output_copy(output, length, offset)) {
+            return -EINVAL;
+        }
+        if (output_length(output) > limit) {
+            return -E2BIG;
+        }
+    }
+}
+
+static inline bool is_dynamic_block(const BitReader* reader) {
+    return 2 == ((bit_reader_peek(reader, 3) >> 1) & 3);
+}
+
+// Decode blocks until reaching a dynamic block at or after the bit offset
+// <boundary>, the end of a member, or until at least <soft_limit> bytes have
+// been produced. No single block may produce more than <hard_limit> bytes.
+static int inflate_blocks(Inflater* inflater, BitReader* reader,
+                          InflateOutput* output, size_t boundary,
+                          size_t soft_limit, size_t hard_limit,
+                          InflateStop* stop) {
+    for (;;) {
+        if (reader->position >= boundary && is_dynamic_block(reader)) {
+            *stop = INFLATE_STOP_BOUNDARY;
+            return 0;
+        }
+        if (output_length(output) >= soft_limit) {
+            *stop = INFLATE_STOP_LIMIT;
+            return 0;
+        }
+
+        bool final = bit_reader_read(reader, 1);
+        int result = 0;
+        switch (bit_reader_read(reader, 2)) {
+        case 0: result = inflate_stored_block(reader, output); break;
+        case 1:
+            result = inflate_huffman_block(reader, output,
+                                           &inflater->fixed_literal,
+                                           &inflater->fixed_distance,
+                                           hard_limit);
+            break;
+        case 2:
+            result = inflater_read_dynamic_header(inflater, reader);
+            if (0 == result) {
+                result = inflate_huffman_block(reader, output,
+                                               &inflater->literal,
+                                               &inflater->distance,
+                                               hard_limit);
+            }
+            break;
+        default: result = -EINVAL; break;
+        }
+
+        if (0 != result) {
+            return result;
+        }
+        if (final) {
+            *stop = INFLATE_STOP_FINAL;
+            return 0;
+        }
+    }
+}
+
+// Find the first bit offset in [<from>, <to>) which begins a plausible dynamic
+// block: one with a valid header. Returns SIZE_MAX if there is none.
+static size_t find_dynamic_block(Inflater* inflater, const uint8_t* data,
+                                 size_t size, size_t from, size_t to) {
+    BitReader reader = {.data = data, .size = size};
+    for (size_t position = from; position < to; ++position) {
+        reader.position = position;
+        // Cheap checks of the block type and the symbol counts first.
+        uint32_t bits = bit_reader_peek(&reader, 17);
+        if (2 != ((bits >> 1) & 3) || ((bits >> 3) & 0x1f) > 29 ||
+            ((bits >> 8) & 0x1f) > 29) {
+            continue;
+        }
+
+        // The code length code must be complete, which rules out most
+        // positions before any tables are built.
+        reader.position += 17;
+        uint64_t lengths = bit_reader_peek_wide(&reader);
+        unsigned int code_length_count = ((bits >> 13) & 0xf) + 4;
+        unsigned int kraft = 0;
+        for (unsigned int i = 0; i < code_length_count; ++i) {
+            unsigned int length = (lengths >> (3 * i)) & 7;
+            if (0 != length) {
+                kraft += 1u << (MAX_CODE_LENGTH_BITS - length);
+            }
+        }
+        if (1u << MAX_CODE_LENGTH_BITS != kraft) {
+            continue;
+        }
+
+        reader.position = position + 3;
+        if (0 == inflater_read_dynamic_header(inflater, &reader)) {
+            return position;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+// Returns the length of the gzip member header at the start of <data>, or 0
+// if there isn't one.
+static size_t gzip_header_length(const uint8_t* data, size_t size) {
+    if (size < 10 || 0x1f != data[0] || 0x8b != data[1] ||
+        Z_DEFLATED != data[2] || 0 != (data[3] & GZIP_FLAG_RESERVED)) {
+        return 0;
+    }
+
+    uint8_t flags = data[3];
+    size_t length = 10;
+    if (flags & GZIP_FLAG_EXTRA) {
+        if (length + 2 > size) {
+            return 0;
+        }
+        length += 2 + (data[length] | (data[length + 1] << 8));
+    }
+
+    const uint8_t strings[] = {GZIP_FLAG_NAME, GZIP_FLAG_COMMENT};
+    for (size_t i = 0; i < sizeof(strings); ++i) {
+        if (0 == (flags & strings[i])) {
+            continue;
+        }
+        if (length >= size) {
+            return 0;
+        }
+        const uint8_t* end = memchr(data + length, 0, size - length);
+        if (NULL == end) {
+            return 0;
+        }
+        length = (size_t)(end - data) + 1;
+    }
+
+    if (flags & GZIP_FLAG_HCRC) {
+        length += 2;
+    }
+    return length < size ? length : 0;
+}
+
+static inline size_t chunk_offset(const ParallelGzip* decoder, size_t index) {
+    return decoder->first_block + index * CHUNK_SIZE * 8;
+}
+
+static void gzip_chunk_free(void* data) {
+    GzipChunk* chunk = (GzipChunk*)data;
+    output_release(&chunk->output);
+    free(chunk);
+}
+
+// ParallelStreamWork: decode a chunk, starting from the first block found in
+// it, until the first dynamic block in the next chunk. The first chunk is
+// decoded from the beginning of the stream, where the window is known to be
+// empty.
+static int decode_chunk(void* user_data, size_t index, void** data,
+                        size_t* length) {
+    ParallelGzip* decoder = (ParallelGzip*)user_data;
+    GzipChunk* chunk = calloc(1, sizeof(GzipChunk));
+    assert(NULL != chunk);
+    Inflater* inflater = inflater_new();
+    assert(NULL != inflater);
+
+    size_t end = index + 1 < decoder->chunk_count
+                     ? chunk_offset(decoder, index + 1)
+                     : decoder->size * 8;
+    size_t boundary = index + 1 < decoder->chunk_count ? end : SIZE_MAX;
+    size_t candidate = chunk_offset(decoder, index);
+    if (0 != index) {
+        candidate = find_dynamic_block(inflater, decoder->data, decoder->size,
+                                       candidate, end);
+    }
+
+    chunk->status = CHUNK_EMPTY;
+    while (SIZE_MAX != candidate) {
+        if (0 == index) {
+            output_init_window(&chunk->output, NULL, 0);
+        } else {
+            output_init_markers(&chunk->output);
+        }
+
+        BitReader reader = {
+            .data = decoder->data,
+            .size = decoder->size,
+            .position = candidate,
+        };
+        InflateStop stop = INFLATE_STOP_LIMIT;
+        int result =
+            inflate_blocks(inflater, &reader, &chunk->output, boundary,
+                           MAX_CHUNK_OUTPUT, MAX_CHUNK_OUTPUT, &stop);
+        if (0 == result && INFLATE_STOP_LIMIT != stop) {
+            chunk->status = CHUNK_DECODED;
+            chunk->start = candidate;
+            chunk->end = reader.position;
+            chunk->final = INFLATE_STOP_FINAL == stop;
+            break;
+        }
+
+        // Too much data, or an error at the start of the stream, is left for
+        // the consumer to sort out. Otherwise, this was a false positive.
+        output_release(&chunk->output);
+        if (0 == index || 0 == result || -E2BIG == result) {
+            chunk->status = CHUNK_UNUSABLE;
+            break;
+        }
+        candidate = find_dynamic_block(inflater, decoder->data, decoder->size,
+                                       candidate + 1, end);
+    }
+
+    free(inflater);
+    *data = chunk;
+    *length = sizeof(GzipChunk);
+    return 0;
+}
+
+// Account for data handed to the consumer.
+static void parallel_gzip_consume(ParallelGzip* decoder, const uint8_t* data,
+                                  size_t length) {
+    // crc32() would reset the checksum given a NULL buffer.
+    if (0 == length) {
+        return;
+    }
+
+    decoder->crc = crc32(decoder->crc, data, (uInt)length);
+    decoder->member_size += (uint32_t)length;
+
+    if (length >= WINDOW_SIZE) {
+        memcpy(decoder->window, data + length - WINDOW_SIZE, WINDOW_SIZE);
+        decoder->window_length = WINDOW_SIZE;
+        return;
+    }
+
+    size_t keep = decoder->window_length;
+    if (keep > WINDOW_SIZE - length) {
+        keep = WINDOW_SIZE - length;
+    }
+    memmove(decoder->window,
+            decoder->window + decoder->window_length - keep, keep);
+    memcpy(decoder->window + keep, data, length);
+    decoder->window_length = keep + length;
+}
+
+// Check the trailer of the member that ends at <position>, and move on to the
+// next member, if there is one.
+static int parallel_gzip_finish_member(ParallelGzip* decoder) {
+    size_t byte = (decoder->position + 7) / 8;
+    if (byte + 8 > decoder->size) {
+        return -EINVAL;
+    }
+
+    const uint8_t* trailer = decoder->data + byte;
+    uint32_t crc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) |
+                   ((uint32_t)trailer[3] << 24);
+    uint32_t size = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) |
+                    ((uint32_t)trailer[7] << 24);
+    if (crc != decoder->crc || size != decoder->member_size) {
+        fprintf(stderr, "gzip: CRC or length mismatch in member trailer\n");
+        return -EINVAL;
+    }
+
+    byte += 8;
+    size_t header = gzip_header_length(decoder->data + byte,
+                                       decoder->size - byte);
+    if (0 == header) {
+        // Anything following the last member is ignored, as gzip(1) does.
+        decoder->position = decoder->size * 8;
+        decoder->done = true;
+        return 0;
+    }
+
+    decoder->position = (byte + header) * 8;
+    decoder->crc = crc32(0, NULL, 0);
+    decoder->member_size = 0;
+    decoder->window_length = 0;
+    return 0;
+}
+
+// Replace the markers in <chunk> using the current window. The chunk is only
+// consumed if every marker can be resolved.
+static int parallel_gzip_accept_chunk(ParallelGzip* decoder,
+                                      const GzipChunk* chunk) {
+    const InflateOutput* output = &chunk->output;
+    size_t unknown = WINDOW_SIZE - decoder->window_length;
+    uint8_t* resolved = NULL;
+    if (output->symbol_count > 0) {
+        resolved = malloc(output->symbol_count);
+        assert(NULL != resolved);
+    }
+
+    for (size_t i = 0; i < output->symbol_count; ++i) {
+        uint16_t value = output->symbols[i];
+        if (value < 256) {
+            resolved[i] = (uint8_t)value;
+        } else if ((size_t)(value - 256) >= unknown) {
+            resolved[i] = decoder->window[value - 256 - unknown];
+        } else {
+            free(resolved);
+            return -EINVAL;
+        }
+    }
+
+    parallel_gzip_consume(decoder, resolved, output->symbol_count);
+    free(decoder->owned);
+    decoder->owned = resolved;
+    decoder->pending = resolved;
+    decoder->pending_length = output->symbol_count;
+
+    // Plain bytes are handed out straight from the chunk, which remains valid
+    // until the next chunk is requested.
+    decoder->position = chunk->end;
+    return 0;
+}
+
+// Decode sequentially from <position>, with the window known.
+static ssize_t parallel_gzip_decode_sequential(ParallelGzip* decoder,
+                                               const void** buffer) {
+    InflateOutput output = {0};
+    output_init_window(&output, decoder->window, decoder->window_length);
+    BitReader reader = {
+        .data = decoder->data,
+        .size = decoder->size,
+        .position = decoder->position,
+    };
+
+    InflateStop stop = INFLATE_STOP_LIMIT;
+    int result = inflate_blocks(decoder->inflater, &reader, &output,
+                                decoder->sequential_boundary,
+                                SEQUENTIAL_OUTPUT, SIZE_MAX, &stop);
+    if (0 != result) {
+        output_release(&output);
+        return result;
+    }
+
+    size_t length = output.byte_count - output.prefix_length;
+    parallel_gzip_consume(decoder, output.bytes + output.prefix_length,
+                          length);
+    free(decoder->owned);
+    decoder->owned = output.bytes;
+    *buffer = output.bytes + output.prefix_length;
+    output.bytes = NULL;
+    output_release(&output);
+
+    decoder->position = reader.position;
+    if (INFLATE_STOP_BOUNDARY == stop) {
+        decoder->sequential = false;
+    } else if (INFLATE_STOP_FINAL == stop) {
+        result = parallel_gzip_finish_member(decoder);
+        if (0 != result) {
+            return result;
+        }
+    }
+
+    return (ssize_t)length;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+bool parallel_gzip_detect(const void* data, size_t size) {
+    return size >= 2 * CHUNK_SIZE && 0 != gzip_header_length(data, size);
+}
+
+ParallelGzip* parallel_gzip_new(const void* data, size_t size,
+                                unsigned int threads) {
+    size_t header = gzip_header_length(data, size);
+    if (0 == header) {
+        return NULL;
+    }
+
+    ParallelGzip* decoder = calloc(1, sizeof(ParallelGzip));
+    assert(NULL != decoder);
+    decoder->data = data;
+    decoder->size = size;
+    decoder->first_block = header * 8;
+    decoder->position = decoder->first_block;
+    decoder->chunk_count = (size - header + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    decoder->crc = crc32(0, NULL, 0);
+    decoder->inflater = inflater_new();
+    assert(NULL != decoder->inflater);
+
+    decoder->stream = parallel_stream_new(decoder->chunk_count, threads,
+                                          decode_chunk, gzip_chunk_free,
+                                          decoder);
+    if (NULL == decoder->stream) {
+        free(decoder->inflater);
+        free(decoder);
+        return NULL;
+    }
+    return decoder;
+}
+
+ssize_t parallel_gzip_read(ParallelGzip* decoder, const void** buffer) {
+    for (;;) {
+        if (decoder->pending_length > 0) {
+            *buffer = decoder->pending;
+            ssize_t length = (ssize_t)decoder->pending_length;
+            decoder->pending_length = 0;
+            return length;
+        }
+
+        if (decoder->done) {
+            return 0;
+        }
+
+        if (decoder->sequential) {
+            ssize_t length = parallel_gzip_decode_sequential(decoder, buffer);
+            if (0 != length) {
+                return length;
+            }
+            continue;
+        }
+
+        if (decoder->next_chunk >= decoder->chunk_count) {
+            decoder->sequential = true;
+            decoder->sequential_boundary = SIZE_MAX;
+            continue;
+        }
+
+        // Anything before the next chunk's region that no chunk decoded (e.g.
+        // the start of a new member) is decoded sequentially.
+        size_t offset = chunk_offset(decoder, decoder->next_chunk);
+        if (decoder->position < offset) {
+            decoder->sequential = true;
+            decoder->sequential_boundary = offset;
+            continue;
+        }
+
+        const void* data = NULL;
+        ssize_t result = parallel_stream_next(decoder->stream, &data);
+        if (0 > result) {
+            return result;
+        }
+        const GzipChunk* chunk = (const GzipChunk*)data;
+        ++decoder->next_chunk;
+        if (CHUNK_EMPTY == chunk->status) {
+            continue;
+        }
+
+        if (CHUNK_DECODED == chunk->status &&
+            chunk->start == decoder->position &&
+            0 == parallel_gzip_accept_chunk(decoder, chunk)) {
+            const InflateOutput* output = &chunk->output;
+            const uint8_t* bytes = output->bytes + output->prefix_length;
+            size_t length = output->byte_count - output->prefix_length;
+            parallel_gzip_consume(decoder, bytes, length);
+
+            if (chunk->final) {
+                int error = parallel_gzip_finish_member(decoder);
+                if (0 != error) {
+                    return error;
+                }
+            }
+
+            if (0 == decoder->pending_length) {
+                decoder->pending = bytes;
+                decoder->pending_length = length;
+                continue;
+            }
+
+            // Hand out the resolved part first, and then the rest.
+            *buffer = decoder->pending;
+            ssize_t resolved = (ssize_t)decoder->pending_length;
+            decoder->pending = bytes;
+            decoder->pending_length = length;
+            return resolved;
+        }
+
+        // The chunk doesn't begin where its predecessor ended, so its search
+        // found a false positive. Decode its region again.
+        decoder->sequential = true;
+        decoder->sequential_boundary =
+            decoder->next_chunk < decoder->chunk_count
+                ? chunk_offset(decoder, decoder->next_chunk)
+                : SIZE_MAX;
+    }
+}
+
+size_t parallel_gzip_tell(const ParallelGzip* decoder) {
+    return decoder->position / 8;
+}
+
+void parallel_gzip_free(ParallelGzip* decoder) {
+    parallel_stream_free(decoder->stream);
+    free(decoder->inflater);
+    free(decoder->owned);
+    free(decoder);
+}
+
+///////////////////////////////////////////////////////////////////////////////
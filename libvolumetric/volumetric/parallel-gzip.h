@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            parallel-gzip.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Parallel decompression of ordinary (single-stream) gzip
+//                  files.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef VOLUMETRIC_PARALLEL_GZIP_H
+#define VOLUMETRIC_PARALLEL_GZIP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// The compressed file is split into fixed-size chunks. Workers search each
+// chunk for the first plausible deflate block, and decode from there without
+// knowing the preceding 32 KiB window: back-references into the unknown
+// window are recorded as markers. The consumer walks the chunks in order,
+// replaces the markers with the (by then known) window, and checks that each
+// chunk starts exactly where the previous one ended. Anything that doesn't
+// line up is decoded again sequentially, so a false positive in the search
+// only costs time.
+
+typedef struct ParallelGzip ParallelGzip;
+
+// Returns true if <data> begins with a gzip member that this decoder can
+// handle, and is large enough to benefit from decoding in parallel.
+bool parallel_gzip_detect(const void* data, size_t size);
+
+// Begin decoding <data> with up to <threads> workers (0 for one per CPU).
+// <data> must outlive the decoder.
+ParallelGzip* parallel_gzip_new(const void* data, size_t size,
+                                unsigned int threads);
+
+// Get the next block of decompressed data, which is valid until the next call.
+// Returns the length of the block, 0 at the end of the stream, or a negative
+// errno on failure.
+ssize_t parallel_gzip_read(ParallelGzip* decoder, const void** buffer);
+
+// Number of compressed bytes that have been fully consumed so far.
+size_t parallel_gzip_tell(const ParallelGzip* decoder);
+
+void parallel_gzip_free(ParallelGzip* decoder);
+
+#endif // VOLUMETRIC_PARALLEL_GZIP_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,246 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            parallel-stream.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the parallel stream interface.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib-2.0/glib.h>
+
+#include <volumetric/parallel-stream.h>
+
+// Number of chunks each worker may produce ahead of the consumer.
+static const size_t CHUNKS_IN_FLIGHT_PER_THREAD = 2;
+
+typedef enum ChunkState {
+    CHUNK_PENDING,
+    CHUNK_READY,
+    CHUNK_FAILED,
+    // Skipped by the consumer, so its data is released as soon as it's
+    // produced, if it's produced at all.
+    CHUNK_SKIPPED,
+} ChunkState;
+
+typedef struct StreamChunk {
+    void* data;
+    size_t length;
+    ChunkState state;
+    int error;
+} StreamChunk;
+
+typedef struct ParallelStream {
+    ParallelStreamWork work;
+    ParallelStreamRelease release;
+    void* user_data;
+
+    GThreadPool* pool;
+    size_t window;
+
+    StreamChunk* chunks;
+    size_t chunk_count;
+    size_t chunks_submitted;
+    size_t next_chunk;
+
+    GMutex lock;
+    GCond chunk_done;
+} ParallelStream;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static void parallel_stream_run_chunk(gpointer data, gpointer user_data) {
+    ParallelStream* stream = (ParallelStream*)user_data;
+    // Indices are offset by one, since the pool doesn't accept NULL tasks.
+    size_t index = GPOINTER_TO_UINT(data) - 1;
+    StreamChunk* chunk = &stream->chunks[index];
+    g_mutex_lock(&stream->lock);
+    bool skipped = CHUNK_SKIPPED == chunk->state;
+    g_mutex_unlock(&stream->lock);
+    if (skipped) {
+        return;
+    }
+
+    void* output = NULL;
+    size_t length = 0;
+    int result = stream->work(stream->user_data, index, &output, &length);
+
+    g_mutex_lock(&stream->lock);
+    if (CHUNK_SKIPPED == chunk->state) {
+        g_mutex_unlock(&stream->lock);
+        if (NULL != output) {
+            stream->release(output);
+        }
+        return;
+    }
+
+    chunk->data = output;
+    chunk->length = length;
+    chunk->error = result;
+    chunk->state = 0 == result ? CHUNK_READY : CHUNK_FAILED;
+    g_cond_broadcast(&stream->chunk_done);
+    g_mutex_unlock(&stream->lock);
+}
+
+// Keep the pool busy, without producing too far ahead of the consumer.
+static void parallel_stream_submit(ParallelStream* stream) {
+    while (stream->chunks_submitted < stream->chunk_count &&
+           stream->chunks_submitted < stream->next_chunk + stream->window) {
+        g_thread_pool_push(stream->pool,
+                           GUINT_TO_POINTER(stream->chunks_submitted + 1),
+                           NULL);
+        ++stream->chunks_submitted;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+ParallelStream* parallel_stream_new(size_t chunk_count, unsigned int threads,
+                                    ParallelStreamWork work,
+                                    ParallelStreamRelease release,
+                                    void* user_data) {
+    ParallelStream* stream = malloc(sizeof(ParallelStream));
+    if (NULL == stream) {
+        return NULL;
+    }
+    memset(stream, 0, sizeof(*stream));
+
+    if (0 == threads) {
+        threads = g_get_num_processors();
+    }
+
+    stream->work = work;
+    stream->release = NULL != release ? release : free;
+    stream->user_data = user_data;
+    stream->window = threads * CHUNKS_IN_FLIGHT_PER_THREAD;
+    stream->chunk_count = chunk_count;
+    stream->chunks = calloc(chunk_count + 1, sizeof(StreamChunk));
+    assert(NULL != stream->chunks);
+    g_mutex_init(&stream->lock);
+    g_cond_init(&stream->chunk_done);
+
+    GError* error = NULL;
+    stream->pool = g_thread_pool_new(parallel_stream_run_chunk, stream,
+                                     (gint)threads, FALSE, &error);
+    if (NULL == stream->pool) {
+        fprintf(stderr, "Couldn't create thread pool: %s\n", error->message);
+        g_error_free(error);
+        g_mutex_clear(&stream->lock);
+        g_cond_clear(&stream->chunk_done);
+        free(stream->chunks);
+        free(stream);
+        return NULL;
+    }
+
+    g_mutex_lock(&stream->lock);
+    parallel_stream_submit(stream);
+    g_mutex_unlock(&stream->lock);
+    return stream;
+}
+
+ssize_t parallel_stream_next(ParallelStream* stream, const void** data) {
+    g_mutex_lock(&stream->lock);
+
+    // The consumer is done with the previous chunk.
+    if (0 < stream->next_chunk) {
+        StreamChunk* previous = &stream->chunks[stream->next_chunk - 1];
+        if (NULL != previous->data) {
+            stream->release(previous->data);
+            previous->data = NULL;
+        }
+    }
+
+    if (stream->next_chunk >= stream->chunk_count) {
+        g_mutex_unlock(&stream->lock);
+        return 0;
+    }
+
+    parallel_stream_submit(stream);
+    StreamChunk* chunk = &stream->chunks[stream->next_chunk];
+    while (CHUNK_PENDING == chunk->state) {
+        g_cond_wait(&stream->chunk_done, &stream->lock);
+    }
+
+    if (CHUNK_FAILED == chunk->state) {
+        int error = chunk->error;
+        g_mutex_unlock(&stream->lock);
+        return error;
+    }
+
+    ++stream->next_chunk;
+    parallel_stream_submit(stream);
+    g_mutex_unlock(&stream->lock);
+
+    *data = chunk->data;
+    return (ssize_t)chunk->length;
+}
+
+void parallel_stream_seek(ParallelStream* stream, size_t chunk) {
+    g_mutex_lock(&stream->lock);
+    assert(chunk >= stream->next_chunk && chunk <= stream->chunk_count);
+
+    // The consumer is done with the previous chunk, and those in between.
+    size_t first = 0 < stream->next_chunk ? stream->next_chunk - 1 : 0;
+    for (size_t i = first; i < chunk; ++i) {
+        StreamChunk* skipped = &stream->chunks[i];
+        if (NULL != skipped->data) {
+            stream->release(skipped->data);
+            skipped->data = NULL;
+        }
+        if (CHUNK_PENDING == skipped->state) {
+            skipped->state = CHUNK_SKIPPED;
+        }
+    }
+
+    stream->next_chunk = chunk;
+    if (stream->chunks_submitted < chunk) {
+        stream->chunks_submitted = chunk;
+    }
+    parallel_stream_submit(stream);
+    g_mutex_unlock(&stream->lock);
+}
+
+void parallel_stream_free(ParallelStream* stream) {
+    // Drop anything that hasn't been started, and wait for the rest.
+    g_thread_pool_free(stream->pool, TRUE, TRUE);
+    for (size_t i = 0; i < stream->chunk_count; ++i) {
+        if (NULL != stream->chunks[i].data) {
+            stream->release(stream->chunks[i].data);
+        }
+    }
+
+    g_mutex_clear(&stream->lock);
+    g_cond_clear(&stream->chunk_done);
+    free(stream->chunks);
+    free(stream);
+}
+
+///////////////////////////////////////////////////////////////////////////////
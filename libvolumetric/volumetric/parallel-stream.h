@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            parallel-stream.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     A stream of data which is produced in chunks by a pool of
+//                  worker threads, but consumed in order.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef VOLUMETRIC_PARALLEL_STREAM_H
+#define VOLUMETRIC_PARALLEL_STREAM_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef struct ParallelStream ParallelStream;
+
+// Produce chunk number <chunk> of the stream. Called on a worker thread, so
+// must not touch state shared with other chunks. On success, *data must point
+// to a malloc'd buffer of *length bytes, which is owned by the stream
+// afterwards. Returns 0 on success, or a negative errno.
+typedef int (*ParallelStreamWork)(void* user_data, size_t chunk, void** data,
+                                  size_t* length);
+
+// Release the data of a chunk. free(3) is used if none is provided.
+typedef void (*ParallelStreamRelease)(void* data);
+
+// Create a stream of <chunk_count> chunks, produced by up to <threads>
+// workers (0 for one per CPU). At most a few chunks per worker are held in
+// memory at any time.
+ParallelStream* parallel_stream_new(size_t chunk_count, unsigned int threads,
+                                    ParallelStreamWork work,
+                                    ParallelStreamRelease release,
+                                    void* user_data);
+
+// Get the next chunk, waiting for it to be produced if necessary. The data is
+// valid until the next call. Returns the length of the chunk, 0 at the end of
+// the stream, or a negative errno if the chunk could not be produced.
+ssize_t parallel_stream_next(ParallelStream* stream, const void** data);
+
+// Skip ahead, so that the next call to parallel_stream_next() returns chunk
+// number <chunk>. The chunks skipped over are released, or never produced if
+// no worker has started on them yet. The workers are kept, so this is cheaper
+// than creating a new stream. <chunk> can't be before the next chunk.
+void parallel_stream_seek(ParallelStream* stream, size_t chunk);
+
+// Stop the workers and free memory held by the stream.
+void parallel_stream_free(ParallelStream* stream);
+
+#endif // VOLUMETRIC_PARALLEL_STREAM_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,147 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            path-filter.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Select paths in a volume by glob patterns
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+// For FNM_LEADING_DIR
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <fnmatch.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib-2.0/glib.h>
+
+#include <volumetric/path-filter.h>
+
+typedef struct PathFilter {
+    // NULL-terminated, or NULL if there were no patterns
+    char** include;
+    char** exclude;
+} PathFilter;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static char** split_patterns(const char* patterns) {
+    if (NULL == patterns || '\0' == patterns[0]) {
+        return NULL;
+    }
+    return g_strsplit(patterns, ":", -1);
+}
+
+// True if <path> matches any of <patterns>, or lies underneath a directory
+// that does.
+static bool path_matches_any(char** patterns, const char* path) {
+    for (char** pattern = patterns; NULL != *pattern; ++pattern) {
+        if (0 == fnmatch(*pattern, path, FNM_PATHNAME | FNM_LEADING_DIR)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// True if the leading components of any of <patterns> match the directory
+// <path>, so that something underneath it may match the whole pattern.
+static bool path_is_parent_of_any(char** patterns, const char* path) {
+    size_t depth = 1;
+    for (const char* slash = strchr(path, '/'); NULL != slash;
+         slash = strchr(slash + 1, '/')) {
+        ++depth;
+    }
+
+    bool matches = false;
+    for (char** pattern = patterns; !matches && NULL != *pattern; ++pattern) {
+        // Cut the pattern after as many components as the path has.
+        const char* end = *pattern;
+        for (size_t i = 0; i < depth && NULL != end; ++i) {
+            end = strchr(i > 0 ? end + 1 : end, '/');
+        }
+        if (NULL == end) {
+            continue;
+        }
+
+        char* prefix = strndup(*pattern, end - *pattern);
+        assert(NULL != prefix);
+        matches = 0 == fnmatch(prefix, path, FNM_PATHNAME);
+        free(prefix);
+    }
+    return matches;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+PathFilter* path_filter_new(const char* include, const char* exclude) {
+    PathFilter* filter = malloc(sizeof(PathFilter));
+    assert(NULL != filter);
+    filter->include = split_patterns(include);
+    filter->exclude = split_patterns(exclude);
+    return filter;
+}
+
+void path_filter_free(PathFilter* filter) {
+    g_strfreev(filter->include);
+    g_strfreev(filter->exclude);
+    free(filter);
+}
+
+bool path_filter_selects(const PathFilter* filter, const char* path,
+                         bool is_directory) {
+    for (;;) {
+        if ('/' == path[0]) {
+            path += 1;
+        } else if ('.' == path[0] && '/' == path[1]) {
+            path += 2;
+        } else {
+            break;
+        }
+    }
+
+    size_t length = strlen(path);
+    while (0 < length && '/' == path[length - 1]) {
+        --length;
+    }
+    if (0 == length || (1 == length && '.' == path[0])) {
+        return true;
+    }
+
+    char* relative = strndup(path, length);
+    assert(NULL != relative);
+    bool selected = NULL == filter->include ||
+                    path_matches_any(filter->include, relative) ||
+                    (is_directory &&
+                     path_is_parent_of_any(filter->include, relative));
+    if (selected && NULL != filter->exclude) {
+        selected = !path_matches_any(filter->exclude, relative);
+    }
+    free(relative);
+    return selected;
+}
+
+///////////////////////////////////////////////////////////////////////////////
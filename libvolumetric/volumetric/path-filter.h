@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            path-filter.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Select paths in a volume by glob patterns
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef VOLUMETRIC_PATH_FILTER_H
+#define VOLUMETRIC_PATH_FILTER_H
+
+#include <stdbool.h>
+
+// Patterns are globs (see fnmatch(3)) matched against paths relative to the
+// root of the volume, e.g. "datasets/*.bin". A pattern that matches a
+// directory also matches everything underneath it.
+typedef struct PathFilter PathFilter;
+
+// <include> and <exclude> are colon-separated lists of patterns, either of
+// which may be NULL. A path is selected if it matches a pattern in <include>
+// (or <include> is NULL), and none in <exclude>.
+PathFilter* path_filter_new(const char* include, const char* exclude);
+void path_filter_free(PathFilter* filter);
+
+// Returns true if <path> is selected. A leading "./" and trailing slashes are
+// ignored, and the root of the volume is always selected. A directory is also
+// selected if something underneath it could be included, so that its
+// metadata is preserved.
+bool path_filter_selects(const PathFilter* filter, const char* path,
+                         bool is_directory);
+
+#endif // VOLUMETRIC_PATH_FILTER_H
+
+///////////////////////////////////////////////////////////////////////////////
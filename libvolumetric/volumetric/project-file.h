@@ -7,7 +7,7 @@
 //
 // CREATED:         02/09/2022
 //
-// LAST EDITED:     02/09/2022
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -38,10 +38,37 @@ extern const char* VOLUME_SCHEMA_VERSION; // 1.0
 // volume-path: <colon-separated list of EXTRA paths to search for volumes>
 // volumes:
 //  <name>:
+//   priority: <integer, volumes with higher priorities are checked out first.
+//              Each volume is marked ready in /run/volumetric/ready/<name>>
+//   depends-on: <colon-separated list of names of volumes (in Docker) which
+//                must be checked out before this one>
 //   <type, e.g. archive>:
 //    name: <name of the volume>
 //    url: <url to find the volume at. Only file:// scheme is supported>
 //    hash: <hash of the volume file>
+//    verify: <before-extract (default) or during-extract>
+//    compression: <gzip (default) or seekable-zstd, used on commit>
+//    compression-threads: <number of threads compressing on commit, or 0
+//                          (default) for one per CPU>
+//    commit: <full (default) or incremental, to commit only what changed
+//             since the last commit, as a layer on top of it>
+//    checkout: <replace (default), swap, overlay, lazy, incremental or
+//               incremental-contents>
+//    cache: <clone (default), hardlink or off, when the extract cache is used>
+//    io: <blocking (default) or io-uring, for small files>
+//    gzip-decoder: <libarchive (default) or parallel, to decode large gzip
+//                   archives on several threads>
+//    sync: <durable (default) or none, before the lock file is written>
+//    include: <colon-separated list of glob patterns of paths to check out>
+//    exclude: <colon-separated list of glob patterns of paths to leave out>
+//    transport: <local (default) or docker-archive, to stream the volume
+//                through a helper container instead of its mountpoint>
+//    helper-image: <image of the helper container, busybox by default>
+//   chunked:
+//    name: <name of the volume>
+//    url: <directory of the chunk store holding every version of the volume>
+//    hash: <hash of the manifest of the current version>
+//    update: <never (default) or on-stale-lock, as for archive volumes>
 // See volume.h for the definitions of other volume types.
 
 typedef struct ProjectFile {
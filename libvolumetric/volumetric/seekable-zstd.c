@@ -0,0 +1,599 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            seekable-zstd.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementation of the seekable zstd archive format.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <archive.h>
+#include <glib-2.0/glib.h>
+#include <zstd.h>
+
+#include <volumetric/seekable-zstd.h>
+
+// Amount of the uncompressed tar stream stored in each frame. Smaller frames
+// allow more parallelism when decompressing, at the cost of compression ratio.
+static const size_t FRAME_SIZE = 4 * 1024 * 1024;
+static const int COMPRESSION_LEVEL = 3;
+// Frames are compressed by several workers in sections of this size, so that
+// every worker has a share of each frame.
+static const size_t FRAME_JOB_SIZE = 512 * 1024;
+
+static const uint32_t SKIPPABLE_FRAME_MAGIC = 0x184D2A5E;
+static const size_t SKIPPABLE_FRAME_HEADER_SIZE = 8;
+// "VLMS", when read from the file
+static const uint32_t SEEKABLE_MAGIC = 0x534D4C56;
+// Version 2 records which entries are directories.
+static const uint32_t SEEKABLE_VERSION = 2;
+static const uint32_t SEEKABLE_ENTRY_DIRECTORY = 1;
+// Footer: skippable frame size, version, magic
+static const size_t SEEKABLE_FOOTER_SIZE = 12;
+
+// Sizes read from an archive are checked against these before anything is
+// allocated for them. No zstd block (of up to 128 KiB) compresses to fewer
+// than 4 bytes, and the index, being offsets and pathnames, compresses far
+// worse than that.
+static const uint64_t ZSTD_MAX_RATIO = 32 * 1024;
+static const uint64_t INDEX_MAX_RATIO = 1024;
+static const uint64_t INDEX_MAX_SIZE = 1024 * 1024 * 1024;
+
+typedef struct SeekableWriter {
+    int fd;
+    char* path;
+    struct archive* archive;
+    int error;
+
+    unsigned char* frame_buffer;
+    size_t frame_length;
+    void* compressed_buffer;
+    size_t compressed_capacity;
+    ZSTD_CCtx* context;
+
+    // Totals for all frames flushed so far
+    uint64_t compressed_offset;
+    uint64_t uncompressed_offset;
+
+    GArray* frames;
+    GArray* entries;
+} SeekableWriter;
+
+typedef struct IndexReader {
+    const unsigned char* data;
+    size_t remaining;
+    bool ok;
+} IndexReader;
+
+///////////////////////////////////////////////////////////////////////////////
+// Serialization
+////
+
+static void put_u32(GByteArray* array, uint32_t value) {
+    unsigned char bytes[4];
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+        bytes[i] = (value >> (8 * i)) & 0xff;
+    }
+    g_byte_array_append(array, bytes, sizeof(bytes));
+}
+
+static void put_u64(GByteArray* array, uint64_t value) {
+    unsigned char bytes[8];
+    for (size_t i = 0; i < sizeof(bytes); ++i) {
+        bytes[i] = (value >> (8 * i)) & 0xff;
+    }
+    g_byte_array_append(array, bytes, sizeof(bytes));
+}
+
+static uint64_t load_le(const unsigned char* data, size_t width) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; ++i) {
+        value |= (uint64_t)data[i] << (8 * i);
+    }
+    return value;
+}
+
+static uint64_t get_le(IndexReader* reader, size_t width) {
+    if (!reader->ok || reader->remaining < width) {
+        reader->ok = false;
+        return 0;
+    }
+
+    uint64_t value = load_le(reader->data, width);
+    reader->data += width;
+    reader->remaining -= width;
+    return value;
+}
+
+static GByteArray* serialize_index(GArray* frames, GArray* entries) {
+    GByteArray* index = g_byte_array_new();
+    put_u64(index, frames->len);
+    put_u64(index, entries->len);
+    for (guint i = 0; i < frames->len; ++i) {
+        const SeekableFrame* frame = &g_array_index(frames, SeekableFrame, i);
+        put_u64(index, frame->compressed_offset);
+        put_u64(index, frame->compressed_size);
+        put_u64(index, frame->uncompressed_offset);
+        put_u64(index, frame->uncompressed_size);
+    }
+
+    for (guint i = 0; i < entries->len; ++i) {
+        const SeekableEntry* entry =
+            &g_array_index(entries, SeekableEntry, i);
+        size_t path_length = strlen(entry->pathname);
+        put_u32(index, entry->frame);
+        put_u64(index, entry->frame_offset);
+        put_u64(index, entry->header_offset);
+        put_u64(index, entry->end_offset);
+        put_u64(index, (uint64_t)entry->size);
+        put_u32(index,
+                entry->is_directory ? SEEKABLE_ENTRY_DIRECTORY : 0);
+        put_u32(index, (uint32_t)path_length);
+        g_byte_array_append(index, (const unsigned char*)entry->pathname,
+                            path_length);
+    }
+
+    return index;
+}
+
+// Whether <uncompressed_size> bytes could have been compressed to
+// <compressed_size> at no more than <ratio> to 1, and are at most <limit>.
+static bool size_is_sane(uint64_t uncompressed_size, uint64_t compressed_size,
+                         uint64_t ratio, uint64_t limit) {
+    return uncompressed_size <= limit &&
+           (uncompressed_size + ratio - 1) / ratio <= compressed_size;
+}
+
+static bool frame_is_sane(const SeekableFrame* frame) {
+    return size_is_sane(frame->uncompressed_size, frame->compressed_size,
+                        ZSTD_MAX_RATIO, FRAME_SIZE);
+}
+
+static SeekableIndex* deserialize_index(const unsigned char* data,
+                                        size_t length, size_t file_size,
+                                        uint32_t version) {
+    IndexReader reader = {.data = data, .remaining = length, .ok = true};
+    uint64_t frame_count = get_le(&reader, 8);
+    uint64_t entry_count = get_le(&reader, 8);
+    // Sanity check, before allocating anything based on these.
+    if (!reader.ok || frame_count > length || entry_count > length) {
+        return NULL;
+    }
+
+    SeekableIndex* index = malloc(sizeof(SeekableIndex));
+    assert(NULL != index);
+    index->frame_count = frame_count;
+    index->frames = calloc(frame_count + 1, sizeof(SeekableFrame));
+    index->entry_count = entry_count;
+    index->entries = calloc(entry_count + 1, sizeof(SeekableEntry));
+    assert(NULL != index->frames && NULL != index->entries);
+
+    uint64_t uncompressed_offset = 0;
+    for (size_t i = 0; i < frame_count && reader.ok; ++i) {
+        SeekableFrame* frame = &index->frames[i];
+        frame->compressed_offset = get_le(&reader, 8);
+        frame->compressed_size = get_le(&reader, 8);
+        frame->uncompressed_offset = get_le(&reader, 8);
+        frame->uncompressed_size = get_le(&reader, 8);
+        reader.ok = reader.ok && frame->compressed_offset <= file_size &&
+                    frame->compressed_size <=
+                        file_size - frame->compressed_offset &&
+                    frame->uncompressed_offset == uncompressed_offset &&
+                    frame_is_sane(frame);
+        uncompressed_offset += frame->uncompressed_size;
+    }
+
+    for (size_t i = 0; i < entry_count && reader.ok; ++i) {
+        SeekableEntry* entry = &index->entries[i];
+        entry->frame = (uint32_t)get_le(&reader, 4);
+        entry->frame_offset = get_le(&reader, 8);
+        entry->header_offset = get_le(&reader, 8);
+        entry->end_offset = get_le(&reader, 8);
+        entry->size = (int64_t)get_le(&reader, 8);
+        if (2 <= version) {
+            entry->is_directory =
+                0 != (get_le(&reader, 4) & SEEKABLE_ENTRY_DIRECTORY);
+        } else {
+            // Any entry without data might be one.
+            entry->is_directory = 0 == entry->size;
+        }
+        size_t path_length = get_le(&reader, 4);
+        if (!reader.ok || path_length > reader.remaining ||
+            entry->frame >= frame_count) {
+            reader.ok = false;
+            break;
+        }
+
+        entry->pathname = strndup((const char*)reader.data, path_length);
+        reader.data += path_length;
+        reader.remaining -= path_length;
+    }
+
+    if (!reader.ok) {
+        seekable_index_free(index);
+        return NULL;
+    }
+
+    return index;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Writer
+////
+
+static int write_all(int fd, const void* buffer, size_t length) {
+    const unsigned char* data = buffer;
+    while (0 < length) {
+        ssize_t written = write(fd, data, length);
+        if (0 > written) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return -errno;
+        }
+
+        data += written;
+        length -= written;
+    }
+
+    return 0;
+}
+
+static int seekable_writer_flush_frame(SeekableWriter* writer) {
+    size_t compressed_size = ZSTD_compress2(
+        writer->context, writer->compressed_buffer,
+        writer->compressed_capacity, writer->frame_buffer,
+        writer->frame_length);
+    if (ZSTD_isError(compressed_size)) {
+        fprintf(stderr, "%s: zstd compression failed: %s\n", writer->path,
+                ZSTD_getErrorName(compressed_size));
+        return -EIO;
+    }
+
+    int result =
+        write_all(writer->fd, writer->compressed_buffer, compressed_size);
+    if (0 != result) {
+        fprintf(stderr, "%s: write failed: %s\n", writer->path,
+                strerror(-result));
+        return result;
+    }
+
+    SeekableFrame frame = {
+        .compressed_offset = writer->compressed_offset,
+        .compressed_size = compressed_size,
+        .uncompressed_offset = writer->uncompressed_offset,
+        .uncompressed_size = writer->frame_length,
+    };
+    g_array_append_val(writer->frames, frame);
+    writer->compressed_offset += compressed_size;
+    writer->uncompressed_offset += writer->frame_length;
+    writer->frame_length = 0;
+    return 0;
+}
+
+static la_ssize_t seekable_writer_write(struct archive* archive,
+                                        void* user_data, const void* buffer,
+                                        size_t length) {
+    SeekableWriter* writer = (SeekableWriter*)user_data;
+    const unsigned char* input = buffer;
+    size_t remaining = length;
+    while (0 < remaining) {
+        size_t copy_length = FRAME_SIZE - writer->frame_length;
+        if (copy_length > remaining) {
+            copy_length = remaining;
+        }
+
+        memcpy(writer->frame_buffer + writer->frame_length, input,
+               copy_length);
+        writer->frame_length += copy_length;
+        input += copy_length;
+        remaining -= copy_length;
+
+        if (FRAME_SIZE == writer->frame_length) {
+            writer->error = seekable_writer_flush_frame(writer);
+            if (0 != writer->error) {
+                archive_set_error(archive, -writer->error,
+                                  "Couldn't write frame");
+                return -1;
+            }
+        }
+    }
+
+    return (la_ssize_t)length;
+}
+
+static int seekable_writer_write_index(SeekableWriter* writer) {
+    GByteArray* index = serialize_index(writer->frames, writer->entries);
+    size_t capacity = ZSTD_compressBound(index->len);
+    void* compressed = malloc(capacity);
+    assert(NULL != compressed);
+    size_t compressed_size = ZSTD_compress(compressed, capacity, index->data,
+                                           index->len, COMPRESSION_LEVEL);
+    g_byte_array_free(index, TRUE);
+    if (ZSTD_isError(compressed_size)) {
+        fprintf(stderr, "%s: zstd compression failed: %s\n", writer->path,
+                ZSTD_getErrorName(compressed_size));
+        free(compressed);
+        return -EIO;
+    }
+
+    size_t frame_size = SKIPPABLE_FRAME_HEADER_SIZE + compressed_size +
+                        SEEKABLE_FOOTER_SIZE;
+    if (UINT32_MAX < frame_size) {
+        fprintf(stderr, "%s: archive index is too large\n", writer->path);
+        free(compressed);
+        return -EFBIG;
+    }
+
+    GByteArray* header = g_byte_array_new();
+    put_u32(header, SKIPPABLE_FRAME_MAGIC);
+    put_u32(header, frame_size - SKIPPABLE_FRAME_HEADER_SIZE);
+    GByteArray* footer = g_byte_array_new();
+    put_u32(footer, frame_size);
+    put_u32(footer, SEEKABLE_VERSION);
+    put_u32(footer, SEEKABLE_MAGIC);
+
+    int result = write_all(writer->fd, header->data, header->len);
+    if (0 == result) {
+        result = write_all(writer->fd, compressed, compressed_size);
+    }
+    if (0 == result) {
+        result = write_all(writer->fd, footer->data, footer->len);
+    }
+
+    g_byte_array_free(header, TRUE);
+    g_byte_array_free(footer, TRUE);
+    free(compressed);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+SeekableWriter* seekable_writer_new(const char* path, unsigned int threads) {
+    SeekableWriter* writer = malloc(sizeof(SeekableWriter));
+    if (NULL == writer) {
+        return NULL;
+    }
+    memset(writer, 0, sizeof(*writer));
+
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (0 > writer->fd) {
+        fprintf(stderr, "%s:%d: Couldn't open %s for writing: %s\n",
+                __FUNCTION__, __LINE__, path, strerror(errno));
+        free(writer);
+        return NULL;
+    }
+
+    writer->path = strdup(path);
+    writer->frame_buffer = malloc(FRAME_SIZE);
+    writer->compressed_capacity = ZSTD_compressBound(FRAME_SIZE);
+    writer->compressed_buffer = malloc(writer->compressed_capacity);
+    assert(NULL != writer->frame_buffer && NULL != writer->compressed_buffer);
+    writer->context = ZSTD_createCCtx();
+    assert(NULL != writer->context);
+    ZSTD_CCtx_setParameter(writer->context, ZSTD_c_compressionLevel,
+                           COMPRESSION_LEVEL);
+
+    // Without multithreading support in libzstd, frames are compressed on
+    // this thread.
+    if (0 == threads) {
+        threads = g_get_num_processors();
+    }
+    if (1 < threads &&
+        !ZSTD_isError(ZSTD_CCtx_setParameter(writer->context,
+                                             ZSTD_c_nbWorkers, threads))) {
+        ZSTD_CCtx_setParameter(writer->context, ZSTD_c_jobSize,
+                               FRAME_JOB_SIZE);
+    }
+    writer->frames = g_array_new(FALSE, FALSE, sizeof(SeekableFrame));
+    writer->entries = g_array_new(FALSE, FALSE, sizeof(SeekableEntry));
+
+    // Writes must reach the callback unblocked, so that entry offsets are
+    // known exactly, and the tar stream is not padded to a block size.
+    writer->archive = archive_write_new();
+    archive_write_set_format_pax_restricted(writer->archive);
+    archive_write_add_filter_none(writer->archive);
+    archive_write_set_bytes_per_block(writer->archive, 0);
+    archive_write_set_bytes_in_last_block(writer->archive, 1);
+    int result = archive_write_open(writer->archive, writer, NULL,
+                                    seekable_writer_write, NULL);
+    assert(ARCHIVE_OK == result);
+    return writer;
+}
+
+struct archive* seekable_writer_get_archive(SeekableWriter* writer) {
+    return writer->archive;
+}
+
+void seekable_writer_begin_entry(SeekableWriter* writer, const char* pathname,
+                                 int64_t size, bool is_directory) {
+    SeekableEntry entry = {
+        .pathname = strdup(pathname),
+        .is_directory = is_directory,
+        .frame = writer->frames->len,
+        .frame_offset = writer->frame_length,
+        .header_offset = writer->uncompressed_offset + writer->frame_length,
+        .size = size,
+    };
+    g_array_append_val(writer->entries, entry);
+}
+
+void seekable_writer_end_entry(SeekableWriter* writer) {
+    assert(0 < writer->entries->len);
+    SeekableEntry* entry = &g_array_index(writer->entries, SeekableEntry,
+                                          writer->entries->len - 1);
+    entry->end_offset = writer->uncompressed_offset + writer->frame_length;
+}
+
+int seekable_writer_close(SeekableWriter* writer) {
+    // Writes the end-of-archive marker into the last frame.
+    if (ARCHIVE_OK != archive_write_close(writer->archive) &&
+        0 == writer->error) {
+        fprintf(stderr, "%s: %s\n", writer->path,
+                archive_error_string(writer->archive));
+        writer->error = -EIO;
+    }
+    archive_write_free(writer->archive);
+
+    int result = writer->error;
+    if (0 == result && 0 < writer->frame_length) {
+        result = seekable_writer_flush_frame(writer);
+    }
+    if (0 == result) {
+        result = seekable_writer_write_index(writer);
+    }
+    if (0 != close(writer->fd) && 0 == result) {
+        result = -errno;
+    }
+
+    for (guint i = 0; i < writer->entries->len; ++i) {
+        free(g_array_index(writer->entries, SeekableEntry, i).pathname);
+    }
+    g_array_free(writer->entries, TRUE);
+    g_array_free(writer->frames, TRUE);
+    free(writer->frame_buffer);
+    free(writer->compressed_buffer);
+    ZSTD_freeCCtx(writer->context);
+    free(writer->path);
+    free(writer);
+    return result;
+}
+
+SeekableIndex* seekable_index_read(const void* contents, size_t size) {
+    const unsigned char* data = contents;
+    if (SKIPPABLE_FRAME_HEADER_SIZE + SEEKABLE_FOOTER_SIZE > size) {
+        return NULL;
+    }
+
+    const unsigned char* footer = data + size - SEEKABLE_FOOTER_SIZE;
+    size_t frame_size = load_le(footer, 4);
+    if (SEEKABLE_MAGIC != load_le(footer + 8, 4)) {
+        return NULL;
+    }
+    uint32_t version = load_le(footer + 4, 4);
+    if (1 > version || SEEKABLE_VERSION < version) {
+        fprintf(stderr, "Unsupported seekable archive version %u\n",
+                (unsigned int)version);
+        return NULL;
+    }
+
+    if (frame_size > size ||
+        SKIPPABLE_FRAME_HEADER_SIZE + SEEKABLE_FOOTER_SIZE > frame_size) {
+        return NULL;
+    }
+
+    const unsigned char* frame = data + size - frame_size;
+    if (SKIPPABLE_FRAME_MAGIC != load_le(frame, 4) ||
+        frame_size - SKIPPABLE_FRAME_HEADER_SIZE != load_le(frame + 4, 4)) {
+        return NULL;
+    }
+
+    const unsigned char* compressed = frame + SKIPPABLE_FRAME_HEADER_SIZE;
+    size_t compressed_size =
+        frame_size - SKIPPABLE_FRAME_HEADER_SIZE - SEEKABLE_FOOTER_SIZE;
+    unsigned long long index_size =
+        ZSTD_getFrameContentSize(compressed, compressed_size);
+    if (ZSTD_CONTENTSIZE_UNKNOWN == index_size ||
+        ZSTD_CONTENTSIZE_ERROR == index_size) {
+        return NULL;
+    } else if (!size_is_sane(index_size, compressed_size, INDEX_MAX_RATIO,
+                             INDEX_MAX_SIZE)) {
+        fprintf(stderr, "Seekable archive index is corrupt: %llu bytes "
+                        "compressed to %zu\n",
+                index_size, compressed_size);
+        return NULL;
+    }
+
+    unsigned char* serialized = malloc(index_size + 1);
+    if (NULL == serialized) {
+        return NULL;
+    }
+    size_t result =
+        ZSTD_decompress(serialized, index_size, compressed, compressed_size);
+    SeekableIndex* index = NULL;
+    if (!ZSTD_isError(result) && result == index_size) {
+        index = deserialize_index(serialized, index_size, size - frame_size,
+                                  version);
+    }
+
+    if (NULL == index) {
+        fprintf(stderr, "Seekable archive index is corrupt\n");
+    }
+
+    free(serialized);
+    return index;
+}
+
+void seekable_index_free(SeekableIndex* index) {
+    for (size_t i = 0; i < index->entry_count; ++i) {
+        free(index->entries[i].pathname);
+    }
+    free(index->entries);
+    free(index->frames);
+    free(index);
+}
+
+int seekable_frame_decompress(const void* contents, const SeekableFrame* frame,
+                              void** output) {
+    *output = NULL;
+    if (!frame_is_sane(frame)) {
+        fprintf(stderr, "Frame at offset %lu is corrupt: %lu bytes "
+                        "compressed to %lu\n",
+                (unsigned long)frame->compressed_offset,
+                (unsigned long)frame->uncompressed_size,
+                (unsigned long)frame->compressed_size);
+        return -EIO;
+    }
+
+    *output = malloc(frame->uncompressed_size + 1);
+    if (NULL == *output) {
+        return -ENOMEM;
+    }
+
+    size_t result = ZSTD_decompress(
+        *output, frame->uncompressed_size,
+        (const unsigned char*)contents + frame->compressed_offset,
+        frame->compressed_size);
+    if (ZSTD_isError(result) || result != frame->uncompressed_size) {
+        fprintf(stderr, "Couldn't decompress frame at offset %lu: %s\n",
+                (unsigned long)frame->compressed_offset,
+                ZSTD_isError(result) ? ZSTD_getErrorName(result)
+                                     : "unexpected frame size");
+        free(*output);
+        *output = NULL;
+        return -EIO;
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
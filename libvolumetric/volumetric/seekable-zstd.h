@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            seekable-zstd.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Seekable archive format: a tar stream compressed as a
+//                  series of independent zstd frames, followed by an index of
+//                  the frames and entries in a skippable frame.
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef VOLUMETRIC_SEEKABLE_ZSTD_H
+#define VOLUMETRIC_SEEKABLE_ZSTD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The file is a valid zstd stream (skippable frames are ignored by
+// decoders), so it can still be extracted with, e.g., `tar --zstd -x'. The
+// layout is:
+//
+//  <frame 0> ... <frame N-1> <skippable frame: compressed index, footer>
+//
+// Each frame holds a contiguous slice of the uncompressed tar stream. Frames
+// are cut on a fixed size, so an entry may span several frames.
+
+struct archive;
+
+typedef struct SeekableFrame {
+    uint64_t compressed_offset;
+    uint64_t compressed_size;
+    uint64_t uncompressed_offset;
+    uint64_t uncompressed_size;
+} SeekableFrame;
+
+typedef struct SeekableEntry {
+    char* pathname;
+    // The frame containing the entry's header, and its offset in that frame
+    uint32_t frame;
+    uint64_t frame_offset;
+    // Extent of the entry (header, data and padding) in the uncompressed
+    // stream.
+    uint64_t header_offset;
+    uint64_t end_offset;
+    int64_t size;
+    // Archives written before this was recorded mark every entry without
+    // data as a directory.
+    bool is_directory;
+} SeekableEntry;
+
+typedef struct SeekableIndex {
+    SeekableFrame* frames;
+    size_t frame_count;
+    SeekableEntry* entries;
+    size_t entry_count;
+} SeekableIndex;
+
+///////////////////////////////////////////////////////////////////////////////
+// Writer API
+////
+
+typedef struct SeekableWriter SeekableWriter;
+
+// Create a seekable archive at <path>, whose frames are compressed by up to
+// <threads> workers (0 for one per CPU). Entries are written to the archive
+// returned by seekable_writer_get_archive(), between calls to
+// seekable_writer_begin_entry() and seekable_writer_end_entry().
+SeekableWriter* seekable_writer_new(const char* path, unsigned int threads);
+struct archive* seekable_writer_get_archive(SeekableWriter* writer);
+void seekable_writer_begin_entry(SeekableWriter* writer, const char* pathname,
+                                 int64_t size, bool is_directory);
+void seekable_writer_end_entry(SeekableWriter* writer);
+
+// Flush the remaining data and the index, and free the writer. Returns 0 on
+// success, or a negative errno.
+int seekable_writer_close(SeekableWriter* writer);
+
+///////////////////////////////////////////////////////////////////////////////
+// Reader API
+////
+
+// Read the index from an archive in memory. Returns NULL if the archive is
+// not in the seekable format.
+SeekableIndex* seekable_index_read(const void* contents, size_t size);
+void seekable_index_free(SeekableIndex* index);
+
+// Decompress a single frame into a malloc'd buffer of uncompressed_size
+// bytes. Safe to call from any thread. Returns 0 or a negative errno.
+int seekable_frame_decompress(const void* contents, const SeekableFrame* frame,
+                              void** output);
+
+#endif // VOLUMETRIC_SEEKABLE_ZSTD_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         01/17/2022
 //
-// LAST EDITED:     02/14/2022
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -27,6 +27,8 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -35,6 +37,7 @@
 #include <volumetric/hash.h>
 #include <volumetric/volume.h>
 #include <volumetric/volume/archive.h>
+#include <volumetric/volume/chunked.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 // Volume-Generic
@@ -43,9 +46,32 @@
 static int volume_visit_map(SerdecYamlDeserializer* yaml, void* user_data,
                             const char* key) {
     Volume* volume = (Volume*)user_data;
+    const char* temp = NULL;
     if (!strcmp("archive", key)) {
         volume->type = VOLUME_TYPE_ARCHIVE;
         return archive_volume_deserialize_yaml(yaml, &volume->archive);
+    } else if (!strcmp("chunked", key)) {
+        volume->type = VOLUME_TYPE_CHUNKED;
+        return chunked_volume_deserialize_yaml(yaml, &volume->chunked);
+    } else if (!strcmp("priority", key)) {
+        int result = serdec_yaml_deserialize_string(yaml, &temp);
+        if (0 > result) {
+            return result;
+        }
+        char* end = NULL;
+        long priority = strtol(temp, &end, 10);
+        if ('\0' == *temp || '\0' != *end || INT_MAX < priority ||
+            INT_MIN > priority) {
+            fprintf(stderr, "Invalid priority: %s\n", temp);
+            return -EINVAL;
+        }
+        volume->priority = (int)priority;
+        return result;
+    } else if (!strcmp("depends-on", key)) {
+        int result = serdec_yaml_deserialize_string(yaml, &temp);
+        free(volume->depends_on);
+        volume->depends_on = strdup(temp);
+        return result;
     } else {
         return -EINVAL;
     }
@@ -56,6 +82,8 @@ static int volume_visit_map(SerdecYamlDeserializer* yaml, void* user_data,
 ////
 
 int volume_deserialize_yaml(SerdecYamlDeserializer* yaml, Volume* volume) {
+    volume->priority = 0;
+    volume->depends_on = NULL;
     return serdec_yaml_deserialize_map(yaml, volume_visit_map, volume);
 }
 
@@ -65,10 +93,88 @@ void volume_free(Volume* volume) {
 }
 
 void volume_release(Volume* volume) {
+    free(volume->depends_on);
     switch (volume->type) {
     case VOLUME_TYPE_ARCHIVE:
         archive_volume_release(&volume->archive);
         break;
+    case VOLUME_TYPE_CHUNKED:
+        chunked_volume_release(&volume->chunked);
+        break;
+    default:
+        assert(false);
+    }
+}
+
+const char* volume_get_name(Volume* volume) {
+    switch (volume->type) {
+    case VOLUME_TYPE_ARCHIVE:
+        return volume->archive.name;
+    case VOLUME_TYPE_CHUNKED:
+        return volume->chunked.name;
+    default:
+        assert(false);
+    }
+}
+
+uint64_t volume_get_size(Volume* volume) {
+    switch (volume->type) {
+    case VOLUME_TYPE_ARCHIVE:
+        return archive_volume_get_size(&volume->archive);
+    case VOLUME_TYPE_CHUNKED:
+        return chunked_volume_get_size(&volume->chunked);
+    default:
+        assert(false);
+    }
+}
+
+void volume_set_extract_cache(Volume* volume, ExtractCache* cache) {
+    switch (volume->type) {
+    case VOLUME_TYPE_ARCHIVE:
+        volume->archive.cache = cache;
+        break;
+    case VOLUME_TYPE_CHUNKED:
+        break;
+    default:
+        assert(false);
+    }
+}
+
+void volume_set_io_scheduler(Volume* volume, IoScheduler* scheduler) {
+    switch (volume->type) {
+    case VOLUME_TYPE_ARCHIVE:
+        volume->archive.io_scheduler = scheduler;
+        break;
+    case VOLUME_TYPE_CHUNKED:
+        volume->chunked.io_scheduler = scheduler;
+        break;
+    default:
+        assert(false);
+    }
+}
+
+void volume_set_extract_buffer_size(Volume* volume, size_t size) {
+    switch (volume->type) {
+    case VOLUME_TYPE_ARCHIVE:
+        volume->archive.buffer_size = size;
+        break;
+    case VOLUME_TYPE_CHUNKED:
+        break;
+    default:
+        assert(false);
+    }
+}
+
+void volume_set_staging_directory(Volume* volume,
+                                  const char* staging_directory,
+                                  const char* docker_root) {
+    switch (volume->type) {
+    case VOLUME_TYPE_ARCHIVE:
+        volume->archive.staging_directory = staging_directory;
+        volume->archive.docker_root = docker_root;
+        break;
+    case VOLUME_TYPE_CHUNKED:
+        break;
     default:
         assert(false);
     }
@@ -78,6 +184,31 @@ int volume_checkout(Volume* volume, Docker* docker) {
     switch (volume->type) {
     case VOLUME_TYPE_ARCHIVE:
         return archive_volume_checkout(&volume->archive, docker);
+    case VOLUME_TYPE_CHUNKED:
+        return chunked_volume_checkout(&volume->chunked, docker);
+    default:
+        assert(false);
+    }
+}
+
+int volume_stage(Volume* volume) {
+    switch (volume->type) {
+    case VOLUME_TYPE_ARCHIVE:
+        return archive_volume_stage(&volume->archive);
+    case VOLUME_TYPE_CHUNKED:
+        // Files are reassembled into the volume directly.
+        return 0;
+    default:
+        assert(false);
+    }
+}
+
+char* volume_get_source_key(Volume* volume) {
+    switch (volume->type) {
+    case VOLUME_TYPE_ARCHIVE:
+        return archive_volume_get_source_key(&volume->archive);
+    case VOLUME_TYPE_CHUNKED:
+        return NULL;
     default:
         assert(false);
     }
@@ -88,6 +219,8 @@ int volume_diff(Volume* volume, Docker* docker) {
     switch (volume->type) {
     case VOLUME_TYPE_ARCHIVE:
         return archive_volume_diff(&volume->archive, docker);
+    case VOLUME_TYPE_CHUNKED:
+        return chunked_volume_diff(&volume->chunked, docker);
     default:
         assert(false);
     }
@@ -98,6 +231,23 @@ int volume_commit(Volume* volume, Docker* docker, bool dry_run) {
     switch (volume->type) {
     case VOLUME_TYPE_ARCHIVE:
         return archive_volume_commit(&volume->archive, docker, dry_run);
+    case VOLUME_TYPE_CHUNKED:
+        return chunked_volume_commit(&volume->chunked, docker, dry_run);
+    default:
+        assert(false);
+    }
+}
+
+// Merge the history of incremental commits into a single version
+int volume_compact(Volume* volume, bool dry_run) {
+    switch (volume->type) {
+    case VOLUME_TYPE_ARCHIVE:
+        return archive_volume_compact(&volume->archive, dry_run);
+    case VOLUME_TYPE_CHUNKED:
+        // Versions share their chunks, rather than building on each other.
+        printf("%s: Chunked volumes have nothing to compact\n",
+               volume->chunked.name);
+        return 0;
     default:
         assert(false);
     }
@@ -7,7 +7,7 @@
 //
 // CREATED:         01/17/2022
 //
-// LAST EDITED:     02/14/2022
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -29,8 +29,10 @@
 #define VOLUMETRIC_VOLUME_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <volumetric/volume/archive.h>
+#include <volumetric/volume/chunked.h>
 
 typedef struct Docker Docker;
 typedef struct SerdecYamlDeserializer SerdecYamlDeserializer;
@@ -39,12 +41,19 @@ typedef struct SerdecYamlDeserializer SerdecYamlDeserializer;
 // Volume-type-generic container
 typedef enum VolumeType {
     VOLUME_TYPE_ARCHIVE,
+    VOLUME_TYPE_CHUNKED,
 } VolumeType;
 
 typedef struct Volume {
     VolumeType type;
+    // Volumes with higher priorities are checked out first, and a volume is
+    // only checked out once the volumes it depends on (a colon-separated list
+    // of volume names, or NULL) are.
+    int priority;
+    char* depends_on;
     union {
         ArchiveVolume archive;
+        ChunkedVolume chunked;
     };
 } Volume;
 
@@ -55,15 +64,54 @@ int volume_deserialize_yaml(SerdecYamlDeserializer* yaml, Volume* volume);
 void volume_free(Volume* volume);    // Free <volume>
 void volume_release(Volume* volume); // Don't free <volume>
 
+// Name of the volume in Docker
+const char* volume_get_name(Volume* volume);
+
+// Approximate amount of data checking out the volume involves, in bytes, or 0
+// if it's unknown. Larger volumes are started first.
+uint64_t volume_get_size(Volume* volume);
+
+// Use <cache> (which must outlive the volume) to check out the volume, if the
+// volume supports it.
+void volume_set_extract_cache(Volume* volume, ExtractCache* cache);
+
+// Take streams from <scheduler> (which must outlive the volume) for the
+// devices used while the volume is checked out, verified or committed, if the
+// volume supports it.
+void volume_set_io_scheduler(Volume* volume, IoScheduler* scheduler);
+
+// Buffer up to <size> bytes of decompressed data ahead of the writer on
+// checkout, if the volume supports it.
+void volume_set_extract_buffer_size(Volume* volume, size_t size);
+
+// Stage the volume in <staging_directory> (see volume_stage), taking volumes
+// in <docker_root> to exist. Both must outlive the volume.
+void volume_set_staging_directory(Volume* volume,
+                                  const char* staging_directory,
+                                  const char* docker_root);
+
 // "Version" the volume from its source
 int volume_checkout(Volume* volume, Docker* docker);
 
+// Prepare to check out the volume before the Docker daemon is running, if
+// the volume supports it.
+int volume_stage(Volume* volume);
+
+// Key identifying the contents the volume is checked out from, if volumes
+// with the same key can share one extraction when they're checked out one
+// after another with the same extract cache. Returns NULL otherwise. The key
+// must be free'd with g_free().
+char* volume_get_source_key(Volume* volume);
+
 // Check for differences between the volume source and live
 int volume_diff(Volume* volume, Docker* docker);
 
 // Commit a dirty volume to the source
 int volume_commit(Volume* volume, Docker* docker, bool dry_run);
 
+// Merge the history of incremental commits into a single version
+int volume_compact(Volume* volume, bool dry_run);
+
 #endif // VOLUMETRIC_VOLUME_H
 
 ///////////////////////////////////////////////////////////////////////////////
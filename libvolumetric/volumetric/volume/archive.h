@@ -8,7 +8,7 @@
 //
 // CREATED:         02/13/2022
 //
-// LAST EDITED:     01/04/2023
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -30,18 +30,151 @@
 #define VOLUMETRIC_VOLUME_ARCHIVE_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 typedef struct FileContents FileContents;
 typedef struct FileHash FileHash;
 typedef struct Docker Docker;
+typedef struct ArchiveCheckpoint ArchiveCheckpoint;
+typedef struct ExtractCache ExtractCache;
+typedef struct IoScheduler IoScheduler;
 typedef struct SerdecYamlDeserializer SerdecYamlDeserializer;
 
+// When the hash of the archive is verified.
+typedef enum ArchiveVerifyMode {
+    // In a separate pass, before the Docker volume is created
+    ARCHIVE_VERIFY_BEFORE_EXTRACT,
+    // While the archive is decompressed, into a staging directory
+    ARCHIVE_VERIFY_DURING_EXTRACT,
+} ArchiveVerifyMode;
+
+// How new archives are compressed when the volume is committed. Checkout
+// detects the format of the archive automatically.
+typedef enum ArchiveCompression {
+    // A single gzip stream (.tar.gz)
+    ARCHIVE_COMPRESSION_GZIP,
+    // Independent zstd frames and an entry index (see seekable-zstd.h)
+    ARCHIVE_COMPRESSION_SEEKABLE_ZSTD,
+} ArchiveCompression;
+
+// What a commit writes to the url of the volume. The previous archive is kept
+// next to it, with the time of the commit appended to its name.
+typedef enum ArchiveCommitMode {
+    // An archive of the whole volume
+    ARCHIVE_COMMIT_FULL,
+    // A layer (see layer.h), holding what changed since the previous archive,
+    // which the layer refers to as its parent. Checkouts apply the chain of
+    // layers in order, until it's compacted.
+    ARCHIVE_COMMIT_INCREMENTAL,
+} ArchiveCommitMode;
+
+// What happens to the contents of an existing volume on checkout.
+typedef enum ArchiveCheckoutMode {
+    // The volume is removed, and the archive is extracted from scratch.
+    ARCHIVE_CHECKOUT_REPLACE,
+    // The archive is extracted next to the volume, and then exchanged with
+    // its contents while the containers using the volume are paused.
+    ARCHIVE_CHECKOUT_SWAP,
+    // Only entries whose metadata differ from the volume are written, and
+    // files which aren't in the archive are removed.
+    ARCHIVE_CHECKOUT_INCREMENTAL,
+    // As above, additionally comparing the data of regular files.
+    ARCHIVE_CHECKOUT_INCREMENTAL_CONTENTS,
+    // The volume is an overlay mount of the extract cache's (read-only) tree,
+    // shared between volumes, and a private upper layer, which is emptied.
+    ARCHIVE_CHECKOUT_OVERLAY,
+    // Like ARCHIVE_CHECKOUT_OVERLAY, but the volume is created as soon as the
+    // headers of a seekable archive are read. Until the extract cache's tree
+    // is complete, the lower layer is a FUSE filesystem which extracts files
+    // on first access. Other archives are checked out like overlay volumes.
+    ARCHIVE_CHECKOUT_LAZY,
+} ArchiveCheckoutMode;
+
+// Whether a replacing checkout goes through the extract cache, if there is
+// one, and how the cached tree is recreated in the volume.
+typedef enum ArchiveCacheMode {
+    // Files are copied, sharing extents with the cache where possible
+    ARCHIVE_CACHE_CLONE,
+    // Files are hard links to the cache. Only suitable for volumes whose
+    // contents are never modified in place.
+    ARCHIVE_CACHE_HARDLINK,
+    // The archive is always extracted into the volume directly
+    ARCHIVE_CACHE_OFF,
+} ArchiveCacheMode;
+
+// How small files are read and written on checkout and commit.
+typedef enum ArchiveIoMode {
+    // One blocking system call at a time
+    ARCHIVE_IO_BLOCKING,
+    // In batches through io_uring, if the kernel supports it. Falls back to
+    // blocking calls otherwise.
+    ARCHIVE_IO_URING,
+} ArchiveIoMode;
+
+// How gzip archives are decompressed on checkout.
+typedef enum ArchiveGzipDecoder {
+    // On a single thread, by libarchive
+    ARCHIVE_GZIP_LIBARCHIVE,
+    // Large archives are split into chunks, which are decoded speculatively
+    // on several threads (see parallel-gzip.h)
+    ARCHIVE_GZIP_PARALLEL,
+} ArchiveGzipDecoder;
+
+// Whether a checkout waits for the volume to be on disk before the lock file
+// is written.
+typedef enum ArchiveSyncMode {
+    // The filesystem is synced once, after the volume is written. Interrupted
+    // checkouts can only be resumed in this mode.
+    ARCHIVE_SYNC_DURABLE,
+    // The volume is written back whenever the kernel gets around to it
+    ARCHIVE_SYNC_NONE,
+} ArchiveSyncMode;
+
+// How the contents of the volume are reached on checkout and commit.
+typedef enum ArchiveTransport {
+    // Through the mountpoint of the volume on this host
+    ARCHIVE_TRANSPORT_LOCAL,
+    // Streamed through the archive endpoints of a helper container, so that
+    // only access to the Docker socket is required. Only replacing checkouts
+    // of the whole archive are supported, and they can't be resumed.
+    ARCHIVE_TRANSPORT_DOCKER_ARCHIVE,
+} ArchiveTransport;
+
 // An archive volume--contents are checked against a .tar.gz archive on the
 // filesystem.
 typedef struct ArchiveVolume {
     char* name;
     char* url;
     FileHash* hash;
+    ArchiveVerifyMode verify;
+    ArchiveCompression compression;
+    unsigned int compression_threads; // On commit, 0 for one per CPU
+    ArchiveCommitMode commit_mode;
+    ArchiveCheckoutMode checkout;
+    ArchiveCacheMode cache_mode;
+    ExtractCache* cache; // Not owned, may be NULL
+    // Limits the checkouts and commits using the same devices. Not owned, may
+    // be NULL.
+    IoScheduler* io_scheduler;
+    ArchiveIoMode io;
+    ArchiveSyncMode sync;
+    ArchiveGzipDecoder gzip_decoder;
+    ArchiveTransport transport;
+    // Image of the helper container used by ARCHIVE_TRANSPORT_DOCKER_ARCHIVE.
+    // May be NULL, for the default.
+    char* helper_image;
+    // Colon-separated lists of patterns selecting the paths which are
+    // checked out (see path-filter.h). Either may be NULL.
+    char* include;
+    char* exclude;
+    size_t buffer_size; // See ArchiveExtractOptions
+    // Where the archive is extracted to by archive_volume_stage(), and the
+    // data root of the Docker daemon. Not owned, may be NULL.
+    const char* staging_directory;
+    const char* docker_root;
+    // Set while an interrupted checkout is resumed
+    const ArchiveCheckpoint* resume;
     int (*update_policy)(struct ArchiveVolume*, Docker*);
     int (*commit)(struct ArchiveVolume*, Docker*);
     int (*check)(struct ArchiveVolume*, Docker*, const FileContents*);
@@ -51,11 +184,34 @@ void archive_volume_defaults(ArchiveVolume* volume);
 int archive_volume_deserialize_yaml(SerdecYamlDeserializer* yaml,
                                     ArchiveVolume* volume);
 int archive_volume_checkout(ArchiveVolume* config, Docker* docker);
+// Do as much of the checkout as possible without the Docker daemon: extract
+// the archive into the extract cache or the staging directory, if the update
+// policy requires a checkout. archive_volume_checkout() uses the staged tree.
+int archive_volume_stage(ArchiveVolume* config);
+// Identify the archive image the volume is checked out from, if volumes with
+// the same key can share a single extraction through the extract cache.
+// Returns NULL otherwise. The key must be free'd with g_free().
+char* archive_volume_get_source_key(ArchiveVolume* config);
+// Size of the archive, as an estimate of the work checking the volume out
+// involves. Returns 0 if the archive can't be found. Like the update
+// policies, this takes the url to be a plain path. Other schemes aren't
+// resolved, so their volumes are sized 0, and are started after the other
+// volumes of the same priority.
+uint64_t archive_volume_get_size(ArchiveVolume* config);
+// Publish the archive of a lazily checked out volume, and serve it until the
+// archive is extracted into the extract cache, and the filesystem is no longer
+// used. A byte is written to <ready_fd> once the tree is published. This is
+// run in the volumetric-lazy process started by archive_volume_checkout().
+int archive_volume_serve_lazy(ArchiveVolume* config, int ready_fd);
 int archive_volume_diff(ArchiveVolume* volume, Docker* docker);
 int archive_volume_commit(ArchiveVolume* volume, Docker* docker, bool dry_run);
+// Merge the chain of layers written by incremental commits into a single
+// archive at the url of the volume. The top of the chain is kept, as it would
+// be by a commit.
+int archive_volume_compact(ArchiveVolume* volume, bool dry_run);
 void archive_volume_release(ArchiveVolume* volume);
 
-// Update policies
+// Update policies. While staging, these are called without a Docker proxy.
 
 typedef enum VolumetricUpdateStatus {
     VOLUMETRIC_NO_ACTION = 0,
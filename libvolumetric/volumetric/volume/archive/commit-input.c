@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            commit-input.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Reading the data of files on commit
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <archive.h>
+#include <glib-2.0/glib.h>
+
+#include <volumetric/volume/archive/commit-input.h>
+
+static const size_t COMMIT_READ_SIZE = 8 * 1024 * 1024;
+static const size_t COMMIT_MIN_READ_SIZE = 64 * 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+void commit_input_advise(int fd, off_t size) {
+    if ((off_t)COMMIT_MIN_READ_SIZE < size) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+}
+
+int commit_input_write_data(CommitInput* input, struct archive* writer,
+                            int fd, off_t offset, off_t length) {
+    size_t wanted = MIN((uint64_t)length, COMMIT_READ_SIZE);
+    wanted = MAX(wanted, COMMIT_MIN_READ_SIZE);
+    if (input->buffer_size < wanted) {
+        free(input->buffer);
+        input->buffer = malloc(wanted);
+        assert(NULL != input->buffer);
+        input->buffer_size = wanted;
+    }
+
+    while (0 < length) {
+        size_t size = MIN((uint64_t)length, input->buffer_size);
+        ssize_t bytes_read = pread(fd, input->buffer, size, offset);
+        if (0 > bytes_read && EINTR == errno) {
+            continue;
+        } else if (0 >= bytes_read) {
+            return 0 == bytes_read ? 0 : -errno;
+        }
+        archive_write_data(writer, input->buffer, bytes_read);
+        input->bytes_read += bytes_read;
+        offset += bytes_read;
+        length -= bytes_read;
+    }
+    return 0;
+}
+
+void commit_input_release(CommitInput* input) {
+    free(input->buffer);
+    input->buffer = NULL;
+    input->buffer_size = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
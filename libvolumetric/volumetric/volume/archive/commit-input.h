@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            commit-input.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Reading the data of files on commit
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#ifndef VOLUMETRIC_COMMIT_INPUT_H
+#define VOLUMETRIC_COMMIT_INPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+struct archive;
+
+// Reads the data of the files in the volume. File data is read, and handed to
+// the archive writer, in blocks of up to 8 MiB. The buffer starts out small,
+// and grows with the files read. Zero-initialize it before use.
+typedef struct CommitInput {
+    unsigned char* buffer;
+    size_t buffer_size;
+    uint64_t bytes_read;
+} CommitInput;
+
+// Prepare to read the regular file <fd> of <size> bytes. Files larger than
+// the smallest read are read ahead sequentially.
+void commit_input_advise(int fd, off_t size);
+
+// Write <length> bytes of <fd> at <offset> to <writer>. Returns 0 on success,
+// or a negative errno. A file which is shorter than expected ends early.
+int commit_input_write_data(CommitInput* input, struct archive* writer,
+                            int fd, off_t offset, off_t length);
+
+void commit_input_release(CommitInput* input);
+
+#endif // VOLUMETRIC_COMMIT_INPUT_H
+
+///////////////////////////////////////////////////////////////////////////////
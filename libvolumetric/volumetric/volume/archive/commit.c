@@ -7,7 +7,7 @@
 //
 // CREATED:         02/13/2022
 //
-// LAST EDITED:     06/22/2022
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -25,9 +25,14 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ////
 
+// For SEEK_DATA and SEEK_HOLE
+#define _GNU_SOURCE
+
+#include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <libgen.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -39,12 +44,41 @@
 #include <archive_entry.h>
 #include <glib-2.0/glib.h>
 
+#include <volumetric/batch-io.h>
 #include <volumetric/directory.h>
 #include <volumetric/docker.h>
 #include <volumetric/file.h>
+#include <volumetric/gzip-writer.h>
 #include <volumetric/hash.h>
+#include <volumetric/io-scheduler.h>
+#include <volumetric/seekable-zstd.h>
 #include <volumetric/string-handling.h>
 #include <volumetric/volume/archive.h>
+#include <volumetric/volume/archive/commit-input.h>
+#include <volumetric/volume/archive/layer.h>
+#include <volumetric/volume/archive/overlay.h>
+#include <volumetric/volume/archive/transport.h>
+
+// Files up to this size are read ahead in batches of COMMIT_BATCH_FILES, when
+// io_uring is available.
+static const size_t COMMIT_BATCH_FILE_SIZE = 64 * 1024;
+static const guint COMMIT_BATCH_FILES = 256;
+
+// Size of the reads of archives received through a helper container
+static const size_t COMMIT_STREAM_BLOCK_SIZE = 1024 * 1024;
+
+// What an incremental commit writes ahead of the files which changed.
+typedef struct CommitLayer {
+    char* entry; // Contents of the layer entry, naming the parent
+    GPtrArray* whiteouts;
+} CommitLayer;
+
+// Where the entries of a compacted chain of layers are written.
+typedef struct CommitMerge {
+    struct archive* writer;
+    SeekableWriter* seekable;
+    size_t entries;
+} CommitMerge;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Filename Stuff
@@ -143,183 +177,843 @@ static char* get_date_string_owned() {
     return string;
 }
 
-static GPtrArray* get_consumers_of_volume(Docker* docker,
-                                          const char* volume_name) {
-    GPtrArray* consumers = g_ptr_array_new();
+static char* get_archive_path_for_file(const char* filename,
+                                       const char* directory) {
+    size_t directory_length = strlen(directory);
+    if (!strncmp(filename, directory, directory_length)) {
+        return string_append_new(strdup("."), filename + directory_length);
+    }
+
+    return strdup(filename);
+}
+
+// Record the data regions of <fd> as the sparse map of <entry>, if the file
+// has any holes. Holes are only looked for if the file occupies less space on
+// disk than its size suggests.
+static void add_sparse_map(struct archive_entry* entry, int fd,
+                           const struct stat* file_stat) {
+    if (!S_ISREG(file_stat->st_mode) ||
+        (off_t)file_stat->st_blocks * 512 >= file_stat->st_size) {
+        return;
+    }
+
+    off_t size = file_stat->st_size;
+    off_t data = 0;
+    while (data < size) {
+        data = lseek(fd, data, SEEK_DATA);
+        if (0 > data && ENXIO == errno) {
+            // The rest of the file is a hole.
+            break;
+        } else if (0 > data) {
+            // The filesystem doesn't support SEEK_DATA.
+            archive_entry_sparse_clear(entry);
+            return;
+        }
+
+        off_t hole = lseek(fd, data, SEEK_HOLE);
+        if (0 > hole || hole > size) {
+            hole = size;
+        }
+        archive_entry_sparse_add_entry(entry, data, hole - data);
+        data = hole;
+    }
+
+    // Files consisting only of a hole still need an entry to be sparse.
+    if (0 == archive_entry_sparse_count(entry)) {
+        archive_entry_sparse_add_entry(entry, size, 0);
+    }
+}
+
+// Feed <length> bytes of a hole to <writer>. The data of holes in sparse
+// entries is never stored, but the writer still expects to be given it.
+static void write_hole(struct archive* writer, off_t length) {
+    static const char zeros[64 * 1024] = {0};
+    while (0 < length) {
+        size_t size = length < (off_t)sizeof(zeros) ? (size_t)length
+                                                    : sizeof(zeros);
+        la_ssize_t written = archive_write_data(writer, zeros, size);
+        if (0 >= written) {
+            return;
+        }
+        length -= written;
+    }
+}
+
+// Write the contents of the file to <writer>, skipping over the holes in its
+// sparse map, if it has one.
+static int write_file_contents(struct archive* writer, CommitInput* input,
+                               struct archive_entry* entry, int fd) {
+    if (0 == archive_entry_sparse_reset(entry)) {
+        return commit_input_write_data(input, writer, fd, 0,
+                                       archive_entry_size(entry));
+    }
 
-    DockerContainerIter* containers = docker_container_list(docker);
-    const DockerContainer* container = NULL;
-    while (NULL != (container = docker_container_iter_next(containers))) {
-        if (NULL == container->mounts) {
+    off_t position = 0;
+    la_int64_t offset = 0;
+    la_int64_t length = 0;
+    while (ARCHIVE_OK == archive_entry_sparse_next(entry, &offset, &length)) {
+        write_hole(writer, offset - position);
+        int result =
+            commit_input_write_data(input, writer, fd, offset, length);
+        if (0 != result) {
+            return result;
+        }
+        position = offset + length;
+    }
+
+    write_hole(writer, archive_entry_size(entry) - position);
+    return 0;
+}
+
+// Append the file at <filename> to <writer>. If <prefetched> is not NULL, it
+// holds the result of stat'ing the file, and possibly its contents.
+static int commit_file(struct archive* writer, SeekableWriter* seekable,
+                       CommitInput* input, const char* filename,
+                       const char* mountpoint,
+                       const BatchIoRead* prefetched) {
+    struct stat file_stat = {0};
+    if (NULL != prefetched && 0 == prefetched->result) {
+        file_stat = prefetched->stat;
+    } else {
+        stat(filename, &file_stat);
+    }
+
+    int fd = -1;
+    if (NULL == prefetched || NULL == prefetched->data) {
+        fd = open(filename, O_RDONLY);
+        if (0 > fd) {
+            fprintf(stderr, "%s:%d: Couldn't open %s for reading: %s\n",
+                    __FUNCTION__, __LINE__, filename, strerror(errno));
+            return -1 * errno;
+        }
+    }
+
+    struct archive_entry* entry = archive_entry_new();
+    char* archive_path = get_archive_path_for_file(filename, mountpoint);
+    archive_entry_set_pathname(entry, archive_path);
+    archive_entry_copy_stat(entry, &file_stat);
+    if (0 <= fd) {
+        add_sparse_map(entry, fd, &file_stat);
+    }
+    if (0 <= fd && S_ISREG(file_stat.st_mode)) {
+        commit_input_advise(fd, file_stat.st_size);
+    }
+    if (NULL != seekable) {
+        seekable_writer_begin_entry(seekable, archive_path,
+                                    archive_entry_size(entry),
+                                    S_ISDIR(file_stat.st_mode));
+    }
+    free(archive_path);
+    archive_write_header(writer, entry);
+
+    int result = 0;
+    if (0 > fd) {
+        archive_write_data(writer, prefetched->data, prefetched->size);
+        input->bytes_read += prefetched->size;
+    } else if (S_ISREG(file_stat.st_mode)) {
+        result = write_file_contents(writer, input, entry, fd);
+    }
+
+    if (0 <= fd) {
+        close(fd);
+    }
+    archive_entry_free(entry);
+    if (0 != result) {
+        fprintf(stderr, "%s:%d: Couldn't read %s: %s\n", __FUNCTION__,
+                __LINE__, filename, strerror(-result));
+        return result;
+    }
+
+    // Flush the padding now, so the entry's extent in the stream is known
+    archive_write_finish_entry(writer);
+    if (NULL != seekable) {
+        seekable_writer_end_entry(seekable);
+    }
+    return 0;
+}
+
+// Append a read-only regular file holding <size> bytes of <data> to <writer>.
+static void commit_buffer(struct archive* writer, SeekableWriter* seekable,
+                          const char* archive_path, const void* data,
+                          size_t size) {
+    struct archive_entry* entry = archive_entry_new();
+    archive_entry_set_pathname(entry, archive_path);
+    archive_entry_set_filetype(entry, AE_IFREG);
+    archive_entry_set_perm(entry, 0444);
+    archive_entry_set_size(entry, size);
+    archive_entry_set_mtime(entry, time(NULL), 0);
+    if (NULL != seekable) {
+        seekable_writer_begin_entry(seekable, archive_path, size, false);
+    }
+    archive_write_header(writer, entry);
+    if (0 < size) {
+        archive_write_data(writer, data, size);
+    }
+    archive_write_finish_entry(writer);
+    if (NULL != seekable) {
+        seekable_writer_end_entry(seekable);
+    }
+    archive_entry_free(entry);
+}
+
+// Whether the file described by <file_stat> differs from the archive entry
+// described by <entry_stat>.
+static bool commit_file_is_modified(const struct stat* file_stat,
+                                    const struct stat* entry_stat) {
+    bool diff = false;
+    if (S_ISREG(file_stat->st_mode)) {
+        diff = diff || file_stat->st_size != entry_stat->st_size;
+    }
+
+    diff = diff || file_stat->st_mode != entry_stat->st_mode;
+    diff = diff || file_stat->st_mtime != entry_stat->st_mtime;
+    diff = diff || file_stat->st_uid != entry_stat->st_uid;
+    diff = diff || file_stat->st_gid != entry_stat->st_gid;
+    return diff;
+}
+
+// Whether a directory above <path> is in <paths>. Whiteouts of directories
+// remove everything beneath them.
+static bool commit_path_has_ancestor(GHashTable* paths, const char* path) {
+    char* ancestor = g_strdup(path);
+    bool found = false;
+    char* separator = NULL;
+    while (!found && NULL != (separator = strrchr(ancestor, '/'))) {
+        *separator = '\0';
+        found = g_hash_table_contains(paths, ancestor);
+    }
+    g_free(ancestor);
+    return found;
+}
+
+static gint commit_compare_paths(gconstpointer first, gconstpointer second) {
+    return strcmp(*(const char* const*)first, *(const char* const*)second);
+}
+
+// Find the files in <files> which were added or modified since the tree of
+// <chain>, and the whiteouts of the paths which were removed from it (or
+// replaced by a file of another type), for an incremental commit.
+static int commit_find_changes(const ArchiveLayerChain* chain,
+                               GPtrArray* files, const char* mountpoint,
+                               GPtrArray** changed, GPtrArray** whiteouts) {
+    GHashTable* entries = archive_layer_chain_get_entries(chain, NULL);
+    if (NULL == entries) {
+        return -EIO;
+    }
+
+    GHashTable* replaced =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    *changed = g_ptr_array_new();
+    *whiteouts = g_ptr_array_new_with_free_func(g_free);
+    for (guint i = 0; i < files->len; ++i) {
+        const char* filename = files->pdata[i];
+        if (!strcmp(filename, mountpoint)) {
             continue;
         }
 
-        const DockerMount* mount = NULL;
-        while (NULL != (mount = docker_mount_iter_next(container->mounts))) {
-            if (!strcmp(mount->source, volume_name)) {
-                g_ptr_array_add(consumers, strdup(container->id));
+        char* archive_path = get_archive_path_for_file(filename, mountpoint);
+        const char* path = archive_path + strlen("./");
+        struct stat file_stat = {0};
+        const struct stat* entry_stat = g_hash_table_lookup(entries, path);
+        if (NULL == entry_stat || 0 != stat(filename, &file_stat)) {
+            g_ptr_array_add(*changed, (gpointer)filename);
+        } else {
+            if (S_ISDIR(file_stat.st_mode) != S_ISDIR(entry_stat->st_mode)) {
+                g_ptr_array_add(*whiteouts,
+                                archive_layer_get_whiteout(archive_path));
+                g_hash_table_add(replaced, g_strdup(path));
             }
+            if (commit_file_is_modified(&file_stat, entry_stat)) {
+                g_ptr_array_add(*changed, (gpointer)filename);
+            }
+            g_hash_table_remove(entries, path);
         }
+        free(archive_path);
     }
 
-    docker_container_iter_free(containers);
-    return consumers;
+    // Whatever's left was removed from the volume.
+    GHashTableIter iter;
+    gpointer key = NULL;
+    g_hash_table_iter_init(&iter, entries);
+    while (g_hash_table_iter_next(&iter, &key, NULL)) {
+        const char* path = (const char*)key;
+        if (!commit_path_has_ancestor(entries, path) &&
+            !commit_path_has_ancestor(replaced, path)) {
+            g_ptr_array_add(*whiteouts, archive_layer_get_whiteout(path));
+        }
+    }
+    g_ptr_array_sort(*whiteouts, commit_compare_paths);
+
+    g_hash_table_unref(replaced);
+    g_hash_table_unref(entries);
+    return 0;
 }
 
-static char* get_archive_path_for_file(const char* filename,
-                                       const char* directory) {
-    size_t directory_length = strlen(directory);
-    if (!strncmp(filename, directory, directory_length)) {
-        return string_append_new(strdup("."), filename + directory_length);
+// Create the archive at <archive_name>, compressed by <threads> workers.
+// Entries are written to <writer>. If <seekable> is set, they're indexed by
+// it, and otherwise the archive belongs to <gzip>.
+static int commit_writer_open(const char* archive_name,
+                              ArchiveCompression compression,
+                              unsigned int threads, struct archive** writer,
+                              SeekableWriter** seekable, GzipWriter** gzip) {
+    *seekable = NULL;
+    *gzip = NULL;
+    if (ARCHIVE_COMPRESSION_SEEKABLE_ZSTD == compression) {
+        *seekable = seekable_writer_new(archive_name, threads);
+        if (NULL == *seekable) {
+            return -EIO;
+        }
+        *writer = seekable_writer_get_archive(*seekable);
+        return 0;
     }
 
-    return strdup(filename);
+    *gzip = gzip_writer_new(archive_name, threads);
+    if (NULL == *gzip) {
+        return -EIO;
+    }
+    *writer = gzip_writer_get_archive(*gzip);
+    return 0;
 }
 
+// Finish the archive. Returns <result>, unless that's 0 and the archive
+// couldn't be finished.
+static int commit_writer_close(SeekableWriter* seekable, GzipWriter* gzip,
+                               int result) {
+    int close_result = NULL != seekable ? seekable_writer_close(seekable)
+                                        : gzip_writer_close(gzip);
+    return 0 != result ? result : close_result;
+}
+
+// Archive <files> beneath <mountpoint>. If <layer> is not NULL, the archive
+// is a layer, and starts with its layer entry and whiteouts.
 static int commit_changes(const char* archive_name, GPtrArray* files,
-                          const char* mountpoint) {
-    struct archive* writer = archive_write_new();
-    archive_write_add_filter_gzip(writer);
-    archive_write_set_format_pax_restricted(writer);
-    int result = archive_write_open_filename(writer, archive_name);
-    if (ARCHIVE_OK != result) {
-        fprintf(stderr, "%s:%d: Couldn't open file for writing: %s\n",
-                __FUNCTION__, __LINE__, archive_error_string(writer));
-        archive_write_free(writer);
+                          const char* mountpoint,
+                          ArchiveCompression compression,
+                          unsigned int threads, bool batch_io,
+                          const CommitLayer* layer) {
+    struct archive* writer = NULL;
+    SeekableWriter* seekable = NULL;
+    GzipWriter* gzip = NULL;
+    int result = commit_writer_open(archive_name, compression, threads,
+                                    &writer, &seekable, &gzip);
+    if (0 != result) {
         return result;
     }
 
-    struct archive_entry* entry = NULL;
-    struct stat file_stat;
-    char buffer[4096];
+    CommitInput input = {0};
+    gint64 start = g_get_monotonic_time();
+    if (NULL != layer) {
+        commit_buffer(writer, seekable, ARCHIVE_LAYER_ENTRY, layer->entry,
+                      strlen(layer->entry));
+        for (guint i = 0; i < layer->whiteouts->len; ++i) {
+            commit_buffer(writer, seekable, layer->whiteouts->pdata[i], NULL,
+                          0);
+        }
+    }
+
+    // Small files are read ahead in batches, if io_uring is available.
+    BatchIo* io = batch_io ? batch_io_new() : NULL;
+    BatchIoRead* batch = NULL;
+    if (NULL != io) {
+        batch = calloc(COMMIT_BATCH_FILES, sizeof(BatchIoRead));
+        assert(NULL != batch);
+    }
+
+    guint batch_start = 0;
+    guint batch_end = 0;
     for (guint i = 0; i < files->len; ++i) {
         printf("\rArchiving entry %d of %d", i + 1, files->len);
+        if (NULL != io && i == batch_end) {
+            batch_start = i;
+            batch_end = MIN(files->len, i + COMMIT_BATCH_FILES);
+            for (guint j = batch_start; j < batch_end; ++j) {
+                batch[j - batch_start].path = files->pdata[j];
+            }
+            batch_io_read_files(io, batch, batch_end - batch_start,
+                                COMMIT_BATCH_FILE_SIZE);
+        }
+
+        BatchIoRead* prefetched =
+            NULL != io ? &batch[i - batch_start] : NULL;
         const char* filename = files->pdata[i];
-        if (!strcmp(filename, mountpoint)) {
-            continue;
+        if (strcmp(filename, mountpoint)) {
+            result = commit_file(writer, seekable, &input, filename,
+                                 mountpoint, prefetched);
         }
+        if (NULL != prefetched) {
+            free(prefetched->data);
+            prefetched->data = NULL;
+        }
+        if (0 != result) {
+            break;
+        }
+    }
 
-        memset(&file_stat, 0, sizeof(file_stat));
-        stat(filename, &file_stat);
+    if (NULL != io) {
+        for (guint i = 0; i < batch_end - batch_start; ++i) {
+            free(batch[i].data);
+        }
+        free(batch);
+        batch_io_free(io);
+    }
 
-        entry = archive_entry_new();
-        char* archive_path = get_archive_path_for_file(filename, mountpoint);
-        archive_entry_set_pathname(entry, archive_path);
-        free(archive_path);
-        archive_entry_copy_stat(entry, &file_stat);
-        archive_write_header(writer, entry);
+    commit_input_release(&input);
 
-        int fd = open(filename, O_RDONLY);
-        if (0 > fd) {
-            fprintf(stderr, "%s:%d: Couldn't open %s for reading: %s\n",
-                    __FUNCTION__, __LINE__, filename, strerror(errno));
-            archive_write_close(writer);
-            archive_write_free(writer);
-            return -1 * errno;
+    printf("\n");
+    result = commit_writer_close(seekable, gzip, result);
+    double seconds = (g_get_monotonic_time() - start) / 1e6;
+    if (0 == result && 0 < seconds) {
+        printf("Archived %juM of file data in %.3fs (%.1fM/s)\n",
+               (uintmax_t)(input.bytes_read / (1024 * 1024)), seconds,
+               input.bytes_read / (1024 * 1024) / seconds);
+    }
+    return result;
+}
+
+// Name of an entry received from a helper container in the archive. The
+// first component of the name is the volume itself, which isn't archived.
+static char* get_archive_path_for_entry(const char* pathname) {
+    const char* separator = strchr(pathname, '/');
+    if (NULL == separator || '\0' == separator[1]) {
+        return NULL;
+    }
+
+    char* archive_path = string_append_new(strdup("."), separator);
+    size_t length = strlen(archive_path);
+    if ('/' == archive_path[length - 1]) {
+        archive_path[length - 1] = '\0';
+    }
+    return archive_path;
+}
+
+// Append the current entry of <reader> to <writer>. Its data is read in the
+// blocks libarchive decompressed it into, rather than copied out. Returns a
+// libarchive status.
+static int commit_entry(struct archive* writer, SeekableWriter* seekable,
+                        struct archive* reader, struct archive_entry* entry) {
+    if (NULL != seekable) {
+        seekable_writer_begin_entry(
+            seekable, archive_entry_pathname(entry),
+            archive_entry_size(entry),
+            AE_IFDIR == archive_entry_filetype(entry));
+    }
+    archive_write_header(writer, entry);
+
+    const void* block = NULL;
+    size_t size = 0;
+    la_int64_t offset = 0;
+    la_int64_t position = 0;
+    int status = ARCHIVE_OK;
+    while (ARCHIVE_OK == (status = archive_read_data_block(reader, &block,
+                                                           &size, &offset))) {
+        write_hole(writer, offset - position);
+        archive_write_data(writer, block, size);
+        position = offset + size;
+    }
+    if (ARCHIVE_EOF != status) {
+        return status;
+    }
+
+    archive_write_finish_entry(writer);
+    if (NULL != seekable) {
+        seekable_writer_end_entry(seekable);
+    }
+    return ARCHIVE_OK;
+}
+
+// Re-archive the entries of <reader>, received from a helper container.
+static int commit_entries(struct archive* writer, SeekableWriter* seekable,
+                          struct archive* reader) {
+    struct archive_entry* entry = NULL;
+    size_t entries = 0;
+    int status = ARCHIVE_OK;
+    for (;;) {
+        status = archive_read_next_header(reader, &entry);
+        if (ARCHIVE_EOF == status || ARCHIVE_WARN > status) {
+            break;
         }
 
-        int bytes_read = read(fd, buffer, sizeof(buffer));
-        while (bytes_read > 0) {
-            archive_write_data(writer, buffer, bytes_read);
-            bytes_read = read(fd, buffer, sizeof(buffer));
+        char* archive_path =
+            get_archive_path_for_entry(archive_entry_pathname(entry));
+        if (NULL == archive_path) {
+            continue;
         }
 
-        close(fd);
-        archive_entry_free(entry);
+        printf("\rArchiving entry %zu", ++entries);
+        archive_entry_set_pathname(entry, archive_path);
+        free(archive_path);
+        const char* hardlink = archive_entry_hardlink(entry);
+        if (NULL != hardlink) {
+            char* hardlink_path = get_archive_path_for_entry(hardlink);
+            archive_entry_set_hardlink(entry, hardlink_path);
+            free(hardlink_path);
+        }
+        status = commit_entry(writer, seekable, reader, entry);
+        if (ARCHIVE_OK != status) {
+            break;
+        }
     }
 
     printf("\n");
-    archive_write_close(writer);
-    archive_write_free(writer);
+    if (ARCHIVE_EOF != status) {
+        fprintf(stderr, "%s:%d: Couldn't read volume archive: %s\n",
+                __FUNCTION__, __LINE__, archive_error_string(reader));
+        return -EIO;
+    }
+    return 0;
+}
+
+// Archive an entry of the tree of a chain of layers, which is being compacted.
+static int commit_merged_entry(void* user_data, struct archive* reader,
+                               struct archive_entry* entry) {
+    CommitMerge* merge = (CommitMerge*)user_data;
+    printf("\rArchiving entry %zu", ++merge->entries);
+    if (ARCHIVE_OK != commit_entry(merge->writer, merge->seekable, reader,
+                                   entry)) {
+        fprintf(stderr, "\n%s:%d: Couldn't read layer: %s\n", __FUNCTION__,
+                __LINE__, archive_error_string(reader));
+        return -EIO;
+    }
     return 0;
 }
 
+// Commit the volume as it's received from the helper container.
+static int commit_from_helper(const char* archive_name, Docker* docker,
+                              const char* helper,
+                              ArchiveCompression compression,
+                              unsigned int threads) {
+    struct archive* writer = NULL;
+    SeekableWriter* seekable = NULL;
+    GzipWriter* gzip = NULL;
+    int result = commit_writer_open(archive_name, compression, threads,
+                                    &writer, &seekable, &gzip);
+    if (0 != result) {
+        return result;
+    }
+
+    int fd = -1;
+    ArchiveTransportStream* stream =
+        archive_transport_get_start(docker, helper, &fd);
+    if (NULL == stream) {
+        return commit_writer_close(seekable, gzip, -EIO);
+    }
+
+    struct archive* reader = archive_read_new();
+    archive_read_support_format_tar(reader);
+    if (ARCHIVE_OK !=
+        archive_read_open_fd(reader, fd, COMMIT_STREAM_BLOCK_SIZE)) {
+        fprintf(stderr, "%s:%d: Couldn't read volume archive: %s\n",
+                __FUNCTION__, __LINE__, archive_error_string(reader));
+        result = -EIO;
+    } else {
+        result = commit_entries(writer, seekable, reader);
+    }
+    archive_read_free(reader);
+
+    // A failed transfer may look like the end of the archive to the reader.
+    int transfer_result = archive_transport_get_finish(stream);
+    if (0 == result) {
+        result = transfer_result;
+    }
+    return commit_writer_close(seekable, gzip, result);
+}
+
+// Print the hash of the new archive, and make it read-only.
+static void commit_seal_archive(ArchiveVolume* volume) {
+    FileContents file = {0};
+    file_contents_init(&file, volume->url);
+    FileHash* file_hash = file_hash_of_buffer(volume->hash->hash_type,
+                                              file.contents, file.size);
+    char* hash_string = file_hash_to_string(file_hash);
+    printf("%s: %s\n", file_hash_type_to_string(file_hash->hash_type),
+           hash_string);
+    free(hash_string);
+    file_hash_free(file_hash);
+    file_contents_release(&file);
+
+    chmod(volume->url, 0444);
+}
+
+// Open the chain of layers an incremental commit goes on top of, with the
+// contents of its top in <top>. <chain> is set to NULL if the volume is
+// committed in full.
+static int commit_open_chain(ArchiveVolume* volume, FileContents* top,
+                             ArchiveLayerChain** chain) {
+    *chain = NULL;
+    struct stat archive_stat = {0};
+    if (ARCHIVE_COMMIT_INCREMENTAL != volume->commit_mode ||
+        0 != stat(volume->url, &archive_stat)) {
+        return 0;
+    } else if (ARCHIVE_TRANSPORT_LOCAL != volume->transport) {
+        printf("%s: Volumes using the docker-archive transport are "
+               "committed in full\n",
+               volume->name);
+        return 0;
+    }
+
+    file_contents_init(top, volume->url);
+    int result = archive_layer_chain_open(volume->url, top, chain);
+    if (0 != result) {
+        fprintf(stderr, "%s: Couldn't read the layers of %s: %s\n",
+                volume->name, volume->url, strerror(-result));
+        file_contents_release(top);
+    }
+    return result;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public API
 ////
 
 int archive_volume_commit(ArchiveVolume* volume, Docker* docker,
                           bool dry_run) {
+    // The paths which weren't checked out would be missing from the archive.
+    if (NULL != volume->include || NULL != volume->exclude) {
+        fprintf(stderr,
+                "%s: Volumes with include or exclude patterns can't be "
+                "committed\n",
+                volume->name);
+        return -EINVAL;
+    }
+
+    // An incremental commit goes on top of the current archive, which is the
+    // top of a chain of layers itself, after the first incremental commit.
+    FileContents top = {0};
+    ArchiveLayerChain* chain = NULL;
+    int result = commit_open_chain(volume, &top, &chain);
+    if (0 != result) {
+        return result;
+    }
+
     // Rename the current source file to save it.
     char* current_time = get_date_string_owned();
     char* new_filename = get_new_filename(volume->url, current_time);
     free(current_time);
 
+    CommitLayer layer = {0};
+    if (NULL != chain) {
+        FileHash* parent_hash = file_hash_of_buffer(volume->hash->hash_type,
+                                                    top.contents, top.size);
+        char* parent_name = get_basename_owned(new_filename);
+        layer.entry = archive_layer_format_entry(parent_name, parent_hash);
+        free(parent_name);
+        file_hash_free(parent_hash);
+    }
+
     printf("%s: Renaming %s to %s\n", volume->name, volume->url, new_filename);
-    int result = 0;
     if (!dry_run) {
         result = rename(volume->url, new_filename);
     }
 
     free(new_filename);
-    if (0 != result && errno ^ ENOENT) {
+    if (0 != result && ENOENT != errno) {
         perror("couldn't rename source");
-        return -1 * errno;
-    } else if (errno & ENOENT) {
+        result = -1 * errno;
+        if (NULL != chain) {
+            archive_layer_chain_free(chain);
+            file_contents_release(&top);
+            g_free(layer.entry);
+        }
+        return result;
+    } else if (0 != result) {
         printf("Volume file %s doesn't appear to exist. Assuming this is an"
                " initial commit.\n",
                volume->url);
+        result = 0;
     }
 
     // Get the list of containers that have this volume mounted
-    GPtrArray* containers = get_consumers_of_volume(docker, volume->name);
+    GPtrArray* containers =
+        docker_container_list_consumers(docker, volume->name);
 
-    // Pause any running containers that have the volume mounted
+    // Pause any running containers that have the volume mounted. If one
+    // can't be paused, nothing is committed, and the ones already paused are
+    // unpaused below.
     printf("Pausing any containers that have this volume mounted...\n");
-    for (guint i = 0; i < containers->len; ++i) {
-        printf("Pausing %s\n", (const char*)containers->pdata[i]);
+    guint paused = 0;
+    for (; paused < containers->len; ++paused) {
+        printf("Pausing %s\n", (const char*)containers->pdata[paused]);
         if (!dry_run) {
-            result = docker_container_pause(docker,
-                                            (const char*)containers->pdata[i]);
+            result = docker_container_pause(
+                docker, (const char*)containers->pdata[paused]);
         }
         if (0 != result) {
-            g_ptr_array_unref(containers);
-            return result;
+            break;
         }
     }
 
-    // Commit changes to disk
-    DockerVolume* live_volume = docker_volume_inspect(docker, volume->name);
-    GPtrArray* files = get_file_list_for_directory(live_volume->mountpoint);
-    if (!dry_run) {
-        result = commit_changes(volume->url, files, live_volume->mountpoint);
+    // The mountpoint of an overlay volume is only mounted while a container
+    // uses it, so its layers are mounted (read-only) to be committed.
+    // Volumes which are only reached through the Docker daemon are archived by
+    // a helper container instead.
+    DockerVolume* live_volume = NULL;
+    char* merged = NULL;
+    char* helper = NULL;
+    const char* mountpoint = NULL;
+    if (0 == result && (ARCHIVE_CHECKOUT_OVERLAY == volume->checkout ||
+                        ARCHIVE_CHECKOUT_LAZY == volume->checkout)) {
+        result = archive_overlay_mount_merged(volume->name, &merged);
+        mountpoint = merged;
+        if (0 != result) {
+            fprintf(stderr, "%s: Couldn't mount volume layers: %s\n",
+                    volume->name, strerror(-result));
+        }
+    } else if (0 == result &&
+               ARCHIVE_TRANSPORT_LOCAL != volume->transport) {
+        if (!dry_run) {
+            helper = archive_transport_helper_new(volume, docker);
+            result = NULL == helper ? -EIO : 0;
+        }
+    } else if (0 == result) {
+        live_volume = docker_volume_inspect(docker, volume->name);
+        mountpoint = live_volume->mountpoint;
+    }
+
+    // Commit changes to disk. The mountpoint is the last path, since the
+    // helper container doesn't have one.
+    IoStreams* streams = NULL;
+    if (0 == result && !dry_run) {
+        streams = io_scheduler_acquire(volume->io_scheduler, volume->url,
+                                       mountpoint, NULL);
+    }
+    GPtrArray* files = NULL;
+    if (0 == result && NULL != mountpoint) {
+        files = get_file_list_for_directory(mountpoint);
+    }
+    GPtrArray* changed = NULL;
+    if (0 == result && NULL != chain) {
+        result = commit_find_changes(chain, files, mountpoint, &changed,
+                                     &layer.whiteouts);
         if (0 == result) {
-            // Print the hash of the new volume.
-            FileContents file = {0};
-            file_contents_init(&file, volume->url);
-            FileHash* file_hash = file_hash_of_buffer(
-                volume->hash->hash_type, file.contents, file.size);
-            char* hash_string = file_hash_to_string(file_hash);
-            printf("%s: %s\n", file_hash_type_to_string(file_hash->hash_type),
-                   hash_string);
-            free(hash_string);
-            file_hash_free(file_hash);
-            file_contents_release(&file);
-
-            // Make the volume read-only
-            chmod(volume->url, 0444);
+            printf("%s: %u entries added or modified, %u removed since the "
+                   "last commit\n",
+                   volume->name, changed->len, layer.whiteouts->len);
+        }
+    }
+    if (0 == result && !dry_run) {
+        if (NULL != helper) {
+            result = commit_from_helper(volume->url, docker, helper,
+                                        volume->compression,
+                                        volume->compression_threads);
+        } else if (NULL != chain) {
+            result = commit_changes(volume->url, changed, mountpoint,
+                                    volume->compression,
+                                    volume->compression_threads,
+                                    ARCHIVE_IO_URING == volume->io, &layer);
+        } else {
+            result = commit_changes(volume->url, files, mountpoint,
+                                    volume->compression,
+                                    volume->compression_threads,
+                                    ARCHIVE_IO_URING == volume->io, NULL);
+        }
+        if (0 == result) {
+            commit_seal_archive(volume);
+        }
+    }
+    io_streams_release(streams);
+    if (NULL != chain) {
+        if (NULL != changed) {
+            g_ptr_array_unref(changed);
+            g_ptr_array_unref(layer.whiteouts);
         }
+        g_free(layer.entry);
+        archive_layer_chain_free(chain);
+        file_contents_release(&top);
+    }
+    if (NULL != files) {
+        g_ptr_array_unref(files);
+    }
+    if (NULL != helper) {
+        archive_transport_helper_free(docker, helper);
+    }
+    if (NULL != merged) {
+        archive_overlay_unmount_merged(merged);
+        g_free(merged);
+    }
+    if (NULL != live_volume) {
+        docker_volume_free(live_volume);
     }
-    g_ptr_array_unref(files);
-    docker_volume_free(live_volume);
 
     // Un-pause all the containers that have the volume mounted
     printf("Unpausing containers\n");
-    for (guint i = 0; i < containers->len; ++i) {
+    for (guint i = 0; i < paused; ++i) {
         printf("Un-pausing %s\n", (const char*)containers->pdata[i]);
         if (!dry_run) {
             // Don't reset the error code to zero if commit failed
             result += docker_container_unpause(
                 docker, (const char*)containers->pdata[i]);
         }
-        if (0 != result) {
-            g_ptr_array_unref(containers);
-            return result;
-        }
     }
 
     g_ptr_array_unref(containers);
-    return 0;
+    return result;
+}
+
+int archive_volume_compact(ArchiveVolume* volume, bool dry_run) {
+    ArchiveLayerChain* chain = NULL;
+    int result = archive_layer_chain_open(volume->url, NULL, &chain);
+    if (0 != result) {
+        fprintf(stderr, "%s: Couldn't read the layers of %s: %s\n",
+                volume->name, volume->url, strerror(-result));
+        return result;
+    }
+
+    size_t length = archive_layer_chain_get_length(chain);
+    if (1 == length) {
+        printf("%s: %s isn't a layer, there's nothing to compact\n",
+               volume->name, volume->url);
+        archive_layer_chain_free(chain);
+        return 0;
+    }
+
+    // Nothing is written unless every archive in the chain is intact.
+    printf("%s: Checking %zu layers on top of the base archive\n",
+           volume->name, length - 1);
+    result = archive_layer_chain_verify(chain, NULL);
+    if (0 != result) {
+        archive_layer_chain_free(chain);
+        return result;
+    }
+
+    // The chain stays mapped while the top is renamed.
+    char* current_time = get_date_string_owned();
+    char* new_filename = get_new_filename(volume->url, current_time);
+    free(current_time);
+    printf("%s: Renaming %s to %s\n", volume->name, volume->url, new_filename);
+    if (!dry_run && 0 != rename(volume->url, new_filename)) {
+        result = -errno;
+        perror("couldn't rename source");
+    }
+
+    if (0 == result && !dry_run) {
+        IoStreams* streams =
+            io_scheduler_acquire(volume->io_scheduler, volume->url, NULL);
+        GzipWriter* gzip = NULL;
+        CommitMerge merge = {0};
+        result = commit_writer_open(volume->url, volume->compression,
+                                    volume->compression_threads,
+                                    &merge.writer, &merge.seekable, &gzip);
+        if (0 == result) {
+            result = archive_layer_chain_merge(chain, commit_merged_entry,
+                                               &merge);
+            printf("\n");
+            result = commit_writer_close(merge.seekable, gzip, result);
+        }
+        io_streams_release(streams);
+
+        // The chain is still complete, so it's put back.
+        if (0 == result) {
+            commit_seal_archive(volume);
+        } else {
+            fprintf(stderr, "%s: Compaction failed, restoring %s\n",
+                    volume->name, volume->url);
+            rename(new_filename, volume->url);
+        }
+    }
+
+    free(new_filename);
+    archive_layer_chain_free(chain);
+    return result;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
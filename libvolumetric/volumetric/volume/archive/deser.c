@@ -7,7 +7,7 @@
 //
 // CREATED:         02/13/2022
 //
-// LAST EDITED:     01/06/2023
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -27,6 +27,8 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -52,6 +54,157 @@ static int archive_volume_set_update_policy(ArchiveVolume* volume,
     return 0;
 }
 
+static int archive_volume_set_verify_mode(ArchiveVolume* volume,
+                                          const char* verify_mode) {
+    if (!strcmp("before-extract", verify_mode)) {
+        volume->verify = ARCHIVE_VERIFY_BEFORE_EXTRACT;
+    } else if (!strcmp("during-extract", verify_mode)) {
+        volume->verify = ARCHIVE_VERIFY_DURING_EXTRACT;
+    } else {
+        fprintf(stderr, "Invalid verify mode: %s\n", verify_mode);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int archive_volume_set_compression(ArchiveVolume* volume,
+                                          const char* compression) {
+    if (!strcmp("gzip", compression)) {
+        volume->compression = ARCHIVE_COMPRESSION_GZIP;
+    } else if (!strcmp("seekable-zstd", compression)) {
+        volume->compression = ARCHIVE_COMPRESSION_SEEKABLE_ZSTD;
+    } else {
+        fprintf(stderr, "Invalid compression: %s\n", compression);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int archive_volume_set_compression_threads(ArchiveVolume* volume,
+                                                  const char* threads) {
+    char* end = NULL;
+    errno = 0;
+    unsigned long value = strtoul(threads, &end, 10);
+    if (0 != errno || end == threads || '\0' != *end || '-' == threads[0] ||
+        UINT_MAX < value) {
+        fprintf(stderr, "Invalid compression-threads: %s\n", threads);
+        return -EINVAL;
+    }
+
+    volume->compression_threads = (unsigned int)value;
+    return 0;
+}
+
+static int archive_volume_set_commit_mode(ArchiveVolume* volume,
+                                          const char* commit_mode) {
+    if (!strcmp("full", commit_mode)) {
+        volume->commit_mode = ARCHIVE_COMMIT_FULL;
+    } else if (!strcmp("incremental", commit_mode)) {
+        volume->commit_mode = ARCHIVE_COMMIT_INCREMENTAL;
+    } else {
+        fprintf(stderr, "Invalid commit mode: %s\n", commit_mode);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int archive_volume_set_checkout_mode(ArchiveVolume* volume,
+                                            const char* checkout_mode) {
+    if (!strcmp("replace", checkout_mode)) {
+        volume->checkout = ARCHIVE_CHECKOUT_REPLACE;
+    } else if (!strcmp("swap", checkout_mode)) {
+        volume->checkout = ARCHIVE_CHECKOUT_SWAP;
+    } else if (!strcmp("incremental", checkout_mode)) {
+        volume->checkout = ARCHIVE_CHECKOUT_INCREMENTAL;
+    } else if (!strcmp("incremental-contents", checkout_mode)) {
+        volume->checkout = ARCHIVE_CHECKOUT_INCREMENTAL_CONTENTS;
+    } else if (!strcmp("overlay", checkout_mode)) {
+        volume->checkout = ARCHIVE_CHECKOUT_OVERLAY;
+    } else if (!strcmp("lazy", checkout_mode)) {
+        volume->checkout = ARCHIVE_CHECKOUT_LAZY;
+    } else {
+        fprintf(stderr, "Invalid checkout mode: %s\n", checkout_mode);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int archive_volume_set_cache_mode(ArchiveVolume* volume,
+                                        const char* cache_mode) {
+    if (!strcmp("clone", cache_mode)) {
+        volume->cache_mode = ARCHIVE_CACHE_CLONE;
+    } else if (!strcmp("hardlink", cache_mode)) {
+        volume->cache_mode = ARCHIVE_CACHE_HARDLINK;
+    } else if (!strcmp("off", cache_mode)) {
+        volume->cache_mode = ARCHIVE_CACHE_OFF;
+    } else {
+        fprintf(stderr, "Invalid cache mode: %s\n", cache_mode);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int archive_volume_set_io_mode(ArchiveVolume* volume,
+                                     const char* io_mode) {
+    if (!strcmp("blocking", io_mode)) {
+        volume->io = ARCHIVE_IO_BLOCKING;
+    } else if (!strcmp("io-uring", io_mode)) {
+        volume->io = ARCHIVE_IO_URING;
+    } else {
+        fprintf(stderr, "Invalid I/O mode: %s\n", io_mode);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int archive_volume_set_sync_mode(ArchiveVolume* volume,
+                                       const char* sync_mode) {
+    if (!strcmp("durable", sync_mode)) {
+        volume->sync = ARCHIVE_SYNC_DURABLE;
+    } else if (!strcmp("none", sync_mode)) {
+        volume->sync = ARCHIVE_SYNC_NONE;
+    } else {
+        fprintf(stderr, "Invalid sync mode: %s\n", sync_mode);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int archive_volume_set_gzip_decoder(ArchiveVolume* volume,
+                                           const char* gzip_decoder) {
+    if (!strcmp("libarchive", gzip_decoder)) {
+        volume->gzip_decoder = ARCHIVE_GZIP_LIBARCHIVE;
+    } else if (!strcmp("parallel", gzip_decoder)) {
+        volume->gzip_decoder = ARCHIVE_GZIP_PARALLEL;
+    } else {
+        fprintf(stderr, "Invalid gzip decoder: %s\n", gzip_decoder);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int archive_volume_set_transport(ArchiveVolume* volume,
+                                       const char* transport) {
+    if (!strcmp("local", transport)) {
+        volume->transport = ARCHIVE_TRANSPORT_LOCAL;
+    } else if (!strcmp("docker-archive", transport)) {
+        volume->transport = ARCHIVE_TRANSPORT_DOCKER_ARCHIVE;
+    } else {
+        fprintf(stderr, "Invalid transport: %s\n", transport);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
 static int archive_volume_visit_map(SerdecYamlDeserializer* yaml,
                                     void* user_data, const char* key) {
     ArchiveVolume* volume = (ArchiveVolume*)user_data;
@@ -74,6 +227,77 @@ static int archive_volume_visit_map(SerdecYamlDeserializer* yaml,
         return archive_volume_set_update_policy(volume, temp);
     }
 
+    else if (!strcmp("verify", key)) {
+        serdec_yaml_deserialize_string(yaml, &temp);
+        return archive_volume_set_verify_mode(volume, temp);
+    }
+
+    else if (!strcmp("compression", key)) {
+        serdec_yaml_deserialize_string(yaml, &temp);
+        return archive_volume_set_compression(volume, temp);
+    }
+
+    else if (!strcmp("compression-threads", key)) {
+        serdec_yaml_deserialize_string(yaml, &temp);
+        return archive_volume_set_compression_threads(volume, temp);
+    }
+
+    else if (!strcmp("commit", key)) {
+        serdec_yaml_deserialize_string(yaml, &temp);
+        return archive_volume_set_commit_mode(volume, temp);
+    }
+
+    else if (!strcmp("checkout", key)) {
+        serdec_yaml_deserialize_string(yaml, &temp);
+        return archive_volume_set_checkout_mode(volume, temp);
+    }
+
+    else if (!strcmp("cache", key)) {
+        serdec_yaml_deserialize_string(yaml, &temp);
+        return archive_volume_set_cache_mode(volume, temp);
+    }
+
+    else if (!strcmp("io", key)) {
+        serdec_yaml_deserialize_string(yaml, &temp);
+        return archive_volume_set_io_mode(volume, temp);
+    }
+
+    else if (!strcmp("include", key)) {
+        int result = serdec_yaml_deserialize_string(yaml, &temp);
+        free(volume->include);
+        volume->include = strdup(temp);
+        return result;
+    }
+
+    else if (!strcmp("exclude", key)) {
+        int result = serdec_yaml_deserialize_string(yaml, &temp);
+        free(volume->exclude);
+        volume->exclude = strdup(temp);
+        return result;
+    }
+
+    else if (!strcmp("sync", key)) {
+        serdec_yaml_deserialize_string(yaml, &temp);
+        return archive_volume_set_sync_mode(volume, temp);
+    }
+
+    else if (!strcmp("gzip-decoder", key)) {
+        serdec_yaml_deserialize_string(yaml, &temp);
+        return archive_volume_set_gzip_decoder(volume, temp);
+    }
+
+    else if (!strcmp("transport", key)) {
+        serdec_yaml_deserialize_string(yaml, &temp);
+        return archive_volume_set_transport(volume, temp);
+    }
+
+    else if (!strcmp("helper-image", key)) {
+        int result = serdec_yaml_deserialize_string(yaml, &temp);
+        free(volume->helper_image);
+        volume->helper_image = strdup(temp);
+        return result;
+    }
+
     else {
         int result = serdec_yaml_deserialize_string(yaml, &temp);
         FileHashType hash_type = file_hash_type_from_string(key);
@@ -108,6 +332,9 @@ int archive_volume_deserialize_yaml(SerdecYamlDeserializer* yaml,
 void archive_volume_release(ArchiveVolume* volume) {
     free(volume->name);
     free(volume->url);
+    free(volume->include);
+    free(volume->exclude);
+    free(volume->helper_image);
     if (NULL != volume->hash) {
         file_hash_free(volume->hash);
     }
@@ -0,0 +1,765 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            layer.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Reading and extracting chains of layer archives
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <archive.h>
+#include <archive_entry.h>
+#include <glib-2.0/glib.h>
+
+#include <volumetric/archive.h>
+#include <volumetric/directory.h>
+#include <volumetric/file.h>
+#include <volumetric/hash.h>
+#include <volumetric/path-filter.h>
+
+#include "layer.h"
+
+const char* ARCHIVE_LAYER_ENTRY = "./.volumetric-layer";
+const char* ARCHIVE_LAYER_WHITEOUT_PREFIX = ".wh.";
+
+// The layer entry is a few short lines. Anything larger isn't one.
+static const size_t LAYER_ENTRY_MAX_SIZE = 4096;
+
+typedef struct ArchiveLayer {
+    char* path;
+    FileContents file; // Unused if the contents were handed to the chain
+    const FileContents* contents;
+    FileHash* hash; // Recorded by the child, NULL for the top of the chain
+} ArchiveLayer;
+
+struct ArchiveLayerChain {
+    GPtrArray* layers; // Base first
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static void layer_free(gpointer data) {
+    ArchiveLayer* layer = (ArchiveLayer*)data;
+    if (&layer->file == layer->contents) {
+        file_contents_release(&layer->file);
+    }
+    if (NULL != layer->hash) {
+        file_hash_free(layer->hash);
+    }
+    g_free(layer->path);
+    free(layer);
+}
+
+static ArchiveLayer* layer_new(const char* path) {
+    ArchiveLayer* layer = malloc(sizeof(ArchiveLayer));
+    assert(NULL != layer);
+    memset(layer, 0, sizeof(*layer));
+    layer->path = g_strdup(path);
+    return layer;
+}
+
+static int layer_map(ArchiveLayer* layer) {
+    struct stat layer_stat = {0};
+    if (0 != stat(layer->path, &layer_stat)) {
+        int result = -errno;
+        fprintf(stderr, "Couldn't open archive %s: %s\n", layer->path,
+                strerror(errno));
+        return result;
+    }
+
+    file_contents_init(&layer->file, layer->path);
+    layer->contents = &layer->file;
+    return 0;
+}
+
+static struct archive* layer_reader_open(const ArchiveLayer* layer) {
+    struct archive* reader = archive_read_new();
+    archive_read_support_filter_all(reader);
+    archive_read_support_format_all(reader);
+    if (ARCHIVE_OK != archive_read_open_memory(reader,
+                                               layer->contents->contents,
+                                               layer->contents->size)) {
+        fprintf(stderr, "%s: %s\n", layer->path, archive_error_string(reader));
+        archive_read_free(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+// Path of an entry relative to the root of the tree, without any leading
+// "./" or trailing slashes. The root itself is "". Free with g_free().
+static char* layer_entry_path(const char* pathname) {
+    for (;;) {
+        if ('/' == pathname[0]) {
+            pathname += 1;
+        } else if ('.' == pathname[0] && '/' == pathname[1]) {
+            pathname += 2;
+        } else if ('.' == pathname[0] && '\0' == pathname[1]) {
+            pathname += 1;
+        } else {
+            break;
+        }
+    }
+
+    char* path = g_strdup(pathname);
+    size_t length = strlen(path);
+    while (0 < length && '/' == path[length - 1]) {
+        path[--length] = '\0';
+    }
+    return path;
+}
+
+static bool layer_is_layer_entry(const char* path) {
+    return !strcmp(path, ARCHIVE_LAYER_ENTRY + strlen("./"));
+}
+
+// The path removed by the whiteout at <path>, or NULL if it isn't one. Free
+// with g_free().
+static char* layer_whiteout_target(const char* path) {
+    const char* separator = strrchr(path, '/');
+    const char* name = NULL != separator ? separator + 1 : path;
+    size_t prefix_length = strlen(ARCHIVE_LAYER_WHITEOUT_PREFIX);
+    if (strncmp(name, ARCHIVE_LAYER_WHITEOUT_PREFIX, prefix_length) ||
+        '\0' == name[prefix_length]) {
+        return NULL;
+    }
+
+    return g_strdup_printf("%.*s%s", (int)(name - path), path,
+                           name + prefix_length);
+}
+
+// Whiteouts only ever remove paths within the tree.
+static bool layer_path_is_contained(const char* path) {
+    char** components = g_strsplit(path, "/", -1);
+    bool contained = true;
+    for (char** component = components; NULL != *component; ++component) {
+        if (!strcmp(".", *component) || !strcmp("..", *component)) {
+            contained = false;
+        }
+    }
+    g_strfreev(components);
+    return contained;
+}
+
+// Read the parent named by the layer entry of <layer>. <parent> is set to
+// NULL if the archive isn't a layer.
+static int layer_read_parent(const ArchiveLayer* layer, char** parent,
+                             FileHash** hash) {
+    *parent = NULL;
+    *hash = NULL;
+    struct archive* reader = layer_reader_open(layer);
+    if (NULL == reader) {
+        return -EIO;
+    }
+
+    struct archive_entry* entry = NULL;
+    int status = archive_read_next_header(reader, &entry);
+    if (ARCHIVE_EOF == status) {
+        archive_read_free(reader);
+        return 0;
+    } else if (ARCHIVE_WARN > status) {
+        fprintf(stderr, "%s: %s\n", layer->path, archive_error_string(reader));
+        archive_read_free(reader);
+        return -EIO;
+    }
+
+    char* path = layer_entry_path(archive_entry_pathname(entry));
+    bool is_layer = layer_is_layer_entry(path);
+    g_free(path);
+    if (!is_layer) {
+        archive_read_free(reader);
+        return 0;
+    }
+
+    char contents[LAYER_ENTRY_MAX_SIZE + 1];
+    la_ssize_t length =
+        archive_read_data(reader, contents, LAYER_ENTRY_MAX_SIZE);
+    archive_read_free(reader);
+    if (0 > length) {
+        fprintf(stderr, "%s: Couldn't read layer entry\n", layer->path);
+        return -EIO;
+    }
+    contents[length] = '\0';
+
+    char** lines = g_strsplit(contents, "\n", -1);
+    for (char** line = lines; NULL != *line; ++line) {
+        char* value = strchr(*line, ' ');
+        if (NULL == value) {
+            continue;
+        }
+
+        *value++ = '\0';
+        if (!strcmp("parent", *line)) {
+            g_free(*parent);
+            *parent = g_strdup(value);
+            continue;
+        }
+
+        FileHashType hash_type = file_hash_type_from_string(*line);
+        if (FILE_HASH_TYPE_INVALID != hash_type && NULL == *hash) {
+            *hash = file_hash_from_string(hash_type, value);
+        }
+    }
+    g_strfreev(lines);
+
+    // The parent is always next to its layer.
+    if (NULL == *parent || NULL == *hash || '\0' == (*parent)[0] ||
+        NULL != strchr(*parent, '/')) {
+        fprintf(stderr, "%s: Malformed layer entry\n", layer->path);
+        g_free(*parent);
+        *parent = NULL;
+        if (NULL != *hash) {
+            file_hash_free(*hash);
+            *hash = NULL;
+        }
+        return -EINVAL;
+    }
+    return 0;
+}
+
+static int layer_verify(const ArchiveLayer* layer, const FileHash* expected) {
+    FileHash* hash =
+        file_hash_of_buffer(expected->hash_type, layer->contents->contents,
+                            layer->contents->size);
+    int result = 0;
+    if (!file_hash_equal(expected, hash)) {
+        char* expected_string = file_hash_to_string(expected);
+        char* got_string = file_hash_to_string(hash);
+        fprintf(stderr,
+                "Error: %s hash mismatch for file %s.\n"
+                "Expected:\n"
+                "    %s\n"
+                "Got:\n"
+                "    %s\n",
+                file_hash_type_to_string(expected->hash_type), layer->path,
+                expected_string, got_string);
+        free(expected_string);
+        free(got_string);
+        result = -EINVAL;
+    }
+    file_hash_free(hash);
+    return result;
+}
+
+// Remove whatever is at <path> underneath <location>.
+static int layer_remove_path(const char* location, const char* path,
+                             ArchiveExtractStats* stats) {
+    char* full_path = g_build_filename(location, path, NULL);
+    struct stat path_stat = {0};
+    if (0 != lstat(full_path, &path_stat)) {
+        // Paths left out by the filter were never written.
+        int result = ENOENT == errno ? 0 : -errno;
+        g_free(full_path);
+        return result;
+    }
+
+    int result = 0;
+    if (S_ISDIR(path_stat.st_mode)) {
+        result = directory_remove_recursive(full_path);
+    } else if (0 != unlink(full_path)) {
+        result = -errno;
+    }
+
+    if (0 != result) {
+        fprintf(stderr, "Couldn't remove %s: %s\n", full_path,
+                strerror(-result));
+    } else if (NULL != stats) {
+        ++stats->files_removed;
+    }
+    g_free(full_path);
+    return result;
+}
+
+// Write the current entry of <reader>, whose path relative to the root of the
+// tree is <path>, underneath <location>.
+static int layer_write_entry(struct archive* reader, struct archive* extractor,
+                             struct archive_entry* entry,
+                             const char* location, const char* path) {
+    char* full_path = g_build_filename(location, path, NULL);
+    archive_entry_set_pathname(entry, full_path);
+    g_free(full_path);
+    const char* hardlink = archive_entry_hardlink(entry);
+    if (NULL != hardlink) {
+        char* target = layer_entry_path(hardlink);
+        char* full_target = g_build_filename(location, target, NULL);
+        archive_entry_set_hardlink(entry, full_target);
+        g_free(full_target);
+        g_free(target);
+    }
+
+    int status = archive_write_header(extractor, entry);
+    if (ARCHIVE_OK > status) {
+        fprintf(stderr, "%s\n", archive_error_string(extractor));
+    }
+    if (ARCHIVE_WARN > status) {
+        return -EIO;
+    }
+
+    const void* block = NULL;
+    size_t size = 0;
+    la_int64_t offset = 0;
+    while (ARCHIVE_OK == (status = archive_read_data_block(reader, &block,
+                                                           &size, &offset))) {
+        if (ARCHIVE_OK >
+            archive_write_data_block(extractor, block, size, offset)) {
+            fprintf(stderr, "%s\n", archive_error_string(extractor));
+            return -EIO;
+        }
+    }
+    if (ARCHIVE_EOF != status) {
+        fprintf(stderr, "%s\n", archive_error_string(reader));
+        return -EIO;
+    }
+
+    status = archive_write_finish_entry(extractor);
+    if (ARCHIVE_OK > status) {
+        fprintf(stderr, "%s\n", archive_error_string(extractor));
+    }
+    return ARCHIVE_WARN > status ? -EIO : 0;
+}
+
+// Apply the whiteouts and entries of <layer> to the tree at <location>.
+static int layer_apply(const ArchiveLayer* layer, const char* location,
+                       const PathFilter* filter, ArchiveExtractStats* stats) {
+    struct archive* reader = layer_reader_open(layer);
+    if (NULL == reader) {
+        return -EIO;
+    }
+
+    // Files are unlinked before they're replaced, since they may be hard
+    // links to the extract cache.
+    struct archive* extractor = archive_write_disk_new();
+    archive_write_disk_set_options(
+        extractor, ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM |
+                       ARCHIVE_EXTRACT_ACL | ARCHIVE_EXTRACT_FFLAGS |
+                       ARCHIVE_EXTRACT_OWNER | ARCHIVE_EXTRACT_UNLINK);
+    archive_write_disk_set_standard_lookup(extractor);
+
+    struct archive_entry* entry = NULL;
+    int status = ARCHIVE_OK;
+    int result = 0;
+    while (0 == result &&
+           ARCHIVE_OK == (status = archive_read_next_header(reader, &entry))) {
+        char* path = layer_entry_path(archive_entry_pathname(entry));
+        char* target = layer_whiteout_target(path);
+        if ('\0' == path[0] || layer_is_layer_entry(path)) {
+            // The root of the tree is never committed to a layer.
+        } else if (NULL != target && layer_path_is_contained(target)) {
+            result = layer_remove_path(location, target, stats);
+        } else if (NULL == target &&
+                   (NULL == filter ||
+                    path_filter_selects(
+                        filter, archive_entry_pathname(entry),
+                        AE_IFDIR == archive_entry_filetype(entry)))) {
+            result =
+                layer_write_entry(reader, extractor, entry, location, path);
+            if (0 == result && NULL != stats) {
+                ++stats->entries_written;
+            }
+        }
+        g_free(target);
+        g_free(path);
+    }
+
+    if (0 == result && ARCHIVE_EOF != status) {
+        fprintf(stderr, "%s: %s\n", layer->path, archive_error_string(reader));
+        result = -EIO;
+    }
+
+    // Directory timestamps are restored once nothing more is written to them
+    if (ARCHIVE_OK != archive_write_close(extractor) && 0 == result) {
+        fprintf(stderr, "%s\n", archive_error_string(extractor));
+        result = -EIO;
+    }
+    archive_write_free(extractor);
+    archive_read_free(reader);
+    return result;
+}
+
+static gboolean layer_path_is_beneath(gpointer key, gpointer value,
+                                      gpointer user_data) {
+    const char* path = (const char*)key;
+    const char* directory = (const char*)user_data;
+    size_t length = strlen(directory);
+    return !strncmp(path, directory, length) && '/' == path[length];
+}
+
+// Whether <path>, or any directory above it, is in <paths>.
+static bool layer_path_is_hidden(GHashTable* paths, const char* path) {
+    if (0 == g_hash_table_size(paths)) {
+        return false;
+    }
+
+    char* ancestor = g_strdup(path);
+    bool hidden = false;
+    for (;;) {
+        if (g_hash_table_contains(paths, ancestor)) {
+            hidden = true;
+            break;
+        }
+
+        char* separator = strrchr(ancestor, '/');
+        if (NULL == separator) {
+            break;
+        }
+        *separator = '\0';
+    }
+    g_free(ancestor);
+    return hidden;
+}
+
+// Read the entries of <layer> into <entries>. See
+// archive_layer_chain_get_entries().
+static int layer_read_entries(const ArchiveLayer* layer, GHashTable* entries,
+                              const PathFilter* filter) {
+    struct archive* reader = layer_reader_open(layer);
+    if (NULL == reader) {
+        return -EIO;
+    }
+
+    struct archive_entry* entry = NULL;
+    int status = ARCHIVE_OK;
+    while (ARCHIVE_OK == (status = archive_read_next_header(reader, &entry))) {
+        char* path = layer_entry_path(archive_entry_pathname(entry));
+        char* target = layer_whiteout_target(path);
+        if ('\0' == path[0] || layer_is_layer_entry(path)) {
+            g_free(path);
+        } else if (NULL != target) {
+            g_hash_table_remove(entries, target);
+            g_hash_table_foreach_remove(entries, layer_path_is_beneath,
+                                        target);
+            g_free(path);
+        } else if (NULL == filter ||
+                   path_filter_selects(
+                       filter, archive_entry_pathname(entry),
+                       AE_IFDIR == archive_entry_filetype(entry))) {
+            struct stat* entry_stat = g_new(struct stat, 1);
+            *entry_stat = *archive_entry_stat(entry);
+            g_hash_table_replace(entries, path, entry_stat);
+        } else {
+            g_free(path);
+        }
+        g_free(target);
+    }
+
+    int result = 0;
+    if (ARCHIVE_EOF != status) {
+        fprintf(stderr, "%s: %s\n", layer->path, archive_error_string(reader));
+        result = -EIO;
+    }
+    archive_read_free(reader);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+int archive_layer_chain_open(const char* url, const FileContents* top,
+                             ArchiveLayerChain** chain) {
+    ArchiveLayerChain* new_chain = malloc(sizeof(ArchiveLayerChain));
+    assert(NULL != new_chain);
+    new_chain->layers = g_ptr_array_new_with_free_func(layer_free);
+
+    ArchiveLayer* layer = layer_new(url);
+    int result = 0;
+    if (NULL != top) {
+        layer->contents = top;
+    } else {
+        result = layer_map(layer);
+    }
+
+    // The chain is read from the top down.
+    while (0 == result) {
+        g_ptr_array_add(new_chain->layers, layer);
+        char* parent = NULL;
+        FileHash* hash = NULL;
+        result = layer_read_parent(layer, &parent, &hash);
+        if (0 != result || NULL == parent) {
+            layer = NULL;
+            break;
+        }
+
+        char* directory = g_path_get_dirname(layer->path);
+        char* path = g_build_filename(directory, parent, NULL);
+        g_free(directory);
+        g_free(parent);
+        for (guint i = 0; i < new_chain->layers->len; ++i) {
+            ArchiveLayer* child = new_chain->layers->pdata[i];
+            if (!strcmp(path, child->path)) {
+                fprintf(stderr, "%s: Layer is its own ancestor\n", path);
+                result = -ELOOP;
+            }
+        }
+
+        layer = layer_new(path);
+        layer->hash = hash;
+        g_free(path);
+        if (0 == result) {
+            result = layer_map(layer);
+        }
+    }
+
+    if (0 != result) {
+        if (NULL != layer) {
+            layer_free(layer);
+        }
+        archive_layer_chain_free(new_chain);
+        return result;
+    }
+
+    // Base first, from here on.
+    GPtrArray* layers = new_chain->layers;
+    for (guint i = 0; i < layers->len / 2; ++i) {
+        gpointer swap = layers->pdata[i];
+        layers->pdata[i] = layers->pdata[layers->len - 1 - i];
+        layers->pdata[layers->len - 1 - i] = swap;
+    }
+    *chain = new_chain;
+    return 0;
+}
+
+void archive_layer_chain_free(ArchiveLayerChain* chain) {
+    g_ptr_array_unref(chain->layers);
+    free(chain);
+}
+
+size_t archive_layer_chain_get_length(const ArchiveLayerChain* chain) {
+    return chain->layers->len;
+}
+
+uint64_t archive_layer_chain_get_size(const ArchiveLayerChain* chain) {
+    uint64_t size = 0;
+    for (guint i = 0; i < chain->layers->len; ++i) {
+        const ArchiveLayer* layer = chain->layers->pdata[i];
+        size += layer->contents->size;
+    }
+    return size;
+}
+
+int archive_layer_chain_verify(const ArchiveLayerChain* chain,
+                               const FileHash* hash) {
+    GPtrArray* layers = chain->layers;
+    int result = 0;
+    for (guint i = 0; i < layers->len && 0 == result; ++i) {
+        const ArchiveLayer* layer = layers->pdata[i];
+        const FileHash* expected = i + 1 < layers->len ? layer->hash : hash;
+        if (NULL != expected) {
+            result = layer_verify(layer, expected);
+        }
+    }
+    return result;
+}
+
+int archive_layer_chain_extract(const ArchiveLayerChain* chain,
+                                const char* location,
+                                const ArchiveExtractOptions* options) {
+    static const ArchiveExtractOptions default_options = {0};
+    if (NULL == options) {
+        options = &default_options;
+    }
+
+    // The layers are small, so only the base is worth verifying while it's
+    // extracted.
+    GPtrArray* layers = chain->layers;
+    const ArchiveLayer* base = layers->pdata[0];
+    ArchiveExtractOptions base_options = *options;
+    int result = 0;
+    if (NULL != options->expected_hash) {
+        for (guint i = 1; i < layers->len && 0 == result; ++i) {
+            const ArchiveLayer* layer = layers->pdata[i];
+            result = layer_verify(layer, i + 1 < layers->len
+                                             ? layer->hash
+                                             : options->expected_hash);
+        }
+        if (1 < layers->len) {
+            base_options.expected_hash = base->hash;
+        }
+    } else {
+        result = archive_layer_chain_verify(chain, NULL);
+    }
+
+    if (0 == result) {
+        result = archive_extract_to_disk(base->contents, location,
+                                         &base_options);
+    }
+    for (guint i = 1; i < layers->len && 0 == result; ++i) {
+        result =
+            layer_apply(layers->pdata[i], location, options->filter,
+                        options->stats);
+    }
+
+    if (0 == result && options->durable && 1 < layers->len) {
+        gint64 start = g_get_monotonic_time();
+        result = directory_sync_filesystem(location);
+        if (NULL != options->stats) {
+            options->stats->sync_microseconds +=
+                g_get_monotonic_time() - start;
+        }
+    }
+    return result;
+}
+
+GHashTable* archive_layer_chain_get_entries(const ArchiveLayerChain* chain,
+                                            const PathFilter* filter) {
+    GHashTable* entries =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    for (guint i = 0; i < chain->layers->len; ++i) {
+        if (0 != layer_read_entries(chain->layers->pdata[i], entries,
+                                    filter)) {
+            g_hash_table_unref(entries);
+            return NULL;
+        }
+    }
+    return entries;
+}
+
+int archive_layer_chain_merge(const ArchiveLayerChain* chain,
+                              ArchiveLayerVisit visit, void* user_data) {
+    // First, find the layer each path of the layers is taken from, and the
+    // paths removed from the base, from the top down. The whiteouts of a
+    // layer only remove paths from the layers beneath it.
+    GPtrArray* layers = chain->layers;
+    GHashTable* owners =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    GHashTable* hidden =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    GPtrArray* whiteouts = g_ptr_array_new();
+    int result = 0;
+    for (guint i = layers->len - 1; 0 < i && 0 == result; --i) {
+        const ArchiveLayer* layer = layers->pdata[i];
+        struct archive* reader = layer_reader_open(layer);
+        if (NULL == reader) {
+            result = -EIO;
+            break;
+        }
+
+        struct archive_entry* entry = NULL;
+        int status = ARCHIVE_OK;
+        while (ARCHIVE_OK ==
+               (status = archive_read_next_header(reader, &entry))) {
+            char* path = layer_entry_path(archive_entry_pathname(entry));
+            char* target = layer_whiteout_target(path);
+            if (NULL != target) {
+                g_ptr_array_add(whiteouts, target);
+                g_free(path);
+            } else if ('\0' == path[0] || layer_is_layer_entry(path) ||
+                       g_hash_table_contains(owners, path) ||
+                       layer_path_is_hidden(hidden, path)) {
+                g_free(path);
+            } else {
+                g_hash_table_insert(owners, path, GUINT_TO_POINTER(i));
+            }
+        }
+        if (ARCHIVE_EOF != status) {
+            fprintf(stderr, "%s: %s\n", layer->path,
+                    archive_error_string(reader));
+            result = -EIO;
+        }
+        archive_read_free(reader);
+
+        for (guint j = 0; j < whiteouts->len; ++j) {
+            g_hash_table_add(hidden, whiteouts->pdata[j]);
+        }
+        g_ptr_array_set_size(whiteouts, 0);
+    }
+    g_ptr_array_unref(whiteouts);
+
+    // Then, visit the entries which make up the tree, from the base up.
+    for (guint i = 0; i < layers->len && 0 == result; ++i) {
+        const ArchiveLayer* layer = layers->pdata[i];
+        struct archive* reader = layer_reader_open(layer);
+        if (NULL == reader) {
+            result = -EIO;
+            break;
+        }
+
+        struct archive_entry* entry = NULL;
+        int status = ARCHIVE_OK;
+        while (0 == result &&
+               ARCHIVE_OK ==
+                   (status = archive_read_next_header(reader, &entry))) {
+            char* path = layer_entry_path(archive_entry_pathname(entry));
+            bool visible = false;
+            if (0 == i) {
+                visible = !g_hash_table_contains(owners, path) &&
+                          !layer_path_is_hidden(hidden, path);
+            } else {
+                visible = i == GPOINTER_TO_UINT(
+                                   g_hash_table_lookup(owners, path));
+            }
+            g_free(path);
+            if (visible) {
+                result = visit(user_data, reader, entry);
+            }
+        }
+        if (0 == result && ARCHIVE_EOF != status) {
+            fprintf(stderr, "%s: %s\n", layer->path,
+                    archive_error_string(reader));
+            result = -EIO;
+        }
+        archive_read_free(reader);
+    }
+
+    g_hash_table_unref(owners);
+    g_hash_table_unref(hidden);
+    return result;
+}
+
+char* archive_layer_format_entry(const char* parent_name,
+                                 const FileHash* parent_hash) {
+    char* hash = file_hash_to_string(parent_hash);
+    char* contents = g_strdup_printf(
+        "parent %s\n%s %s\n", parent_name,
+        file_hash_type_to_string(parent_hash->hash_type), hash);
+    free(hash);
+    return contents;
+}
+
+char* archive_layer_get_whiteout(const char* archive_path) {
+    char* path = layer_entry_path(archive_path);
+    const char* separator = strrchr(path, '/');
+    char* whiteout = NULL;
+    if (NULL != separator) {
+        whiteout = g_strdup_printf("./%.*s/%s%s", (int)(separator - path),
+                                   path, ARCHIVE_LAYER_WHITEOUT_PREFIX,
+                                   separator + 1);
+    } else {
+        whiteout =
+            g_strdup_printf("./%s%s", ARCHIVE_LAYER_WHITEOUT_PREFIX, path);
+    }
+    g_free(path);
+    return whiteout;
+}
+
+///////////////////////////////////////////////////////////////////////////////
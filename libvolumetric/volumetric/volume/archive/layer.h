@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            layer.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Incremental commits, as chains of layer archives
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#ifndef VOLUMETRIC_LAYER_H
+#define VOLUMETRIC_LAYER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct archive;
+struct archive_entry;
+typedef struct ArchiveExtractOptions ArchiveExtractOptions;
+typedef struct FileContents FileContents;
+typedef struct FileHash FileHash;
+typedef struct PathFilter PathFilter;
+typedef struct _GHashTable GHashTable;
+
+// An incremental commit (see ArchiveCommitMode) writes a layer: an archive
+// holding only the entries which were added or modified since its parent, the
+// archive the volume was committed to before. A layer starts with an entry
+// named ARCHIVE_LAYER_ENTRY, whose contents look like this:
+//  parent <file name of the parent, in the same directory as the layer>
+//  <hash type, e.g. md5> <hash of the parent>
+// Whiteouts follow, which are empty entries named ".wh.<name>", next to the
+// path of the parent they remove from the tree. The changed entries come
+// last. A chain of layers ends in a base, which is a regular archive.
+extern const char* ARCHIVE_LAYER_ENTRY;
+extern const char* ARCHIVE_LAYER_WHITEOUT_PREFIX;
+
+typedef struct ArchiveLayerChain ArchiveLayerChain;
+
+// Open the archive at <url>, and the chain of parents beneath it, if it's a
+// layer. An archive which isn't a layer is a chain of one. If <top> isn't
+// NULL, it holds the contents of <url>, and must outlive the chain. Returns 0
+// on success, or a negative errno.
+int archive_layer_chain_open(const char* url, const FileContents* top,
+                             ArchiveLayerChain** chain);
+void archive_layer_chain_free(ArchiveLayerChain* chain);
+
+// Number of archives in the chain, including the base.
+size_t archive_layer_chain_get_length(const ArchiveLayerChain* chain);
+
+// Combined size of the archives in the chain, in bytes.
+uint64_t archive_layer_chain_get_size(const ArchiveLayerChain* chain);
+
+// Check that every parent in the chain matches the hash its child recorded
+// for it, and that the top matches <hash>, if it's not NULL. Returns 0 on
+// success, or -EINVAL.
+int archive_layer_chain_verify(const ArchiveLayerChain* chain,
+                               const FileHash* hash);
+
+// Extract the base to <location>, according to <options> (which may be
+// NULL), and then apply each layer on top of it, in order. If the expected
+// hash in <options> is set, it belongs to the top of the chain, and the base
+// is verified as it's extracted. Otherwise, the chain is verified before
+// anything is written. Returns 0 on success, or a negative errno.
+int archive_layer_chain_extract(const ArchiveLayerChain* chain,
+                                const char* location,
+                                const ArchiveExtractOptions* options);
+
+// The entries of the tree the chain checks out, keyed by their path relative
+// to its root (e.g. "etc/hosts"), with their struct stat as values. Entries
+// which aren't selected by <filter> (if it's not NULL) are left out. Returns
+// NULL if an archive can't be read. Free with g_hash_table_unref().
+GHashTable* archive_layer_chain_get_entries(const ArchiveLayerChain* chain,
+                                            const PathFilter* filter);
+
+// Called for the entries of the tree the chain checks out, read from
+// <reader>. Returns 0 to continue, or a negative errno to stop.
+typedef int (*ArchiveLayerVisit)(void* user_data, struct archive* reader,
+                                 struct archive_entry* entry);
+
+// Visit the entries of the tree the chain checks out, as one archive would
+// hold them: those of the base first, in order, followed by those added by
+// each layer. Returns 0 on success, or a negative errno.
+int archive_layer_chain_merge(const ArchiveLayerChain* chain,
+                              ArchiveLayerVisit visit, void* user_data);
+
+// Contents of ARCHIVE_LAYER_ENTRY for a layer on top of the archive
+// <parent_name>, with hash <parent_hash>. Must be free'd with g_free().
+char* archive_layer_format_entry(const char* parent_name,
+                                 const FileHash* parent_hash);
+
+// Name of the whiteout entry removing the entry <archive_path> (e.g.
+// "./etc/hosts"). Must be free'd with g_free().
+char* archive_layer_get_whiteout(const char* archive_path);
+
+#endif // VOLUMETRIC_LAYER_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,294 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            lazy.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Lazy checkouts, published before they're extracted
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+// For pipe2 and POSIX_SPAWN_SETSID
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <spawn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <glib-2.0/glib.h>
+
+#include <volumetric/directory.h>
+#include <volumetric/extract-cache.h>
+#include <volumetric/file.h>
+#include <volumetric/hash.h>
+#include <volumetric/lazy-archive.h>
+#include <volumetric/seekable-zstd.h>
+#include <volumetric/volume/archive.h>
+
+#include "config.h"
+#include "layer.h"
+#include "lazy.h"
+#include "overlay.h"
+
+extern char** environ;
+
+// The descriptor volumetric-lazy reports on, once the tree is published
+static const int READY_FD = 3;
+static const long FUSE_SUPER_MAGIC = 0x65735546;
+
+typedef struct LazyServer {
+    ArchiveVolume* config;
+    char* staging;
+    char* mountpoint;
+    bool inserted;
+} LazyServer;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+// Once the whole archive is extracted, the volume no longer needs the
+// filesystem.
+static void complete_volume(LazyArchive* lazy, void* user_data) {
+    LazyServer* server = user_data;
+    ArchiveVolume* config = server->config;
+    int result = 0;
+    if (ARCHIVE_SYNC_DURABLE == config->sync) {
+        result = directory_sync_filesystem(server->staging);
+    }
+    if (0 != result) {
+        fprintf(stderr, "%s: Couldn't sync the extracted archive: %s\n",
+                config->name, strerror(-result));
+        return;
+    }
+
+    server->inserted = true;
+    ExtractCacheEntry* entry =
+        extract_cache_insert(config->cache, config->hash, server->staging);
+    if (NULL == entry) {
+        fprintf(stderr, "%s: Couldn't add the archive to the extract cache\n",
+                config->name);
+        return;
+    }
+
+    // Containers started from now on use the cache entry, unless the volume
+    // has been checked out again in the meantime.
+    char* lower =
+        archive_overlay_get_path(config->name, ARCHIVE_OVERLAY_LOWER);
+    char target[PATH_MAX] = {0};
+    ssize_t length = readlink(lower, target, sizeof(target) - 1);
+    if (0 < length && !strcmp(server->mountpoint, target)) {
+        result = extract_cache_entry_pin(entry, config->name);
+        if (0 == result) {
+            result = archive_overlay_set_lower(
+                config->name, extract_cache_entry_get_tree(entry));
+        }
+    }
+    g_free(lower);
+    extract_cache_entry_close(entry);
+    if (0 != result) {
+        fprintf(stderr, "%s: Couldn't switch to the extracted archive: %s\n",
+                config->name, strerror(-result));
+        return;
+    }
+
+    printf("%s: Archive is extracted; detaching the lazy filesystem\n",
+           config->name);
+    lazy_archive_detach(lazy);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+int archive_lazy_start(ArchiveVolume* config, const FileContents* file) {
+    SeekableIndex* index = seekable_index_read(file->contents, file->size);
+    if (NULL == index) {
+        return -ENOTSUP;
+    }
+    seekable_index_free(index);
+
+    // The filesystem only serves the entries of a single archive.
+    ArchiveLayerChain* chain = NULL;
+    int result = archive_layer_chain_open(config->url, file, &chain);
+    if (0 != result) {
+        return result;
+    }
+    size_t layers = archive_layer_chain_get_length(chain);
+    archive_layer_chain_free(chain);
+    if (1 < layers) {
+        return -ENOTSUP;
+    }
+
+    int fds[2] = {0};
+    if (0 != pipe2(fds, O_CLOEXEC)) {
+        return -errno;
+    }
+
+    char* ready_fd = g_strdup_printf("%d", READY_FD);
+    char* hash = file_hash_to_string(config->hash);
+    char* argv[] = {
+        (char*)CONFIG_LAZY_PROGRAM,
+        "--ready-fd",
+        ready_fd,
+        "--extract-cache",
+        (char*)extract_cache_get_directory(config->cache),
+        "--sync",
+        ARCHIVE_SYNC_DURABLE == config->sync ? "durable" : "none",
+        config->name,
+        config->url,
+        (char*)file_hash_type_to_string(config->hash->hash_type),
+        hash,
+        NULL,
+    };
+
+    // The server outlives this process, and mustn't get its signals.
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], READY_FD);
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSID);
+    pid_t pid = 0;
+    printf("%s: Publishing the archive through a lazy filesystem\n",
+           config->name);
+    result = -posix_spawn(&pid, CONFIG_LAZY_PROGRAM, &actions,
+                              &attributes, argv, environ);
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    g_free(ready_fd);
+    free(hash);
+
+    char ready = 0;
+    ssize_t length = 0;
+    do {
+        length = read(fds[0], &ready, 1);
+    } while (0 > length && EINTR == errno);
+    close(fds[0]);
+    if (0 == result && 1 != length) {
+        // The server exited without publishing the tree.
+        waitpid(pid, NULL, 0);
+        result = -EIO;
+    }
+    return result;
+}
+
+bool archive_lazy_is_published(ArchiveVolume* config) {
+    char* lower =
+        archive_overlay_get_path(config->name, ARCHIVE_OVERLAY_LOWER);
+    char* mountpoint =
+        archive_overlay_get_path(config->name, ARCHIVE_OVERLAY_LAZY);
+    char target[PATH_MAX] = {0};
+    ssize_t length = readlink(lower, target, sizeof(target) - 1);
+    struct stat target_stat = {0};
+    struct statfs filesystem = {0};
+
+    // Without its server, the mountpoint is either empty, or disconnected.
+    bool published = false;
+    if (0 < length && !strcmp(mountpoint, target)) {
+        published = 0 == statfs(mountpoint, &filesystem) &&
+                    FUSE_SUPER_MAGIC == filesystem.f_type;
+    } else if (0 < length) {
+        published = 0 == stat(target, &target_stat);
+    }
+    g_free(lower);
+    g_free(mountpoint);
+    return published;
+}
+
+int archive_volume_serve_lazy(ArchiveVolume* config, int ready_fd) {
+    FileContents file = {0};
+    file_contents_init(&file, config->url);
+    char* staging = NULL;
+    LazyArchive* lazy = NULL;
+    if (NULL != file.contents) {
+        staging = extract_cache_stage(config->cache);
+    }
+    if (NULL != staging) {
+        lazy = lazy_archive_new(file.contents, file.size, staging);
+    }
+
+    int result = 0;
+    char* mountpoint =
+        archive_overlay_get_path(config->name, ARCHIVE_OVERLAY_LAZY);
+    if (NULL == lazy) {
+        fprintf(stderr, "%s: Couldn't read the tree of archive %s\n",
+                config->name, config->url);
+        result = -EINVAL;
+    } else {
+        // A filesystem left behind by an earlier server is replaced.
+        umount2(mountpoint, MNT_DETACH);
+        if (0 != g_mkdir_with_parents(mountpoint, 0700)) {
+            result = -errno;
+        }
+    }
+
+    LazyServer server = {
+        .config = config,
+        .staging = staging,
+        .mountpoint = mountpoint,
+    };
+    if (0 == result) {
+        result =
+            lazy_archive_start(lazy, mountpoint, complete_volume, &server);
+    }
+    if (0 == result) {
+        printf("%s: Published archive %s at %s\n", config->name, config->url,
+               mountpoint);
+        fflush(stdout);
+        char ready = 1;
+        if (1 != write(ready_fd, &ready, 1)) {
+            result = -errno;
+            lazy_archive_detach(lazy);
+        }
+    } else {
+        fprintf(stderr, "%s: Couldn't publish the archive: %s\n",
+                config->name, strerror(-result));
+    }
+    close(ready_fd);
+
+    // The filesystem is served until it's detached, and no longer used.
+    if (NULL != lazy) {
+        int completed = lazy_archive_wait(lazy);
+        result = 0 == result ? completed : result;
+        lazy_archive_free(lazy);
+    }
+    if (NULL != staging && !server.inserted) {
+        extract_cache_discard(config->cache, staging);
+    }
+    free(staging);
+    g_free(mountpoint);
+    file_contents_release(&file);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            lazy.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Lazy checkouts, published before they're extracted
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#ifndef VOLUMETRIC_LAZY_H
+#define VOLUMETRIC_LAZY_H
+
+#include <stdbool.h>
+
+typedef struct ArchiveVolume ArchiveVolume;
+typedef struct FileContents FileContents;
+
+// The lower layer of a lazily checked out volume is the tree of its archive,
+// published through a FUSE filesystem (see lazy-archive.h) at the volume's
+// lazy mountpoint, while the archive is extracted into the extract cache. The
+// filesystem is served by a volumetric-lazy process, which points the lower
+// layer at the cache entry once the extraction is complete, and exits once
+// the filesystem is no longer used.
+
+// Start serving the archive in <file> in a new process. Returns 0 once the
+// tree is published, -ENOTSUP if the archive isn't in the seekable format, or
+// is a layer (see layer.h), or another negative errno.
+int archive_lazy_start(ArchiveVolume* config, const FileContents* file);
+
+// Whether the lower layer of the volume can be reached. It can't after a
+// reboot, until the archive is published again.
+bool archive_lazy_is_published(ArchiveVolume* config);
+
+#endif // VOLUMETRIC_LAZY_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 //
 // CREATED:         12/30/2022
 //
-// LAST EDITED:	    01/07/2023
+// LAST EDITED:	    10/17/2026
 //
 ////
 // Copyright 2022, Ethan D. Twardy
@@ -28,17 +28,23 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <volumetric/archive.h>
+
 #include "lock-file.h"
 #include "config.h"
 
 static const char* VOLUMETRIC_LOCK_DIRECTORY = CONFIG_LOCK_PATH;
 static const char* VOLUMETRIC_LOCK_EXTENSION = ".lock";
+static const char* VOLUMETRIC_CHECKPOINT_EXTENSION = ".checkpoint";
+static const char* VOLUMETRIC_STAGE_EXTENSION = ".staged";
 
 typedef struct ArchiveLockFile {
     int fd;
@@ -51,10 +57,10 @@ static ArchiveLockFile* archive_lock_file_new() {
     return lock_file;
 }
 
-static char* archive_lock_file_get_path(const char* volume_name) {
+static char* archive_lock_file_get_path(const char* volume_name,
+                                        const char* extension) {
     size_t length = strlen(VOLUMETRIC_LOCK_DIRECTORY) + 1 +
-                    strlen(volume_name) + strlen(VOLUMETRIC_LOCK_EXTENSION) +
-                    1;
+                    strlen(volume_name) + strlen(extension) + 1;
     char* path = malloc(length);
     if (NULL == path) {
         return NULL;
@@ -64,17 +70,170 @@ static char* archive_lock_file_get_path(const char* volume_name) {
     strcat(path, VOLUMETRIC_LOCK_DIRECTORY);
     strcat(path, "/");
     strcat(path, volume_name);
-    strcat(path, VOLUMETRIC_LOCK_EXTENSION);
+    strcat(path, extension);
     return path;
 }
 
+// Write the checkpoint file to <path>. The pathname of the last entry comes
+// last, since it may contain anything.
+static int archive_checkpoint_write(const char* path, const char* archive_path,
+                                    const struct stat* archive_stat,
+                                    const ArchiveCheckpoint* checkpoint) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (0 > fd) {
+        return -errno;
+    }
+
+    FILE* file = fdopen(fd, "w");
+    if (NULL == file) {
+        int result = -errno;
+        close(fd);
+        return result;
+    }
+
+    fprintf(file, "archive %s\n", archive_path);
+    fprintf(file, "size %jd\n", (intmax_t)archive_stat->st_size);
+    fprintf(file, "mtime %jd.%09ld\n", (intmax_t)archive_stat->st_mtim.tv_sec,
+            archive_stat->st_mtim.tv_nsec);
+    fprintf(file, "entries %ju\n", (uintmax_t)checkpoint->entries);
+    fprintf(file, "offset %jd\n", (intmax_t)checkpoint->offset);
+    fprintf(file, "pathname %s\n",
+            NULL != checkpoint->pathname ? checkpoint->pathname : "");
+
+    int result = 0 == fflush(file) && 0 == fsync(fd) ? 0 : -errno;
+    if (0 != fclose(file) && 0 == result) {
+        result = -errno;
+    }
+    return result;
+}
+
+static int archive_lock_directory_sync() {
+    int fd = open(VOLUMETRIC_LOCK_DIRECTORY, O_RDONLY | O_DIRECTORY);
+    if (0 > fd) {
+        return -errno;
+    }
+
+    int result = 0 == fsync(fd) ? 0 : -errno;
+    close(fd);
+    return result;
+}
+
+static int archive_checkpoint_save(const char* volume_name,
+                                   const char* extension,
+                                   const char* archive_path,
+                                   const ArchiveCheckpoint* checkpoint) {
+    struct stat archive_stat = {0};
+    if (0 != stat(archive_path, &archive_stat)) {
+        return -errno;
+    }
+
+    char* path = archive_lock_file_get_path(volume_name, extension);
+    char* temporary = archive_lock_file_get_path(volume_name, ".tmp~");
+    if (NULL == path || NULL == temporary) {
+        free(path);
+        free(temporary);
+        return -ENOMEM;
+    }
+
+    int result = archive_checkpoint_write(temporary, archive_path,
+                                          &archive_stat, checkpoint);
+    if (0 == result && 0 != rename(temporary, path)) {
+        result = -errno;
+    }
+    if (0 == result) {
+        result = archive_lock_directory_sync();
+    } else {
+        unlink(temporary);
+    }
+
+    free(path);
+    free(temporary);
+    return result;
+}
+
+static int archive_checkpoint_load(const char* volume_name,
+                                   const char* extension,
+                                   const char* archive_path,
+                                   ArchiveCheckpoint* checkpoint) {
+    char* path = archive_lock_file_get_path(volume_name, extension);
+    if (NULL == path) {
+        return -ENOMEM;
+    }
+
+    FILE* file = fopen(path, "re");
+    free(path);
+    if (NULL == file) {
+        return ENOENT == errno ? -ENOENT : -ESTALE;
+    }
+
+    // Anything unexpected means the checkout can't be resumed, but it was
+    // still interrupted.
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t length = getline(&line, &capacity, file);
+    bool same_archive = 0 < length && !strncmp("archive ", line, 8) &&
+                        '\n' == line[length - 1];
+    if (same_archive) {
+        line[length - 1] = '\0';
+        same_archive = !strcmp(line + 8, archive_path);
+    }
+
+    struct stat archive_stat = {0};
+    intmax_t size = 0;
+    intmax_t mtime_sec = 0;
+    long mtime_nsec = 0;
+    uintmax_t entries = 0;
+    intmax_t offset = 0;
+    same_archive = same_archive && 0 == stat(archive_path, &archive_stat) &&
+                   1 == fscanf(file, "size %jd\n", &size) &&
+                   2 == fscanf(file, "mtime %jd.%ld\n", &mtime_sec,
+                               &mtime_nsec) &&
+                   1 == fscanf(file, "entries %ju\n", &entries) &&
+                   1 == fscanf(file, "offset %jd\n", &offset) &&
+                   size == archive_stat.st_size &&
+                   mtime_sec == archive_stat.st_mtim.tv_sec &&
+                   mtime_nsec == archive_stat.st_mtim.tv_nsec;
+
+    // The pathname is the rest of the file, less the final newline.
+    if (same_archive) {
+        length = getdelim(&line, &capacity, '\0', file);
+        same_archive = 9 < length && !strncmp("pathname ", line, 9) &&
+                       '\n' == line[length - 1];
+    }
+    fclose(file);
+    if (!same_archive) {
+        free(line);
+        return -ESTALE;
+    }
+
+    line[length - 1] = '\0';
+    checkpoint->entries = entries;
+    checkpoint->offset = offset;
+    checkpoint->pathname = strdup(line + 9);
+    free(line);
+    return NULL != checkpoint->pathname ? 0 : -ENOMEM;
+}
+
+static int archive_checkpoint_remove(const char* volume_name,
+                                     const char* extension) {
+    char* path = archive_lock_file_get_path(volume_name, extension);
+    if (NULL == path) {
+        return -ENOMEM;
+    }
+
+    int result = 0 == unlink(path) || ENOENT == errno ? 0 : -errno;
+    free(path);
+    return result;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public API
 ////
 
 ArchiveLockFile* archive_lock_file_create(const char* volume_name) {
     ArchiveLockFile* lock_file = archive_lock_file_new();
-    lock_file->path = archive_lock_file_get_path(volume_name);
+    lock_file->path =
+        archive_lock_file_get_path(volume_name, VOLUMETRIC_LOCK_EXTENSION);
 
     lock_file->fd = open(lock_file->path, O_CREAT | O_TRUNC | O_RDWR, 0600);
     if (0 > lock_file->fd) {
@@ -87,7 +246,8 @@ ArchiveLockFile* archive_lock_file_create(const char* volume_name) {
 
 ArchiveLockFile* archive_lock_file_open(const char* volume_name) {
     ArchiveLockFile* lock_file = archive_lock_file_new();
-    lock_file->path = archive_lock_file_get_path(volume_name);
+    lock_file->path =
+        archive_lock_file_get_path(volume_name, VOLUMETRIC_LOCK_EXTENSION);
     if (NULL == lock_file->path) {
         free(lock_file);
         return NULL;
@@ -109,6 +269,13 @@ void archive_lock_file_close(ArchiveLockFile* file) {
     free(file);
 }
 
+int archive_lock_file_sync(ArchiveLockFile* file) {
+    if (0 != fsync(file->fd)) {
+        return -errno;
+    }
+    return archive_lock_directory_sync();
+}
+
 struct timespec archive_lock_file_get_mtime(ArchiveLockFile* file) {
     struct stat file_stat = {0};
     int result = fstat(file->fd, &file_stat);
@@ -122,4 +289,45 @@ struct timespec archive_lock_file_get_mtime(ArchiveLockFile* file) {
     return file_stat.st_mtim;
 }
 
+int archive_lock_file_save_checkpoint(const char* volume_name,
+                                      const char* archive_path,
+                                      const ArchiveCheckpoint* checkpoint) {
+    return archive_checkpoint_save(volume_name,
+                                   VOLUMETRIC_CHECKPOINT_EXTENSION,
+                                   archive_path, checkpoint);
+}
+
+int archive_lock_file_load_checkpoint(const char* volume_name,
+                                      const char* archive_path,
+                                      ArchiveCheckpoint* checkpoint) {
+    return archive_checkpoint_load(volume_name,
+                                   VOLUMETRIC_CHECKPOINT_EXTENSION,
+                                   archive_path, checkpoint);
+}
+
+int archive_lock_file_remove_checkpoint(const char* volume_name) {
+    return archive_checkpoint_remove(volume_name,
+                                     VOLUMETRIC_CHECKPOINT_EXTENSION);
+}
+
+int archive_lock_file_save_stage(const char* volume_name,
+                                 const char* archive_path) {
+    ArchiveCheckpoint complete = {0};
+    return archive_checkpoint_save(volume_name, VOLUMETRIC_STAGE_EXTENSION,
+                                   archive_path, &complete);
+}
+
+int archive_lock_file_check_stage(const char* volume_name,
+                                  const char* archive_path) {
+    ArchiveCheckpoint complete = {0};
+    int result = archive_checkpoint_load(
+        volume_name, VOLUMETRIC_STAGE_EXTENSION, archive_path, &complete);
+    free(complete.pathname);
+    return result;
+}
+
+int archive_lock_file_remove_stage(const char* volume_name) {
+    return archive_checkpoint_remove(volume_name, VOLUMETRIC_STAGE_EXTENSION);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
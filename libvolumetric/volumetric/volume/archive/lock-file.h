@@ -8,7 +8,7 @@
 //
 // CREATED:         12/30/2022
 //
-// LAST EDITED:	    01/07/2023
+// LAST EDITED:	    10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -33,6 +33,7 @@
 #include <time.h>
 
 typedef struct ArchiveLockFile ArchiveLockFile;
+typedef struct ArchiveCheckpoint ArchiveCheckpoint;
 
 // Create a lock file for the volume with the provided name, or truncate it if
 // it currently exists.
@@ -45,9 +46,53 @@ ArchiveLockFile* archive_lock_file_open(const char* volume_name);
 // Close the lock file.
 void archive_lock_file_close(ArchiveLockFile* file);
 
+// Flush the lock file, and its directory entry, to disk. Returns 0 on success,
+// or a negative errno.
+int archive_lock_file_sync(ArchiveLockFile* file);
+
 // Get the modification time (mtime) of the open lock file.
 struct timespec archive_lock_file_get_mtime(ArchiveLockFile* file);
 
+// While a checkout is in progress, a checkpoint file is kept next to the lock
+// file, recording how far the checkout got. Its presence means that the
+// volume is incomplete.
+
+// Save <checkpoint> for a checkout of <volume_name> from the archive at
+// <archive_path>. The file is replaced atomically, and synced to disk.
+// Returns 0 on success, or a negative errno.
+int archive_lock_file_save_checkpoint(const char* volume_name,
+                                      const char* archive_path,
+                                      const ArchiveCheckpoint* checkpoint);
+
+// Load the checkpoint of an interrupted checkout of <volume_name>. Returns 0
+// if the checkout can be resumed from <checkpoint> (whose pathname must be
+// freed), -ENOENT if there's no checkpoint, or -ESTALE if there is one, but
+// the archive at <archive_path> changed since it was saved.
+int archive_lock_file_load_checkpoint(const char* volume_name,
+                                      const char* archive_path,
+                                      ArchiveCheckpoint* checkpoint);
+
+// Remove the checkpoint, once the checkout is complete.
+int archive_lock_file_remove_checkpoint(const char* volume_name);
+
+// An archive can be extracted into a staging directory before the volume is
+// checked out (see archive_volume_stage). A stage file, in the same format as
+// a checkpoint, records that the staged tree is complete.
+
+// Record that the staged tree of <volume_name> was extracted from the archive
+// at <archive_path>. Returns 0 on success, or a negative errno.
+int archive_lock_file_save_stage(const char* volume_name,
+                                 const char* archive_path);
+
+// Returns 0 if the staged tree of <volume_name> is complete, and was
+// extracted from the archive at <archive_path> as it is now, -ENOENT if
+// nothing is staged, or -ESTALE otherwise.
+int archive_lock_file_check_stage(const char* volume_name,
+                                  const char* archive_path);
+
+// Remove the stage file, before the staged tree is used or removed.
+int archive_lock_file_remove_stage(const char* volume_name);
+
 #endif // VOLUMETRIC_LOCK_FILE_H
 
 ///////////////////////////////////////////////////////////////////////////////
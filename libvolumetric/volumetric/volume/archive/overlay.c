@@ -0,0 +1,175 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            overlay.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Layers of overlay-backed archive volumes
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glib-2.0/glib.h>
+
+#include <volumetric/directory.h>
+
+#include "overlay.h"
+#include "config.h"
+
+static const char* VOLUMETRIC_OVERLAY_DIRECTORY = CONFIG_LOCK_PATH "/overlay";
+static const char* LAYER_NAMES[] = {
+    [ARCHIVE_OVERLAY_LOWER] = "lower",
+    [ARCHIVE_OVERLAY_UPPER] = "upper",
+    [ARCHIVE_OVERLAY_WORK] = "work",
+    [ARCHIVE_OVERLAY_MERGED] = "merged",
+    [ARCHIVE_OVERLAY_LAZY] = "lazy",
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static int make_directory(const char* path) {
+    return 0 == mkdir(path, 0700) || EEXIST == errno ? 0 : -errno;
+}
+
+// Replace whatever is at <path> with an empty directory.
+static int replace_directory(const char* path) {
+    struct stat path_stat = {0};
+    if (0 == lstat(path, &path_stat)) {
+        int result = S_ISDIR(path_stat.st_mode)
+                         ? directory_remove_recursive(path)
+                         : (0 == unlink(path) ? 0 : -errno);
+        if (0 != result) {
+            return result;
+        }
+    }
+    return 0 == mkdir(path, 0755) ? 0 : -errno;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+char* archive_overlay_get_path(const char* volume_name,
+                               ArchiveOverlayLayer layer) {
+    return g_strdup_printf("%s/%s/%s", VOLUMETRIC_OVERLAY_DIRECTORY,
+                           volume_name, LAYER_NAMES[layer]);
+}
+
+int archive_overlay_create(const char* volume_name, const char* lower,
+                           char** options) {
+    char* directory =
+        g_strdup_printf("%s/%s", VOLUMETRIC_OVERLAY_DIRECTORY, volume_name);
+    int result = make_directory(VOLUMETRIC_OVERLAY_DIRECTORY);
+    if (0 == result) {
+        result = make_directory(directory);
+    }
+    g_free(directory);
+    if (0 != result) {
+        return result;
+    }
+
+    char* paths[4] = {0};
+    for (int i = ARCHIVE_OVERLAY_LOWER; i <= ARCHIVE_OVERLAY_MERGED; ++i) {
+        paths[i] = archive_overlay_get_path(volume_name, i);
+    }
+
+    result = archive_overlay_set_lower(volume_name, lower);
+    if (0 == result) {
+        result = replace_directory(paths[ARCHIVE_OVERLAY_UPPER]);
+    }
+    if (0 == result) {
+        result = replace_directory(paths[ARCHIVE_OVERLAY_WORK]);
+    }
+
+    if (0 == result) {
+        *options = g_strdup_printf("lowerdir=%s,upperdir=%s,workdir=%s",
+                                   paths[ARCHIVE_OVERLAY_LOWER],
+                                   paths[ARCHIVE_OVERLAY_UPPER],
+                                   paths[ARCHIVE_OVERLAY_WORK]);
+    }
+
+    for (int i = ARCHIVE_OVERLAY_LOWER; i <= ARCHIVE_OVERLAY_MERGED; ++i) {
+        g_free(paths[i]);
+    }
+    return result;
+}
+
+int archive_overlay_set_lower(const char* volume_name, const char* lower) {
+    // The link is replaced atomically, since diff and commit follow it.
+    char* path = archive_overlay_get_path(volume_name, ARCHIVE_OVERLAY_LOWER);
+    char* link = g_strdup_printf("%s~", path);
+    unlink(link);
+    int result = 0;
+    if (0 != symlink(lower, link) || 0 != rename(link, path)) {
+        result = -errno;
+    }
+    g_free(link);
+    g_free(path);
+    return result;
+}
+
+int archive_overlay_mount_merged(const char* volume_name, char** merged) {
+    char* lower = archive_overlay_get_path(volume_name, ARCHIVE_OVERLAY_LOWER);
+    char* upper = archive_overlay_get_path(volume_name, ARCHIVE_OVERLAY_UPPER);
+    char* target =
+        archive_overlay_get_path(volume_name, ARCHIVE_OVERLAY_MERGED);
+
+    // Without an upper directory, the mount is read-only, and whiteouts and
+    // opaque directories in the (former) upper layer still apply.
+    char tree[PATH_MAX] = {0};
+    int result = 0;
+    if (NULL == realpath(lower, tree)) {
+        result = -errno;
+    } else {
+        result = make_directory(target);
+    }
+    if (0 == result) {
+        char* options = g_strdup_printf("lowerdir=%s:%s", upper, tree);
+        if (0 != mount("overlay", target, "overlay", MS_RDONLY, options)) {
+            result = -errno;
+        }
+        g_free(options);
+    }
+
+    g_free(lower);
+    g_free(upper);
+    if (0 != result) {
+        g_free(target);
+        return result;
+    }
+    *merged = target;
+    return 0;
+}
+
+int archive_overlay_unmount_merged(const char* merged) {
+    return 0 == umount(merged) ? 0 : -errno;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            overlay.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Layers of overlay-backed archive volumes
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef VOLUMETRIC_OVERLAY_H
+#define VOLUMETRIC_OVERLAY_H
+
+// The layers of an overlay-backed archive volume are kept in
+// CONFIG_LOCK_PATH/overlay/<volume-name>/:
+//  lower       Symbolic link to the extracted archive, which is shared by
+//              every volume checking out the same archive.
+//  upper/      Changes made through the volume
+//  work/       Scratch space for overlayfs
+//  merged/     Where the layers are mounted (read-only) to commit the volume
+//  lazy/       Where the archive is published while it's extracted, for lazy
+//              checkouts (see lazy.h)
+typedef enum ArchiveOverlayLayer {
+    ARCHIVE_OVERLAY_LOWER,
+    ARCHIVE_OVERLAY_UPPER,
+    ARCHIVE_OVERLAY_WORK,
+    ARCHIVE_OVERLAY_MERGED,
+    ARCHIVE_OVERLAY_LAZY,
+} ArchiveOverlayLayer;
+
+// Path of <layer> of the volume. Must be free'd with g_free().
+char* archive_overlay_get_path(const char* volume_name,
+                               ArchiveOverlayLayer layer);
+
+// Start the volume over on top of the tree at <lower>, with empty upper and
+// work directories. On success, <options> is set to the options to mount the
+// layers with (free with g_free()), which refer to the lower layer through its
+// link. Returns 0 on success, or a negative errno.
+int archive_overlay_create(const char* volume_name, const char* lower,
+                           char** options);
+
+// Point the lower layer of the volume at the tree at <lower>, which must have
+// the same contents. Mounts made before keep the tree they were made with.
+// Returns 0 on success, or a negative errno.
+int archive_overlay_set_lower(const char* volume_name, const char* lower);
+
+// Mount the upper layer over the lower one, read-only, at the merged
+// directory, whose path is returned in <merged> (free with g_free()). Returns
+// 0 on success, or a negative errno.
+int archive_overlay_mount_merged(const char* volume_name, char** merged);
+int archive_overlay_unmount_merged(const char* merged);
+
+#endif // VOLUMETRIC_OVERLAY_H
+
+///////////////////////////////////////////////////////////////////////////////
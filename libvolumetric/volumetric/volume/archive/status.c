@@ -7,7 +7,7 @@
 //
 // CREATED:         02/13/2022
 //
-// LAST EDITED:     02/15/2022
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -27,32 +27,33 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fts.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/xattr.h>
 
-#include <archive.h>
-#include <archive_entry.h>
 #include <glib-2.0/glib.h>
 
 #include <volumetric/directory.h>
 #include <volumetric/docker.h>
-#include <volumetric/file.h>
+#include <volumetric/path-filter.h>
 #include <volumetric/string-handling.h>
 #include <volumetric/volume/archive.h>
+#include <volumetric/volume/archive/layer.h>
+#include <volumetric/volume/archive/overlay.h>
 
 ///////////////////////////////////////////////////////////////////////////////
 // Private API
 ////
 
-static bool check_file_for_modifications(struct archive_entry* entry,
+static bool check_file_for_modifications(const struct stat* archive_stat,
                                          const char* directory_file) {
     // Check for differences based on stat data
     struct stat file_stat = {0};
     assert(0 == stat(directory_file, &file_stat));
 
-    const struct stat* archive_stat = archive_entry_stat(entry);
     bool diff = false;
     if (S_ISREG(file_stat.st_mode)) {
         diff = diff || file_stat.st_size != archive_stat->st_size;
@@ -63,61 +64,56 @@ static bool check_file_for_modifications(struct archive_entry* entry,
     return diff;
 }
 
-// Find what's changed in the directory from the archive
+static gint compare_paths(gconstpointer first, gconstpointer second) {
+    return strcmp((const char*)first, (const char*)second);
+}
+
+// Find what's changed in the directory from the archive, and the layers
+// beneath it, if it's one. Entries which aren't selected by <filter> (if it's
+// not NULL) weren't checked out, so they're ignored.
 static int diff_directory_from_archive(GPtrArray* directory,
                                        const char* archive_url,
-                                       const char* directory_base) {
-    struct archive* reader = archive_read_new();
-    struct archive_entry* entry = NULL;
-    archive_read_support_filter_all(reader);
-    archive_read_support_format_all(reader);
-
-    FileContents archive = {0};
-    file_contents_init(&archive, archive_url);
-    archive_read_open_memory(reader, archive.contents, archive.size);
-    while (archive_read_next_header(reader, &entry) == ARCHIVE_OK) {
-        static const char* archive_base = "./";
-        const char* entry_path = archive_entry_pathname(entry);
-        if (!strcmp(archive_base, entry_path)) {
-            // Skip "./"
-            continue;
-        }
+                                       const char* directory_base,
+                                       const PathFilter* filter) {
+    ArchiveLayerChain* chain = NULL;
+    int result = archive_layer_chain_open(archive_url, NULL, &chain);
+    if (0 != result) {
+        return result;
+    }
 
-        char* archive_file = string_new(entry_path + strlen(archive_base));
-        size_t archive_file_length = strlen(archive_file);
-        if ('/' == archive_file[archive_file_length - 1]) {
-            // Truncate trailing '/'
-            archive_file[archive_file_length - 1] = '\0';
-        }
+    GHashTable* entries = archive_layer_chain_get_entries(chain, filter);
+    archive_layer_chain_free(chain);
+    if (NULL == entries) {
+        return -EIO;
+    }
 
-        bool found = false;
-        for (guint i = 0; i < directory->len; ++i) {
-            const char* directory_file = directory->pdata[i];
-            if (!strcmp(archive_file, directory_file)) {
-                found = true;
-                char* full_path = string_append_new(string_new(directory_base),
-                                                    directory_file);
-                if (check_file_for_modifications(entry, full_path)) {
-                    printf("M %s\n", archive_file);
-                }
-                free(full_path);
-                g_ptr_array_remove_index_fast(directory, i);
-                break;
-            }
+    for (guint i = 0; i < directory->len && NULL != directory->pdata[i];
+         ++i) {
+        const char* directory_file = directory->pdata[i];
+        const struct stat* archive_stat =
+            g_hash_table_lookup(entries, directory_file);
+        if (NULL == archive_stat) {
+            printf("A %s\n", directory_file);
+            continue;
         }
 
-        if (!found) {
-            printf("D %s\n", (const char*)archive_file);
+        char* full_path =
+            string_append_new(string_new(directory_base), directory_file);
+        if (check_file_for_modifications(archive_stat, full_path)) {
+            printf("M %s\n", directory_file);
         }
-        free(archive_file);
+        free(full_path);
+        g_hash_table_remove(entries, directory_file);
     }
 
-    for (guint i = 0; i < directory->len && NULL != directory->pdata[i]; ++i) {
-        printf("A %s\n", (const char*)directory->pdata[i]);
+    GList* removed =
+        g_list_sort(g_hash_table_get_keys(entries), compare_paths);
+    for (GList* iter = removed; NULL != iter; iter = iter->next) {
+        printf("D %s\n", (const char*)iter->data);
     }
+    g_list_free(removed);
 
-    archive_read_free(reader);
-    file_contents_release(&archive);
+    g_hash_table_unref(entries);
     return 0;
 }
 
@@ -145,11 +141,136 @@ static void trim_prefix_from_entries(GPtrArray* list, const char* prefix) {
     }
 }
 
+static bool check_stat_for_modifications(const struct stat* file_stat,
+                                         const struct stat* lower_stat) {
+    bool diff = false;
+    if (S_ISREG(file_stat->st_mode)) {
+        diff = diff || file_stat->st_size != lower_stat->st_size;
+    }
+
+    diff = diff || file_stat->st_mode != lower_stat->st_mode;
+    diff = diff || file_stat->st_mtime != lower_stat->st_mtime;
+    return diff;
+}
+
+// Overlayfs records removed files as character devices with device number 0.
+static bool overlay_file_is_whiteout(const struct stat* file_stat) {
+    return S_ISCHR(file_stat->st_mode) && 0 == file_stat->st_rdev;
+}
+
+// An opaque directory in the upper layer hides everything beneath it in the
+// lower layer.
+static bool overlay_directory_is_opaque(const char* path) {
+    char value = 0;
+    return 1 == lgetxattr(path, "trusted.overlay.opaque", &value, 1) &&
+           'y' == value;
+}
+
+// Print the files beneath the opaque directory <file> which are hidden.
+static void diff_opaque_directory(const char* upper, const char* lower,
+                                  const char* file) {
+    char* lower_directory = g_strdup_printf("%s/%s", lower, file);
+    char* const paths[] = {lower_directory, NULL};
+    FTS* tree = fts_open(paths, FTS_NOCHDIR | FTS_PHYSICAL, NULL);
+    if (NULL == tree) {
+        g_free(lower_directory);
+        return;
+    }
+
+    size_t prefix_length = strlen(lower) + 1;
+    FTSENT* node = NULL;
+    while ((node = fts_read(tree))) {
+        if (FTS_DP == node->fts_info || 0 == node->fts_level) {
+            continue;
+        }
+
+        const char* hidden = node->fts_path + prefix_length;
+        char* upper_path = g_strdup_printf("%s/%s", upper, hidden);
+        struct stat upper_stat = {0};
+        if (0 != lstat(upper_path, &upper_stat)) {
+            printf("D %s\n", hidden);
+        }
+        g_free(upper_path);
+    }
+
+    fts_close(tree);
+    g_free(lower_directory);
+}
+
+// Find what's changed in an overlay volume. Everything that's changed is in
+// the upper layer, so the lower layer (the extracted archive) is only
+// consulted for the files found there.
+static int diff_overlay_from_lower(ArchiveVolume* volume) {
+    char* upper =
+        archive_overlay_get_path(volume->name, ARCHIVE_OVERLAY_UPPER);
+    char* lower =
+        archive_overlay_get_path(volume->name, ARCHIVE_OVERLAY_LOWER);
+
+    // Whiteouts aren't regular files or directories, so the upper layer is
+    // walked here, rather than with get_file_list_for_directory().
+    char* const paths[] = {upper, NULL};
+    FTS* tree = fts_open(paths, FTS_NOCHDIR | FTS_PHYSICAL, NULL);
+    if (NULL == tree) {
+        int result = -errno;
+        g_free(upper);
+        g_free(lower);
+        return result;
+    }
+
+    size_t prefix_length = strlen(upper) + 1;
+    FTSENT* node = NULL;
+    while ((node = fts_read(tree))) {
+        if (FTS_DP == node->fts_info || 0 == node->fts_level) {
+            continue;
+        }
+
+        const char* file = node->fts_path + prefix_length;
+        const struct stat* upper_stat = node->fts_statp;
+        char* lower_path = g_strdup_printf("%s/%s", lower, file);
+        struct stat lower_stat = {0};
+        if (overlay_file_is_whiteout(upper_stat)) {
+            printf("D %s\n", file);
+        } else if (0 != lstat(lower_path, &lower_stat)) {
+            printf("A %s\n", file);
+        } else {
+            if (FTS_D == node->fts_info && S_ISDIR(lower_stat.st_mode) &&
+                overlay_directory_is_opaque(node->fts_path)) {
+                diff_opaque_directory(upper, lower, file);
+            }
+            if (check_stat_for_modifications(upper_stat, &lower_stat)) {
+                printf("M %s\n", file);
+            }
+        }
+        g_free(lower_path);
+    }
+
+    fts_close(tree);
+    g_free(upper);
+    g_free(lower);
+    return 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Public API
 ////
 
 int archive_volume_diff(ArchiveVolume* volume, Docker* docker) {
+    if (ARCHIVE_CHECKOUT_OVERLAY == volume->checkout ||
+        ARCHIVE_CHECKOUT_LAZY == volume->checkout) {
+        docker_proxy_free(docker);
+        return diff_overlay_from_lower(volume);
+    }
+
+    // The mountpoint of the volume isn't necessarily reachable.
+    if (ARCHIVE_TRANSPORT_LOCAL != volume->transport) {
+        docker_proxy_free(docker);
+        fprintf(stderr,
+                "%s: Volumes using the docker-archive transport can't be "
+                "diffed\n",
+                volume->name);
+        return -ENOTSUP;
+    }
+
     DockerVolume* live_volume = docker_volume_inspect(docker, volume->name);
     docker_proxy_free(docker);
     assert(NULL != live_volume);
@@ -169,8 +290,15 @@ int archive_volume_diff(ArchiveVolume* volume, Docker* docker) {
     }
     trim_prefix_from_entries(directory, mountpoint);
 
-    int result =
-        diff_directory_from_archive(directory, volume->url, mountpoint);
+    PathFilter* filter = NULL;
+    if (NULL != volume->include || NULL != volume->exclude) {
+        filter = path_filter_new(volume->include, volume->exclude);
+    }
+    int result = diff_directory_from_archive(directory, volume->url,
+                                             mountpoint, filter);
+    if (NULL != filter) {
+        path_filter_free(filter);
+    }
 
     free(mountpoint);
     g_ptr_array_unref(directory);
@@ -0,0 +1,206 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            transport.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Streaming archive volumes through the Docker daemon
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <glib-2.0/glib.h>
+#include <zstd.h>
+
+#include <volumetric/docker.h>
+#include <volumetric/file.h>
+#include <volumetric/volume/archive.h>
+
+#include "transport.h"
+
+static const char* DEFAULT_HELPER_IMAGE = "busybox";
+// Where the volume is mounted in the helper container
+static const char* HELPER_TARGET = "/volume";
+static const uint8_t ZSTD_MAGIC[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+// State of an archive which is decompressed as it's sent
+typedef struct ZstdUpload {
+    ZSTD_DStream* stream;
+    ZSTD_inBuffer input;
+    // Whether the last call filled the buffer, in which case the decoder may
+    // be holding more output.
+    bool pending;
+    // Non-zero if the input ended in the middle of a frame
+    size_t remaining;
+} ZstdUpload;
+
+struct ArchiveTransportStream {
+    Docker* docker;
+    const char* helper;
+    // Sockets the archive is written to and read from
+    int write_fd;
+    int read_fd;
+    int result;
+    GThread* thread;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+// Decompress the archive straight into the upload buffer.
+static size_t read_decompressed(char* buffer, size_t size, size_t nitems,
+                                void* user_data) {
+    ZstdUpload* upload = (ZstdUpload*)user_data;
+    ZSTD_outBuffer output = {buffer, size * nitems, 0};
+    while (0 == output.pos &&
+           (upload->input.pos < upload->input.size || upload->pending)) {
+        size_t result =
+            ZSTD_decompressStream(upload->stream, &output, &upload->input);
+        if (ZSTD_isError(result)) {
+            fprintf(stderr, "Couldn't decompress archive: %s\n",
+                    ZSTD_getErrorName(result));
+            return DOCKER_STREAM_ABORT;
+        }
+        upload->pending = output.pos == output.size;
+        upload->remaining = result;
+    }
+
+    if (0 == output.pos && 0 != upload->remaining) {
+        fprintf(stderr, "Couldn't decompress archive: truncated frame\n");
+        return DOCKER_STREAM_ABORT;
+    }
+    return output.pos;
+}
+
+static size_t write_to_socket(char* buffer, size_t size, size_t nitems,
+                              void* user_data) {
+    ArchiveTransportStream* stream = (ArchiveTransportStream*)user_data;
+    size_t length = size * nitems;
+    size_t written = 0;
+    while (written < length) {
+        // The reader may have given up on the archive already.
+        ssize_t result = send(stream->write_fd, buffer + written,
+                              length - written, MSG_NOSIGNAL);
+        if (0 > result && EINTR == errno) {
+            continue;
+        } else if (0 > result) {
+            return 0;
+        }
+        written += result;
+    }
+    return written;
+}
+
+static gpointer get_archive_run(gpointer user_data) {
+    ArchiveTransportStream* stream = (ArchiveTransportStream*)user_data;
+    stream->result =
+        docker_container_get_archive(stream->docker, stream->helper,
+                                     HELPER_TARGET, write_to_socket, stream);
+
+    // The reader sees the end of the archive.
+    close(stream->write_fd);
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+char* archive_transport_helper_new(ArchiveVolume* config, Docker* docker) {
+    const char* image = NULL != config->helper_image ? config->helper_image
+                                                     : DEFAULT_HELPER_IMAGE;
+    char* helper = docker_container_create_helper(docker, image, config->name,
+                                                  HELPER_TARGET);
+    if (NULL == helper) {
+        fprintf(stderr, "%s: Couldn't create a helper container from %s\n",
+                config->name, image);
+    }
+    return helper;
+}
+
+void archive_transport_helper_free(Docker* docker, char* helper) {
+    docker_container_remove(docker, helper);
+    free(helper);
+}
+
+int archive_transport_put(Docker* docker, const char* helper,
+                          const FileContents* file) {
+    bool zstd = file->size >= sizeof(ZSTD_MAGIC) &&
+                !memcmp(file->contents, ZSTD_MAGIC, sizeof(ZSTD_MAGIC));
+    if (!zstd) {
+        return docker_container_put_archive(docker, helper, HELPER_TARGET,
+                                            file->contents, file->size);
+    }
+
+    // The daemon doesn't accept zstd.
+    ZstdUpload upload = {
+        .stream = ZSTD_createDStream(),
+        .input = {file->contents, file->size, 0},
+    };
+    assert(NULL != upload.stream);
+    ZSTD_initDStream(upload.stream);
+    int result = docker_container_put_archive_stream(
+        docker, helper, HELPER_TARGET, read_decompressed, &upload);
+    ZSTD_freeDStream(upload.stream);
+    return result;
+}
+
+ArchiveTransportStream* archive_transport_get_start(Docker* docker,
+                                                    const char* helper,
+                                                    int* fd) {
+    int fds[2] = {0};
+    if (0 != socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds)) {
+        fprintf(stderr, "Couldn't create socket pair: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    ArchiveTransportStream* stream = malloc(sizeof(ArchiveTransportStream));
+    assert(NULL != stream);
+    stream->docker = docker;
+    stream->helper = helper;
+    stream->read_fd = fds[0];
+    stream->write_fd = fds[1];
+    stream->result = 0;
+    stream->thread = g_thread_new("transport", get_archive_run, stream);
+    *fd = stream->read_fd;
+    return stream;
+}
+
+int archive_transport_get_finish(ArchiveTransportStream* stream) {
+    // Unblocks the writer, if the archive wasn't read to the end.
+    close(stream->read_fd);
+    g_thread_join(stream->thread);
+    int result = stream->result;
+    free(stream);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
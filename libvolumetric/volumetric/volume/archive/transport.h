@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            transport.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Streaming archive volumes through the Docker daemon
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#ifndef VOLUMETRIC_TRANSPORT_H
+#define VOLUMETRIC_TRANSPORT_H
+
+typedef struct ArchiveVolume ArchiveVolume;
+typedef struct Docker Docker;
+typedef struct FileContents FileContents;
+
+// Volumes using ARCHIVE_TRANSPORT_DOCKER_ARCHIVE are reached through a helper
+// container, which has the volume mounted, but is never started. Archives are
+// sent to and received from it through the archive endpoints of the daemon.
+
+// Create the helper container for the volume. Returns its ID, or NULL.
+char* archive_transport_helper_new(ArchiveVolume* config, Docker* docker);
+
+// Remove the helper container, and free <helper>.
+void archive_transport_helper_free(Docker* docker, char* helper);
+
+// Extract the archive in <file> into the volume. gzip-compressed archives are
+// sent straight from the file, and seekable ones are decompressed as they're
+// sent. Returns 0 on success, or a negative errno.
+int archive_transport_put(Docker* docker, const char* helper,
+                          const FileContents* file);
+
+typedef struct ArchiveTransportStream ArchiveTransportStream;
+
+// Start receiving a tar archive of the volume, which is read from <fd>. The
+// entries are named "volume/<path>". <docker> is used by another thread until
+// archive_transport_get_finish() returns. Returns NULL on failure.
+ArchiveTransportStream* archive_transport_get_start(Docker* docker,
+                                                    const char* helper,
+                                                    int* fd);
+
+// Close <fd>, and wait for the transfer to finish. Returns 0 if the whole
+// archive was received, or a negative errno.
+int archive_transport_get_finish(ArchiveTransportStream* stream);
+
+#endif // VOLUMETRIC_TRANSPORT_H
+
+///////////////////////////////////////////////////////////////////////////////
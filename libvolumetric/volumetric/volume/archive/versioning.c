@@ -7,7 +7,7 @@
 //
 // CREATED:         01/17/2022
 //
-// LAST EDITED:     01/07/2023
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -28,22 +28,62 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mount.h>
 #include <sys/stat.h>
 
 #include <glib-2.0/glib.h>
 #include <serdec/yaml.h>
 
 #include <volumetric/archive.h>
+#include <volumetric/directory.h>
 #include <volumetric/docker.h>
+#include <volumetric/extract-cache.h>
 #include <volumetric/file.h>
+#include <volumetric/path-filter.h>
+#include <volumetric/string-handling.h>
 #include <volumetric/hash.h>
+#include <volumetric/io-scheduler.h>
 #include <volumetric/volume/archive.h>
+#include <volumetric/volume/archive/layer.h>
+#include <volumetric/volume/archive/lazy.h>
 #include <volumetric/volume/archive/lock-file.h>
+#include <volumetric/volume/archive/overlay.h>
+#include <volumetric/volume/archive/transport.h>
+
+// The progress of a checkout is saved whenever this much more has been
+// written, so that it can be resumed if it's interrupted.
+static const uint64_t CHECKPOINT_INTERVAL = 256 * 1024 * 1024;
+
+// Appended to the mountpoint of a volume to get the directory a swapping
+// checkout extracts into, which must be on the same filesystem.
+static const char* SWAP_STAGING_SUFFIX = ".volumetric-swap";
+
+// Whether the volume exists, judging by its directory in the data root of
+// the Docker daemon, for when the daemon isn't running yet.
+static int archive_volume_exists_in_docker_root(ArchiveVolume* volume) {
+    if (NULL == volume->docker_root) {
+        return -ENOTCONN;
+    }
+
+    char* path =
+        g_strdup_printf("%s/volumes/%s", volume->docker_root, volume->name);
+    struct stat path_stat = {0};
+    int result = 0 == stat(path, &path_stat) ? 1 : 0;
+    if (0 == result && ENOENT != errno) {
+        result = -errno;
+    }
+    g_free(path);
+    return result;
+}
 
 // In this case, if the volume already exists, we do nothing.
 int archive_volume_update_policy_never(ArchiveVolume* volume, Docker* docker) {
-    int result = docker_volume_exists(docker, volume->name);
+    int result = NULL != docker ? docker_volume_exists(docker, volume->name)
+                                : archive_volume_exists_in_docker_root(volume);
     if (result < 0) {
         return result;
     } else if (result == 1) {
@@ -56,10 +96,26 @@ int archive_volume_update_policy_never(ArchiveVolume* volume, Docker* docker) {
 
 int archive_volume_check_hash(ArchiveVolume* volume, Docker* docker,
                               const FileContents* file) {
+    if (ARCHIVE_VERIFY_DURING_EXTRACT == volume->verify &&
+        ARCHIVE_TRANSPORT_LOCAL == volume->transport &&
+        ARCHIVE_CHECKOUT_LAZY != volume->checkout) {
+        // The hash will be checked in the same pass as decompression. Lazy
+        // checkouts publish the archive before it's extracted, though.
+        return 0;
+    } else if (NULL == file->contents) {
+        // The volume is cloned from an extract cache entry, or moved from a
+        // staged tree, which were verified when they were extracted. The
+        // archive isn't read at all.
+        return 0;
+    }
+
     // Hash the contents of the file (in memory) to verify against config
+    IoStreams* streams =
+        io_scheduler_acquire(volume->io_scheduler, volume->url, NULL);
     printf("%s: Checking hash of file %s\n", volume->name, volume->url);
     FileHash* file_hash = file_hash_of_buffer(volume->hash->hash_type,
                                               file->contents, file->size);
+    io_streams_release(streams);
     if (!file_hash_equal(volume->hash, file_hash)) {
         char* expected = file_hash_to_string(volume->hash);
         char* got = file_hash_to_string(file_hash);
@@ -119,6 +175,15 @@ int archive_volume_update_policy_on_stale_lock(ArchiveVolume* volume,
 int archive_volume_check_remove_existing_volume(ArchiveVolume* volume,
                                                 Docker* docker,
                                                 const FileContents*) {
+    // An incremental checkout brings the existing contents up to date, and
+    // an interrupted one continues where it left off.
+    if ((ARCHIVE_CHECKOUT_REPLACE != volume->checkout &&
+         ARCHIVE_CHECKOUT_OVERLAY != volume->checkout &&
+         ARCHIVE_CHECKOUT_LAZY != volume->checkout) ||
+        NULL != volume->resume) {
+        return 0;
+    }
+
     // Remove the volume if it exists, to prevent contamination.
     int result = 0;
     if (docker_volume_exists(docker, volume->name)) {
@@ -138,48 +203,748 @@ int archive_volume_commit_update_lock_file(ArchiveVolume* volume,
         return -EINVAL;
     }
 
+    // The lock file vouches for a volume that's already on disk.
+    int result = 0;
+    if (ARCHIVE_SYNC_DURABLE == volume->sync) {
+        result = archive_lock_file_sync(lock_file);
+        if (0 != result) {
+            fprintf(stderr, "Couldn't sync lock file: %s\n",
+                    strerror(-result));
+        }
+    }
+
     archive_lock_file_close(lock_file);
-    return 0;
+    return result;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// Public API
+// Private API
 ////
 
-int archive_volume_checkout(ArchiveVolume* config, Docker* docker) {
-    // Apply the update policy to determine whether any action is required.
-    int result = config->update_policy(config, docker);
-    if (VOLUMETRIC_NO_ACTION == result || 0 > result) {
+// The cache holds complete trees, so volumes checking out only some paths
+// don't use it. Overlay (and lazy) volumes always do, since they're mounted on
+// top of it.
+static bool archive_volume_uses_cache(ArchiveVolume* config) {
+    if (NULL == config->cache || NULL == config->hash ||
+        ARCHIVE_TRANSPORT_LOCAL != config->transport ||
+        NULL != config->include || NULL != config->exclude) {
+        return false;
+    }
+
+    return ARCHIVE_CHECKOUT_OVERLAY == config->checkout ||
+           ARCHIVE_CHECKOUT_LAZY == config->checkout ||
+           (ARCHIVE_CACHE_OFF != config->cache_mode &&
+            ARCHIVE_CHECKOUT_REPLACE == config->checkout);
+}
+
+// Durable checkouts which extract the archive directly into the volume can
+// pick up where they left off if they're interrupted.
+static bool archive_volume_can_resume(ArchiveVolume* config) {
+    return ARCHIVE_CHECKOUT_REPLACE == config->checkout &&
+           ARCHIVE_SYNC_DURABLE == config->sync &&
+           ARCHIVE_TRANSPORT_LOCAL == config->transport &&
+           !archive_volume_uses_cache(config);
+}
+
+// Replacing and swapping checkouts can use a tree extracted ahead of time,
+// unless they go through the cache, which is filled ahead of time instead.
+static bool archive_volume_can_stage(ArchiveVolume* config) {
+    return NULL != config->staging_directory &&
+           ARCHIVE_TRANSPORT_LOCAL == config->transport &&
+           (ARCHIVE_CHECKOUT_REPLACE == config->checkout ||
+            ARCHIVE_CHECKOUT_SWAP == config->checkout) &&
+           !archive_volume_uses_cache(config);
+}
+
+static char* archive_volume_get_staged_path(ArchiveVolume* config) {
+    return string_join_new(string_new(config->staging_directory), '/',
+                           config->name);
+}
+
+// Return the staged tree of the volume, if there's a complete one for the
+// archive. The stage file is removed, so that the tree is used at most once.
+static char* archive_volume_take_staged(ArchiveVolume* config) {
+    if (!archive_volume_can_stage(config) || NULL != config->resume) {
+        return NULL;
+    }
+
+    int result = archive_lock_file_check_stage(config->name, config->url);
+    if (-ENOENT == result) {
+        return NULL;
+    }
+
+    char* staged = archive_volume_get_staged_path(config);
+    if (0 == result) {
+        result = archive_lock_file_remove_stage(config->name);
+    }
+    if (0 != result) {
+        printf("%s: Discarding stale staged tree\n", config->name);
+        archive_lock_file_remove_stage(config->name);
+        directory_remove_recursive(staged);
+        free(staged);
+        return NULL;
+    }
+
+    return staged;
+}
+
+static int
+archive_volume_save_checkpoint(void* user_data,
+                               const ArchiveCheckpoint* checkpoint) {
+    ArchiveVolume* config = (ArchiveVolume*)user_data;
+    return archive_lock_file_save_checkpoint(config->name, config->url,
+                                             checkpoint);
+}
+
+// Extract the archive in <file> to <location>. If it's a layer, the chain of
+// layers beneath it is extracted, in order.
+static int archive_volume_extract(ArchiveVolume* config,
+                                  const FileContents* file,
+                                  const char* location,
+                                  const ArchiveExtractOptions* options) {
+    ArchiveLayerChain* chain = NULL;
+    int result = archive_layer_chain_open(config->url, file, &chain);
+    if (0 != result) {
+        fprintf(stderr, "%s: Couldn't read the layers of %s: %s\n",
+                config->name, config->url, strerror(-result));
+        return result;
+    }
+
+    size_t length = archive_layer_chain_get_length(chain);
+    if (1 < length) {
+        printf("%s: Applying %zu layers on top of the base archive\n",
+               config->name, length - 1);
+    }
+    result = archive_layer_chain_extract(chain, location, options);
+    archive_layer_chain_free(chain);
+    return result;
+}
+
+static int archive_volume_clone_from_cache(ArchiveVolume* config,
+                                           ExtractCacheEntry* entry,
+                                           const char* mountpoint) {
+    DirectoryCloneMode mode = ARCHIVE_CACHE_HARDLINK == config->cache_mode
+                                  ? DIRECTORY_CLONE_HARDLINK
+                                  : DIRECTORY_CLONE_COPY;
+    printf("%s: Cloning volume from extract cache\n", config->name);
+    int result = extract_cache_entry_clone(entry, mountpoint, mode);
+    extract_cache_entry_close(entry);
+    return result;
+}
+
+// Extract the archive into a new cache entry, which is opened in <entry>. If
+// the cache can't take the tree, <entry> is set to NULL, but 0 is returned.
+static int archive_volume_extract_to_cache(
+    ArchiveVolume* config, FileContents* file,
+    const ArchiveExtractOptions* options, ExtractCacheEntry** entry) {
+    *entry = NULL;
+    char* staging = extract_cache_stage(config->cache);
+    if (NULL == staging) {
+        return 0;
+    }
+
+    int result = archive_volume_extract(config, file, staging, options);
+    if (0 != result) {
+        extract_cache_discard(config->cache, staging);
+        free(staging);
+        return result;
+    }
+
+    *entry = extract_cache_insert(config->cache, config->hash, staging);
+    free(staging);
+    return 0;
+}
+
+// Extract the archive into a new cache entry, and then clone the entry into
+// the volume. The caller evicts from the cache once it has released its I/O
+// streams, since eviction waits for every open entry to be closed.
+static int archive_volume_extract_through_cache(
+    ArchiveVolume* config, FileContents* file, const char* mountpoint,
+    const ArchiveExtractOptions* options) {
+    ExtractCacheEntry* entry = NULL;
+    int result =
+        archive_volume_extract_to_cache(config, file, options, &entry);
+    if (0 != result) {
         return result;
+    } else if (NULL == entry) {
+        return archive_volume_extract(config, file, mountpoint, options);
+    }
+
+    return archive_volume_clone_from_cache(config, entry, mountpoint);
+}
+
+// Exchange the contents of the volume with <staging>, while the containers
+// which have the volume mounted are paused.
+static int archive_volume_swap(ArchiveVolume* config, Docker* docker,
+                               const char* staging, const char* mountpoint) {
+    GPtrArray* containers =
+        docker_container_list_consumers(docker, config->name);
+    gint64 start = g_get_monotonic_time();
+    int result = 0;
+    guint paused = 0;
+    for (; paused < containers->len; ++paused) {
+        const char* container = containers->pdata[paused];
+        if (0 != docker_container_pause(docker, container)) {
+            fprintf(stderr, "%s: Couldn't pause %s\n", config->name,
+                    container);
+            result = -EIO;
+            break;
+        }
+    }
+
+    if (0 == result) {
+        result = directory_exchange_contents(staging, mountpoint);
+    }
+
+    // The archive's root entry was applied to the staging directory.
+    struct stat staging_stat = {0};
+    if (0 == result && 0 == stat(staging, &staging_stat)) {
+        chmod(mountpoint, staging_stat.st_mode & 07777);
+    }
+
+    for (guint i = 0; i < paused; ++i) {
+        const char* container = containers->pdata[i];
+        if (0 != docker_container_unpause(docker, container)) {
+            fprintf(stderr, "%s: Couldn't unpause %s\n", config->name,
+                    container);
+            result = 0 == result ? -EIO : result;
+        }
+    }
+
+    if (0 == result) {
+        printf("%s: Swapped volume contents in %jums, with %u containers "
+               "paused\n",
+               config->name,
+               (uintmax_t)((g_get_monotonic_time() - start) / 1000), paused);
+    }
+    g_ptr_array_unref(containers);
+    return result;
+}
+
+// Extract the archive (or copy the <staged> tree, if it's not NULL) next to
+// the volume, and swap it in. The volume is left as it is if anything goes
+// wrong before the swap.
+static int
+archive_volume_extract_and_swap(ArchiveVolume* config, Docker* docker,
+                                const FileContents* file, const char* staged,
+                                const char* mountpoint,
+                                const ArchiveExtractOptions* options) {
+    char* staging =
+        string_append_new(string_new(mountpoint), SWAP_STAGING_SUFFIX);
+
+    // Remnants of an earlier, interrupted checkout are of no use.
+    struct stat staging_stat = {0};
+    if (0 == lstat(staging, &staging_stat)) {
+        directory_remove_recursive(staging);
+    }
+
+    struct stat mountpoint_stat = {0};
+    if (0 != mkdir(staging, 0700) || 0 != stat(staging, &staging_stat) ||
+        0 != stat(mountpoint, &mountpoint_stat)) {
+        int result = -errno;
+        fprintf(stderr, "%s: Couldn't create %s: %s\n", config->name, staging,
+                strerror(errno));
+        free(staging);
+        return result;
+    }
+
+    int result = 0;
+    if (staging_stat.st_dev != mountpoint_stat.st_dev) {
+        fprintf(stderr, "%s: %s isn't on the same filesystem as the volume\n",
+                config->name, staging);
+        result = -EXDEV;
+    }
+
+    if (0 == result && NULL != staged) {
+        result = directory_clone(staged, staging, DIRECTORY_CLONE_COPY);
+    } else if (0 == result) {
+        result = archive_volume_extract(config, file, staging, options);
+    }
+    if (0 == result) {
+        result = archive_volume_swap(config, docker, staging, mountpoint);
+    }
+
+    // By now, the staging directory holds the previous contents.
+    directory_remove_recursive(staging);
+    free(staging);
+    return result;
+}
+
+// Move the <staged> tree into the volume, or swap it in. Trees staged on
+// another filesystem are copied instead.
+static int archive_volume_use_staged(ArchiveVolume* config, Docker* docker,
+                                     const char* staged,
+                                     const char* mountpoint) {
+    struct stat staged_stat = {0};
+    struct stat mountpoint_stat = {0};
+    bool same_filesystem = 0 == stat(staged, &staged_stat) &&
+                           0 == stat(mountpoint, &mountpoint_stat) &&
+                           staged_stat.st_dev == mountpoint_stat.st_dev;
+
+    int result = 0;
+    if (ARCHIVE_CHECKOUT_SWAP == config->checkout && same_filesystem) {
+        printf("%s: Swapping staged tree into the volume\n", config->name);
+        result = archive_volume_swap(config, docker, staged, mountpoint);
+    } else if (ARCHIVE_CHECKOUT_SWAP == config->checkout) {
+        printf("%s: Copying staged tree next to the volume\n", config->name);
+        result = archive_volume_extract_and_swap(config, docker, NULL, staged,
+                                                 mountpoint, NULL);
+    } else if (same_filesystem) {
+        printf("%s: Moving staged tree into the volume\n", config->name);
+        result = directory_move_contents(staged, mountpoint);
+        if (0 == result) {
+            chmod(mountpoint, staged_stat.st_mode & 07777);
+        }
+    } else {
+        printf("%s: Copying staged tree into the volume\n", config->name);
+        result = directory_clone(staged, mountpoint, DIRECTORY_CLONE_COPY);
+    }
+
+    // By now, the staged tree is empty, or holds the previous contents.
+    directory_remove_recursive(staged);
+    return result;
+}
+
+// Create the volume as an overlay of a private, empty upper layer on top of
+// the tree of <entry>, which is extracted from <file> into the cache first if
+// it's NULL. As above, the caller evicts from the cache afterwards.
+static int archive_volume_checkout_overlay(ArchiveVolume* config,
+                                           Docker* docker,
+                                           ExtractCacheEntry* entry,
+                                           FileContents* file) {
+    int result = 0;
+    bool durable = ARCHIVE_SYNC_DURABLE == config->sync;
+    char* published = NULL;
+    if (NULL == entry && ARCHIVE_CHECKOUT_LAZY == config->checkout) {
+        result = archive_lazy_start(config, file);
+        if (0 == result) {
+            published =
+                archive_overlay_get_path(config->name, ARCHIVE_OVERLAY_LAZY);
+        } else if (-ENOTSUP == result) {
+            printf("%s: Archive can't be published; extracting it first\n",
+                   config->name);
+            result = 0;
+        } else {
+            fprintf(stderr, "%s: Couldn't publish the archive: %s\n",
+                    config->name, strerror(-result));
+            return result;
+        }
+    }
+
+    if (NULL == entry && NULL == published) {
+        printf("%s: Extracting and verifying volume archive image\n",
+               config->name);
+        ArchiveExtractOptions options = {
+            .batch_io = ARCHIVE_IO_URING == config->io,
+            .parallel_gzip = ARCHIVE_GZIP_PARALLEL == config->gzip_decoder,
+            .buffer_size = config->buffer_size,
+            .durable = durable,
+            .preflight = ARCHIVE_PREFLIGHT_INDEXED,
+            .expected_hash = config->hash,
+        };
+        result = archive_volume_extract_to_cache(config, file, &options,
+                                                 &entry);
+        if (0 == result && NULL == entry) {
+            fprintf(stderr, "%s: Couldn't add the archive to the extract "
+                            "cache\n",
+                    config->name);
+            result = -EIO;
+        }
+    }
+    if (0 != result) {
+        return result;
+    }
+
+    // The pin keeps the lower layer around for as long as the volume uses it,
+    // and releases whichever entry the volume used before. Other volumes may
+    // have pinned the same entry. The lazy filesystem's server pins the entry
+    // once the archive is extracted.
+    char* mount_options = NULL;
+    if (NULL != published) {
+        result =
+            archive_overlay_create(config->name, published, &mount_options);
+    } else {
+        result = extract_cache_entry_pin(entry, config->name);
+        if (0 == result) {
+            result = archive_overlay_create(
+                config->name, extract_cache_entry_get_tree(entry),
+                &mount_options);
+        }
+    }
+    if (0 == result) {
+        printf("%s: Initializing Docker volume over the %s\n", config->name,
+               NULL != published ? "lazy filesystem" : "extract cache");
+        DockerVolume* volume = docker_volume_create_local_mount(
+            docker, config->name, "overlay", "overlay", mount_options);
+        if (NULL == volume) {
+            result = 0 != errno ? -errno : -EIO;
+        } else {
+            docker_volume_free(volume);
+        }
+    }
+    g_free(mount_options);
+
+    if (NULL != published) {
+        // The server exits once the filesystem is no longer used.
+        if (0 != result) {
+            umount2(published, MNT_DETACH);
+        }
+        g_free(published);
+        return result;
+    }
+
+    if (0 == result && durable) {
+        gint64 start = g_get_monotonic_time();
+        result =
+            directory_sync_filesystem(extract_cache_entry_get_tree(entry));
+        printf("%s: Synced to disk in %jums\n", config->name,
+               (uintmax_t)((g_get_monotonic_time() - start) / 1000));
+    }
+    extract_cache_entry_close(entry);
+    return result;
+}
+
+// Extract the archive into a new volume through a helper container, instead
+// of the mountpoint of the volume.
+static int archive_volume_checkout_through_docker(ArchiveVolume* config,
+                                                  Docker* docker,
+                                                  const FileContents* file) {
+    // The helper container extracts a single archive, whiteouts and all.
+    ArchiveLayerChain* chain = NULL;
+    int result = archive_layer_chain_open(config->url, file, &chain);
+    if (0 == result && 1 < archive_layer_chain_get_length(chain)) {
+        fprintf(stderr,
+                "%s: Layers can't be streamed through the Docker archive "
+                "API; compact the archive first\n",
+                config->name);
+        result = -ENOTSUP;
+    }
+    if (NULL != chain) {
+        archive_layer_chain_free(chain);
+    }
+    if (0 != result) {
+        return result;
+    }
+
+    printf("%s: Initializing Docker volume\n", config->name);
+    DockerVolume* volume = docker_volume_create(docker, config->name);
+    if (NULL == volume) {
+        return -EIO;
+    }
+    docker_volume_free(volume);
+
+    char* helper = archive_transport_helper_new(config, docker);
+    if (NULL == helper) {
+        return -EIO;
+    }
+
+    printf("%s: Streaming volume archive image into the volume\n",
+           config->name);
+    gint64 start = g_get_monotonic_time();
+    result = archive_transport_put(docker, helper, file);
+    archive_transport_helper_free(docker, helper);
+    if (0 == result) {
+        printf("%s: Streamed %zuK in %jums\n", config->name, file->size / 1024,
+               (uintmax_t)((g_get_monotonic_time() - start) / 1000));
+    }
+    return result;
+}
+
+// Check out the volume, once it's been decided that it's necessary.
+static int archive_volume_checkout_required(ArchiveVolume* config,
+                                            Docker* docker) {
+    if (ARCHIVE_TRANSPORT_LOCAL != config->transport &&
+        (ARCHIVE_CHECKOUT_REPLACE != config->checkout ||
+         NULL != config->include || NULL != config->exclude)) {
+        fprintf(stderr,
+                "%s: Checkouts through the Docker archive API must replace "
+                "the volume, and can't include or exclude paths\n",
+                config->name);
+        return -EINVAL;
+    }
+
+    if ((ARCHIVE_CHECKOUT_OVERLAY == config->checkout ||
+         ARCHIVE_CHECKOUT_LAZY == config->checkout) &&
+        !archive_volume_uses_cache(config)) {
+        fprintf(stderr,
+                "%s: Overlay and lazy checkouts require an extract cache and "
+                "a hash, and can't include or exclude paths\n",
+                config->name);
+        return -EINVAL;
+    }
+
+    // If this archive has been extracted before, the archive isn't needed.
+    ExtractCacheEntry* cached = NULL;
+    if (archive_volume_uses_cache(config)) {
+        cached = extract_cache_lookup(config->cache, config->hash);
+    }
+
+    // Likewise if it was extracted ahead of time.
+    char* staged = NULL;
+    if (NULL == cached) {
+        staged = archive_volume_take_staged(config);
     }
 
     // Map the file to memory
     FileContents file = {0};
-    file_contents_init(&file, config->url);
+    if (NULL == cached && NULL == staged) {
+        file_contents_init(&file, config->url);
+    }
 
     // Run a check action to determine that the checkout is safe to perform.
+    int result = 0;
     if (NULL != config->check) {
         result = config->check(config, docker, &file);
         if (0 > result) {
+            if (NULL != cached) {
+                extract_cache_entry_close(cached);
+            } else if (NULL != staged) {
+                directory_remove_recursive(staged);
+                free(staged);
+            } else {
+                file_contents_release(&file);
+            }
+            return result;
+        }
+    }
+
+    // The volume is incomplete until the checkpoint is removed again.
+    if (NULL == config->resume) {
+        ArchiveCheckpoint start = {0};
+        result = archive_lock_file_save_checkpoint(config->name, config->url,
+                                                   &start);
+        if (0 > result) {
+            fprintf(stderr, "%s: Couldn't save checkpoint: %s\n",
+                    config->name, strerror(-result));
+            if (NULL != cached) {
+                extract_cache_entry_close(cached);
+            } else if (NULL != staged) {
+                directory_remove_recursive(staged);
+                free(staged);
+            } else {
+                file_contents_release(&file);
+            }
+            return result;
+        }
+    }
+
+    if (ARCHIVE_CHECKOUT_OVERLAY == config->checkout ||
+        ARCHIVE_CHECKOUT_LAZY == config->checkout) {
+        IoStreams* streams = io_scheduler_acquire(
+            config->io_scheduler, extract_cache_get_directory(config->cache),
+            config->url, NULL);
+        result =
+            archive_volume_checkout_overlay(config, docker, cached, &file);
+        io_streams_release(streams);
+        if (NULL == cached) {
             file_contents_release(&file);
+        }
+
+        // Another job may be waiting for these streams with an entry open,
+        // which eviction would wait for in turn.
+        extract_cache_evict(config->cache);
+        if (0 != result) {
+            fprintf(stderr, "%s: Checkout failed, removing volume\n",
+                    config->name);
+            docker_volume_remove(docker, config->name);
+            extract_cache_unpin(config->cache, config->name);
+            archive_lock_file_remove_checkpoint(config->name);
+            return result;
+        }
+
+        result = archive_lock_file_remove_checkpoint(config->name);
+        if (0 == result && NULL != config->commit) {
+            result = config->commit(config, docker);
+        }
+        return result;
+    }
+
+    // The volume no longer uses any tree in the cache directly.
+    if (NULL != config->cache) {
+        extract_cache_unpin(config->cache, config->name);
+    }
+
+    if (ARCHIVE_TRANSPORT_LOCAL != config->transport) {
+        IoStreams* streams =
+            io_scheduler_acquire(config->io_scheduler, config->url, NULL);
+        result = archive_volume_checkout_through_docker(config, docker, &file);
+        io_streams_release(streams);
+        file_contents_release(&file);
+        if (0 != result) {
+            fprintf(stderr, "%s: Checkout failed, removing volume\n",
+                    config->name);
+            docker_volume_remove(docker, config->name);
+            archive_lock_file_remove_checkpoint(config->name);
             return result;
         }
+
+        result = archive_lock_file_remove_checkpoint(config->name);
+        if (0 == result && NULL != config->commit) {
+            result = config->commit(config, docker);
+        }
+        return result;
     }
 
     // Create the volume
     printf("%s: Initializing Docker volume\n", config->name);
     DockerVolume* volume = docker_volume_create(docker, config->name);
     if (NULL == volume) {
-        file_contents_release(&file);
-        return -1 * errno;
+        result = -1 * errno;
+        if (NULL != cached) {
+            extract_cache_entry_close(cached);
+        } else if (NULL != staged) {
+            directory_remove_recursive(staged);
+            free(staged);
+        } else {
+            file_contents_release(&file);
+        }
+        return result;
     }
 
     // Decompress it to disk.
-    printf("%s: Extracting volume archive image to disk\n", config->name);
-    archive_extract_to_disk_universal(&file, volume->mountpoint);
-    file_contents_release(&file);
+    ArchiveExtractStats stats = {0};
+    ArchiveExtractOptions options = {
+        .stats = &stats,
+        .batch_io = ARCHIVE_IO_URING == config->io,
+        .parallel_gzip = ARCHIVE_GZIP_PARALLEL == config->gzip_decoder,
+        .buffer_size = config->buffer_size,
+        .durable = ARCHIVE_SYNC_DURABLE == config->sync,
+        .preflight = ARCHIVE_PREFLIGHT_INDEXED,
+    };
+    if (ARCHIVE_CHECKOUT_INCREMENTAL == config->checkout) {
+        options.update = ARCHIVE_UPDATE_METADATA;
+    } else if (ARCHIVE_CHECKOUT_INCREMENTAL_CONTENTS == config->checkout) {
+        options.update = ARCHIVE_UPDATE_CONTENTS;
+    }
+    PathFilter* filter = NULL;
+    if (NULL != config->include || NULL != config->exclude) {
+        filter = path_filter_new(config->include, config->exclude);
+        options.filter = filter;
+    }
+    if (archive_volume_can_resume(config)) {
+        options.checkpoint = archive_volume_save_checkpoint;
+        options.checkpoint_data = config;
+        options.checkpoint_interval = CHECKPOINT_INTERVAL;
+        options.resume = config->resume;
+    }
+
+    // The source of the tree is the last path, since there may be no cache.
+    const char* source = config->url;
+    if (NULL != cached) {
+        source = extract_cache_entry_get_tree(cached);
+    } else if (NULL != staged) {
+        source = staged;
+    }
+    IoStreams* streams = io_scheduler_acquire(
+        config->io_scheduler, volume->mountpoint, source,
+        archive_volume_uses_cache(config)
+            ? extract_cache_get_directory(config->cache)
+            : NULL,
+        NULL);
+
+    if (NULL != cached) {
+        result = archive_volume_clone_from_cache(config, cached,
+                                                 volume->mountpoint);
+    } else if (NULL != staged) {
+        result = archive_volume_use_staged(config, docker, staged,
+                                           volume->mountpoint);
+        free(staged);
+    } else if (archive_volume_uses_cache(config)) {
+        // The entry is keyed by the hash, so the tree must be verified to
+        // match it, whatever the check action did.
+        printf("%s: Extracting and verifying volume archive image\n",
+               config->name);
+        options.expected_hash = config->hash;
+        result = archive_volume_extract_through_cache(
+            config, &file, volume->mountpoint, &options);
+        file_contents_release(&file);
+    } else if (ARCHIVE_CHECKOUT_SWAP == config->checkout) {
+        printf("%s: Extracting volume archive image next to the volume\n",
+               config->name);
+        if (ARCHIVE_VERIFY_DURING_EXTRACT == config->verify) {
+            options.expected_hash = config->hash;
+        }
+        result = archive_volume_extract_and_swap(
+            config, docker, &file, NULL, volume->mountpoint, &options);
+        file_contents_release(&file);
+    } else {
+        if (ARCHIVE_UPDATE_NONE != options.update) {
+            printf("%s: Updating volume from archive image\n", config->name);
+            if (ARCHIVE_VERIFY_DURING_EXTRACT == config->verify) {
+                options.expected_hash = config->hash;
+            }
+        } else if (ARCHIVE_VERIFY_DURING_EXTRACT == config->verify) {
+            printf("%s: Extracting and verifying volume archive image\n",
+                   config->name);
+            options.expected_hash = config->hash;
+        } else {
+            printf("%s: Extracting volume archive image to disk\n",
+                   config->name);
+        }
+        result = archive_volume_extract(config, &file, volume->mountpoint,
+                                        &options);
+        file_contents_release(&file);
+    }
+    if (NULL != filter) {
+        path_filter_free(filter);
+    }
 
+    // Extraction syncs the volume itself, but clones from the cache, staged
+    // trees and swaps don't.
+    bool extracted = NULL == cached && NULL == staged;
+    if (0 == result && options.durable &&
+        (archive_volume_uses_cache(config) || !extracted ||
+         ARCHIVE_CHECKOUT_SWAP == config->checkout)) {
+        gint64 start = g_get_monotonic_time();
+        result = directory_sync_filesystem(volume->mountpoint);
+        stats.sync_microseconds += g_get_monotonic_time() - start;
+    }
+    io_streams_release(streams);
+    if (archive_volume_uses_cache(config) && extracted) {
+        extract_cache_evict(config->cache);
+    }
     docker_volume_free(volume);
+    if (0 != result && ARCHIVE_CHECKOUT_SWAP == config->checkout) {
+        // The volume may still be in use, so it's never removed. A failed
+        // exchange is undone, leaving the previous contents in place, but if
+        // only the sync failed, the volume already holds the new contents.
+        fprintf(stderr, "%s: Checkout failed\n", config->name);
+        archive_lock_file_remove_checkpoint(config->name);
+        return result;
+    } else if (0 != result) {
+        // Don't leave an empty volume behind, or the update policy may decide
+        // that no action is required next time.
+        fprintf(stderr, "%s: Checkout failed, removing volume\n",
+                config->name);
+        docker_volume_remove(docker, config->name);
+        archive_lock_file_remove_checkpoint(config->name);
+        return result;
+    }
+
+    result = archive_lock_file_remove_checkpoint(config->name);
+    if (0 != result) {
+        fprintf(stderr, "%s: Couldn't remove checkpoint: %s\n", config->name,
+                strerror(-result));
+        return result;
+    }
+
+    if (ARCHIVE_UPDATE_NONE != options.update) {
+        printf("%s: %zu entries written, %zu unchanged, %zu removed\n",
+               config->name, stats.entries_written, stats.entries_unchanged,
+               stats.files_removed);
+    }
+    if (0 < config->buffer_size && extracted) {
+        const ArchivePipelineStats* pipeline = &stats.pipeline;
+        printf("%s: Buffered %zuK at most, %zuK on average; decompression "
+               "stalled %zu times, writing %zu times\n",
+               config->name, pipeline->peak_depth / 1024,
+               pipeline->mean_depth / 1024, pipeline->decompress_stalls,
+               pipeline->write_stalls);
+    }
+    if (options.durable) {
+        printf("%s: Synced to disk in %jums\n", config->name,
+               (uintmax_t)(stats.sync_microseconds / 1000));
+    }
 
     // Run any commit action
     if (NULL != config->commit) {
@@ -189,4 +954,222 @@ int archive_volume_checkout(ArchiveVolume* config, Docker* docker) {
     return result;
 }
 
+// Extract the archive into the extract cache, unless it's there already.
+static int archive_volume_stage_in_cache(ArchiveVolume* config) {
+    ExtractCacheEntry* entry =
+        extract_cache_lookup(config->cache, config->hash);
+    if (NULL != entry) {
+        printf("%s: Volume archive image is in the extract cache\n",
+               config->name);
+        extract_cache_entry_close(entry);
+        return 0;
+    }
+
+    printf("%s: Extracting and verifying volume archive image into the "
+           "extract cache\n",
+           config->name);
+    IoStreams* streams = io_scheduler_acquire(
+        config->io_scheduler, config->url,
+        extract_cache_get_directory(config->cache), NULL);
+    FileContents file = {0};
+    file_contents_init(&file, config->url);
+    ArchiveExtractOptions options = {
+        .batch_io = ARCHIVE_IO_URING == config->io,
+        .parallel_gzip = ARCHIVE_GZIP_PARALLEL == config->gzip_decoder,
+        .buffer_size = config->buffer_size,
+        .durable = ARCHIVE_SYNC_DURABLE == config->sync,
+        .preflight = ARCHIVE_PREFLIGHT_INDEXED,
+        .expected_hash = config->hash,
+    };
+    int result =
+        archive_volume_extract_to_cache(config, &file, &options, &entry);
+    file_contents_release(&file);
+    io_streams_release(streams);
+    if (NULL != entry) {
+        extract_cache_entry_close(entry);
+        extract_cache_evict(config->cache);
+    }
+    return result;
+}
+
+// Extract the archive into the staging directory, unless a complete tree for
+// it is there already.
+static int archive_volume_stage_tree(ArchiveVolume* config) {
+    if (0 == archive_lock_file_check_stage(config->name, config->url)) {
+        printf("%s: Volume archive image is already staged\n", config->name);
+        return 0;
+    }
+
+    // Remnants of an earlier, interrupted stage are of no use.
+    archive_lock_file_remove_stage(config->name);
+    char* staged = archive_volume_get_staged_path(config);
+    struct stat staged_stat = {0};
+    if (0 == lstat(staged, &staged_stat)) {
+        directory_remove_recursive(staged);
+    }
+
+    if ((0 != mkdir(config->staging_directory, 0700) && EEXIST != errno) ||
+        0 != mkdir(staged, 0700)) {
+        int result = -errno;
+        fprintf(stderr, "%s: Couldn't create %s: %s\n", config->name,
+                staged, strerror(errno));
+        free(staged);
+        return result;
+    }
+
+    printf("%s: Extracting and verifying volume archive image into %s\n",
+           config->name, staged);
+    FileContents file = {0};
+    file_contents_init(&file, config->url);
+    ArchiveExtractOptions options = {
+        .batch_io = ARCHIVE_IO_URING == config->io,
+        .parallel_gzip = ARCHIVE_GZIP_PARALLEL == config->gzip_decoder,
+        .buffer_size = config->buffer_size,
+        .durable = ARCHIVE_SYNC_DURABLE == config->sync,
+        .preflight = ARCHIVE_PREFLIGHT_INDEXED,
+        .expected_hash = config->hash,
+    };
+    PathFilter* filter = NULL;
+    if (NULL != config->include || NULL != config->exclude) {
+        filter = path_filter_new(config->include, config->exclude);
+        options.filter = filter;
+    }
+    IoStreams* streams = io_scheduler_acquire(config->io_scheduler,
+                                              config->url, staged, NULL);
+    int result = archive_volume_extract(config, &file, staged, &options);
+    io_streams_release(streams);
+    file_contents_release(&file);
+    if (NULL != filter) {
+        path_filter_free(filter);
+    }
+
+    if (0 == result) {
+        result = archive_lock_file_save_stage(config->name, config->url);
+    }
+    if (0 != result) {
+        fprintf(stderr, "%s: Staging failed\n", config->name);
+        directory_remove_recursive(staged);
+    }
+    free(staged);
+    return result;
+}
+
+// The lazy filesystem of an up-to-date volume doesn't survive a reboot, so its
+// server is started again. The archive is checked first, as on checkout, since
+// it may have been replaced in the meantime.
+static int archive_volume_republish(ArchiveVolume* config, Docker* docker) {
+    FileContents file = {0};
+    file_contents_init(&file, config->url);
+    int result = NULL == file.contents ? -ENOENT : 0;
+    if (0 == result && NULL != config->check) {
+        result = config->check(config, docker, &file);
+    }
+    if (0 == result) {
+        result = archive_lazy_start(config, &file);
+    }
+    file_contents_release(&file);
+    if (0 != result) {
+        fprintf(stderr, "%s: Couldn't publish the archive again: %s\n",
+                config->name, strerror(-result));
+    }
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+int archive_volume_checkout(ArchiveVolume* config, Docker* docker) {
+    // An interrupted checkout is never taken for a complete one, whatever the
+    // update policy says.
+    ArchiveCheckpoint checkpoint = {0};
+    int interrupted = archive_lock_file_load_checkpoint(
+        config->name, config->url, &checkpoint);
+    int result = 0;
+    if (-ENOENT == interrupted) {
+        // Apply the update policy to determine whether any action is
+        // required.
+        result = config->update_policy(config, docker);
+        if (VOLUMETRIC_NO_ACTION == result &&
+            ARCHIVE_CHECKOUT_LAZY == config->checkout &&
+            !archive_lazy_is_published(config)) {
+            return archive_volume_republish(config, docker);
+        } else if (VOLUMETRIC_NO_ACTION == result || 0 > result) {
+            return result;
+        }
+    } else if (0 == interrupted && archive_volume_can_resume(config) &&
+               1 == docker_volume_exists(docker, config->name)) {
+        printf("%s: Resuming interrupted checkout after %ju entries\n",
+               config->name, (uintmax_t)checkpoint.entries);
+        config->resume = &checkpoint;
+    } else {
+        printf("%s: Previous checkout was interrupted; starting over\n",
+               config->name);
+        if (ARCHIVE_CHECKOUT_REPLACE == config->checkout &&
+            1 == docker_volume_exists(docker, config->name)) {
+            result = docker_volume_remove(docker, config->name);
+        }
+    }
+
+    if (0 <= result) {
+        result = archive_volume_checkout_required(config, docker);
+    }
+    config->resume = NULL;
+    free(checkpoint.pathname);
+    return result;
+}
+
+int archive_volume_stage(ArchiveVolume* config) {
+    // An interrupted checkout is resumed, or started over, on checkout.
+    ArchiveCheckpoint checkpoint = {0};
+    int interrupted = archive_lock_file_load_checkpoint(
+        config->name, config->url, &checkpoint);
+    free(checkpoint.pathname);
+    bool uses_cache = archive_volume_uses_cache(config);
+    if (-ENOENT != interrupted ||
+        (!uses_cache && !archive_volume_can_stage(config))) {
+        return 0;
+    }
+
+    int result = config->update_policy(config, NULL);
+    if (VOLUMETRIC_NO_ACTION == result || 0 > result) {
+        return result;
+    }
+
+    return uses_cache ? archive_volume_stage_in_cache(config)
+                      : archive_volume_stage_tree(config);
+}
+
+char* archive_volume_get_source_key(ArchiveVolume* config) {
+    // Checkouts which don't go through the cache extract privately.
+    if (NULL == config->hash || NULL != config->include ||
+        ARCHIVE_TRANSPORT_LOCAL != config->transport ||
+        NULL != config->exclude || ARCHIVE_CACHE_OFF == config->cache_mode ||
+        ARCHIVE_CHECKOUT_REPLACE != config->checkout) {
+        return NULL;
+    }
+
+    char* hash = file_hash_to_string(config->hash);
+    char* key = g_strdup_printf(
+        "%s-%s", file_hash_type_to_string(config->hash->hash_type), hash);
+    free(hash);
+    return key;
+}
+
+uint64_t archive_volume_get_size(ArchiveVolume* config) {
+    struct stat archive_stat = {0};
+    if (0 != stat(config->url, &archive_stat)) {
+        return 0;
+    }
+
+    // Checking out a layer involves the whole chain beneath it.
+    ArchiveLayerChain* chain = NULL;
+    if (0 != archive_layer_chain_open(config->url, NULL, &chain)) {
+        return archive_stat.st_size;
+    }
+    uint64_t size = archive_layer_chain_get_size(chain);
+    archive_layer_chain_free(chain);
+    return size;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            chunked.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Implementations of certain routines for the chunked volume
+//                  type
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef VOLUMETRIC_VOLUME_CHUNKED_H
+#define VOLUMETRIC_VOLUME_CHUNKED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct FileHash FileHash;
+typedef struct Docker Docker;
+typedef struct IoScheduler IoScheduler;
+typedef struct SerdecYamlDeserializer SerdecYamlDeserializer;
+
+// A chunked volume--contents are kept in a chunk store (see chunk-store.h)
+// in the directory at the url, which holds every version of the volume:
+//
+//  chunks/                     Chunks of the data of regular files
+//  manifest                    The current version (see manifest.h)
+//  manifest-<date>-<time>      Previous versions, as of the date of the
+//                              commit which replaced them
+//
+// A commit only writes the chunks which aren't in the store yet, so versions
+// which are mostly the same take little more space than one of them.
+typedef struct ChunkedVolume {
+    char* name;
+    char* url;
+    FileHash* hash; // Of the manifest
+    // Limits the checkouts and commits using the same devices. Not owned, may
+    // be NULL.
+    IoScheduler* io_scheduler;
+    int (*update_policy)(struct ChunkedVolume*, Docker*);
+    int (*commit)(struct ChunkedVolume*, Docker*);
+    int (*check)(struct ChunkedVolume*, Docker*);
+} ChunkedVolume;
+
+void chunked_volume_defaults(ChunkedVolume* volume);
+int chunked_volume_deserialize_yaml(SerdecYamlDeserializer* yaml,
+                                    ChunkedVolume* volume);
+int chunked_volume_checkout(ChunkedVolume* config, Docker* docker);
+// Amount of file data in the current version.
+uint64_t chunked_volume_get_size(ChunkedVolume* config);
+int chunked_volume_diff(ChunkedVolume* volume, Docker* docker);
+int chunked_volume_commit(ChunkedVolume* volume, Docker* docker,
+                          bool dry_run);
+void chunked_volume_release(ChunkedVolume* volume);
+
+// Update policies. These behave as they do for archive volumes, with the
+// manifest in place of the archive.
+
+int chunked_volume_update_policy_never(ChunkedVolume* volume, Docker* docker);
+int chunked_volume_update_policy_on_stale_lock(ChunkedVolume* volume,
+                                               Docker* docker);
+
+// Commit actions
+
+int chunked_volume_commit_update_lock_file(ChunkedVolume* volume,
+                                           Docker* docker);
+
+// Check actions
+
+int chunked_volume_check_remove_existing_volume(ChunkedVolume* volume,
+                                                Docker* docker);
+
+#endif // VOLUMETRIC_VOLUME_CHUNKED_H
+
+///////////////////////////////////////////////////////////////////////////////
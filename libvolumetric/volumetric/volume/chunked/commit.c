@@ -0,0 +1,374 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            commit.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Commit chunked volumes to their chunk store
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fts.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glib-2.0/glib.h>
+
+#include <volumetric/chunk-store.h>
+#include <volumetric/chunker.h>
+#include <volumetric/directory.h>
+#include <volumetric/docker.h>
+#include <volumetric/hash.h>
+#include <volumetric/io-scheduler.h>
+#include <volumetric/volume/chunked.h>
+#include <volumetric/volume/chunked/manifest.h>
+
+// Chunks are always named by SHA-256, whatever the hash of the manifest is.
+static const FileHashType COMMIT_CHUNK_HASH_TYPE = FILE_HASH_TYPE_SHA256;
+
+// File data is read in blocks of this size, which must be a multiple of the
+// largest chunk.
+static const size_t COMMIT_READ_SIZE = 16 * CHUNKER_MAX_SIZE;
+
+typedef struct CommitStats {
+    size_t chunks;
+    size_t chunks_written;
+    uint64_t bytes;
+    uint64_t bytes_written;
+} CommitStats;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+// Name and store a chunk of <entry>. A dry run only counts the chunks which
+// would be written, if the store exists (<store> may be NULL).
+static int commit_chunk(ChunkStore* store, ChunkedManifestEntry* entry,
+                        const unsigned char* data, size_t length,
+                        bool dry_run, CommitStats* stats) {
+    FileHash* hash = NULL;
+    if (NULL != store) {
+        hash = chunk_store_hash(store, data, length);
+    } else {
+        hash = file_hash_of_buffer(COMMIT_CHUNK_HASH_TYPE, (void*)data,
+                                   length);
+    }
+
+    int result = 0;
+    if (dry_run) {
+        bool stored =
+            NULL != store && chunk_store_contains(store, hash, length);
+        result = stored ? 0 : 1;
+    } else {
+        result = chunk_store_put(store, hash, data, length);
+    }
+    if (0 > result) {
+        file_hash_free(hash);
+        return result;
+    }
+
+    stats->chunks += 1;
+    stats->bytes += length;
+    if (1 == result) {
+        stats->chunks_written += 1;
+        stats->bytes_written += length;
+    }
+    chunked_manifest_entry_add_chunk(entry, hash, (uint32_t)length);
+    return 0;
+}
+
+// Cut the regular file at <path> into chunks, reading it through <buffer>,
+// which holds COMMIT_READ_SIZE bytes.
+static int commit_file(ChunkStore* store, ChunkedManifestEntry* entry,
+                       const char* path, unsigned char* buffer, bool dry_run,
+                       CommitStats* stats) {
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (0 > fd) {
+        return -errno;
+    }
+
+    // Chunks are only cut once there's a full chunk's worth of data ahead of
+    // them, or the end of the file.
+    int result = 0;
+    size_t available = 0;
+    uint64_t total = 0;
+    bool end = false;
+    while (0 == result && (!end || 0 < available)) {
+        while (!end && COMMIT_READ_SIZE > available) {
+            ssize_t bytes_read = read(fd, buffer + available,
+                                      COMMIT_READ_SIZE - available);
+            if (0 > bytes_read && EINTR == errno) {
+                continue;
+            } else if (0 > bytes_read) {
+                result = -errno;
+                break;
+            }
+            end = 0 == bytes_read;
+            available += bytes_read;
+        }
+
+        size_t offset = 0;
+        while (0 == result && 0 < available - offset &&
+               (end || CHUNKER_MAX_SIZE <= available - offset)) {
+            size_t length =
+                chunker_next_boundary(buffer + offset, available - offset);
+            result = commit_chunk(store, entry, buffer + offset, length,
+                                  dry_run, stats);
+            offset += length;
+        }
+
+        memmove(buffer, buffer + offset, available - offset);
+        available -= offset;
+        total += offset;
+    }
+
+    close(fd);
+
+    // The manifest must describe the data which was stored.
+    if (0 == result && total != entry->size) {
+        fprintf(stderr, "%s changed while it was committed\n", path);
+        result = -EAGAIN;
+    }
+    return result;
+}
+
+static int commit_compare_names(const FTSENT** first, const FTSENT** second) {
+    return strcmp((*first)->fts_name, (*second)->fts_name);
+}
+
+// Record every entry underneath <mountpoint> in <manifest>. Entries are
+// sorted by name, so that unchanged volumes have identical manifests.
+static int commit_tree(ChunkStore* store, ChunkedManifest* manifest,
+                       const char* mountpoint, bool dry_run,
+                       CommitStats* stats) {
+    char* root = g_strdup(mountpoint);
+    size_t root_length = strlen(root);
+    while (1 < root_length && '/' == root[root_length - 1]) {
+        root[--root_length] = '\0';
+    }
+    char* const paths[] = {root, NULL};
+    FTS* tree = fts_open(paths, FTS_NOCHDIR | FTS_PHYSICAL | FTS_XDEV,
+                         commit_compare_names);
+    if (NULL == tree) {
+        int result = -errno;
+        g_free(root);
+        return result;
+    }
+
+    unsigned char* buffer = malloc(COMMIT_READ_SIZE);
+    assert(NULL != buffer);
+    int result = 0;
+    FTSENT* node = NULL;
+    while (0 == result && NULL != (node = fts_read(tree))) {
+        if (FTS_DP == node->fts_info) {
+            continue;
+        } else if (FTS_ERR == node->fts_info || FTS_DNR == node->fts_info ||
+                   FTS_NS == node->fts_info) {
+            fprintf(stderr, "%s: %s\n", node->fts_path,
+                    strerror(node->fts_errno));
+            result = -node->fts_errno;
+            continue;
+        } else if (FTS_D != node->fts_info && FTS_F != node->fts_info &&
+                   FTS_SL != node->fts_info && FTS_SLNONE != node->fts_info) {
+            printf("Skipping special file %s\n", node->fts_path);
+            continue;
+        }
+
+        const char* relative = node->fts_path + root_length;
+        char* path = 0 == node->fts_level ? g_strdup(".")
+                                          : g_strdup_printf(".%s", relative);
+        ChunkedManifestEntry* entry =
+            chunked_manifest_add_entry(manifest, path, node->fts_statp);
+        g_free(path);
+        if (FTS_F == node->fts_info) {
+            result = commit_file(store, entry, node->fts_path, buffer,
+                                 dry_run, stats);
+        } else if (FTS_SL == node->fts_info || FTS_SLNONE == node->fts_info) {
+            entry->target = g_file_read_link(node->fts_path, NULL);
+            result = NULL == entry->target ? -EIO : 0;
+        }
+        if (0 != result) {
+            fprintf(stderr, "Couldn't commit %s: %s\n", node->fts_path,
+                    strerror(-result));
+        }
+    }
+
+    free(buffer);
+    fts_close(tree);
+    g_free(root);
+    return result;
+}
+
+// Print the hash of the new manifest.
+static void commit_print_hash(ChunkedVolume* volume, const char* path) {
+    gchar* contents = NULL;
+    gsize length = 0;
+    if (!g_file_get_contents(path, &contents, &length, NULL)) {
+        return;
+    }
+
+    FileHashType hash_type = NULL != volume->hash ? volume->hash->hash_type
+                                                  : COMMIT_CHUNK_HASH_TYPE;
+    FileHash* hash = file_hash_of_buffer(hash_type, contents, length);
+    char* hash_string = file_hash_to_string(hash);
+    printf("%s: %s\n", file_hash_type_to_string(hash_type), hash_string);
+    free(hash_string);
+    file_hash_free(hash);
+    g_free(contents);
+}
+
+// Replace the current manifest with the one at <path>, keeping the current
+// one under the date of the commit.
+static int commit_replace_manifest(ChunkedVolume* volume, const char* path) {
+    char* manifest_path = chunked_manifest_get_path(volume->url);
+    GDateTime* now = g_date_time_new_now_local();
+    char* date = g_date_time_format(now, "%Y%m%d-%H%M%S");
+    g_date_time_unref(now);
+    char* previous_path = g_strdup_printf("%s-%s", manifest_path, date);
+    g_free(date);
+
+    int result = 0;
+    struct stat manifest_stat = {0};
+    if (0 == stat(manifest_path, &manifest_stat)) {
+        printf("%s: Renaming %s to %s\n", volume->name, manifest_path,
+               previous_path);
+        if (0 != rename(manifest_path, previous_path)) {
+            result = -errno;
+            perror("couldn't rename manifest");
+        }
+    }
+
+    if (0 == result && 0 != rename(path, manifest_path)) {
+        result = -errno;
+        perror("couldn't rename manifest");
+        rename(previous_path, manifest_path);
+    }
+    if (0 == result) {
+        commit_print_hash(volume, manifest_path);
+    }
+
+    g_free(previous_path);
+    g_free(manifest_path);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+int chunked_volume_commit(ChunkedVolume* volume, Docker* docker,
+                          bool dry_run) {
+    // A dry run doesn't create the store, but it can tell how much would be
+    // written to an existing one.
+    ChunkStore* store = NULL;
+    int result = chunk_store_open(volume->url, COMMIT_CHUNK_HASH_TYPE,
+                                  !dry_run, &store);
+    if (0 != result && (!dry_run || -ENOENT != result)) {
+        fprintf(stderr, "%s: Couldn't open chunk store %s: %s\n",
+                volume->name, volume->url, strerror(-result));
+        return result;
+    } else if (0 != result) {
+        printf("Chunk store %s doesn't appear to exist. Assuming this is an "
+               "initial commit.\n",
+               volume->url);
+        result = 0;
+    }
+
+    // Get the list of containers that have this volume mounted
+    GPtrArray* containers =
+        docker_container_list_consumers(docker, volume->name);
+
+    // Pause any running containers that have the volume mounted
+    printf("Pausing any containers that have this volume mounted...\n");
+    for (guint i = 0; 0 == result && i < containers->len; ++i) {
+        printf("Pausing %s\n", (const char*)containers->pdata[i]);
+        if (!dry_run) {
+            result = docker_container_pause(docker,
+                                            (const char*)containers->pdata[i]);
+        }
+    }
+
+    // Only new chunks are written, and the manifest is written last, once
+    // they're all on disk, so it never names a chunk that's missing.
+    DockerVolume* live_volume = NULL;
+    if (0 == result) {
+        live_volume = docker_volume_inspect(docker, volume->name);
+        result = NULL == live_volume ? -ENOENT : 0;
+    }
+    ChunkedManifest* manifest = chunked_manifest_new(COMMIT_CHUNK_HASH_TYPE);
+    CommitStats stats = {0};
+    char* manifest_path = g_strdup_printf("%s/manifest.new", volume->url);
+    if (0 == result) {
+        IoStreams* streams = io_scheduler_acquire(
+            volume->io_scheduler, volume->url, live_volume->mountpoint, NULL);
+        result = commit_tree(store, manifest, live_volume->mountpoint,
+                             dry_run, &stats);
+        if (0 == result && !dry_run) {
+            unlink(manifest_path);
+            result = chunked_manifest_write(manifest, manifest_path);
+        }
+        if (0 == result && !dry_run) {
+            result = directory_sync_filesystem(volume->url);
+        }
+        io_streams_release(streams);
+    }
+    if (0 == result) {
+        printf("%s: %u entries, %zu of %zu chunks (%ju of %ju bytes) %s "
+               "new\n",
+               volume->name, manifest->entries->len, stats.chunks_written,
+               stats.chunks, (uintmax_t)stats.bytes_written,
+               (uintmax_t)stats.bytes, dry_run ? "would be" : "were");
+    }
+    if (0 == result && !dry_run) {
+        result = commit_replace_manifest(volume, manifest_path);
+    }
+
+    g_free(manifest_path);
+    chunked_manifest_free(manifest);
+    if (NULL != live_volume) {
+        docker_volume_free(live_volume);
+    }
+    if (NULL != store) {
+        chunk_store_free(store);
+    }
+
+    // Un-pause all the containers that have the volume mounted
+    printf("Unpausing containers\n");
+    for (guint i = 0; i < containers->len; ++i) {
+        printf("Un-pausing %s\n", (const char*)containers->pdata[i]);
+        if (!dry_run) {
+            // Don't reset the error code to zero if commit failed
+            result += docker_container_unpause(
+                docker, (const char*)containers->pdata[i]);
+        }
+    }
+
+    g_ptr_array_unref(containers);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,391 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            manifest.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     The list of entries in a version of a chunked volume
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib-2.0/glib.h>
+
+#include <volumetric/chunker.h>
+#include <volumetric/volume/chunked/manifest.h>
+
+static const char* MANIFEST_FORMAT = "volumetric-manifest";
+static const int MANIFEST_VERSION = 1;
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static void chunked_manifest_chunk_clear(gpointer data) {
+    ChunkedManifestChunk* chunk = data;
+    file_hash_free(chunk->hash);
+}
+
+static void chunked_manifest_entry_free(gpointer data) {
+    ChunkedManifestEntry* entry = data;
+    g_free(entry->path);
+    g_free(entry->target);
+    if (NULL != entry->chunks) {
+        g_array_unref(entry->chunks);
+    }
+    g_free(entry);
+}
+
+// Paths must be "." or "./<path>", without empty, "." or ".." components,
+// and their parent must be a directory which came before them, so that
+// nothing is ever created outside of the volume.
+static bool chunked_manifest_path_is_valid(GHashTable* directories,
+                                           const char* path) {
+    if (!strcmp(".", path)) {
+        return 0 == g_hash_table_size(directories);
+    } else if (strncmp("./", path, 2)) {
+        return false;
+    }
+
+    char** components = g_strsplit(path + 2, "/", -1);
+    bool valid = NULL != components[0];
+    for (char** component = components; valid && NULL != *component;
+         ++component) {
+        valid = '\0' != **component && strcmp(".", *component) &&
+                strcmp("..", *component);
+    }
+    g_strfreev(components);
+
+    char* parent = g_path_get_dirname(path);
+    valid = valid && g_hash_table_contains(directories, parent);
+    g_free(parent);
+    return valid;
+}
+
+static int chunked_manifest_parse_entry(ChunkedManifest* manifest,
+                                        GHashTable* directories,
+                                        const char* line) {
+    unsigned int mode = 0;
+    unsigned int uid = 0;
+    unsigned int gid = 0;
+    intmax_t seconds = 0;
+    long nanoseconds = 0;
+    uintmax_t size = 0;
+    int offset = 0;
+    if (6 != sscanf(line, "%o %u %u %jd.%ld %ju %n", &mode, &uid, &gid,
+                    &seconds, &nanoseconds, &size, &offset) ||
+        0 == offset || '\0' == line[offset] || 0 > nanoseconds ||
+        999999999 < nanoseconds) {
+        return -EBADMSG;
+    } else if (!S_ISDIR(mode) && !S_ISREG(mode) && !S_ISLNK(mode)) {
+        return -EBADMSG;
+    }
+
+    char* path = g_strcompress(line + offset);
+    if (!chunked_manifest_path_is_valid(directories, path)) {
+        fprintf(stderr, "Invalid path in manifest: %s\n", line + offset);
+        g_free(path);
+        return -EBADMSG;
+    }
+
+    struct stat entry_stat = {
+        .st_mode = mode,
+        .st_uid = uid,
+        .st_gid = gid,
+        .st_mtim = {.tv_sec = seconds, .tv_nsec = nanoseconds},
+        .st_size = S_ISREG(mode) ? (off_t)size : 0,
+    };
+    chunked_manifest_add_entry(manifest, path, &entry_stat);
+    if (S_ISDIR(mode)) {
+        g_hash_table_add(directories, path);
+    } else {
+        g_free(path);
+    }
+    return 0;
+}
+
+static int chunked_manifest_parse_chunk(ChunkedManifest* manifest,
+                                        ChunkedManifestEntry* entry,
+                                        const char* line) {
+    if (NULL == entry || NULL == entry->chunks) {
+        return -EBADMSG;
+    }
+
+    const char* hex = line + 2;
+    size_t hex_length = strspn(hex, "0123456789abcdef");
+    if (0 == hex_length || 0 != hex_length % 2 || ' ' != hex[hex_length]) {
+        return -EBADMSG;
+    }
+
+    char* end = NULL;
+    errno = 0;
+    unsigned long length = strtoul(hex + hex_length + 1, &end, 10);
+    if (0 != errno || '\0' != *end || 0 == length ||
+        CHUNKER_MAX_SIZE < length) {
+        return -EBADMSG;
+    }
+
+    char* hash_string = g_strndup(hex, hex_length);
+    FileHash* hash = file_hash_from_string(manifest->hash_type, hash_string);
+    g_free(hash_string);
+    assert(NULL != hash);
+    chunked_manifest_entry_add_chunk(entry, hash, (uint32_t)length);
+    return 0;
+}
+
+// Check that <entry> is complete, once the lines following it are read.
+static bool chunked_manifest_entry_is_complete(ChunkedManifestEntry* entry) {
+    if (NULL == entry) {
+        return true;
+    } else if (S_ISLNK(entry->mode)) {
+        return NULL != entry->target;
+    } else if (!S_ISREG(entry->mode)) {
+        return true;
+    }
+
+    uint64_t size = 0;
+    for (guint i = 0; i < entry->chunks->len; ++i) {
+        size += g_array_index(entry->chunks, ChunkedManifestChunk, i).length;
+    }
+    return size == entry->size;
+}
+
+static int chunked_manifest_parse_header(const char* line,
+                                         FileHashType* hash_type) {
+    char format[32] = {0};
+    char hash_name[32] = {0};
+    int version = 0;
+    if (3 != sscanf(line, "%31s %d %31s", format, &version, hash_name) ||
+        strcmp(MANIFEST_FORMAT, format)) {
+        return -EBADMSG;
+    } else if (MANIFEST_VERSION != version) {
+        fprintf(stderr, "Unsupported manifest version: %d\n", version);
+        return -ENOTSUP;
+    }
+
+    *hash_type = file_hash_type_from_string(hash_name);
+    return FILE_HASH_TYPE_INVALID == *hash_type ? -EBADMSG : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+char* chunked_manifest_get_path(const char* store) {
+    return g_strdup_printf("%s/manifest", store);
+}
+
+ChunkedManifest* chunked_manifest_new(FileHashType hash_type) {
+    ChunkedManifest* manifest = g_malloc0(sizeof(ChunkedManifest));
+    manifest->hash_type = hash_type;
+    manifest->entries =
+        g_ptr_array_new_with_free_func(chunked_manifest_entry_free);
+    return manifest;
+}
+
+void chunked_manifest_free(ChunkedManifest* manifest) {
+    g_ptr_array_unref(manifest->entries);
+    g_free(manifest);
+}
+
+ChunkedManifestEntry* chunked_manifest_add_entry(
+    ChunkedManifest* manifest, const char* path,
+    const struct stat* entry_stat) {
+    ChunkedManifestEntry* entry = g_malloc0(sizeof(ChunkedManifestEntry));
+    entry->path = g_strdup(path);
+    entry->mode = entry_stat->st_mode;
+    entry->uid = entry_stat->st_uid;
+    entry->gid = entry_stat->st_gid;
+    entry->mtime = entry_stat->st_mtim;
+    if (S_ISREG(entry_stat->st_mode)) {
+        entry->size = entry_stat->st_size;
+        entry->chunks =
+            g_array_new(FALSE, FALSE, sizeof(ChunkedManifestChunk));
+        g_array_set_clear_func(entry->chunks, chunked_manifest_chunk_clear);
+        manifest->size += entry->size;
+    }
+    g_ptr_array_add(manifest->entries, entry);
+    return entry;
+}
+
+void chunked_manifest_entry_add_chunk(ChunkedManifestEntry* entry,
+                                      FileHash* hash, uint32_t length) {
+    ChunkedManifestChunk chunk = {.hash = hash, .length = length};
+    g_array_append_val(entry->chunks, chunk);
+}
+
+int chunked_manifest_read(const void* contents, size_t size,
+                          ChunkedManifest** manifest) {
+    char* text = g_strndup(contents, size);
+    char** lines = g_strsplit(text, "\n", -1);
+    g_free(text);
+
+    FileHashType hash_type = FILE_HASH_TYPE_INVALID;
+    int result = NULL != lines[0]
+                     ? chunked_manifest_parse_header(lines[0], &hash_type)
+                     : -EBADMSG;
+    if (0 != result) {
+        g_strfreev(lines);
+        return result;
+    }
+
+    ChunkedManifest* new_manifest = chunked_manifest_new(hash_type);
+    GHashTable* directories =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    ChunkedManifestEntry* entry = NULL;
+    for (char** line = &lines[1]; 0 == result && NULL != *line; ++line) {
+        if ('\0' == **line) {
+            continue;
+        } else if (!strncmp("+ ", *line, 2)) {
+            result = chunked_manifest_parse_chunk(new_manifest, entry, *line);
+        } else if (!strncmp("> ", *line, 2)) {
+            if (NULL == entry || !S_ISLNK(entry->mode) ||
+                NULL != entry->target) {
+                result = -EBADMSG;
+            } else {
+                entry->target = g_strcompress(*line + 2);
+            }
+        } else if (!chunked_manifest_entry_is_complete(entry)) {
+            result = -EBADMSG;
+        } else {
+            result = chunked_manifest_parse_entry(new_manifest, directories,
+                                                  *line);
+            if (0 == result) {
+                entry = g_ptr_array_index(new_manifest->entries,
+                                          new_manifest->entries->len - 1);
+            }
+        }
+    }
+    g_hash_table_unref(directories);
+    g_strfreev(lines);
+
+    if (0 == result && (0 == new_manifest->entries->len ||
+                        !chunked_manifest_entry_is_complete(entry))) {
+        result = -EBADMSG;
+    }
+    if (0 != result) {
+        chunked_manifest_free(new_manifest);
+        return result;
+    }
+
+    *manifest = new_manifest;
+    return 0;
+}
+
+int chunked_manifest_open(const char* path, const FileHash* expected_hash,
+                          ChunkedManifest** manifest) {
+    gchar* contents = NULL;
+    gsize length = 0;
+    GError* error = NULL;
+    if (!g_file_get_contents(path, &contents, &length, &error)) {
+        fprintf(stderr, "Couldn't read manifest: %s\n", error->message);
+        int result = G_FILE_ERROR_NOENT == error->code ? -ENOENT : -EIO;
+        g_error_free(error);
+        return result;
+    }
+
+    if (NULL != expected_hash) {
+        FileHash* hash =
+            file_hash_of_buffer(expected_hash->hash_type, contents, length);
+        if (!file_hash_equal(expected_hash, hash)) {
+            char* expected = file_hash_to_string(expected_hash);
+            char* got = file_hash_to_string(hash);
+            fprintf(stderr,
+                    "Error: %s hash mismatch for file %s.\n"
+                    "Expected:\n"
+                    "    %s\n"
+                    "Got:\n"
+                    "    %s\n",
+                    file_hash_type_to_string(expected_hash->hash_type), path,
+                    expected, got);
+            free(expected);
+            free(got);
+            file_hash_free(hash);
+            g_free(contents);
+            return -EINVAL;
+        }
+        file_hash_free(hash);
+    }
+
+    int result = chunked_manifest_read(contents, length, manifest);
+    if (0 != result) {
+        fprintf(stderr, "Couldn't parse manifest %s: %s\n", path,
+                strerror(-result));
+    }
+    g_free(contents);
+    return result;
+}
+
+int chunked_manifest_write(const ChunkedManifest* manifest, const char* path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0444);
+    if (0 > fd) {
+        return -errno;
+    }
+    FILE* output = fdopen(fd, "w");
+    assert(NULL != output);
+
+    fprintf(output, "%s %d %s\n", MANIFEST_FORMAT, MANIFEST_VERSION,
+            file_hash_type_to_string(manifest->hash_type));
+    for (guint i = 0; i < manifest->entries->len; ++i) {
+        const ChunkedManifestEntry* entry = manifest->entries->pdata[i];
+        char* path_escaped = g_strescape(entry->path, NULL);
+        fprintf(output, "%o %u %u %jd.%09ld %ju %s\n", (unsigned)entry->mode,
+                (unsigned)entry->uid, (unsigned)entry->gid,
+                (intmax_t)entry->mtime.tv_sec, entry->mtime.tv_nsec,
+                (uintmax_t)entry->size, path_escaped);
+        g_free(path_escaped);
+
+        for (guint j = 0; NULL != entry->chunks && j < entry->chunks->len;
+             ++j) {
+            const ChunkedManifestChunk* chunk =
+                &g_array_index(entry->chunks, ChunkedManifestChunk, j);
+            char* hash = file_hash_to_string(chunk->hash);
+            fprintf(output, "+ %s %" PRIu32 "\n", hash, chunk->length);
+            free(hash);
+        }
+        if (NULL != entry->target) {
+            char* target_escaped = g_strescape(entry->target, NULL);
+            fprintf(output, "> %s\n", target_escaped);
+            g_free(target_escaped);
+        }
+    }
+
+    int result = 0;
+    if (0 != fflush(output) || 0 != fsync(fd)) {
+        result = -errno;
+    }
+    if (0 != fclose(output) && 0 == result) {
+        result = -errno;
+    }
+    if (0 != result) {
+        unlink(path);
+    }
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
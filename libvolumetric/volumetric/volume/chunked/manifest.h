@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            manifest.h
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     The list of entries in a version of a chunked volume
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#ifndef VOLUMETRIC_VOLUME_CHUNKED_MANIFEST_H
+#define VOLUMETRIC_VOLUME_CHUNKED_MANIFEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <volumetric/hash.h>
+
+typedef struct _GArray GArray;
+typedef struct _GPtrArray GPtrArray;
+
+// A manifest is a text file. The first line names the format, and the hash
+// type naming the chunks. Every entry of the volume follows on a line of its
+// own, parents before their children:
+//
+//  volumetric-manifest 1 <hash type>
+//  <mode, in octal> <uid> <gid> <mtime seconds>.<nanoseconds> <size> <path>
+//  + <hash> <length>           One per chunk of a regular file, in order
+//  > <target>                  The target of a symbolic link
+//
+// Paths are relative to the root of the volume, which is ".", and escaped
+// as by g_strescape(), as are link targets. Only directories, regular files
+// and symbolic links are recorded.
+
+typedef struct ChunkedManifestChunk {
+    FileHash* hash;
+    uint32_t length;
+} ChunkedManifestChunk;
+
+typedef struct ChunkedManifestEntry {
+    char* path;
+    mode_t mode;
+    uid_t uid;
+    gid_t gid;
+    struct timespec mtime;
+    uint64_t size;
+    char* target; // Of symbolic links, NULL otherwise
+    GArray* chunks; // Of ChunkedManifestChunk, for regular files
+} ChunkedManifestEntry;
+
+typedef struct ChunkedManifest {
+    FileHashType hash_type; // Of the chunks
+    GPtrArray* entries;
+    uint64_t size; // Of all regular files
+} ChunkedManifest;
+
+// Path of the current manifest of the volume whose chunk store is the
+// directory <store>. Must be free'd with g_free().
+char* chunked_manifest_get_path(const char* store);
+
+ChunkedManifest* chunked_manifest_new(FileHashType hash_type);
+void chunked_manifest_free(ChunkedManifest* manifest);
+
+// Append an entry for <path>, with the metadata in <entry_stat>.
+ChunkedManifestEntry* chunked_manifest_add_entry(
+    ChunkedManifest* manifest, const char* path,
+    const struct stat* entry_stat);
+
+// Append a chunk of <length> bytes to the data of <entry>, taking ownership
+// of <hash>.
+void chunked_manifest_entry_add_chunk(ChunkedManifestEntry* entry,
+                                      FileHash* hash, uint32_t length);
+
+// Parse the manifest of <size> bytes at <contents>. Returns 0 on success,
+// or a negative errno.
+int chunked_manifest_read(const void* contents, size_t size,
+                          ChunkedManifest** manifest);
+
+// Read and parse the manifest at <path>. If <expected_hash> isn't NULL, the
+// file must match it. Returns 0 on success, or a negative errno.
+int chunked_manifest_open(const char* path, const FileHash* expected_hash,
+                          ChunkedManifest** manifest);
+
+// Write the manifest to a new file at <path>, and sync it to disk. Returns 0
+// on success, or a negative errno.
+int chunked_manifest_write(const ChunkedManifest* manifest, const char* path);
+
+#endif // VOLUMETRIC_VOLUME_CHUNKED_MANIFEST_H
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,149 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            status.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Compare chunked volumes with their current version
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <assert.h>
+#include <errno.h>
+#include <fts.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <glib-2.0/glib.h>
+
+#include <volumetric/docker.h>
+#include <volumetric/volume/chunked.h>
+#include <volumetric/volume/chunked/manifest.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static bool check_entry_for_modifications(const ChunkedManifestEntry* entry,
+                                          const struct stat* file_stat) {
+    bool diff = file_stat->st_mode != entry->mode;
+    if (S_ISREG(file_stat->st_mode)) {
+        diff = diff || (uint64_t)file_stat->st_size != entry->size;
+    }
+
+    diff = diff || file_stat->st_mtime != entry->mtime.tv_sec;
+    return diff;
+}
+
+static gint compare_paths(gconstpointer first, gconstpointer second) {
+    return strcmp((const char*)first, (const char*)second);
+}
+
+static int compare_names(const FTSENT** first, const FTSENT** second) {
+    return strcmp((*first)->fts_name, (*second)->fts_name);
+}
+
+// Find what's changed in the directory from the manifest. Paths are printed
+// relative to the root of the volume.
+static int diff_directory_from_manifest(const ChunkedManifest* manifest,
+                                        const char* mountpoint) {
+    GHashTable* entries = g_hash_table_new(g_str_hash, g_str_equal);
+    for (guint i = 1; i < manifest->entries->len; ++i) {
+        ChunkedManifestEntry* entry = manifest->entries->pdata[i];
+        g_hash_table_insert(entries, entry->path + 2, entry);
+    }
+
+    char* root = g_strdup(mountpoint);
+    size_t root_length = strlen(root);
+    while (1 < root_length && '/' == root[root_length - 1]) {
+        root[--root_length] = '\0';
+    }
+    char* const paths[] = {root, NULL};
+    FTS* tree =
+        fts_open(paths, FTS_NOCHDIR | FTS_PHYSICAL | FTS_XDEV, compare_names);
+    assert(NULL != tree);
+
+    int result = 0;
+    FTSENT* node = NULL;
+    while (0 == result && NULL != (node = fts_read(tree))) {
+        if (FTS_DP == node->fts_info || 0 == node->fts_level) {
+            continue;
+        } else if (FTS_ERR == node->fts_info || FTS_DNR == node->fts_info ||
+                   FTS_NS == node->fts_info) {
+            fprintf(stderr, "fts_read error: %s\n",
+                    strerror(node->fts_errno));
+            result = -node->fts_errno;
+            continue;
+        }
+
+        const char* path = node->fts_path + root_length + 1;
+        const ChunkedManifestEntry* entry = g_hash_table_lookup(entries, path);
+        if (NULL == entry) {
+            printf("A %s\n", path);
+            continue;
+        }
+
+        if (check_entry_for_modifications(entry, node->fts_statp)) {
+            printf("M %s\n", path);
+        }
+        g_hash_table_remove(entries, path);
+    }
+    fts_close(tree);
+    g_free(root);
+
+    GList* removed =
+        g_list_sort(g_hash_table_get_keys(entries), compare_paths);
+    for (GList* iter = removed; 0 == result && NULL != iter;
+         iter = iter->next) {
+        printf("D %s\n", (const char*)iter->data);
+    }
+    g_list_free(removed);
+
+    g_hash_table_unref(entries);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+int chunked_volume_diff(ChunkedVolume* volume, Docker* docker) {
+    DockerVolume* live_volume = docker_volume_inspect(docker, volume->name);
+    docker_proxy_free(docker);
+    assert(NULL != live_volume);
+
+    char* manifest_path = chunked_manifest_get_path(volume->url);
+    ChunkedManifest* manifest = NULL;
+    int result = chunked_manifest_open(manifest_path, NULL, &manifest);
+    g_free(manifest_path);
+    if (0 == result) {
+        result = diff_directory_from_manifest(manifest,
+                                              live_volume->mountpoint);
+        chunked_manifest_free(manifest);
+    }
+
+    docker_volume_free(live_volume);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
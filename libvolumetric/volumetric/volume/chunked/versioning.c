@@ -0,0 +1,344 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            versioning.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Checkout and update policies of chunked volumes
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glib-2.0/glib.h>
+
+#include <volumetric/chunk-store.h>
+#include <volumetric/chunker.h>
+#include <volumetric/directory.h>
+#include <volumetric/docker.h>
+#include <volumetric/io-scheduler.h>
+#include <volumetric/volume/archive.h>
+#include <volumetric/volume/archive/lock-file.h>
+#include <volumetric/volume/chunked.h>
+#include <volumetric/volume/chunked/manifest.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Update Policies
+////
+
+// In this case, if the volume already exists, we do nothing.
+int chunked_volume_update_policy_never(ChunkedVolume* volume, Docker* docker) {
+    int result = docker_volume_exists(docker, volume->name);
+    if (result < 0) {
+        return result;
+    } else if (result == 1) {
+        printf("%s: Volume exists, taking no further action.\n", volume->name);
+        return VOLUMETRIC_NO_ACTION;
+    }
+
+    return VOLUMETRIC_ACTION_REQUIRED;
+}
+
+int chunked_volume_update_policy_on_stale_lock(ChunkedVolume* volume,
+                                               Docker* docker) {
+    // If the lock file does not exist, checkout the volume.
+    ArchiveLockFile* lock_file = archive_lock_file_open(volume->name);
+    if (NULL == lock_file) {
+        return VOLUMETRIC_ACTION_REQUIRED;
+    }
+
+    // Every commit replaces the manifest, so it's as recent as the volume.
+    const struct timespec lock_stat = archive_lock_file_get_mtime(lock_file);
+    archive_lock_file_close(lock_file);
+
+    char* manifest_path = chunked_manifest_get_path(volume->url);
+    struct stat manifest_stat = {0};
+    int result = stat(manifest_path, &manifest_stat);
+    g_free(manifest_path);
+    if (0 != result) {
+        return -errno;
+    }
+
+    if (manifest_stat.st_mtim.tv_sec > lock_stat.tv_sec) {
+        printf("%s: Lock file is stale; performing checkout\n", volume->name);
+        return VOLUMETRIC_ACTION_REQUIRED;
+    }
+
+    printf("%s: Lock file is up-to-date; taking no further action\n",
+           volume->name);
+    return VOLUMETRIC_NO_ACTION;
+}
+
+int chunked_volume_check_remove_existing_volume(ChunkedVolume* volume,
+                                                Docker* docker) {
+    // Remove the volume if it exists, to prevent contamination.
+    int result = 0;
+    if (docker_volume_exists(docker, volume->name)) {
+        result = docker_volume_remove(docker, volume->name);
+    }
+
+    return result;
+}
+
+int chunked_volume_commit_update_lock_file(ChunkedVolume* volume,
+                                           Docker* docker) {
+    ArchiveLockFile* lock_file = archive_lock_file_create(volume->name);
+    if (NULL == lock_file) {
+        char message[80] = {0};
+        strerror_r(errno, message, sizeof(message));
+        fprintf(stderr, "Couldn't create lock file: %s\n", message);
+        return -EINVAL;
+    }
+
+    // The volume is synced before the lock file vouches for it.
+    int result = archive_lock_file_sync(lock_file);
+    if (0 != result) {
+        fprintf(stderr, "Couldn't sync lock file: %s\n", strerror(-result));
+    }
+
+    archive_lock_file_close(lock_file);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Private API
+////
+
+static int chunked_volume_write_all(int fd, const unsigned char* data,
+                                    size_t length) {
+    while (0 < length) {
+        ssize_t written = write(fd, data, length);
+        if (0 > written && EINTR != errno) {
+            return -errno;
+        } else if (0 < written) {
+            data += written;
+            length -= written;
+        }
+    }
+
+    return 0;
+}
+
+// Reassemble the regular file <entry> at <path> from its chunks, through
+// <buffer>, which holds CHUNKER_MAX_SIZE bytes.
+static int chunked_volume_write_file(ChunkStore* store,
+                                     const ChunkedManifestEntry* entry,
+                                     const char* path,
+                                     unsigned char* buffer) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                  0600);
+    if (0 > fd) {
+        return -errno;
+    }
+
+    int result = 0;
+    for (guint i = 0; 0 == result && i < entry->chunks->len; ++i) {
+        const ChunkedManifestChunk* chunk =
+            &g_array_index(entry->chunks, ChunkedManifestChunk, i);
+        result = chunk_store_get(store, chunk->hash, buffer,
+                                 CHUNKER_MAX_SIZE, chunk->length);
+        if (0 == result) {
+            result = chunked_volume_write_all(fd, buffer, chunk->length);
+        }
+    }
+
+    if (0 != close(fd) && 0 == result) {
+        result = -errno;
+    }
+    return result;
+}
+
+static int chunked_volume_write_metadata(const ChunkedManifestEntry* entry,
+                                         const char* path) {
+    // Ownership can only be given away by root.
+    if (0 == geteuid() && 0 != lchown(path, entry->uid, entry->gid)) {
+        return -errno;
+    } else if (!S_ISLNK(entry->mode) &&
+               0 != chmod(path, entry->mode & 07777)) {
+        return -errno;
+    }
+
+    const struct timespec times[2] = {entry->mtime, entry->mtime};
+    if (0 != utimensat(AT_FDCWD, path, times, AT_SYMLINK_NOFOLLOW)) {
+        return -errno;
+    }
+    return 0;
+}
+
+static char* chunked_volume_get_entry_path(const ChunkedManifestEntry* entry,
+                                           const char* mountpoint) {
+    if (!strcmp(".", entry->path)) {
+        return g_strdup(mountpoint);
+    }
+    return g_strdup_printf("%s/%s", mountpoint, entry->path + 2);
+}
+
+// Recreate the entries of <manifest> underneath <mountpoint>. Manifests list
+// parents before their children, so directories are created first, and their
+// metadata written last, in the opposite order.
+static int chunked_volume_write_tree(ChunkStore* store,
+                                     const ChunkedManifest* manifest,
+                                     const char* mountpoint) {
+    unsigned char* buffer = malloc(CHUNKER_MAX_SIZE);
+    assert(NULL != buffer);
+
+    int result = 0;
+    for (guint i = 0; 0 == result && i < manifest->entries->len; ++i) {
+        const ChunkedManifestEntry* entry = manifest->entries->pdata[i];
+        char* path = chunked_volume_get_entry_path(entry, mountpoint);
+        if (S_ISDIR(entry->mode)) {
+            if (0 != i && 0 != mkdir(path, 0700) && EEXIST != errno) {
+                result = -errno;
+            }
+        } else if (S_ISREG(entry->mode)) {
+            result = chunked_volume_write_file(store, entry, path, buffer);
+        } else if (0 != symlink(entry->target, path)) {
+            result = -errno;
+        }
+
+        if (0 == result && !S_ISDIR(entry->mode)) {
+            result = chunked_volume_write_metadata(entry, path);
+        }
+        if (0 != result) {
+            fprintf(stderr, "Couldn't write %s: %s\n", path,
+                    strerror(-result));
+        }
+        g_free(path);
+    }
+
+    for (guint i = manifest->entries->len; 0 == result && 0 < i; --i) {
+        const ChunkedManifestEntry* entry = manifest->entries->pdata[i - 1];
+        if (S_ISDIR(entry->mode)) {
+            char* path = chunked_volume_get_entry_path(entry, mountpoint);
+            result = chunked_volume_write_metadata(entry, path);
+            g_free(path);
+        }
+    }
+
+    free(buffer);
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Public API
+////
+
+int chunked_volume_checkout(ChunkedVolume* config, Docker* docker) {
+    // Apply the update policy to determine whether any action is required.
+    int result = config->update_policy(config, docker);
+    if (VOLUMETRIC_NO_ACTION == result || 0 > result) {
+        return result;
+    }
+
+    // The manifest names every chunk by its hash, so the whole version is
+    // verified by its hash, and the hash of each chunk as it's read.
+    char* manifest_path = chunked_manifest_get_path(config->url);
+    if (NULL != config->hash) {
+        printf("%s: Checking hash of file %s\n", config->name, manifest_path);
+    }
+    ChunkedManifest* manifest = NULL;
+    result = chunked_manifest_open(manifest_path, config->hash, &manifest);
+    g_free(manifest_path);
+    if (0 != result) {
+        return result;
+    }
+
+    ChunkStore* store = NULL;
+    result = chunk_store_open(config->url, manifest->hash_type, false, &store);
+    if (0 != result) {
+        fprintf(stderr, "%s: Couldn't open chunk store %s: %s\n",
+                config->name, config->url, strerror(-result));
+        chunked_manifest_free(manifest);
+        return result;
+    }
+
+    // Run a check action to determine that the checkout is safe to perform.
+    if (NULL != config->check) {
+        result = config->check(config, docker);
+        if (0 > result) {
+            chunk_store_free(store);
+            chunked_manifest_free(manifest);
+            return result;
+        }
+    }
+
+    // Create the volume
+    printf("%s: Initializing Docker volume\n", config->name);
+    DockerVolume* volume = docker_volume_create(docker, config->name);
+    if (NULL == volume) {
+        result = -1 * errno;
+        chunk_store_free(store);
+        chunked_manifest_free(manifest);
+        return result;
+    }
+
+    IoStreams* streams = io_scheduler_acquire(
+        config->io_scheduler, volume->mountpoint, config->url, NULL);
+    printf("%s: Reassembling %u entries from chunks\n", config->name,
+           manifest->entries->len);
+    result = chunked_volume_write_tree(store, manifest, volume->mountpoint);
+    if (0 == result) {
+        result = directory_sync_filesystem(volume->mountpoint);
+    }
+    io_streams_release(streams);
+    docker_volume_free(volume);
+    chunk_store_free(store);
+    chunked_manifest_free(manifest);
+    if (0 != result) {
+        // Don't leave an incomplete volume behind, or the update policy may
+        // decide that no action is required next time.
+        fprintf(stderr, "%s: Checkout failed, removing volume\n",
+                config->name);
+        docker_volume_remove(docker, config->name);
+        return result;
+    }
+
+    // Run any commit action
+    if (NULL != config->commit) {
+        result = config->commit(config, docker);
+    }
+
+    return result;
+}
+
+uint64_t chunked_volume_get_size(ChunkedVolume* config) {
+    char* manifest_path = chunked_manifest_get_path(config->url);
+    struct stat manifest_stat = {0};
+    ChunkedManifest* manifest = NULL;
+    if (0 != stat(manifest_path, &manifest_stat) ||
+        0 != chunked_manifest_open(manifest_path, NULL, &manifest)) {
+        g_free(manifest_path);
+        return 0;
+    }
+
+    g_free(manifest_path);
+    uint64_t size = manifest->size;
+    chunked_manifest_free(manifest);
+    return size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,120 @@
+#!/bin/sh
+###############################################################################
+# NAME:             benchmark-jobs.sh
+#
+# AUTHOR:           Ethan D. Twardy <ethan.twardy@gmail.com>
+#
+# DESCRIPTION:      Measure how the wall-clock time of volumetric-checkout
+#                   scales with the number of jobs.
+#
+# CREATED:          10/17/2026
+#
+# LAST EDITED:      10/17/2026
+#
+# Copyright 2026, Ethan D. Twardy
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+###
+
+# Usage: benchmark-jobs.sh VOLUMETRIC_CHECKOUT
+#
+# Checks out VOLUMES archive volumes of VOLUME_SIZE MiB each, from scratch,
+# once for each number of jobs in JOBS, and prints the wall-clock time and
+# the speedup over the first run. Needs a Docker daemon (or DOCKER_HOST),
+# the docker CLI, and write access to the lock directory, VOLUMETRIC_LOCK_DIR.
+# The volumes are named volumetric-benchmark-N, and are removed afterwards.
+#
+# Exits with 77 (skipped) if the daemon isn't reachable.
+
+set -e
+
+checkout="$1"
+volumes="${VOLUMES:-40}"
+volume_size="${VOLUME_SIZE:-16}"
+jobs="${JOBS:-1 2 4 8 16}"
+lock_directory="${VOLUMETRIC_LOCK_DIR:-/var/lib/volumetric}"
+
+if [ -z "$checkout" ]; then
+    printf >&2 'Usage: %s VOLUMETRIC_CHECKOUT\n' "$0"
+    exit 2
+fi
+
+if ! docker info >/dev/null 2>&1 || [ ! -w "$lock_directory" ]; then
+    printf >&2 'The Docker daemon or %s is unavailable, skipping\n' \
+           "$lock_directory"
+    exit 77
+fi
+
+work=$(mktemp -d)
+remove_volumes() {
+    for i in $(seq 0 $((volumes - 1))); do
+        docker volume rm -f "volumetric-benchmark-$i" >/dev/null
+        rm -f "$lock_directory/volumetric-benchmark-$i.lock"
+    done
+}
+cleanup() {
+    remove_volumes
+    rm -rf "$work"
+}
+trap cleanup EXIT
+
+# Every volume holds 64 files, half random data and half zeroes, so that
+# decompression and writing both take a fair share of the time.
+mkdir -p "$work/images" "$work/volumes"
+file_size=$((volume_size * 1024 / 64))
+for i in $(seq 0 $((volumes - 1))); do
+    tree="$work/tree"
+    mkdir -p "$tree"
+    for j in $(seq 0 31); do
+        head -c "${file_size}K" /dev/urandom > "$tree/random-$j"
+        head -c "${file_size}K" /dev/zero > "$tree/zero-$j"
+    done
+
+    image="$work/images/volumetric-benchmark-$i.tar.gz"
+    tar -C "$tree" -czf "$image" .
+    rm -rf "$tree"
+    hash=$(sha256sum "$image" | cut -d' ' -f1)
+    cat > "$work/volumes/volumetric-benchmark-$i.yaml" <<EOF
+version: '1.0'
+volumes:
+  volumetric-benchmark-$i:
+    archive:
+      name: volumetric-benchmark-$i
+      url: $image
+      sha256: $hash
+EOF
+done
+
+cat > "$work/volumetric.yaml" <<EOF
+version: '1.0'
+volume-directory: $work/volumes
+EOF
+
+printf '%d volumes of %d MiB\n' "$volumes" "$volume_size"
+printf '%6s %10s %8s\n' jobs seconds speedup
+baseline=
+for count in $jobs; do
+    remove_volumes
+    sync
+    start=$(date +%s.%N)
+    "$checkout" -c "$work/volumetric.yaml" -j "$count" >/dev/null
+    end=$(date +%s.%N)
+
+    seconds=$(awk "BEGIN { print $end - $start }")
+    baseline="${baseline:-$seconds}"
+    printf '%6d %10.2f %8.2f\n' "$count" "$seconds" \
+           "$(awk "BEGIN { print $baseline / $seconds }")"
+done
+
+###############################################################################
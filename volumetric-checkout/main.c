@@ -7,7 +7,7 @@
 //
 // CREATED:         01/16/2022
 //
-// LAST EDITED:     02/15/2022
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -29,10 +29,20 @@
 #include <assert.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <glib-2.0/glib.h>
 
@@ -40,6 +50,8 @@
 #include <volumetric/configuration.h>
 #include <volumetric/directory.h>
 #include <volumetric/docker.h>
+#include <volumetric/extract-cache.h>
+#include <volumetric/io-scheduler.h>
 #include <volumetric/project-file.h>
 #include <volumetric/volume.h>
 
@@ -51,15 +63,72 @@ static struct argp_option options[] = {
      "Read configuration file FILE instead of default "
      "(" CONFIG_CONFIGURATION_FILE ")",
      0},
+    {"jobs", 'j', "N", 0,
+     "Check out up to N volumes concurrently (0 for one job per CPU)", 0},
+    {"stage", 's', 0, 0,
+     "Extract volume images ahead of checkout, without the Docker daemon", 0},
     {0},
 };
 static char args_doc[] = "";
 
 struct arguments {
     const char* configuration_file;
+    unsigned int jobs;
+    bool stage;
 };
 
+// A group of volumes (see group_volumes), which are checked out one after
+// another, once every job they depend on is finished.
+typedef struct CheckoutJob {
+    GPtrArray* volumes;
+    // Highest priority of the volumes, and of the jobs depending on this one
+    int priority;
+    uint64_t size;
+    GPtrArray* dependents;
+    // Number of unfinished jobs this one depends on
+    guint waiting;
+    // Whether a job this one depends on failed, in which case its volumes are
+    // skipped.
+    bool failed;
+} CheckoutJob;
+
+// State shared between the checkout workers. Whichever worker becomes idle
+// first claims the ready job with the highest priority, and the largest one
+// among those, so that the longest checkouts aren't started last.
+typedef struct CheckoutQueue {
+    GPtrArray* ready;
+    guint remaining;
+    guint volumes_finished;
+    guint volume_count;
+    bool stage;
+    // The first error any job returned
+    int result;
+    GMutex lock;
+    GCond changed;
+} CheckoutQueue;
+
+// Each worker owns a Docker connection for the duration of the run, since the
+// proxy (and the CURL handle inside it) can't be shared between threads.
+// Staging workers don't have one.
+typedef struct CheckoutWorker {
+    CheckoutQueue* queue;
+    Docker* docker;
+    GThread* thread;
+} CheckoutWorker;
+
 static const char* CONFIGURATION_FILE = CONFIG_CONFIGURATION_FILE;
+static const char* EXTRACT_CACHE_DIRECTORY = CONFIG_LOCK_PATH "/cache";
+static const char* STAGING_DIRECTORY = CONFIG_LOCK_PATH "/staging";
+// Holds archive images shared by several volumes when there's no extract
+// cache, from staging until the end of the next checkout.
+static const char* SHARED_CACHE_DIRECTORY = CONFIG_LOCK_PATH "/shared";
+// An empty file is created here for each volume once it's checked out, so
+// that services can wait for the volumes they use, instead of all of them.
+// The service manager only hears that we're ready once every volume is, so
+// services which should start sooner must wait for these instead, e.g. with
+// PathExists= in a path unit. The directory is under /run, so that no marker
+// survives a reboot to claim that a volume is ready before it's checked out.
+static const char* READY_DIRECTORY = CONFIG_RUNTIME_PATH "/ready";
 
 static error_t parse_opt(int key, char* arg, struct argp_state* state) {
     struct arguments* arguments = (struct arguments*)state->input;
@@ -67,6 +136,19 @@ static error_t parse_opt(int key, char* arg, struct argp_state* state) {
     case 'c':
         arguments->configuration_file = arg;
         break;
+    case 'j': {
+        char* end = NULL;
+        long jobs = strtol(arg, &end, 10);
+        if ('\0' != *end || 0 > jobs) {
+            argp_error(state, "invalid number of jobs: %s", arg);
+        }
+
+        arguments->jobs = (unsigned int)jobs;
+        break;
+    }
+    case 's':
+        arguments->stage = true;
+        break;
     default:
         return ARGP_ERR_UNKNOWN;
     }
@@ -74,28 +156,471 @@ static error_t parse_opt(int key, char* arg, struct argp_state* state) {
     return 0;
 }
 
-static int load_volumes(VolumetricConfiguration* config) {
+// Take ownership of every volume in every project file, since the project
+// iterator releases the volumes of a project when it advances to the next one.
+static GPtrArray* collect_volumes(VolumetricConfiguration* config) {
+    GPtrArray* volumes =
+        g_ptr_array_new_with_free_func((GDestroyNotify)volume_free);
     ProjectIter* project_iter = project_iter_new(config);
     assert(NULL != project_iter);
-    Docker* docker = docker_proxy_new();
-    assert(NULL != docker);
 
     const ProjectFile* project = NULL;
-    int result = 0;
     while (NULL != (project = project_iter_next(project_iter))) {
-
         GHashTableIter iter;
         gpointer key, value;
         g_hash_table_iter_init(&iter, project->volumes);
         while (g_hash_table_iter_next(&iter, &key, &value)) {
-            Volume* current_volume = (Volume*)value;
-            // Making sure we always report an error if there's at least one.
-            result += volume_checkout(current_volume, docker);
+            g_hash_table_iter_steal(&iter);
+            g_ptr_array_add(volumes, value);
+            free(key);
         }
     }
 
-    docker_proxy_free(docker);
     project_iter_free(project_iter);
+    return volumes;
+}
+
+// Send a message to the service manager, if it's listening (see
+// sd_notify(3)).
+static void notify_systemd(const char* format, ...) {
+    const char* path = getenv("NOTIFY_SOCKET");
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (NULL == path || ('/' != path[0] && '@' != path[0]) ||
+        strlen(path) >= sizeof(address.sun_path)) {
+        return;
+    }
+
+    // Names starting with '@' are in the abstract namespace.
+    size_t path_length = strlen(path);
+    memcpy(address.sun_path, path, path_length);
+    if ('@' == path[0]) {
+        address.sun_path[0] = '\0';
+    }
+
+    char message[256] = {0};
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (0 > fd) {
+        return;
+    }
+    sendto(fd, message, strlen(message), MSG_NOSIGNAL,
+           (struct sockaddr*)&address,
+           offsetof(struct sockaddr_un, sun_path) + path_length);
+    close(fd);
+}
+
+static void mark_volume_ready(Volume* volume) {
+    char* path =
+        g_strdup_printf("%s/%s", READY_DIRECTORY, volume_get_name(volume));
+    int fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (0 > fd) {
+        fprintf(stderr, "%s: Couldn't create %s: %s\n",
+                volume_get_name(volume), path, strerror(errno));
+    } else {
+        close(fd);
+    }
+    g_free(path);
+}
+
+// Claim the next job to run. The queue must be locked, and a job ready.
+static CheckoutJob* take_next_job(CheckoutQueue* queue) {
+    guint next = 0;
+    for (guint i = 1; i < queue->ready->len; ++i) {
+        CheckoutJob* job = queue->ready->pdata[i];
+        CheckoutJob* best = queue->ready->pdata[next];
+        if (job->priority > best->priority ||
+            (job->priority == best->priority && job->size > best->size)) {
+            next = i;
+        }
+    }
+    return g_ptr_array_remove_index(queue->ready, next);
+}
+
+// Release the jobs depending on <job>. The queue must be locked.
+static void finish_job(CheckoutQueue* queue, CheckoutJob* job, bool failed) {
+    for (guint i = 0; i < job->dependents->len; ++i) {
+        CheckoutJob* dependent = job->dependents->pdata[i];
+        dependent->failed = dependent->failed || failed;
+        if (0 == --dependent->waiting) {
+            g_ptr_array_add(queue->ready, dependent);
+        }
+    }
+    --queue->remaining;
+    g_cond_broadcast(&queue->changed);
+}
+
+static int run_job(CheckoutQueue* queue, CheckoutJob* job, Docker* docker) {
+    int result = 0;
+    for (guint i = 0; i < job->volumes->len; ++i) {
+        Volume* volume = job->volumes->pdata[i];
+        int volume_result = 0;
+        if (job->failed) {
+            fprintf(stderr,
+                    "%s: Skipped, since a volume it depends on failed\n",
+                    volume_get_name(volume));
+            volume_result = -ECANCELED;
+        } else if (queue->stage) {
+            volume_result = volume_stage(volume);
+        } else {
+            volume_result = volume_checkout(volume, docker);
+            if (0 == volume_result) {
+                mark_volume_ready(volume);
+            }
+        }
+        if (0 == result) {
+            result = volume_result;
+        }
+
+        g_mutex_lock(&queue->lock);
+        guint finished = ++queue->volumes_finished;
+        g_mutex_unlock(&queue->lock);
+        notify_systemd("STATUS=%s %u of %u volumes (last: %s)",
+                       queue->stage ? "Staged" : "Checked out", finished,
+                       queue->volume_count, volume_get_name(volume));
+    }
+    return result;
+}
+
+static gpointer checkout_worker_run(gpointer user_data) {
+    CheckoutWorker* worker = (CheckoutWorker*)user_data;
+    CheckoutQueue* queue = worker->queue;
+    g_mutex_lock(&queue->lock);
+    for (;;) {
+        while (0 == queue->ready->len && 0 < queue->remaining) {
+            g_cond_wait(&queue->changed, &queue->lock);
+        }
+        if (0 == queue->ready->len) {
+            break;
+        }
+        CheckoutJob* job = take_next_job(queue);
+        g_mutex_unlock(&queue->lock);
+
+        int result = run_job(queue, job, worker->docker);
+
+        g_mutex_lock(&queue->lock);
+        if (0 == queue->result) {
+            queue->result = result;
+        }
+        finish_job(queue, job, 0 != result);
+    }
+    g_mutex_unlock(&queue->lock);
+
+    return NULL;
+}
+
+static int checkout_volumes(GPtrArray* jobs_by_order, guint volume_count,
+                            unsigned int jobs, bool stage) {
+    CheckoutQueue queue = {
+        .ready = g_ptr_array_new(),
+        .remaining = jobs_by_order->len,
+        .volume_count = volume_count,
+        .stage = stage,
+    };
+    g_mutex_init(&queue.lock);
+    g_cond_init(&queue.changed);
+    for (guint i = 0; i < jobs_by_order->len; ++i) {
+        CheckoutJob* job = jobs_by_order->pdata[i];
+        if (0 == job->waiting) {
+            g_ptr_array_add(queue.ready, job);
+        }
+    }
+
+    // Docker proxies are created up front, on this thread, because the first
+    // call to curl_easy_init() performs global initialization that is not
+    // thread-safe. The volumes can be checked out by fewer workers than were
+    // asked for, but not by none.
+    CheckoutWorker* workers = calloc(jobs, sizeof(CheckoutWorker));
+    assert(NULL != workers);
+    unsigned int workers_started = 0;
+    for (unsigned int i = 0; i < jobs; ++i) {
+        workers[i].queue = &queue;
+        workers[i].docker = stage ? NULL : docker_proxy_new();
+        if (!stage && NULL == workers[i].docker) {
+            if (0 == i) {
+                fprintf(stderr, "Couldn't connect to the Docker daemon\n");
+                queue.result = -ENOTCONN;
+            } else {
+                fprintf(stderr,
+                        "Couldn't connect to the Docker daemon for every "
+                        "job, continuing with %u of %u\n",
+                        i, jobs);
+            }
+            break;
+        }
+        ++workers_started;
+    }
+
+    if (1 == workers_started) {
+        checkout_worker_run(&workers[0]);
+    } else {
+        for (unsigned int i = 0; i < workers_started; ++i) {
+            workers[i].thread = g_thread_new("checkout", checkout_worker_run,
+                                             &workers[i]);
+        }
+        for (unsigned int i = 0; i < workers_started; ++i) {
+            g_thread_join(workers[i].thread);
+        }
+    }
+
+    for (unsigned int i = 0; i < workers_started; ++i) {
+        if (NULL != workers[i].docker) {
+            docker_proxy_free(workers[i].docker);
+        }
+    }
+    free(workers);
+    g_ptr_array_unref(queue.ready);
+    g_mutex_clear(&queue.lock);
+    g_cond_clear(&queue.changed);
+    return queue.result;
+}
+
+// Volumes checked out from the same archive image are grouped together, so
+// that the first of them extracts the image into the extract cache and the
+// rest are cloned from it, instead of every one of them extracting it.
+static GPtrArray* group_volumes(GPtrArray* volumes) {
+    GPtrArray* groups =
+        g_ptr_array_new_with_free_func((GDestroyNotify)g_ptr_array_unref);
+    GHashTable* groups_by_key =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    for (guint i = 0; i < volumes->len; ++i) {
+        Volume* volume = volumes->pdata[i];
+        char* key = volume_get_source_key(volume);
+        GPtrArray* group = NULL;
+        if (NULL != key) {
+            group = g_hash_table_lookup(groups_by_key, key);
+        }
+
+        if (NULL == group) {
+            group = g_ptr_array_new();
+            g_ptr_array_add(groups, group);
+            if (NULL != key) {
+                g_hash_table_insert(groups_by_key, key, group);
+                key = NULL;
+            }
+        }
+        g_ptr_array_add(group, volume);
+        g_free(key);
+    }
+
+    g_hash_table_unref(groups_by_key);
+    return groups;
+}
+
+static void checkout_job_free(gpointer data) {
+    CheckoutJob* job = data;
+    g_ptr_array_unref(job->volumes);
+    g_ptr_array_unref(job->dependents);
+    free(job);
+}
+
+// Add the dependencies of the volumes in <job> on other jobs.
+static int add_dependencies(CheckoutJob* job, GHashTable* jobs_by_volume) {
+    int result = 0;
+    for (guint i = 0; i < job->volumes->len; ++i) {
+        Volume* volume = job->volumes->pdata[i];
+        if (NULL == volume->depends_on) {
+            continue;
+        }
+
+        gchar** names = g_strsplit(volume->depends_on, ":", -1);
+        for (gchar** name = names; NULL != *name; ++name) {
+            CheckoutJob* dependency =
+                g_hash_table_lookup(jobs_by_volume, *name);
+            if ('\0' == **name) {
+                continue;
+            } else if (NULL == dependency) {
+                fprintf(stderr, "%s: Depends on unknown volume %s\n",
+                        volume_get_name(volume), *name);
+                result = -EINVAL;
+            } else if (dependency != job &&
+                       !g_ptr_array_find(dependency->dependents, job, NULL)) {
+                // Volumes in the same job are checked out in order anyway.
+                g_ptr_array_add(dependency->dependents, job);
+                ++job->waiting;
+            }
+        }
+        g_strfreev(names);
+    }
+    return result;
+}
+
+// Turn the groups of volumes into jobs, ordered so that every job comes after
+// the jobs it depends on. Returns NULL if a volume depends on one that doesn't
+// exist, or if the dependencies form a cycle.
+static GPtrArray* schedule_jobs(GPtrArray* groups) {
+    GPtrArray* jobs = g_ptr_array_new_with_free_func(checkout_job_free);
+    GHashTable* jobs_by_volume = g_hash_table_new(g_str_hash, g_str_equal);
+    for (guint i = 0; i < groups->len; ++i) {
+        CheckoutJob* job = calloc(1, sizeof(CheckoutJob));
+        assert(NULL != job);
+        job->volumes = g_ptr_array_ref(groups->pdata[i]);
+        job->dependents = g_ptr_array_new();
+        job->priority = INT_MIN;
+        for (guint j = 0; j < job->volumes->len; ++j) {
+            Volume* volume = job->volumes->pdata[j];
+            job->priority = MAX(job->priority, volume->priority);
+            job->size += volume_get_size(volume);
+            g_hash_table_insert(jobs_by_volume,
+                                (char*)volume_get_name(volume), job);
+        }
+        g_ptr_array_add(jobs, job);
+    }
+
+    int result = 0;
+    for (guint i = 0; i < jobs->len; ++i) {
+        if (0 != add_dependencies(jobs->pdata[i], jobs_by_volume)) {
+            result = -EINVAL;
+        }
+    }
+    g_hash_table_unref(jobs_by_volume);
+
+    // Order the jobs, counting down the dependencies of each job as the jobs
+    // they depend on are added.
+    GPtrArray* ordered = g_ptr_array_new();
+    for (guint i = 0; i < jobs->len && 0 == result; ++i) {
+        CheckoutJob* job = jobs->pdata[i];
+        if (0 == job->waiting) {
+            g_ptr_array_add(ordered, job);
+        }
+    }
+    for (guint i = 0; i < ordered->len; ++i) {
+        CheckoutJob* job = ordered->pdata[i];
+        for (guint j = 0; j < job->dependents->len; ++j) {
+            CheckoutJob* dependent = job->dependents->pdata[j];
+            if (0 == --dependent->waiting) {
+                g_ptr_array_add(ordered, dependent);
+            }
+        }
+    }
+    if (0 == result && ordered->len < jobs->len) {
+        fprintf(stderr, "Volume dependencies form a cycle\n");
+        result = -EINVAL;
+    }
+    if (0 != result) {
+        g_ptr_array_unref(ordered);
+        g_ptr_array_unref(jobs);
+        return NULL;
+    }
+
+    // Jobs inherit the priority of the jobs waiting for them, so that those
+    // aren't held up by less important ones.
+    for (guint i = ordered->len; 0 < i; --i) {
+        CheckoutJob* job = ordered->pdata[i - 1];
+        for (guint j = 0; j < job->dependents->len; ++j) {
+            CheckoutJob* dependent = job->dependents->pdata[j];
+            job->priority = MAX(job->priority, dependent->priority);
+            ++dependent->waiting;
+        }
+    }
+
+    g_ptr_array_set_free_func(jobs, NULL);
+    g_ptr_array_unref(jobs);
+    g_ptr_array_set_free_func(ordered, checkout_job_free);
+    return ordered;
+}
+
+static double seconds_since(const struct timespec* start) {
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) +
+           (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static int load_volumes(VolumetricConfiguration* config, unsigned int jobs,
+                        bool stage) {
+    struct timespec start = {0};
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    GPtrArray* volumes = collect_volumes(config);
+    const char* staging_directory = NULL != config->staging_directory
+                                        ? config->staging_directory
+                                        : STAGING_DIRECTORY;
+    ExtractCache* cache = NULL;
+    if (0 < config->extract_cache_size) {
+        cache = extract_cache_new(EXTRACT_CACHE_DIRECTORY,
+                                  config->extract_cache_size);
+    }
+
+    // Jobs on different devices run in parallel, but each device only takes
+    // as many as its limit.
+    IoScheduler* io_scheduler = io_scheduler_new(config->io_limits);
+
+    // Without an extract cache, images shared by several volumes go through
+    // one which is never evicted from, and removed after checkout.
+    GPtrArray* groups = group_volumes(volumes);
+    ExtractCache* shared_cache = NULL;
+    for (guint i = 0; i < groups->len; ++i) {
+        GPtrArray* group = groups->pdata[i];
+        if (1 < group->len && NULL == cache && NULL == shared_cache) {
+            shared_cache =
+                extract_cache_new(SHARED_CACHE_DIRECTORY, UINT64_MAX);
+        }
+
+        ExtractCache* group_cache = 1 < group->len && NULL == cache
+                                        ? shared_cache
+                                        : cache;
+        for (guint j = 0; j < group->len; ++j) {
+            if (NULL != group_cache) {
+                volume_set_extract_cache(group->pdata[j], group_cache);
+            }
+            volume_set_io_scheduler(group->pdata[j], io_scheduler);
+            volume_set_extract_buffer_size(group->pdata[j],
+                                           config->extract_buffer_size);
+            volume_set_staging_directory(
+                group->pdata[j], staging_directory, config->docker_root);
+        }
+    }
+
+    if (0 == jobs) {
+        jobs = g_get_num_processors();
+    }
+    if (jobs > groups->len && 0 < groups->len) {
+        jobs = groups->len;
+    }
+
+    // Volumes are marked ready again as they're checked out.
+    if (!stage && 0 == access(READY_DIRECTORY, F_OK)) {
+        directory_remove_recursive(READY_DIRECTORY);
+    }
+    if (!stage && 0 != g_mkdir_with_parents(READY_DIRECTORY, 0755)) {
+        fprintf(stderr, "Couldn't create %s: %s\n", READY_DIRECTORY,
+                strerror(errno));
+    }
+
+    int result = 0;
+    GPtrArray* scheduled = schedule_jobs(groups);
+    if (NULL == scheduled) {
+        result = -EINVAL;
+    } else if (0 < scheduled->len) {
+        result = checkout_volumes(scheduled, volumes->len, jobs, stage);
+    }
+
+    // Report wall-clock time so that the effect of --jobs can be measured.
+    printf("%s %u volumes in %.3fs using %u job(s)\n",
+           stage ? "Staged" : "Checked out", volumes->len,
+           seconds_since(&start), jobs);
+    notify_systemd("READY=1\nSTATUS=%s %u volumes%s",
+                   stage ? "Staged" : "Checked out", volumes->len,
+                   0 != result ? ", with errors" : "");
+    if (NULL != scheduled) {
+        g_ptr_array_unref(scheduled);
+    }
+    g_ptr_array_unref(groups);
+    g_ptr_array_unref(volumes);
+    if (NULL != cache) {
+        extract_cache_free(cache);
+    }
+    if (NULL != shared_cache) {
+        extract_cache_free(shared_cache);
+    }
+    io_scheduler_free(io_scheduler);
+    if (!stage && 0 == access(SHARED_CACHE_DIRECTORY, F_OK)) {
+        directory_remove_recursive(SHARED_CACHE_DIRECTORY);
+    }
     return result;
 }
 
@@ -104,6 +629,7 @@ static struct argp argp = {options, parse_opt, args_doc, doc, 0, 0, 0};
 int main(int argc, char** argv) {
     struct arguments arguments = {
         .configuration_file = CONFIGURATION_FILE,
+        .jobs = 1,
     };
 
     argp_parse(&argp, argc, argv, 0, 0, &arguments);
@@ -114,7 +640,7 @@ int main(int argc, char** argv) {
         return result;
     }
 
-    result = load_volumes(&config);
+    result = load_volumes(&config, arguments.jobs, arguments.stage);
     volumetric_configuration_release(&config);
     return result;
 }
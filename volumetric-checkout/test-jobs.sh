@@ -0,0 +1,128 @@
+#!/bin/sh
+###############################################################################
+# NAME:             test-jobs.sh
+#
+# AUTHOR:           Ethan D. Twardy <ethan.twardy@gmail.com>
+#
+# DESCRIPTION:      Check out volumes on several jobs, through the extract
+#                   cache, with one I/O stream per device.
+#
+# CREATED:          10/17/2026
+#
+# LAST EDITED:      10/17/2026
+#
+# Copyright 2026, Ethan D. Twardy
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+###
+
+# Usage: test-jobs.sh VOLUMETRIC_CHECKOUT
+#
+# Checks out VOLUMES archive volumes twice, on JOBS jobs, with an extract
+# cache too small for all of their images. The second checkout finds some of
+# the images in the cache, and evicts others, while other jobs wait for the
+# only stream of the device. Fails if either checkout doesn't finish within
+# TIMEOUT seconds. Needs a Docker daemon (or DOCKER_HOST), the docker CLI, and
+# write access to the lock directory, VOLUMETRIC_LOCK_DIR. The extract cache
+# in it must be empty, since the test evicts from it. The volumes are named
+# volumetric-test-N, and are removed afterwards.
+#
+# Exits with 77 (skipped) if any of these is unavailable.
+
+set -e
+
+checkout="$1"
+volumes="${VOLUMES:-8}"
+jobs="${JOBS:-4}"
+timeout="${TIMEOUT:-300}"
+lock_directory="${VOLUMETRIC_LOCK_DIR:-/var/lib/volumetric}"
+cache_directory="$lock_directory/cache"
+
+if [ -z "$checkout" ]; then
+    printf >&2 'Usage: %s VOLUMETRIC_CHECKOUT\n' "$0"
+    exit 2
+fi
+
+if ! docker info >/dev/null 2>&1 || [ ! -w "$lock_directory" ]; then
+    printf >&2 'The Docker daemon or %s is unavailable, skipping\n' \
+           "$lock_directory"
+    exit 77
+elif [ -n "$(ls -A "$cache_directory" 2>/dev/null | grep -v '^\.lock$')" ]
+then
+    printf >&2 '%s is in use, skipping\n' "$cache_directory"
+    exit 77
+fi
+
+work=$(mktemp -d)
+remove_volumes() {
+    for i in $(seq 0 $((volumes - 1))); do
+        docker volume rm -f "volumetric-test-$i" >/dev/null
+        rm -f "$lock_directory/volumetric-test-$i.lock"
+    done
+}
+cleanup() {
+    remove_volumes
+    rm -rf "$work"
+    find "$cache_directory" -mindepth 1 -maxdepth 1 ! -name .lock \
+         -exec rm -rf {} + 2>/dev/null || true
+}
+trap cleanup EXIT
+
+# Every image holds 1 MiB, and the cache takes about half of them.
+mkdir -p "$work/images" "$work/volumes"
+for i in $(seq 0 $((volumes - 1))); do
+    tree="$work/tree"
+    mkdir -p "$tree"
+    head -c 1M /dev/urandom > "$tree/random"
+
+    image="$work/images/volumetric-test-$i.tar.gz"
+    tar -C "$tree" -czf "$image" .
+    rm -rf "$tree"
+    hash=$(sha256sum "$image" | cut -d' ' -f1)
+    cat > "$work/volumes/volumetric-test-$i.yaml" <<EOT
+version: '1.0'
+volumes:
+  volumetric-test-$i:
+    archive:
+      name: volumetric-test-$i
+      url: $image
+      sha256: $hash
+EOT
+done
+
+cat > "$work/volumetric.yaml" <<EOT
+version: '1.0'
+volume-directory: $work/volumes
+extract-cache-size: $((volumes / 2))M
+io-limits:
+  rotational: 1
+  solid-state: 1
+  network: 1
+EOT
+
+for run in first second; do
+    remove_volumes
+    status=0
+    timeout "$timeout" "$checkout" -c "$work/volumetric.yaml" -j "$jobs" \
+            >/dev/null || status=$?
+    if [ 124 -eq "$status" ]; then
+        printf >&2 'The %s checkout timed out after %ss\n' "$run" "$timeout"
+        exit 1
+    elif [ 0 -ne "$status" ]; then
+        printf >&2 'The %s checkout failed (%d)\n' "$run" "$status"
+        exit 1
+    fi
+done
+
+###############################################################################
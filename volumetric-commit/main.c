@@ -7,7 +7,7 @@
 //
 // CREATED:         02/04/2022
 //
-// LAST EDITED:     06/22/2022
+// LAST EDITED:     10/17/2026
 //
 // Copyright 2022, Ethan D. Twardy
 //
@@ -32,6 +32,7 @@
 #include <config.h>
 #include <volumetric/configuration.h>
 #include <volumetric/docker.h>
+#include <volumetric/io-scheduler.h>
 #include <volumetric/volume.h>
 
 const char* argp_program_version = "volumetric-diff " CONFIG_VERSION;
@@ -46,6 +47,10 @@ static struct argp_option options[] = {
      0},
     {"dry-run", 'd', 0, 0,
      "Act as if we were performing a real commit, but don't do anything", 0},
+    {"compact", 'C', 0, 0,
+     "Merge the layers written by incremental commits into a single archive, "
+     "instead of committing the volume",
+     0},
     {0},
 };
 
@@ -55,6 +60,7 @@ struct arguments {
     const char* volume_name;
     const char* configuration_file;
     bool dry_run;
+    bool compact;
 };
 
 static error_t parse_opt(int key, char* arg, struct argp_state* state) {
@@ -66,6 +72,9 @@ static error_t parse_opt(int key, char* arg, struct argp_state* state) {
     case 'd':
         arguments->dry_run = true;
         break;
+    case 'C':
+        arguments->compact = true;
+        break;
     case ARGP_KEY_ARG:
         if (state->arg_num >= NUMBER_OF_ARGS) {
             argp_usage(state);
@@ -108,10 +117,17 @@ int main(int argc, char** argv) {
     }
 
     // Do diff using volume
-    Docker* docker = docker_proxy_new();
-    result = volume_commit(&volume, docker, arguments.dry_run);
-    docker_proxy_free(docker);
+    IoScheduler* io_scheduler = io_scheduler_new(config.io_limits);
+    volume_set_io_scheduler(&volume, io_scheduler);
+    if (arguments.compact) {
+        result = volume_compact(&volume, arguments.dry_run);
+    } else {
+        Docker* docker = docker_proxy_new();
+        result = volume_commit(&volume, docker, arguments.dry_run);
+        docker_proxy_free(docker);
+    }
     volume_release(&volume);
+    io_scheduler_free(io_scheduler);
 
     volumetric_configuration_release(&config);
     return result;
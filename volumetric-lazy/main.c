@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// NAME:            main.c
+//
+// AUTHOR:          Ethan D. Twardy <ethan.twardy@gmail.com>
+//
+// DESCRIPTION:     Entrypoint for the volumetric-lazy utility
+//
+// CREATED:         10/17/2026
+//
+// LAST EDITED:     10/17/2026
+//
+// Copyright 2026, Ethan D. Twardy
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+////
+
+
+#include <argp.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <config.h>
+#include <volumetric/extract-cache.h>
+#include <volumetric/hash.h>
+#include <volumetric/volume/archive.h>
+
+const char* argp_program_version = "volumetric-lazy " CONFIG_VERSION;
+const char* argp_program_bug_address = "<ethan.twardy@gmail.com>";
+static char doc[] =
+    "Publish the archive of a lazily checked out volume, and serve it until "
+    "it's extracted. Started by volumetric-checkout";
+static char args_doc[] = "VOLUME_NAME URL HASH_TYPE HASH";
+static const int NUMBER_OF_ARGS = 4;
+static struct argp_option options[] = {
+    {"extract-cache", 'e', "DIRECTORY", 0,
+     "Extract the archive into the extract cache in DIRECTORY", 0},
+    {"ready-fd", 'r', "FD", 0,
+     "Write a byte to FD once the archive is published", 0},
+    {"sync", 's', "MODE", 0,
+     "Whether the extracted archive is synced to disk: durable (default) or "
+     "none",
+     0},
+    {0},
+};
+
+struct arguments {
+    const char* args[4];
+    const char* extract_cache;
+    int ready_fd;
+    ArchiveSyncMode sync;
+};
+
+static error_t parse_opt(int key, char* arg, struct argp_state* state) {
+    struct arguments* arguments = state->input;
+    switch (key) {
+    case 'e':
+        arguments->extract_cache = arg;
+        break;
+    case 'r':
+        arguments->ready_fd = atoi(arg);
+        break;
+    case 's':
+        if (!strcmp("durable", arg)) {
+            arguments->sync = ARCHIVE_SYNC_DURABLE;
+        } else if (!strcmp("none", arg)) {
+            arguments->sync = ARCHIVE_SYNC_NONE;
+        } else {
+            argp_error(state, "Invalid sync mode: %s", arg);
+        }
+        break;
+    case ARGP_KEY_ARG:
+        if (state->arg_num >= NUMBER_OF_ARGS) {
+            argp_usage(state);
+        }
+
+        arguments->args[state->arg_num] = arg;
+        break;
+    case ARGP_KEY_END:
+        if (state->arg_num < NUMBER_OF_ARGS ||
+            NULL == arguments->extract_cache) {
+            argp_usage(state);
+        }
+
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+
+    return 0;
+}
+
+static struct argp argp = {options, parse_opt, args_doc, doc, 0, 0, 0};
+int main(int argc, char** argv) {
+    struct arguments arguments = {0};
+    arguments.ready_fd = -1;
+    argp_parse(&argp, argc, argv, 0, 0, &arguments);
+
+    FileHashType hash_type = file_hash_type_from_string(arguments.args[2]);
+    if (FILE_HASH_TYPE_INVALID == hash_type) {
+        return EINVAL;
+    }
+    ExtractCache* cache =
+        extract_cache_new(arguments.extract_cache, UINT64_MAX);
+    if (NULL == cache) {
+        return EIO;
+    }
+
+    // Only what's needed to serve the archive is passed on the command line.
+    ArchiveVolume volume = {0};
+    archive_volume_defaults(&volume);
+    volume.name = strdup(arguments.args[0]);
+    volume.url = strdup(arguments.args[1]);
+    volume.hash = file_hash_from_string(hash_type, arguments.args[3]);
+    volume.checkout = ARCHIVE_CHECKOUT_LAZY;
+    volume.sync = arguments.sync;
+    volume.cache = cache;
+
+    int result = archive_volume_serve_lazy(&volume, arguments.ready_fd);
+    archive_volume_release(&volume);
+    extract_cache_free(cache);
+    return -result;
+}
+
+///////////////////////////////////////////////////////////////////////////////